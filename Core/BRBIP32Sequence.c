@@ -350,6 +350,18 @@ size_t BRBIP32PubKey(uint8_t *pubKey, size_t pubKeyLen, BRMasterPubKey mpk, uint
 	return (!pubKey || sizeof(BRECPoint) <= pubKeyLen) ? sizeof(BRECPoint) : 0;
 }
 
+// returns the extended public key for path N(m/0H/chain), only pubKey and chainCode are set
+BRMasterPubKey BRBIP32ChainPubKey(BRMasterPubKey mpk, uint32_t chain) {
+	BRMasterPubKey cpk = BR_MASTER_PUBKEY_NONE;
+
+	assert(memcmp(&mpk, &BR_MASTER_PUBKEY_NONE, sizeof(mpk)) != 0);
+
+	cpk.chainCode = mpk.chainCode;
+	memcpy(cpk.pubKey, mpk.pubKey, sizeof(cpk.pubKey));
+	_CKDpub((BRECPoint *) cpk.pubKey, &cpk.chainCode, chain); // path N(m/0H/chain)
+	return cpk;
+}
+
 // sets the private key for path m/0H/chain/index to key
 void BRBIP32PrivKey(BRKey *key, const void *seed, size_t seedLen, uint32_t chain, uint32_t index) {
 	UInt256 chainCode;
@@ -61,6 +61,10 @@ BRMasterPubKey BRBIP32MasterPubKey(const void *seed, size_t seedLen);
 // returns number of bytes written, or pubKeyLen needed if pubKey is NULL
 size_t BRBIP32PubKey(uint8_t *pubKey, size_t pubKeyLen, BRMasterPubKey mpk, uint32_t chain, uint32_t index);
 
+// returns the extended public key for path N(m/0H/chain), only pubKey and chainCode are set; the keys of the chain
+// then derive with BRBIP32PubKeyPath(pubKey, pubKeyLen, chainPubKey, 1, index) in a single CKD step
+BRMasterPubKey BRBIP32ChainPubKey(BRMasterPubKey mpk, uint32_t chain);
+
 // sets the private key for path m/0H/chain/index to key
 void BRBIP32PrivKey(BRKey *key, const void *seed, size_t seedLen, uint32_t chain, uint32_t index);
 
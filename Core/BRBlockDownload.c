@@ -0,0 +1,254 @@
+// Copyright (c) 2012-2018 The Elastos Open Source Project
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include "BRBlockDownload.h"
+#include "BRSet.h"
+#include "BRArray.h"
+#include <stdlib.h>
+#include <assert.h>
+
+typedef struct _BRBlockWindow _BRBlockWindow;
+
+typedef struct {
+    UInt256 hash; // must be first, items are looked up by hash
+    _BRBlockWindow *window;
+    int received;
+} _BRBlockItem;
+
+struct _BRBlockWindow {
+    const BRPeer *peer; // NULL while nobody is downloading the window
+    double requestTime; // time of the request or of the last block received since
+    size_t count, receivedCount;
+    _BRBlockItem items[]; // windowSize items, never reallocated so the item index can point into them
+};
+
+struct BRBlockDownloadStruct {
+    size_t windowSize, peerWindows, pendingCount;
+    double stallTimeout;
+    _BRBlockWindow **windows; // in chain order, a window is removed once all its blocks are received
+    BRSet *items; // queued items indexed by block hash
+    BRSet *held; // blocks waiting for their parent indexed by prevBlock
+};
+
+static size_t _BRBlockItemHash(const void *item)
+{
+    return (size_t)((const UInt256 *)item)->u32[0];
+}
+
+static int _BRBlockItemEq(const void *item, const void *otherItem)
+{
+    return UInt256Eq((const UInt256 *)item, (const UInt256 *)otherItem);
+}
+
+static size_t _BRHeldBlockHash(const void *block)
+{
+    return (size_t)((const BRMerkleBlock *)block)->prevBlock.u32[0];
+}
+
+static int _BRHeldBlockEq(const void *block, const void *otherBlock)
+{
+    return UInt256Eq(&((const BRMerkleBlock *)block)->prevBlock, &((const BRMerkleBlock *)otherBlock)->prevBlock);
+}
+
+static void _BRBlockDownloadRemoveWindow(BRBlockDownload *download, size_t index)
+{
+    _BRBlockWindow *window = download->windows[index];
+
+    for (size_t i = 0; i < window->count; i++) {
+        if (! window->items[i].received) download->pendingCount--;
+        BRSetRemove(download->items, &window->items[i]);
+    }
+
+    array_rm(download->windows, index);
+    free(window);
+}
+
+static void _BRBlockDownloadFreeHeld(BRBlockDownload *download, void *info,
+                                     void (*blockFree)(void *info, BRMerkleBlock *block))
+{
+    BRMerkleBlock *block;
+
+    while ((block = BRSetIterate(download->held, NULL)) != NULL) {
+        BRSetRemove(download->held, block);
+        if (blockFree) blockFree(info, block);
+    }
+}
+
+// returns a newly allocated block download that must be freed by calling BRBlockDownloadFree()
+BRBlockDownload *BRBlockDownloadNew(size_t windowSize, size_t peerWindows, double stallTimeout)
+{
+    BRBlockDownload *download = calloc(1, sizeof(*download));
+
+    assert(download != NULL);
+    assert(windowSize > 0);
+    assert(peerWindows > 0);
+    download->windowSize = windowSize;
+    download->peerWindows = peerWindows;
+    download->stallTimeout = stallTimeout;
+    array_new(download->windows, 100);
+    download->items = BRSetNew(_BRBlockItemHash, _BRBlockItemEq, 1000);
+    download->held = BRSetNew(_BRHeldBlockHash, _BRHeldBlockEq, 100);
+    return download;
+}
+
+// queues block hashes in chain order, hashes that are already queued are skipped, returns the number queued
+size_t BRBlockDownloadAddHashes(BRBlockDownload *download, const UInt256 hashes[], size_t hashesCount)
+{
+    _BRBlockWindow *window = NULL;
+    _BRBlockItem *item;
+    size_t count = 0;
+
+    assert(download != NULL);
+    assert(hashes != NULL || hashesCount == 0);
+    if (array_count(download->windows) > 0) window = download->windows[array_count(download->windows) - 1];
+
+    for (size_t i = 0; i < hashesCount; i++) {
+        if (BRSetContains(download->items, &hashes[i])) continue;
+
+        if (! window || window->peer || window->count == download->windowSize) { // only fill windows not requested
+            window = calloc(1, sizeof(*window) + download->windowSize*sizeof(*window->items));
+            assert(window != NULL);
+            array_add(download->windows, window);
+        }
+
+        item = &window->items[window->count++];
+        item->hash = hashes[i];
+        item->window = window;
+        BRSetAdd(download->items, item);
+        download->pendingCount++;
+        count++;
+    }
+
+    return count;
+}
+
+// assigns peer the first window nobody is downloading, or failing that the first window another peer has stalled on,
+// and writes the hashes still missing from it to hashes; returns 0 when there's nothing for peer to request, or it
+// already has peerWindows windows outstanding
+size_t BRBlockDownloadNextWindow(BRBlockDownload *download, const BRPeer *peer, double now, UInt256 hashes[],
+                                 size_t hashesCount)
+{
+    _BRBlockWindow *window = NULL, *stalled = NULL;
+    size_t outstanding = 0, count = 0;
+
+    assert(download != NULL);
+    assert(peer != NULL);
+    assert(hashes != NULL || hashesCount == 0);
+
+    for (size_t i = 0; i < array_count(download->windows); i++) {
+        _BRBlockWindow *w = download->windows[i];
+
+        if (w->peer == peer) outstanding++;
+        else if (! w->peer) { if (! window) window = w; }
+        else if (! stalled && w->requestTime + download->stallTimeout < now) stalled = w;
+    }
+
+    if (outstanding >= download->peerWindows) return 0;
+    if (! window) window = stalled;
+    if (! window) return 0;
+    window->peer = peer;
+    window->requestTime = now;
+
+    for (size_t i = 0; i < window->count && count < hashesCount; i++) {
+        if (! window->items[i].received) hashes[count++] = window->items[i].hash;
+    }
+
+    return count;
+}
+
+// marks the block with the given hash received, returns true if it was queued and hadn't been received yet
+int BRBlockDownloadReceived(BRBlockDownload *download, UInt256 blockHash, double now)
+{
+    _BRBlockItem *item;
+    _BRBlockWindow *window;
+
+    assert(download != NULL);
+    item = BRSetGet(download->items, &blockHash);
+    if (! item || item->received) return 0;
+
+    window = item->window;
+    item->received = 1;
+    window->receivedCount++;
+    window->requestTime = now; // the peer is making progress, don't count the window as stalled
+    download->pendingCount--;
+
+    if (window->receivedCount == window->count) {
+        for (size_t i = array_count(download->windows); i > 0; i--) {
+            if (download->windows[i - 1] != window) continue;
+            _BRBlockDownloadRemoveWindow(download, i - 1);
+            break;
+        }
+    }
+
+    return 1;
+}
+
+// hands the windows assigned to peer back to the queue, call when the peer disconnects or can't serve them
+void BRBlockDownloadReleasePeer(BRBlockDownload *download, const BRPeer *peer)
+{
+    assert(download != NULL);
+
+    for (size_t i = 0; i < array_count(download->windows); i++) {
+        if (download->windows[i]->peer == peer) download->windows[i]->peer = NULL;
+    }
+}
+
+// number of queued blocks that haven't been received yet
+size_t BRBlockDownloadPendingCount(const BRBlockDownload *download)
+{
+    assert(download != NULL);
+    return download->pendingCount;
+}
+
+// holds a block that arrived before its parent, returns a held block with the same parent that it replaces, if any
+BRMerkleBlock *BRBlockDownloadHoldBlock(BRBlockDownload *download, BRMerkleBlock *block)
+{
+    BRMerkleBlock *replaced;
+
+    assert(download != NULL);
+    assert(block != NULL);
+    replaced = BRSetAdd(download->held, block);
+    return (replaced != block) ? replaced : NULL;
+}
+
+// removes and returns the held block whose parent is prevBlock, or NULL if there's none
+BRMerkleBlock *BRBlockDownloadNextBlock(BRBlockDownload *download, UInt256 prevBlock)
+{
+    BRMerkleBlock key;
+
+    assert(download != NULL);
+    if (BRSetCount(download->held) == 0) return NULL;
+    key.prevBlock = prevBlock;
+    return BRSetRemove(download->held, &key);
+}
+
+// number of blocks held waiting for their parent
+size_t BRBlockDownloadHeldCount(const BRBlockDownload *download)
+{
+    assert(download != NULL);
+    return BRSetCount(download->held);
+}
+
+// forgets all queued hashes and frees the held blocks with blockFree
+void BRBlockDownloadClear(BRBlockDownload *download, void *info, void (*blockFree)(void *info, BRMerkleBlock *block))
+{
+    assert(download != NULL);
+
+    for (size_t i = array_count(download->windows); i > 0; i--) free(download->windows[i - 1]);
+    array_clear(download->windows);
+    BRSetClear(download->items);
+    download->pendingCount = 0;
+    _BRBlockDownloadFreeHeld(download, info, blockFree);
+}
+
+// frees memory allocated for download, and the held blocks with blockFree
+void BRBlockDownloadFree(BRBlockDownload *download, void *info, void (*blockFree)(void *info, BRMerkleBlock *block))
+{
+    assert(download != NULL);
+    BRBlockDownloadClear(download, info, blockFree);
+    array_free(download->windows);
+    BRSetFree(download->items);
+    BRSetFree(download->held);
+    free(download);
+}
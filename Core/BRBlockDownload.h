@@ -0,0 +1,66 @@
+// Copyright (c) 2012-2018 The Elastos Open Source Project
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#ifndef BRBlockDownload_h
+#define BRBlockDownload_h
+
+#include "BRPeer.h"
+#include "BRMerkleBlock.h"
+#include "BRInt.h"
+#include <stddef.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define BLOCK_DOWNLOAD_WINDOW_SIZE   32   // block hashes requested from a peer with one getdata
+#define BLOCK_DOWNLOAD_PEER_WINDOWS  8    // windows a peer may have outstanding at once
+#define BLOCK_DOWNLOAD_STALL_TIMEOUT 10.0 // seconds a window may go without progress before another peer takes it
+
+// The block download splits the block hashes announced during chain sync into windows that are requested from
+// several peers at once. Merkle blocks that arrive ahead of their parent are held until the chain reaches them, so
+// they are still added in height order.
+typedef struct BRBlockDownloadStruct BRBlockDownload;
+
+// returns a newly allocated block download that must be freed by calling BRBlockDownloadFree()
+BRBlockDownload *BRBlockDownloadNew(size_t windowSize, size_t peerWindows, double stallTimeout);
+
+// queues block hashes in chain order, hashes that are already queued are skipped, returns the number queued
+size_t BRBlockDownloadAddHashes(BRBlockDownload *download, const UInt256 hashes[], size_t hashesCount);
+
+// assigns peer the first window nobody is downloading, or failing that the first window another peer has stalled on,
+// and writes the hashes still missing from it to hashes; returns 0 when there's nothing for peer to request, or it
+// already has peerWindows windows outstanding
+size_t BRBlockDownloadNextWindow(BRBlockDownload *download, const BRPeer *peer, double now, UInt256 hashes[],
+                                 size_t hashesCount);
+
+// marks the block with the given hash received, returns true if it was queued and hadn't been received yet
+int BRBlockDownloadReceived(BRBlockDownload *download, UInt256 blockHash, double now);
+
+// hands the windows assigned to peer back to the queue, call when the peer disconnects or can't serve them
+void BRBlockDownloadReleasePeer(BRBlockDownload *download, const BRPeer *peer);
+
+// number of queued blocks that haven't been received yet
+size_t BRBlockDownloadPendingCount(const BRBlockDownload *download);
+
+// holds a block that arrived before its parent, returns a held block with the same parent that it replaces, if any
+BRMerkleBlock *BRBlockDownloadHoldBlock(BRBlockDownload *download, BRMerkleBlock *block);
+
+// removes and returns the held block whose parent is prevBlock, or NULL if there's none
+BRMerkleBlock *BRBlockDownloadNextBlock(BRBlockDownload *download, UInt256 prevBlock);
+
+// number of blocks held waiting for their parent
+size_t BRBlockDownloadHeldCount(const BRBlockDownload *download);
+
+// forgets all queued hashes and frees the held blocks with blockFree
+void BRBlockDownloadClear(BRBlockDownload *download, void *info, void (*blockFree)(void *info, BRMerkleBlock *block));
+
+// frees memory allocated for download, and the held blocks with blockFree
+void BRBlockDownloadFree(BRBlockDownload *download, void *info, void (*blockFree)(void *info, BRMerkleBlock *block));
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // BRBlockDownload_h
@@ -157,6 +157,13 @@ void BRBloomFilterInsertData(BRBloomFilter *filter, const uint8_t *data, size_t
     if (data) filter->elemCount++;
 }
 
+// projected false positive rate of filter once it holds elemCount elements
+double BRBloomFilterFalsePositiveRate(const BRBloomFilter *filter, size_t elemCount)
+{
+    assert(filter != NULL);
+    return pow(1.0 - exp(-(double)filter->hashFuncs*elemCount/(filter->length*8.0)), filter->hashFuncs);
+}
+
 // frees memory allocated for filter
 void BRBloomFilterFree(BRBloomFilter *filter)
 {
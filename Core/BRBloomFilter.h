@@ -71,6 +71,9 @@ int BRBloomFilterContainsData(const BRBloomFilter *filter, const uint8_t *data,
 // add data to filter
 void BRBloomFilterInsertData(BRBloomFilter *filter, const uint8_t *data, size_t dataLen);
 
+// projected false positive rate of filter once it holds elemCount elements
+double BRBloomFilterFalsePositiveRate(const BRBloomFilter *filter, size_t elemCount);
+
 // frees memory allocated for filter
 void BRBloomFilterFree(BRBloomFilter *filter);
 
@@ -110,19 +110,24 @@ void BRSHA1(void *md20, const void *data, size_t len)
 #define s2(x) (ror32((x), 7) ^ ror32((x), 18) ^ ((x) >> 3))
 #define s3(x) (ror32((x), 17) ^ ror32((x), 19) ^ ((x) >> 10))
 
-static void _BRSHA256Compress(uint32_t *r, const uint32_t *x)
+static const uint32_t _BRSHA256K[] = {
+    0x428a2f98, 0x71374491, 0xb5c0fbcf, 0xe9b5dba5, 0x3956c25b, 0x59f111f1, 0x923f82a4, 0xab1c5ed5,
+    0xd807aa98, 0x12835b01, 0x243185be, 0x550c7dc3, 0x72be5d74, 0x80deb1fe, 0x9bdc06a7, 0xc19bf174,
+    0xe49b69c1, 0xefbe4786, 0x0fc19dc6, 0x240ca1cc, 0x2de92c6f, 0x4a7484aa, 0x5cb0a9dc, 0x76f988da,
+    0x983e5152, 0xa831c66d, 0xb00327c8, 0xbf597fc7, 0xc6e00bf3, 0xd5a79147, 0x06ca6351, 0x14292967,
+    0x27b70a85, 0x2e1b2138, 0x4d2c6dfc, 0x53380d13, 0x650a7354, 0x766a0abb, 0x81c2c92e, 0x92722c85,
+    0xa2bfe8a1, 0xa81a664b, 0xc24b8b70, 0xc76c51a3, 0xd192e819, 0xd6990624, 0xf40e3585, 0x106aa070,
+    0x19a4c116, 0x1e376c08, 0x2748774c, 0x34b0bcb5, 0x391c0cb3, 0x4ed8aa4a, 0x5b9cca4f, 0x682e6ff3,
+    0x748f82ee, 0x78a5636f, 0x84c87814, 0x8cc70208, 0x90befffa, 0xa4506ceb, 0xbef9a3f7, 0xc67178f2
+};
+
+static const uint32_t _BRSHA256IV[] = {
+    0x6a09e667, 0xbb67ae85, 0x3c6ef372, 0xa54ff53a, 0x510e527f, 0x9b05688c, 0x1f83d9ab, 0x5be0cd19
+};
+
+static void _BRSHA256CompressGeneric(uint32_t *r, const uint32_t *x)
 {
-    static const uint32_t k[] = {
-        0x428a2f98, 0x71374491, 0xb5c0fbcf, 0xe9b5dba5, 0x3956c25b, 0x59f111f1, 0x923f82a4, 0xab1c5ed5,
-        0xd807aa98, 0x12835b01, 0x243185be, 0x550c7dc3, 0x72be5d74, 0x80deb1fe, 0x9bdc06a7, 0xc19bf174,
-        0xe49b69c1, 0xefbe4786, 0x0fc19dc6, 0x240ca1cc, 0x2de92c6f, 0x4a7484aa, 0x5cb0a9dc, 0x76f988da,
-        0x983e5152, 0xa831c66d, 0xb00327c8, 0xbf597fc7, 0xc6e00bf3, 0xd5a79147, 0x06ca6351, 0x14292967,
-        0x27b70a85, 0x2e1b2138, 0x4d2c6dfc, 0x53380d13, 0x650a7354, 0x766a0abb, 0x81c2c92e, 0x92722c85,
-        0xa2bfe8a1, 0xa81a664b, 0xc24b8b70, 0xc76c51a3, 0xd192e819, 0xd6990624, 0xf40e3585, 0x106aa070,
-        0x19a4c116, 0x1e376c08, 0x2748774c, 0x34b0bcb5, 0x391c0cb3, 0x4ed8aa4a, 0x5b9cca4f, 0x682e6ff3,
-        0x748f82ee, 0x78a5636f, 0x84c87814, 0x8cc70208, 0x90befffa, 0xa4506ceb, 0xbef9a3f7, 0xc67178f2
-    };
-
+    const uint32_t *k = _BRSHA256K;
     int i;
     uint32_t a = r[0], b = r[1], c = r[2], d = r[3], e = r[4], f = r[5], g = r[6], h = r[7], t1, t2, w[64];
 
@@ -140,6 +145,174 @@ static void _BRSHA256Compress(uint32_t *r, const uint32_t *x)
     mem_clean(w, sizeof(w));
 }
 
+#if (defined(__x86_64__) || defined(__i386__)) && (defined(__clang__) || __GNUC__ >= 5)
+#define BR_SHA256_X86 1
+#include <cpuid.h>
+#include <immintrin.h>
+
+// sha-256 with the x86 sha extensions: https://software.intel.com/en-us/articles/intel-sha-extensions
+__attribute__((target("sha,sse4.1,ssse3")))
+static void _BRSHA256CompressSHANI(uint32_t *r, const uint32_t *x)
+{
+    const __m128i mask = _mm_set_epi64x(0x0c0d0e0f08090a0bULL, 0x0405060700010203ULL); // be32 of each word
+    __m128i state0, state1, abef, cdgh, msg, tmp, w[4];
+    int i;
+
+    tmp = _mm_shuffle_epi32(_mm_loadu_si128((const __m128i *)&r[0]), 0xb1); // cdab
+    state1 = _mm_shuffle_epi32(_mm_loadu_si128((const __m128i *)&r[4]), 0x1b); // efgh
+    state0 = _mm_alignr_epi8(tmp, state1, 8); // abef
+    state1 = _mm_blend_epi16(state1, tmp, 0xf0); // cdgh
+    abef = state0, cdgh = state1;
+
+    for (i = 0; i < 16; i++) { // four rounds at a time
+        if (i < 4) w[i] = _mm_shuffle_epi8(_mm_loadu_si128((const __m128i *)&x[i*4]), mask);
+        else {
+            tmp = _mm_sha256msg1_epu32(w[i & 3], w[(i + 1) & 3]);
+            tmp = _mm_add_epi32(tmp, _mm_alignr_epi8(w[(i + 3) & 3], w[(i + 2) & 3], 4));
+            w[i & 3] = _mm_sha256msg2_epu32(tmp, w[(i + 3) & 3]);
+        }
+
+        msg = _mm_add_epi32(w[i & 3], _mm_loadu_si128((const __m128i *)&_BRSHA256K[i*4]));
+        state1 = _mm_sha256rnds2_epu32(state1, state0, msg);
+        state0 = _mm_sha256rnds2_epu32(state0, state1, _mm_shuffle_epi32(msg, 0x0e));
+    }
+
+    state0 = _mm_add_epi32(state0, abef);
+    state1 = _mm_add_epi32(state1, cdgh);
+    tmp = _mm_shuffle_epi32(state0, 0x1b); // feba
+    state1 = _mm_shuffle_epi32(state1, 0xb1); // dchg
+    _mm_storeu_si128((__m128i *)&r[0], _mm_blend_epi16(tmp, state1, 0xf0)); // dcba
+    _mm_storeu_si128((__m128i *)&r[4], _mm_alignr_epi8(state1, tmp, 8)); // hgfe
+}
+
+// eight independent sha-256 compressions, lane i of each word belongs to the i-th message
+#define ror32x8(a, b) _mm256_or_si256(_mm256_srli_epi32((a), (b)), _mm256_slli_epi32((a), 32 - (b)))
+#define chx8(x, y, z) _mm256_xor_si256(_mm256_and_si256((x), (y)), _mm256_andnot_si256((x), (z)))
+#define majx8(x, y, z) _mm256_or_si256(_mm256_and_si256((x), (y)), _mm256_and_si256((z), _mm256_or_si256((x), (y))))
+#define s0x8(x) _mm256_xor_si256(_mm256_xor_si256(ror32x8((x), 2), ror32x8((x), 13)), ror32x8((x), 22))
+#define s1x8(x) _mm256_xor_si256(_mm256_xor_si256(ror32x8((x), 6), ror32x8((x), 11)), ror32x8((x), 25))
+#define s2x8(x) _mm256_xor_si256(_mm256_xor_si256(ror32x8((x), 7), ror32x8((x), 18)), _mm256_srli_epi32((x), 3))
+#define s3x8(x) _mm256_xor_si256(_mm256_xor_si256(ror32x8((x), 17), ror32x8((x), 19)), _mm256_srli_epi32((x), 10))
+
+__attribute__((target("avx2")))
+static void _BRSHA256CompressAVX2(__m256i *r, const __m256i *x)
+{
+    __m256i a = r[0], b = r[1], c = r[2], d = r[3], e = r[4], f = r[5], g = r[6], h = r[7], t1, t2, w[16];
+    int i;
+
+    for (i = 0; i < 16; i++) w[i] = x[i];
+
+    for (i = 0; i < 64; i++) {
+        if (i >= 16) {
+            w[i & 15] = _mm256_add_epi32(_mm256_add_epi32(s3x8(w[(i - 2) & 15]), w[(i - 7) & 15]),
+                                         _mm256_add_epi32(s2x8(w[(i - 15) & 15]), w[i & 15]));
+        }
+
+        t1 = _mm256_add_epi32(_mm256_add_epi32(h, s1x8(e)), _mm256_add_epi32(chx8(e, f, g), w[i & 15]));
+        t1 = _mm256_add_epi32(t1, _mm256_set1_epi32((int)_BRSHA256K[i]));
+        t2 = _mm256_add_epi32(s0x8(a), majx8(a, b, c));
+        h = g, g = f, f = e, e = _mm256_add_epi32(d, t1), d = c, c = b, b = a, a = _mm256_add_epi32(t1, t2);
+    }
+
+    r[0] = _mm256_add_epi32(r[0], a), r[1] = _mm256_add_epi32(r[1], b), r[2] = _mm256_add_epi32(r[2], c);
+    r[3] = _mm256_add_epi32(r[3], d), r[4] = _mm256_add_epi32(r[4], e), r[5] = _mm256_add_epi32(r[5], f);
+    r[6] = _mm256_add_epi32(r[6], g), r[7] = _mm256_add_epi32(r[7], h);
+}
+
+// double-sha-256 of eight 64 byte inputs
+__attribute__((target("avx2")))
+static void _BRSHA256_2_64x8(uint8_t *md32s, const uint8_t *data64s)
+{
+    uint32_t in[8][16], out[8][8], md[8][8];
+    __m256i state[8], mid[8], x[16];
+    int i, j;
+
+    memcpy(in, data64s, sizeof(in));
+    for (i = 0; i < 16; i++) {
+        x[i] = _mm256_set_epi32((int)be32(in[7][i]), (int)be32(in[6][i]), (int)be32(in[5][i]), (int)be32(in[4][i]),
+                                (int)be32(in[3][i]), (int)be32(in[2][i]), (int)be32(in[1][i]), (int)be32(in[0][i]));
+    }
+
+    for (i = 0; i < 8; i++) state[i] = _mm256_set1_epi32((int)_BRSHA256IV[i]);
+    _BRSHA256CompressAVX2(state, x);
+    for (i = 0; i < 16; i++) x[i] = _mm256_setzero_si256(); // the padding block of a 64 byte input
+    x[0] = _mm256_set1_epi32((int)0x80000000), x[15] = _mm256_set1_epi32(64*8);
+    _BRSHA256CompressAVX2(state, x);
+
+    for (i = 0; i < 8; i++) mid[i] = state[i], state[i] = _mm256_set1_epi32((int)_BRSHA256IV[i]);
+    for (i = 0; i < 8; i++) x[i] = mid[i]; // the first digest as big endian words, padded
+    for (; i < 16; i++) x[i] = _mm256_setzero_si256();
+    x[8] = _mm256_set1_epi32((int)0x80000000), x[15] = _mm256_set1_epi32(32*8);
+    _BRSHA256CompressAVX2(state, x);
+
+    for (i = 0; i < 8; i++) _mm256_storeu_si256((__m256i *)out[i], state[i]);
+    for (i = 0; i < 8; i++) {
+        for (j = 0; j < 8; j++) md[i][j] = be32(out[j][i]);
+    }
+
+    memcpy(md32s, md, sizeof(md));
+    mem_clean(in, sizeof(in));
+}
+
+static int _BRSHA256CpuKernels(void)
+{
+    unsigned a, b, c, d, c1;
+    uint32_t xcr0l, xcr0h;
+    int kernels = 0;
+
+    if (__get_cpuid_max(0, NULL) < 7) return 0;
+    __cpuid(1, a, b, c1, d);
+    __cpuid_count(7, 0, a, b, c, d);
+
+    // ssse3, sse4.1, sha
+    if ((c1 & (1 << 9)) && (c1 & (1 << 19)) && (b & (1 << 29))) kernels |= BR_SHA256_SHANI;
+
+    // osxsave, avx, avx2, and the os saving the ymm registers
+    if ((c1 & (1 << 27)) && (c1 & (1 << 28)) && (b & (1 << 5))) {
+        __asm__ ("xgetbv" : "=a"(xcr0l), "=d"(xcr0h) : "c"(0));
+        if ((xcr0l & 0x06) == 0x06) kernels |= BR_SHA256_AVX2;
+    }
+
+    return kernels;
+}
+#endif
+
+static void _BRSHA256CompressResolve(uint32_t *r, const uint32_t *x);
+
+// the kernel BRSHA256() and the like compress with, and the kernels in use, -1 until the first use
+static void (*volatile _BRSHA256Compress)(uint32_t *r, const uint32_t *x) = _BRSHA256CompressResolve;
+static volatile int _BRSHA256Kernels = -1;
+
+static void _BRSHA256CompressResolve(uint32_t *r, const uint32_t *x)
+{
+    BRSHA256Use(BRSHA256Supported());
+    _BRSHA256Compress(r, x);
+}
+
+int BRSHA256Supported(void)
+{
+#ifdef BR_SHA256_X86
+    static volatile int supported = -1;
+
+    if (supported < 0) supported = _BRSHA256CpuKernels();
+    return supported;
+#else
+    return 0;
+#endif
+}
+
+int BRSHA256Use(int kernels)
+{
+    kernels &= BRSHA256Supported();
+#ifdef BR_SHA256_X86
+    _BRSHA256Compress = (kernels & BR_SHA256_SHANI) ? _BRSHA256CompressSHANI : _BRSHA256CompressGeneric;
+#else
+    _BRSHA256Compress = _BRSHA256CompressGeneric;
+#endif
+    _BRSHA256Kernels = kernels;
+    return kernels;
+}
+
 void BRSHA224(void *md28, const void *data, size_t len) {
     size_t i;
     uint32_t x[16], buf[] = { 0xc1059ed8, 0x367cd507, 0x3070dd17, 0xf70e5939, 0xffc00b31, 0x68581511,
@@ -202,6 +375,26 @@ void BRSHA256_2(void *md32, const void *data, size_t len)
     BRSHA256(md32, t, sizeof(t));
 }
 
+// double-sha-256 of count independent 64 byte inputs, such as the pairs of a merkle tree level
+void BRSHA256_2_64(void *md32s, const void *data64s, size_t count)
+{
+    size_t i = 0;
+    int kernels = _BRSHA256Kernels;
+
+    assert(md32s != NULL || count == 0);
+    assert(data64s != NULL || count == 0);
+    if (kernels < 0) kernels = BRSHA256Use(BRSHA256Supported());
+
+#ifdef BR_SHA256_X86
+    // eight avx2 lanes keep up with a sha extensions stream, the rest goes through the compress kernel
+    if (kernels & BR_SHA256_AVX2) {
+        for (; i + 8 <= count; i += 8) _BRSHA256_2_64x8((uint8_t *)md32s + i*32, (const uint8_t *)data64s + i*64);
+    }
+#endif
+
+    for (; i < count; i++) BRSHA256_2((uint8_t *)md32s + i*32, (const uint8_t *)data64s + i*64, 64);
+}
+
 // bitwise right rotation
 #define ror64(a, b) (((a) >> (b)) | ((a) << (64 - (b))))
 
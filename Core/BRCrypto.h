@@ -44,6 +44,20 @@ void BRSHA224(void *md28, const void *data, size_t len);
 // double-sha-256 = sha-256(sha-256(x))
 void BRSHA256_2(void *md32, const void *data, size_t len);
 
+// double-sha-256 of count independent 64 byte inputs, written to md32s as count consecutive 32 byte digests
+void BRSHA256_2_64(void *md32s, const void *data64s, size_t count);
+
+// hardware sha-256 kernels, picked at first use from what the cpu supports
+#define BR_SHA256_SHANI 0x01 // x86 sha extensions
+#define BR_SHA256_AVX2  0x02 // eight inputs at a time, for BRSHA256_2_64() only
+
+// the BR_SHA256_* kernels the cpu supports
+int BRSHA256Supported(void);
+
+// restricts sha-256 to the given supported kernels, 0 for the portable code only, returns the kernels in use
+// not thread safe, for tests and benchmarks
+int BRSHA256Use(int kernels);
+
 void BRSHA384(void *md48, const void *data, size_t len);
 
 void BRSHA512(void *md64, const void *data, size_t len);
@@ -25,6 +25,7 @@
 #include "BRMerkleBlock.h"
 #include "BRCrypto.h"
 #include "BRAddress.h"
+#include "BRArray.h"
 #include <stdlib.h>
 #include <inttypes.h>
 #include <limits.h>
@@ -183,41 +184,65 @@ size_t BRMerkleBlockSerialize(const BRMerkleBlock *block, uint8_t *buf, size_t b
     return (! buf || len <= bufLen) ? len : 0;
 }
 
-static size_t _BRMerkleBlockTxHashesR(const BRMerkleBlock *block, UInt256 *txHashes, size_t hashesCount, size_t *idx,
-                                      size_t *hashIdx, size_t *flagIdx, int depth)
+// deepest level a partial merkle tree can have, for 2^32 transactions
+#define MERKLE_MAX_DEPTH 32
+
+// a node of a partial merkle tree, internal nodes get their hash from the level below
+typedef struct {
+    UInt256 hash;
+    int internal;
+} _BRMerkleNode;
+
+// walks the partial merkle tree in the depth-first order it is serialized in, without recursion, appending each node to
+// the array of its level if levels isn't NULL, and populating txHashes with up to hashesCount matched tx hashes
+// nodes past the end of the hashes or flags are missing and have a zero hash, as a missing right branch has
+static size_t _BRMerkleBlockWalk(const BRMerkleBlock *block, _BRMerkleNode **levels, UInt256 *txHashes,
+                                 size_t hashesCount)
 {
+    size_t hashIdx = 0, flagIdx = 0, idx = 0, n = 0;
+    int depth, maxDepth = _ceil_log2(block->totalTx), stack[2*MERKLE_MAX_DEPTH + 1];
     uint8_t flag;
 
-    if (*flagIdx/8 < block->flagsLen && *hashIdx < block->hashesCount) {
-        flag = (block->flags[*flagIdx/8] & (1 << (*flagIdx % 8)));
-        (*flagIdx)++;
+    if (maxDepth > MERKLE_MAX_DEPTH) maxDepth = MERKLE_MAX_DEPTH;
+    stack[n++] = 0;
 
-        if (! flag || depth == _ceil_log2(block->totalTx)) {
-            if (flag && *idx < hashesCount) {
-                if (txHashes) txHashes[*idx] = block->hashes[*hashIdx]; // leaf
-                (*idx)++;
-            }
+    while (n > 0) { // both children of a node are at the same depth, so the stack only holds depths
+        _BRMerkleNode node = { UINT256_ZERO, 0 };
 
-            (*hashIdx)++;
-        }
-        else {
-            _BRMerkleBlockTxHashesR(block, txHashes, hashesCount, idx, hashIdx, flagIdx, depth + 1); // left branch
-            _BRMerkleBlockTxHashesR(block, txHashes, hashesCount, idx, hashIdx, flagIdx, depth + 1); // right branch
+        depth = stack[--n];
+
+        if (flagIdx/8 < block->flagsLen && hashIdx < block->hashesCount) {
+            flag = (block->flags[flagIdx/8] & (1 << (flagIdx % 8)));
+            flagIdx++;
+
+            if (! flag || depth == maxDepth) {
+                node.hash = block->hashes[hashIdx++]; // leaf
+
+                if (flag && idx < hashesCount) {
+                    if (txHashes) txHashes[idx] = node.hash;
+                    idx++;
+                }
+            }
+            else { // left and right branch
+                node.internal = 1;
+                stack[n++] = depth + 1;
+                stack[n++] = depth + 1;
+            }
         }
+
+        if (levels) array_add(levels[depth], node);
     }
 
-    return *idx;
+    return idx;
 }
 
 // populates txHashes with the matched tx hashes in the block
 // returns number of hashes written, or the total hashesCount needed if txHashes is NULL
 size_t BRMerkleBlockTxHashes(const BRMerkleBlock *block, UInt256 *txHashes, size_t hashesCount)
 {
-    size_t idx = 0, hashIdx = 0, flagIdx = 0;
-
     assert(block != NULL);
 
-    return _BRMerkleBlockTxHashesR(block, txHashes, (txHashes) ? hashesCount : SIZE_MAX, &idx, &hashIdx, &flagIdx, 0);
+    return _BRMerkleBlockWalk(block, NULL, txHashes, (txHashes) ? hashesCount : SIZE_MAX);
 }
 
 // sets the hashes and flags fields for a block created with BRMerkleBlockNew()
@@ -236,32 +261,57 @@ void BRMerkleBlockSetTxHashes(BRMerkleBlock *block, const UInt256 hashes[], size
     if (block->flags) memcpy(block->flags, flags, flagsLen);
 }
 
-// recursively walks the merkle tree to calculate the merkle root
+// calculates the merkle root of the partial merkle tree a level at a time, from the leaves up, hashing all the sibling
+// pairs of a level in one batch, and populates txHashes with the matched tx hashes in the same walk
 // NOTE: this merkle tree design has a security vulnerability (CVE-2012-2459), which can be defended against by
 // considering the merkle root invalid if there are duplicate hashes in any rows with an even number of elements
-static UInt256 _BRMerkleBlockRootR(const BRMerkleBlock *block, size_t *hashIdx, size_t *flagIdx, int depth)
+UInt256 BRMerkleBlockRoot(const BRMerkleBlock *block, UInt256 *txHashes, size_t hashesCount, size_t *txCount)
 {
-    uint8_t flag;
-    UInt256 hashes[2], md = UINT256_ZERO;
+    _BRMerkleNode *levels[MERKLE_MAX_DEPTH + 1];
+    UInt256 (*pairs)[2] = NULL, *mds = NULL, root = UINT256_ZERO;
+    size_t i, j, child, count, pairsCount = 0;
+    int depth, valid = 1;
 
-    if (*flagIdx/8 < block->flagsLen && *hashIdx < block->hashesCount) {
-        flag = (block->flags[*flagIdx/8] & (1 << (*flagIdx % 8)));
-        (*flagIdx)++;
+    assert(block != NULL);
 
-        if (flag && depth != _ceil_log2(block->totalTx)) {
-            hashes[0] = _BRMerkleBlockRootR(block, hashIdx, flagIdx, depth + 1); // left branch
-            hashes[1] = _BRMerkleBlockRootR(block, hashIdx, flagIdx, depth + 1); // right branch
+    for (depth = 0; depth <= MERKLE_MAX_DEPTH; depth++) array_new(levels[depth], 0);
+    count = _BRMerkleBlockWalk(block, levels, txHashes, (txHashes) ? hashesCount : SIZE_MAX);
+    if (txCount) *txCount = count;
 
-            if (! UInt256IsZero(&hashes[0]) && ! UInt256Eq(&(hashes[0]), &(hashes[1]))) {
-                if (UInt256IsZero(&hashes[1])) hashes[1] = hashes[0]; // if right branch is missing, dup left branch
-                BRSHA256_2(&md, hashes, sizeof(hashes));
-            }
-            else *hashIdx = SIZE_MAX; // defend against (CVE-2012-2459)
+    for (depth = 0; depth < MERKLE_MAX_DEPTH; depth++) {
+        if (array_count(levels[depth + 1]) / 2 > pairsCount) pairsCount = array_count(levels[depth + 1]) / 2;
+    }
+
+    if (pairsCount > 0) {
+        pairs = malloc(pairsCount*sizeof(*pairs));
+        mds = malloc(pairsCount*sizeof(*mds));
+        assert(pairs != NULL && mds != NULL);
+    }
+
+    for (depth = MERKLE_MAX_DEPTH - 1; valid && depth >= 0; depth--) {
+        for (i = 0, j = 0, child = 0; valid && i < array_count(levels[depth]); i++) {
+            if (! levels[depth][i].internal) continue;
+            pairs[j][0] = levels[depth + 1][child++].hash; // left branch
+            pairs[j][1] = levels[depth + 1][child++].hash; // right branch
+
+            if (UInt256IsZero(&pairs[j][0]) || UInt256Eq(&pairs[j][0], &pairs[j][1])) valid = 0; // (CVE-2012-2459)
+            if (UInt256IsZero(&pairs[j][1])) pairs[j][1] = pairs[j][0]; // if right branch is missing, dup left branch
+            j++;
+        }
+
+        if (! valid || j == 0) continue;
+        BRSHA256_2_64(mds, pairs, j);
+
+        for (i = 0, j = 0; i < array_count(levels[depth]); i++) {
+            if (levels[depth][i].internal) levels[depth][i].hash = mds[j++];
         }
-        else md = block->hashes[(*hashIdx)++]; // leaf
     }
 
-    return md;
+    if (valid && array_count(levels[0]) > 0) root = levels[0][0].hash;
+    for (depth = 0; depth <= MERKLE_MAX_DEPTH; depth++) array_free(levels[depth]);
+    if (pairs) free(pairs);
+    if (mds) free(mds);
+    return root;
 }
 
 // true if merkle tree and timestamp are valid, and proof-of-work matches the stated difficulty target
@@ -275,8 +325,7 @@ int BRMerkleBlockIsValid(const BRMerkleBlock *block, uint32_t currentTime)
     // bit is the sign, and the remaining 23bits is the value after having been right shifted by (size - 3)*8 bits
     static const uint32_t maxsize = MAX_PROOF_OF_WORK >> 24, maxtarget = MAX_PROOF_OF_WORK & 0x00ffffff;
     const uint32_t size = block->target >> 24, target = block->target & 0x00ffffff;
-    size_t hashIdx = 0, flagIdx = 0;
-    UInt256 merkleRoot = _BRMerkleBlockRootR(block, &hashIdx, &flagIdx, 0), t = UINT256_ZERO;
+    UInt256 merkleRoot = BRMerkleBlockRoot(block, NULL, 0, NULL), t = UINT256_ZERO;
     int r = 1;
 
     // check if merkle root is correct
@@ -73,6 +73,11 @@ size_t BRMerkleBlockSerialize(const BRMerkleBlock *block, uint8_t *buf, size_t b
 // returns number of tx hashes written, or the total hashesCount needed if txHashes is NULL
 size_t BRMerkleBlockTxHashes(const BRMerkleBlock *block, UInt256 *txHashes, size_t hashesCount);
 
+// calculates the merkle root of the block's partial merkle tree a level at a time, and populates txHashes, which may be
+// NULL, with up to hashesCount matched tx hashes in the same walk, setting txCount to the number found if not NULL
+// returns UINT256_ZERO if the tree is malformed
+UInt256 BRMerkleBlockRoot(const BRMerkleBlock *block, UInt256 *txHashes, size_t hashesCount, size_t *txCount);
+
 // sets the hashes and flags fields for a block created with BRMerkleBlockNew()
 void BRMerkleBlockSetTxHashes(BRMerkleBlock *block, const UInt256 hashes[], size_t hashesCount,
                               const uint8_t *flags, size_t flagsLen);
@@ -0,0 +1,287 @@
+// Copyright (c) 2012-2018 The Elastos Open Source Project
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include "BROrphanPool.h"
+#include "BRSet.h"
+#include "BRArray.h"
+#include <stdlib.h>
+#include <assert.h>
+
+typedef struct _BROrphan _BROrphan;
+
+struct _BROrphan {
+    UInt256 prevBlock; // must be first, orphans are looked up by prevBlock
+    BRMerkleBlock *block;
+    const BRPeer *peer;
+    size_t size;
+    _BROrphan *older, *newer;
+};
+
+typedef struct {
+    const BRPeer *peer;
+    size_t count, bytes;
+} _BROrphanPeer;
+
+struct BROrphanPoolStruct {
+    size_t maxCount, maxBytes, peerMaxCount, peerMaxBytes, bytes, evictedCount;
+    BRSet *orphans; // orphans indexed by prevBlock
+    _BROrphan *oldest, *newest; // orphans in the order they were added
+    _BROrphanPeer *peers; // orphan count and size for each peer that has orphans in the pool
+};
+
+static size_t _BROrphanHash(const void *orphan)
+{
+    return (size_t)((const UInt256 *)orphan)->u32[0];
+}
+
+static int _BROrphanEq(const void *orphan, const void *otherOrphan)
+{
+    return UInt256Eq((const UInt256 *)orphan, (const UInt256 *)otherOrphan);
+}
+
+// approximate memory taken up by block, enough to tell a block full of hashes from a bare header
+static size_t _BROrphanSize(const BRMerkleBlock *block)
+{
+    return sizeof(*block) + block->hashesCount*sizeof(*block->hashes) + block->flagsLen;
+}
+
+static _BROrphanPeer *_BROrphanPoolPeer(const BROrphanPool *pool, const BRPeer *peer)
+{
+    for (size_t i = array_count(pool->peers); i > 0; i--) {
+        if (pool->peers[i - 1].peer == peer) return &pool->peers[i - 1];
+    }
+
+    return NULL;
+}
+
+// unlinks orphan and frees it, but not its block
+static void _BROrphanPoolUnlink(BROrphanPool *pool, _BROrphan *orphan)
+{
+    _BROrphanPeer *peer = _BROrphanPoolPeer(pool, orphan->peer);
+
+    assert(peer != NULL);
+    BRSetRemove(pool->orphans, orphan);
+    if (orphan->older) orphan->older->newer = orphan->newer;
+    else pool->oldest = orphan->newer;
+    if (orphan->newer) orphan->newer->older = orphan->older;
+    else pool->newest = orphan->older;
+    pool->bytes -= orphan->size;
+    peer->count--;
+    peer->bytes -= orphan->size;
+    if (peer->count == 0) array_rm(pool->peers, peer - pool->peers);
+    free(orphan);
+}
+
+static void _BROrphanPoolEvict(BROrphanPool *pool, _BROrphan *orphan, void *info,
+                               void (*blockFree)(void *info, BRMerkleBlock *block))
+{
+    BRMerkleBlock *block = orphan->block;
+
+    _BROrphanPoolUnlink(pool, orphan);
+    pool->evictedCount++;
+    if (blockFree) blockFree(info, block);
+}
+
+// frees the oldest orphans of peers over their share, then the oldest of all until pool is within its limits
+static void _BROrphanPoolTrim(BROrphanPool *pool, void *info, void (*blockFree)(void *info, BRMerkleBlock *block))
+{
+    _BROrphan *orphan = pool->oldest, *next;
+
+    while (orphan) {
+        _BROrphanPeer *peer = _BROrphanPoolPeer(pool, orphan->peer);
+
+        next = orphan->newer;
+        if (peer->count > pool->peerMaxCount || peer->bytes > pool->peerMaxBytes) {
+            _BROrphanPoolEvict(pool, orphan, info, blockFree);
+        }
+        orphan = next;
+    }
+
+    while (pool->oldest && (BRSetCount(pool->orphans) > pool->maxCount || pool->bytes > pool->maxBytes)) {
+        _BROrphanPoolEvict(pool, pool->oldest, info, blockFree);
+    }
+}
+
+// returns a newly allocated orphan pool that must be freed by calling BROrphanPoolFree()
+BROrphanPool *BROrphanPoolNew(size_t maxCount, size_t maxBytes, size_t peerMaxCount, size_t peerMaxBytes)
+{
+    BROrphanPool *pool = calloc(1, sizeof(*pool));
+
+    assert(pool != NULL);
+    pool->maxCount = maxCount;
+    pool->maxBytes = maxBytes;
+    pool->peerMaxCount = peerMaxCount;
+    pool->peerMaxBytes = peerMaxBytes;
+    pool->orphans = BRSetNew(_BROrphanHash, _BROrphanEq, 100);
+    array_new(pool->peers, 10);
+    return pool;
+}
+
+// changes the limits of pool, orphans that no longer fit are freed with blockFree
+void BROrphanPoolSetLimits(BROrphanPool *pool, size_t maxCount, size_t maxBytes, size_t peerMaxCount,
+                           size_t peerMaxBytes, void *info, void (*blockFree)(void *info, BRMerkleBlock *block))
+{
+    assert(pool != NULL);
+    pool->maxCount = maxCount;
+    pool->maxBytes = maxBytes;
+    pool->peerMaxCount = peerMaxCount;
+    pool->peerMaxBytes = peerMaxBytes;
+    _BROrphanPoolTrim(pool, info, blockFree);
+}
+
+// adds block relayed by peer, or by no peer if it's NULL, replacing an orphan with the same prevBlock; orphans that no
+// longer fit are freed with blockFree, returns false if that included block itself
+int BROrphanPoolAdd(BROrphanPool *pool, BRMerkleBlock *block, const BRPeer *peer, void *info,
+                    void (*blockFree)(void *info, BRMerkleBlock *block))
+{
+    _BROrphan *orphan;
+    _BROrphanPeer *orphanPeer, newPeer = { peer, 0, 0 };
+
+    assert(pool != NULL);
+    assert(block != NULL);
+    orphan = BRSetGet(pool->orphans, &block->prevBlock);
+
+    if (orphan) {
+        BRMerkleBlock *replaced = orphan->block;
+
+        _BROrphanPoolUnlink(pool, orphan);
+        if (replaced != block && blockFree) blockFree(info, replaced);
+    }
+
+    orphan = calloc(1, sizeof(*orphan));
+    assert(orphan != NULL);
+    orphan->prevBlock = block->prevBlock;
+    orphan->block = block;
+    orphan->peer = peer;
+    orphan->size = _BROrphanSize(block);
+    orphan->older = pool->newest;
+    if (pool->newest) pool->newest->newer = orphan;
+    else pool->oldest = orphan;
+    pool->newest = orphan;
+    BRSetAdd(pool->orphans, orphan);
+    pool->bytes += orphan->size;
+
+    orphanPeer = _BROrphanPoolPeer(pool, peer);
+
+    if (! orphanPeer) {
+        array_add(pool->peers, newPeer);
+        orphanPeer = &pool->peers[array_count(pool->peers) - 1];
+    }
+
+    orphanPeer->count++;
+    orphanPeer->bytes += orphan->size;
+    _BROrphanPoolTrim(pool, info, blockFree);
+    return (pool->newest && pool->newest->block == block);
+}
+
+// removes and returns the orphan whose parent is prevBlock, or NULL if there's none
+BRMerkleBlock *BROrphanPoolNextBlock(BROrphanPool *pool, UInt256 prevBlock)
+{
+    _BROrphan *orphan;
+    BRMerkleBlock *block = NULL;
+
+    assert(pool != NULL);
+    orphan = BRSetGet(pool->orphans, &prevBlock);
+
+    if (orphan) {
+        block = orphan->block;
+        _BROrphanPoolUnlink(pool, orphan);
+    }
+
+    return block;
+}
+
+// removes block from pool without freeing it, returns true if it was in the pool
+int BROrphanPoolRemove(BROrphanPool *pool, const BRMerkleBlock *block)
+{
+    _BROrphan *orphan;
+
+    assert(pool != NULL);
+    assert(block != NULL);
+    orphan = BRSetGet(pool->orphans, &block->prevBlock);
+    if (! orphan || orphan->block != block) return 0;
+    _BROrphanPoolUnlink(pool, orphan);
+    return 1;
+}
+
+// the orphan added last, or NULL if pool is empty
+BRMerkleBlock *BROrphanPoolNewest(const BROrphanPool *pool)
+{
+    assert(pool != NULL);
+    return (pool->newest) ? pool->newest->block : NULL;
+}
+
+// frees the orphans relayed by peer with blockFree, call when the peer disconnects
+void BROrphanPoolRemovePeer(BROrphanPool *pool, const BRPeer *peer, void *info,
+                            void (*blockFree)(void *info, BRMerkleBlock *block))
+{
+    _BROrphan *orphan, *next;
+
+    assert(pool != NULL);
+
+    for (orphan = pool->oldest; orphan && _BROrphanPoolPeer(pool, peer); orphan = next) {
+        next = orphan->newer;
+
+        if (orphan->peer == peer) {
+            BRMerkleBlock *block = orphan->block;
+
+            _BROrphanPoolUnlink(pool, orphan);
+            if (blockFree) blockFree(info, block);
+        }
+    }
+}
+
+// number of orphans in pool
+size_t BROrphanPoolCount(const BROrphanPool *pool)
+{
+    assert(pool != NULL);
+    return BRSetCount(pool->orphans);
+}
+
+// approximate memory taken up by the orphans in pool
+size_t BROrphanPoolBytes(const BROrphanPool *pool)
+{
+    assert(pool != NULL);
+    return pool->bytes;
+}
+
+// number of orphans in pool relayed by peer
+size_t BROrphanPoolPeerCount(const BROrphanPool *pool, const BRPeer *peer)
+{
+    _BROrphanPeer *orphanPeer;
+
+    assert(pool != NULL);
+    orphanPeer = _BROrphanPoolPeer(pool, peer);
+    return (orphanPeer) ? orphanPeer->count : 0;
+}
+
+// number of orphans freed to keep pool within its limits since it was created
+size_t BROrphanPoolEvictedCount(const BROrphanPool *pool)
+{
+    assert(pool != NULL);
+    return pool->evictedCount;
+}
+
+// frees all orphans in pool with blockFree
+void BROrphanPoolClear(BROrphanPool *pool, void *info, void (*blockFree)(void *info, BRMerkleBlock *block))
+{
+    assert(pool != NULL);
+
+    while (pool->oldest) {
+        BRMerkleBlock *block = pool->oldest->block;
+
+        _BROrphanPoolUnlink(pool, pool->oldest);
+        if (blockFree) blockFree(info, block);
+    }
+}
+
+// frees memory allocated for pool, and the orphans in it with blockFree
+void BROrphanPoolFree(BROrphanPool *pool, void *info, void (*blockFree)(void *info, BRMerkleBlock *block))
+{
+    assert(pool != NULL);
+    BROrphanPoolClear(pool, info, blockFree);
+    BRSetFree(pool->orphans);
+    array_free(pool->peers);
+    free(pool);
+}
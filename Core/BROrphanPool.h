@@ -0,0 +1,74 @@
+// Copyright (c) 2012-2018 The Elastos Open Source Project
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#ifndef BROrphanPool_h
+#define BROrphanPool_h
+
+#include "BRPeer.h"
+#include "BRMerkleBlock.h"
+#include "BRInt.h"
+#include <stddef.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define ORPHAN_POOL_MAX_COUNT      500      // orphan blocks kept at once
+#define ORPHAN_POOL_MAX_BYTES      0x800000 // memory the kept orphan blocks may take up
+#define ORPHAN_POOL_PEER_MAX_COUNT 100      // orphan blocks kept from any one peer
+#define ORPHAN_POOL_PEER_MAX_BYTES 0x200000 // memory the orphan blocks kept from any one peer may take up
+
+// The orphan pool keeps blocks that arrived before their parent until the chain reaches them. It's indexed by
+// prevBlock, and when it's full the least recently added orphans are freed first. Each peer may only fill part of
+// the pool, so a peer relaying junk blocks evicts its own orphans rather than those of the other peers.
+typedef struct BROrphanPoolStruct BROrphanPool;
+
+// returns a newly allocated orphan pool that must be freed by calling BROrphanPoolFree()
+BROrphanPool *BROrphanPoolNew(size_t maxCount, size_t maxBytes, size_t peerMaxCount, size_t peerMaxBytes);
+
+// changes the limits of pool, orphans that no longer fit are freed with blockFree
+void BROrphanPoolSetLimits(BROrphanPool *pool, size_t maxCount, size_t maxBytes, size_t peerMaxCount,
+                           size_t peerMaxBytes, void *info, void (*blockFree)(void *info, BRMerkleBlock *block));
+
+// adds block relayed by peer, or by no peer if it's NULL, replacing an orphan with the same prevBlock; orphans that no
+// longer fit are freed with blockFree, returns false if that included block itself
+int BROrphanPoolAdd(BROrphanPool *pool, BRMerkleBlock *block, const BRPeer *peer, void *info,
+                    void (*blockFree)(void *info, BRMerkleBlock *block));
+
+// removes and returns the orphan whose parent is prevBlock, or NULL if there's none
+BRMerkleBlock *BROrphanPoolNextBlock(BROrphanPool *pool, UInt256 prevBlock);
+
+// removes block from pool without freeing it, returns true if it was in the pool
+int BROrphanPoolRemove(BROrphanPool *pool, const BRMerkleBlock *block);
+
+// the orphan added last, or NULL if pool is empty
+BRMerkleBlock *BROrphanPoolNewest(const BROrphanPool *pool);
+
+// frees the orphans relayed by peer with blockFree, call when the peer disconnects
+void BROrphanPoolRemovePeer(BROrphanPool *pool, const BRPeer *peer, void *info,
+                            void (*blockFree)(void *info, BRMerkleBlock *block));
+
+// number of orphans in pool
+size_t BROrphanPoolCount(const BROrphanPool *pool);
+
+// approximate memory taken up by the orphans in pool
+size_t BROrphanPoolBytes(const BROrphanPool *pool);
+
+// number of orphans in pool relayed by peer
+size_t BROrphanPoolPeerCount(const BROrphanPool *pool, const BRPeer *peer);
+
+// number of orphans freed to keep pool within its limits since it was created
+size_t BROrphanPoolEvictedCount(const BROrphanPool *pool);
+
+// frees all orphans in pool with blockFree
+void BROrphanPoolClear(BROrphanPool *pool, void *info, void (*blockFree)(void *info, BRMerkleBlock *block));
+
+// frees memory allocated for pool, and the orphans in it with blockFree
+void BROrphanPoolFree(BROrphanPool *pool, void *info, void (*blockFree)(void *info, BRMerkleBlock *block));
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // BROrphanPool_h
@@ -31,6 +31,7 @@
 #include "BRInt.h"
 #include "BRPeerMessages.h"
 #include "BRPeerManager.h"
+#include "BRPeerReactor.h"
 #include <stdlib.h>
 #include <float.h>
 #include <inttypes.h>
@@ -56,6 +57,12 @@
 #define MESSAGE_TIMEOUT    120.0
 
 #define PTHREAD_STACK_SIZE  (512 * 1024)
+#define RECEIVE_BUFFER_SIZE 0x10000 // buffer a connection takes from the pool to read into, larger if a message needs
+#define READS_PER_EVENT     16      // reads before a busy connection lets the reactor serve other peers
+
+#ifndef MSG_NOSIGNAL   // linux based systems have a MSG_NOSIGNAL send flag, useful for supressing SIGPIPE signals
+#define MSG_NOSIGNAL 0 // set to 0 if undefined (BSD has the SO_NOSIGPIPE sockopt, and windows has no signals at all)
+#endif
 
 // the standard blockchain download protocol works as follows (for SPV mode):
 // - local peer sends getblocks
@@ -85,6 +92,8 @@
 //   are generated and local peer sends filterload with an updated bloom filter
 // - after filterload is sent, getdata is sent to re-request recent blocks that may contain new tx matching the filter
 
+static uint64_t _receivedMessages = 0, _receivedBlocks = 0, _receiveAllocatedBytes = 0;
+
 inline static int _BRPeerIsIPv4(const BRPeer *peer)
 {
     return (peer->address.u64[0] == 0 && peer->address.u16[4] == 0 && peer->address.u16[5] == 0xffff);
@@ -97,6 +106,9 @@ static int _BRPeerAcceptMessage(BRPeer *peer, const uint8_t *msg, size_t msgLen,
     BRPeerContext *ctx = (BRPeerContext *)peer;
     int r = 1;
 
+    __sync_fetch_and_add(&_receivedMessages, 1);
+    if (strncmp(MSG_MERKLEBLOCK, type, 12) == 0) __sync_fetch_and_add(&_receivedBlocks, 1);
+
     if (ctx->currentBlock && strncmp(MSG_TX, type, 12) != 0) { // if we receive a non-tx message, merkleblock is done
         peer_log(peer, "incomplete merkleblock %s, expected %zu more tx, got %s", u256hex(ctx->currentBlock->blockHash),
                  array_count(ctx->currentBlockTxHashes), type);
@@ -124,6 +136,395 @@ static int _BRPeerAcceptMessage(BRPeer *peer, const uint8_t *msg, size_t msgLen,
     return r;
 }
 
+static socklen_t _BRPeerSocketAddress(const BRPeer *peer, int domain, struct sockaddr_storage *addr)
+{
+    memset(addr, 0, sizeof(*addr));
+
+    if (domain == PF_INET6) {
+        ((struct sockaddr_in6 *)addr)->sin6_family = AF_INET6;
+        ((struct sockaddr_in6 *)addr)->sin6_addr = *(struct in6_addr *)&peer->address;
+        ((struct sockaddr_in6 *)addr)->sin6_port = htons(peer->port);
+        return sizeof(struct sockaddr_in6);
+    }
+    else {
+        ((struct sockaddr_in *)addr)->sin_family = AF_INET;
+        ((struct sockaddr_in *)addr)->sin_addr = *(struct in_addr *)&peer->address.u32[3];
+        ((struct sockaddr_in *)addr)->sin_port = htons(peer->port);
+        return sizeof(struct sockaddr_in);
+    }
+}
+
+// called once the socket is closed, fails outstanding pings and the mempool request and tells the owner
+static void _BRPeerDidDisconnect(BRPeer *peer, int error)
+{
+    BRPeerContext *ctx = (BRPeerContext *)peer;
+
+    ctx->status = BRPeerStatusDisconnected;
+    peer_log(peer, "disconnected");
+
+    while (array_count(ctx->pongCallback) > 0) {
+        void (*pongCallback)(void *, int) = ctx->pongCallback[0];
+        void *pongInfo = ctx->pongInfo[0];
+
+        array_rm(ctx->pongCallback, 0);
+        array_rm(ctx->pongInfo, 0);
+        if (pongCallback) pongCallback(pongInfo, 0);
+    }
+
+    if (ctx->mempoolCallback) ctx->mempoolCallback(ctx->mempoolInfo, 0);
+    ctx->mempoolCallback = NULL;
+    if (ctx->disconnected) ctx->disconnected(ctx->info, error);
+}
+
+#if PEER_REACTOR
+
+// all peers in the process share a few reactor threads: a connection is a non-blocking socket the reactor calls
+// _BRPeerConnectionReady() for, and one timer wheel timer that is kept armed for the earliest of its deadlines;
+// messages are read into a buffer from the reactor's pool and dispatched in place, the buffer goes back to the pool
+// as soon as no partial message is left in it, so idle peers hold no receive memory
+typedef struct BRPeerConnectionStruct {
+    BRPeerReactor *reactor;
+    BRPeerReactorSource *source;
+    BRPeerReactorTimer *timer;
+    int fd, connecting, closing, error;
+    double connectTimeout, msgTimeout, timerTime;
+    uint8_t *recvBuf, *sendBuf;
+    size_t recvLen, recvSize, sendOff, sendLen, sendSize;
+} _BRPeerConnection;
+
+static double _BRPeerNow(void)
+{
+    struct timeval tv;
+
+    gettimeofday(&tv, NULL);
+    return tv.tv_sec + (double)tv.tv_usec/1000000;
+}
+
+// arms the connection timer for the earliest deadline, ctx->lock must be held
+static void _BRPeerConnectionArm(BRPeerContext *ctx, _BRPeerConnection *conn)
+{
+    double now = _BRPeerNow(), time = conn->msgTimeout;
+
+    if (ctx->mempoolTime < time) time = ctx->mempoolTime;
+    if (conn->connecting && conn->connectTimeout < time) time = conn->connectTimeout;
+    if (conn->closing) time = now;
+
+    if (time != conn->timerTime) {
+        conn->timerTime = time;
+        BRPeerReactorTimerSet(conn->timer, (time == DBL_MAX) ? -1 : time - now);
+    }
+}
+
+// has the connection closed with error on the next tick, ctx->lock must be held
+static void _BRPeerConnectionScheduleClose(BRPeerContext *ctx, _BRPeerConnection *conn, int error)
+{
+    if (! conn->closing) {
+        conn->closing = 1;
+        conn->error = error;
+        ctx->socket = -1;
+        _BRPeerConnectionArm(ctx, conn);
+    }
+}
+
+// sends as much of the send buffer as the socket takes, ctx->lock must be held
+static int _BRPeerConnectionFlush(_BRPeerConnection *conn)
+{
+    ssize_t n;
+    int error = 0;
+
+    while (! error && conn->sendOff < conn->sendLen) {
+        n = send(conn->fd, &conn->sendBuf[conn->sendOff], conn->sendLen - conn->sendOff, MSG_NOSIGNAL);
+        if (n >= 0) conn->sendOff += n;
+        else if (errno == EWOULDBLOCK || errno == EAGAIN) break; // the rest is sent when the socket is writable
+        else if (errno != EINTR) error = errno;
+    }
+
+    if (conn->sendOff == conn->sendLen) conn->sendOff = conn->sendLen = 0;
+    BRPeerReactorSetEvents(conn->source, PEER_REACTOR_READ | ((conn->sendLen > 0) ? PEER_REACTOR_WRITE : 0));
+    return error;
+}
+
+// closes the socket, frees the connection and calls the disconnected callback, only on the reactor thread
+static void _BRPeerConnectionClose(BRPeer *peer, int error)
+{
+    BRPeerContext *ctx = (BRPeerContext *)peer;
+    _BRPeerConnection *conn;
+
+    pthread_mutex_lock(&ctx->lock);
+    conn = ctx->connection;
+    ctx->connection = NULL;
+    ctx->socket = -1;
+    pthread_mutex_unlock(&ctx->lock);
+    if (! conn) return;
+
+    if (conn->source) BRPeerReactorRemove(conn->source);
+    if (conn->fd >= 0) close(conn->fd);
+    BRPeerReactorTimerFree(conn->timer);
+    if (conn->recvBuf) BRPeerReactorBufferPut(conn->reactor, conn->recvBuf, conn->recvSize);
+    free(conn->sendBuf);
+    free(conn);
+    _BRPeerDidDisconnect(peer, error);
+}
+
+// dispatches the complete messages in the receive buffer, returns an errno.h code if the connection must be closed
+static int _BRPeerConnectionDispatch(BRPeer *peer, _BRPeerConnection *conn)
+{
+    BRPeerContext *ctx = (BRPeerContext *)peer;
+    uint8_t *buf = conn->recvBuf, *header, *magic;
+    size_t off = 0, len = conn->recvLen, needed = 0;
+    uint32_t msgLen, checksum;
+    UInt256 hash;
+    int error = 0;
+
+    while (! error && ctx->socket >= 0 && len - off >= sizeof(uint32_t)) { // stop when the peer has been disconnected
+        if (UInt32GetLE(&buf[off]) != ctx->magicNumber) { // skip to where the magic number might start
+            magic = memchr(&buf[off + 1], (uint8_t)ctx->magicNumber, len - off - 1);
+            off = (magic) ? magic - buf : len;
+            continue;
+        }
+
+        if (len - off < HEADER_LENGTH) break;
+        header = &buf[off];
+        msgLen = UInt32GetLE(&header[16]);
+        checksum = UInt32GetLE(&header[20]);
+
+        if (header[15] != 0) { // verify header type field is NULL terminated
+            peer_log(peer, "malformed message header: type not NULL terminated");
+            error = EPROTO;
+        }
+        else if (msgLen > MAX_MSG_LENGTH) { // check message length
+            peer_log(peer, "error reading %s, message length %"PRIu32" is too long", (const char *)&header[4], msgLen);
+            error = EPROTO;
+        }
+        else if (len - off < HEADER_LENGTH + msgLen) {
+            needed = HEADER_LENGTH + msgLen;
+            break;
+        }
+        else {
+            BRSHA256_2(&hash, &header[HEADER_LENGTH], msgLen);
+
+            if (UInt32GetLE(&hash) != checksum) { // verify checksum
+                peer_log(peer, "error reading %s, invalid checksum %x, expected %x, payload length:%"PRIu32
+                         ", SHA256_2:%s", (const char *)&header[4], UInt32GetLE(&hash), checksum, msgLen,
+                         u256hex(hash));
+                error = EPROTO;
+            }
+            else if (! _BRPeerAcceptMessage(peer, &header[HEADER_LENGTH], msgLen, (const char *)&header[4])) {
+                error = EPROTO;
+            }
+
+            off += HEADER_LENGTH + msgLen;
+        }
+    }
+
+    if (off > 0) memmove(buf, &buf[off], len - off);
+    conn->recvLen = len - off;
+
+    if (needed > conn->recvSize) { // move the partial message to a buffer of a size class that fits it
+        size_t size;
+
+        buf = BRPeerReactorBufferGet(conn->reactor, needed, &size);
+        memcpy(buf, conn->recvBuf, conn->recvLen);
+        BRPeerReactorBufferPut(conn->reactor, conn->recvBuf, conn->recvSize);
+        conn->recvBuf = buf;
+        conn->recvSize = size;
+    }
+
+    pthread_mutex_lock(&ctx->lock);
+    conn->msgTimeout = (needed > 0) ? _BRPeerNow() + MESSAGE_TIMEOUT : DBL_MAX; // a message is partly read
+    _BRPeerConnectionArm(ctx, conn);
+    pthread_mutex_unlock(&ctx->lock);
+    return error;
+}
+
+static int _BRPeerConnectionRead(BRPeer *peer, _BRPeerConnection *conn)
+{
+    ssize_t n;
+    int error = 0;
+
+    if (! conn->recvBuf) conn->recvBuf = BRPeerReactorBufferGet(conn->reactor, RECEIVE_BUFFER_SIZE, &conn->recvSize);
+
+    for (int i = 0; ! error && i < READS_PER_EVENT; i++) { // level triggered, the reactor comes back for the rest
+        n = read(conn->fd, &conn->recvBuf[conn->recvLen], conn->recvSize - conn->recvLen);
+
+        if (n > 0) {
+            conn->recvLen += n;
+            error = _BRPeerConnectionDispatch(peer, conn);
+        }
+        else if (n == 0) error = ECONNRESET;
+        else if (errno == EWOULDBLOCK || errno == EAGAIN) break;
+        else if (errno != EINTR) error = errno;
+    }
+
+    if (conn->recvLen == 0) { // everything read has been dispatched
+        BRPeerReactorBufferPut(conn->reactor, conn->recvBuf, conn->recvSize);
+        conn->recvBuf = NULL;
+        conn->recvSize = 0;
+    }
+
+    if (error) peer_log(peer, "read message error: %s", strerror(error));
+    return error;
+}
+
+// the non-blocking connect has completed or failed
+static int _BRPeerConnectionConnected(BRPeer *peer, _BRPeerConnection *conn)
+{
+    BRPeerContext *ctx = (BRPeerContext *)peer;
+    socklen_t optLen = sizeof(int);
+    int error = 0;
+
+    if (getsockopt(conn->fd, SOL_SOCKET, SO_ERROR, &error, &optLen) < 0) error = errno;
+
+    if (error) {
+        peer_log(peer, "connect error: %s", strerror(error));
+        return error;
+    }
+
+    peer_log(peer, "socket connected");
+    ctx->startTime = _BRPeerNow();
+    pthread_mutex_lock(&ctx->lock);
+    conn->connecting = 0;
+    error = _BRPeerConnectionFlush(conn); // anything queued while connecting
+    _BRPeerConnectionArm(ctx, conn);
+    pthread_mutex_unlock(&ctx->lock);
+    if (! error) ctx->manager->peerMessages->BRPeerSendVersionMessage(peer);
+    return error;
+}
+
+static void _BRPeerConnectionReady(void *info, int events)
+{
+    BRPeer *peer = info;
+    BRPeerContext *ctx = info;
+    _BRPeerConnection *conn;
+    int connecting = 0, error = 0;
+
+    pthread_mutex_lock(&ctx->lock);
+    conn = ctx->connection;
+    if (conn) connecting = conn->connecting;
+    if (conn && conn->closing) error = conn->error;
+    else if (conn && ! connecting && (events & PEER_REACTOR_WRITE)) error = _BRPeerConnectionFlush(conn);
+    pthread_mutex_unlock(&ctx->lock);
+    if (! conn) return;
+
+    if (! error && connecting) error = _BRPeerConnectionConnected(peer, conn);
+    else if (! error && (events & (PEER_REACTOR_READ | PEER_REACTOR_HUP))) error = _BRPeerConnectionRead(peer, conn);
+
+    pthread_mutex_lock(&ctx->lock);
+    if (! error && conn->closing) error = conn->error; // disconnected or a send failed meanwhile
+    pthread_mutex_unlock(&ctx->lock);
+    if (error) _BRPeerConnectionClose(peer, error);
+}
+
+static void _BRPeerConnectionTimerFired(void *info)
+{
+    BRPeer *peer = info;
+    BRPeerContext *ctx = info;
+    _BRPeerConnection *conn;
+    double now = _BRPeerNow();
+    int error = 0, closing = 0, mempool = 0;
+
+    pthread_mutex_lock(&ctx->lock);
+    conn = ctx->connection;
+    conn->timerTime = DBL_MAX;
+
+    if (conn->closing) {
+        error = conn->error;
+        closing = 1;
+    }
+    else if (conn->connecting && now >= conn->connectTimeout) {
+        peer_log(peer, "connect error: %s", strerror(ETIMEDOUT));
+        error = ETIMEDOUT;
+        closing = 1;
+    }
+    else if (now >= conn->msgTimeout) {
+        peer_log(peer, "read message error: %s", strerror(ETIMEDOUT));
+        error = ETIMEDOUT;
+        closing = 1;
+    }
+    else if (now >= ctx->mempoolTime) mempool = 1;
+    else _BRPeerConnectionArm(ctx, conn);
+
+    pthread_mutex_unlock(&ctx->lock);
+
+    if (closing) _BRPeerConnectionClose(peer, error);
+    else if (mempool) {
+        peer_log(peer, "done waiting for mempool response");
+        ctx->mempoolTime = DBL_MAX;
+        ctx->manager->peerMessages->BRPeerSendPingMessage(peer, ctx->mempoolInfo, ctx->mempoolCallback);
+        ctx->mempoolCallback = NULL;
+        pthread_mutex_lock(&ctx->lock);
+        _BRPeerConnectionArm(ctx, conn);
+        pthread_mutex_unlock(&ctx->lock);
+    }
+}
+
+// starts a non-blocking connect and adds the socket to the reactor, ctx->lock must be held
+static int _BRPeerConnectionStart(BRPeer *peer, _BRPeerConnection *conn, BRPeerReactor *reactor, int domain)
+{
+    BRPeerContext *ctx = (BRPeerContext *)peer;
+    struct sockaddr_storage addr;
+    socklen_t addrLen = _BRPeerSocketAddress(peer, domain, &addr);
+    int fd, arg, on = 1, error = 0;
+
+    fd = socket(domain, SOCK_STREAM, 0);
+    if (fd < 0) error = errno;
+
+    if (! error) {
+        setsockopt(fd, SOL_SOCKET, SO_KEEPALIVE, &on, sizeof(on));
+#ifdef SO_NOSIGPIPE // BSD based systems have a SO_NOSIGPIPE socket option to supress SIGPIPE signals
+        setsockopt(fd, SOL_SOCKET, SO_NOSIGPIPE, &on, sizeof(on));
+#endif
+        arg = fcntl(fd, F_GETFL, NULL);
+        if (arg < 0 || fcntl(fd, F_SETFL, arg | O_NONBLOCK) < 0) error = errno;
+    }
+
+    if (! error && connect(fd, (struct sockaddr *)&addr, addrLen) < 0 && errno != EINPROGRESS) {
+        error = errno;
+
+        if (domain == PF_INET6 && _BRPeerIsIPv4(peer)) {
+            close(fd);
+            return _BRPeerConnectionStart(peer, conn, reactor, PF_INET); // fallback to IPv4
+        }
+    }
+
+    if (! error) { // writable once connected
+        conn->source = BRPeerReactorAdd(reactor, fd, PEER_REACTOR_WRITE, peer, _BRPeerConnectionReady);
+        if (! conn->source) error = errno;
+    }
+
+    if (error) {
+        peer_log(peer, "connect error: %s", strerror(error));
+        if (fd >= 0) close(fd);
+    }
+    else conn->fd = ctx->socket = fd;
+
+    return error;
+}
+
+static void _BRPeerConnectionOpen(BRPeer *peer)
+{
+    BRPeerContext *ctx = (BRPeerContext *)peer;
+    BRPeerReactor *reactor = BRPeerReactorShared();
+    _BRPeerConnection *conn = calloc(1, sizeof(*conn));
+    int error;
+
+    assert(conn != NULL);
+    conn->fd = -1;
+    conn->connecting = 1;
+    conn->connectTimeout = _BRPeerNow() + CONNECT_TIMEOUT;
+    conn->msgTimeout = conn->timerTime = DBL_MAX;
+    conn->reactor = reactor;
+    conn->timer = BRPeerReactorTimerNew(reactor, peer, _BRPeerConnectionTimerFired);
+    pthread_mutex_lock(&ctx->lock);
+    ctx->connection = conn;
+    error = _BRPeerConnectionStart(peer, conn, reactor, PF_INET6);
+    if (error) _BRPeerConnectionScheduleClose(ctx, conn, error); // reported from the reactor, like any other error
+    else _BRPeerConnectionArm(ctx, conn);
+    pthread_mutex_unlock(&ctx->lock);
+}
+
+#else // ! PEER_REACTOR
+
 static int _BRPeerOpenSocket(BRPeer *peer, int domain, double timeout, int *error)
 {
     BRPeerContext *ctx = (BRPeerContext *)peer;
@@ -154,20 +555,7 @@ static int _BRPeerOpenSocket(BRPeer *peer, int domain, double timeout, int *erro
     }
 
     if (r) {
-        memset(&addr, 0, sizeof(addr));
-
-        if (domain == PF_INET6) {
-            ((struct sockaddr_in6 *)&addr)->sin6_family = AF_INET6;
-            ((struct sockaddr_in6 *)&addr)->sin6_addr = *(struct in6_addr *)&peer->address;
-            ((struct sockaddr_in6 *)&addr)->sin6_port = htons(peer->port);
-            addrLen = sizeof(struct sockaddr_in6);
-        }
-        else {
-            ((struct sockaddr_in *)&addr)->sin_family = AF_INET;
-            ((struct sockaddr_in *)&addr)->sin_addr = *(struct in_addr *)&peer->address.u32[3];
-            ((struct sockaddr_in *)&addr)->sin_port = htons(peer->port);
-            addrLen = sizeof(struct sockaddr_in);
-        }
+        addrLen = _BRPeerSocketAddress(peer, domain, &addr);
 
         if (connect(ctx->socket, (struct sockaddr *)&addr, addrLen) < 0) err = errno;
 
@@ -216,6 +604,7 @@ static void *_peerThreadRoutine(void *arg)
         ssize_t n = 0;
 
         assert(payload != NULL);
+        __sync_fetch_and_add(&_receiveAllocatedBytes, payloadLen);
         gettimeofday(&tv, NULL);
         ctx->startTime = tv.tv_sec + (double)tv.tv_usec/1000000;
         ctx->manager->peerMessages->BRPeerSendVersionMessage(peer);
@@ -274,7 +663,11 @@ static void *_peerThreadRoutine(void *arg)
                 }
                 else {
 //                    peer_dbg(peer, "start read head: port %d", (int)peer->port);
-                    if (msgLen > payloadLen) payload = realloc(payload, (payloadLen = msgLen));
+                    if (msgLen > payloadLen) {
+                        payload = realloc(payload, (payloadLen = msgLen));
+                        __sync_fetch_and_add(&_receiveAllocatedBytes, payloadLen);
+                    }
+
                     assert(payload != NULL);
                     len = 0;
                     socket = ctx->socket;
@@ -324,26 +717,14 @@ static void *_peerThreadRoutine(void *arg)
 
     socket = ctx->socket;
     ctx->socket = -1;
-    ctx->status = BRPeerStatusDisconnected;
     if (socket >= 0) close(socket);
-    peer_log(peer, "disconnected");
-
-    while (array_count(ctx->pongCallback) > 0) {
-        void (*pongCallback)(void *, int) = ctx->pongCallback[0];
-        void *pongInfo = ctx->pongInfo[0];
-
-        array_rm(ctx->pongCallback, 0);
-        array_rm(ctx->pongInfo, 0);
-        if (pongCallback) pongCallback(pongInfo, 0);
-    }
-
-    if (ctx->mempoolCallback) ctx->mempoolCallback(ctx->mempoolInfo, 0);
-    ctx->mempoolCallback = NULL;
-    if (ctx->disconnected) ctx->disconnected(ctx->info, error);
+    _BRPeerDidDisconnect(peer, error);
     pthread_cleanup_pop(1);
     return NULL; // detached threads don't need to return a value
 }
 
+#endif // PEER_REACTOR
+
 void _dummyThreadCleanup(void *info)
 {
 }
@@ -382,6 +763,7 @@ BRPeer *BRPeerNew(uint32_t magicNumber)
     ctx->disconnectTime = DBL_MAX;
     ctx->socket = -1;
     ctx->threadCleanup = _dummyThreadCleanup;
+    pthread_mutex_init(&ctx->lock, NULL);
     return &ctx->peer;
 }
 
@@ -454,8 +836,10 @@ void BRPeerConnect(BRPeer *peer)
 {
     BRPeerContext *ctx = (BRPeerContext *)peer;
     struct timeval tv;
+#if ! PEER_REACTOR
     int error = 0;
     pthread_attr_t attr;
+#endif
 
     if (ctx->status == BRPeerStatusDisconnected || ctx->waitingForNetwork) {
         ctx->status = BRPeerStatusConnecting;
@@ -469,7 +853,9 @@ void BRPeerConnect(BRPeer *peer)
             ctx->waitingForNetwork = 0;
             gettimeofday(&tv, NULL);
             ctx->disconnectTime = tv.tv_sec + (double)tv.tv_usec/1000000 + CONNECT_TIMEOUT;
-
+#if PEER_REACTOR
+            _BRPeerConnectionOpen(peer);
+#else
             if (pthread_attr_init(&attr) != 0) {
                 error = ENOMEM;
                 peer_log(peer, "error creating thread");
@@ -485,6 +871,7 @@ void BRPeerConnect(BRPeer *peer)
                 ctx->status = BRPeerStatusDisconnected;
                 //if (ctx->disconnected) ctx->disconnected(ctx->info, error);
             }
+#endif
         }
     }
 }
@@ -493,6 +880,12 @@ void BRPeerConnect(BRPeer *peer)
 void BRPeerDisconnect(BRPeer *peer)
 {
     BRPeerContext *ctx = (BRPeerContext *)peer;
+#if PEER_REACTOR
+    // the reactor closes the socket, closing it here would silently drop it from epoll
+    pthread_mutex_lock(&ctx->lock);
+    if (ctx->connection) _BRPeerConnectionScheduleClose(ctx, ctx->connection, ECONNRESET);
+    pthread_mutex_unlock(&ctx->lock);
+#else
     int socket = ctx->socket;
 
     if (socket >= 0) {
@@ -500,6 +893,7 @@ void BRPeerDisconnect(BRPeer *peer)
         if (shutdown(socket, SHUT_RDWR) < 0) peer_log(peer, "peer shutdown error: %s", strerror(errno));
         close(socket);
     }
+#endif
 }
 
 // call this to (re)schedule a disconnect in the given number of seconds, or < 0 to cancel (useful for sync timeout)
@@ -563,16 +957,58 @@ uint64_t BRPeerFeePerKb(BRPeer *peer)
     return ((BRPeerContext *)peer)->feePerKb;
 }
 
-#ifndef MSG_NOSIGNAL   // linux based systems have a MSG_NOSIGNAL send flag, useful for supressing SIGPIPE signals
-#define MSG_NOSIGNAL 0 // set to 0 if undefined (BSD has the SO_NOSIGPIPE sockopt, and windows has no signals at all)
-#endif
-
 // sends a bitcoin protocol message to peer
 void BRPeerSendMessage(BRPeer *peer, const uint8_t *msg, size_t msgLen, const char *type)
 {
     if (msgLen > MAX_MSG_LENGTH) {
         peer_log(peer, "failed to send %s, length %zu is too long", type, msgLen);
     }
+#if PEER_REACTOR
+    else {
+        BRPeerContext *ctx = (BRPeerContext *)peer;
+        _BRPeerConnection *conn;
+        uint8_t *buf, hash[32];
+        int error = 0;
+
+        peer_log(peer, "sending %s", type);
+        pthread_mutex_lock(&ctx->lock);
+        conn = ctx->connection;
+
+        if (! conn || conn->closing) error = ENOTCONN;
+        else if (conn->sendLen - conn->sendOff > MAX_MSG_LENGTH) { // peer isn't reading
+            error = ENOBUFS;
+            _BRPeerConnectionScheduleClose(ctx, conn, error);
+        }
+        else {
+            if (conn->sendOff > 0) { // compact what's left of the send buffer
+                memmove(conn->sendBuf, &conn->sendBuf[conn->sendOff], conn->sendLen - conn->sendOff);
+                conn->sendLen -= conn->sendOff;
+                conn->sendOff = 0;
+            }
+
+            if (conn->sendLen + HEADER_LENGTH + msgLen > conn->sendSize) {
+                conn->sendSize = conn->sendLen + HEADER_LENGTH + msgLen;
+                conn->sendBuf = realloc(conn->sendBuf, conn->sendSize);
+                assert(conn->sendBuf != NULL);
+            }
+
+            buf = &conn->sendBuf[conn->sendLen];
+            UInt32SetLE(&buf[0], ctx->magicNumber);
+            strncpy((char *)&buf[4], type, 12);
+            UInt32SetLE(&buf[16], (uint32_t)msgLen);
+            BRSHA256_2(hash, msg, msgLen);
+            memcpy(&buf[20], hash, sizeof(uint32_t));
+            if (msgLen > 0) memcpy(&buf[HEADER_LENGTH], msg, msgLen);
+            conn->sendLen += HEADER_LENGTH + msgLen;
+            if (! conn->connecting) error = _BRPeerConnectionFlush(conn); // else sent once connected
+            if (error) _BRPeerConnectionScheduleClose(ctx, conn, error);
+            else _BRPeerConnectionArm(ctx, conn); // sending may have started a mempool timeout
+        }
+
+        pthread_mutex_unlock(&ctx->lock);
+        if (error) peer_log(peer, "ERROR: sending %s message %s", type, strerror(error));
+    }
+#else
     else {
         BRPeerContext *ctx = (BRPeerContext *)peer;
         uint8_t buf[HEADER_LENGTH + msgLen], hash[32];
@@ -610,6 +1046,7 @@ void BRPeerSendMessage(BRPeer *peer, const uint8_t *msg, size_t msgLen, const ch
             BRPeerDisconnect(peer);
         }
     }
+#endif
 }
 
 // useful to get additional tx after a bloom filter update
@@ -627,6 +1064,25 @@ void BRPeerRerequestBlocks(BRPeer *peer, UInt256 fromBlock)
     }
 }
 
+// receive statistics for all peers in the process since it started: the buffer pool hit rate is
+// bufferHits/bufferGets, and the receive memory allocated per synced block is allocatedBytes/blocks
+void BRPeerGetReceiveStats(BRPeerReceiveStats *stats)
+{
+    assert(stats != NULL);
+    memset(stats, 0, sizeof(*stats));
+    stats->messages = __sync_fetch_and_add(&_receivedMessages, 0);
+    stats->blocks = __sync_fetch_and_add(&_receivedBlocks, 0);
+    stats->allocatedBytes = __sync_fetch_and_add(&_receiveAllocatedBytes, 0);
+#if PEER_REACTOR
+    BRPeerBufferStats bufferStats = { 0, 0, 0, 0 };
+
+    BRPeerReactorSharedBufferStats(&bufferStats);
+    stats->bufferGets = bufferStats.gets;
+    stats->bufferHits = bufferStats.hits;
+    stats->allocatedBytes += bufferStats.allocatedBytes;
+#endif
+}
+
 void BRPeerFree(BRPeer *peer)
 {
     BRPeerContext *ctx = (BRPeerContext *)peer;
@@ -638,6 +1094,7 @@ void BRPeerFree(BRPeer *peer)
     if (ctx->knownTxHashSet) BRSetFree(ctx->knownTxHashSet);
     if (ctx->pongCallback) array_free(ctx->pongCallback);
     if (ctx->pongInfo) array_free(ctx->pongInfo);
+    pthread_mutex_destroy(&ctx->lock);
     free(ctx);
 }
 
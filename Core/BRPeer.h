@@ -119,6 +119,12 @@ BRPeer *BRPeerCopy(const BRPeer *peer);
 
 #define BR_PEER_NONE ((BRPeer) { UINT128_ZERO, 0, 0, 0, 0 })
 
+typedef struct {
+    uint64_t messages, blocks; // messages received from all peers, and how many of them were merkleblocks
+    uint64_t bufferGets, bufferHits; // receive buffers taken from the reactor pools, and how many were reused
+    uint64_t allocatedBytes; // bytes allocated for receive buffers
+} BRPeerReceiveStats;
+
 // NOTE: BRPeer functions are not thread-safe
 
 // returns a newly allocated BRPeer struct that must be freed by calling BRPeerFree()
@@ -197,6 +203,10 @@ void BRPeerSendMessage(BRPeer *peer, const uint8_t *msg, size_t msgLen, const ch
 // useful to get additional tx after a bloom filter update
 void BRPeerRerequestBlocks(BRPeer *peer, UInt256 fromBlock);
 
+// receive statistics for all peers in the process since it started: the buffer pool hit rate is
+// bufferHits/bufferGets, and the receive memory allocated per synced block is allocatedBytes/blocks
+void BRPeerGetReceiveStats(BRPeerReceiveStats *stats);
+
 // returns a hash value for peer suitable for use in a hashtable
 inline static size_t BRPeerHash(const void *peer)
 {
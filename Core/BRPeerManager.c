@@ -50,6 +50,11 @@
 #define MAX_CONNECT_FAILURES  20 // notify user of network problems after this many connect failures in a row
 #define PEER_FLAG_SYNCED      0x01
 #define PEER_FLAG_NEEDSUPDATE 0x02
+#define PEER_FLAG_DOWNLOAD    0x04 // peer has the bloom filter loaded and takes part in the chain download
+#define PEER_FLAG_FILTERADD   0x08 // peer hasn't answered the ping sent after its last filteradd yet
+
+// projected false positive rate up to which the bloom filter is extended with filteradd rather than rebuilt
+#define BLOOM_REBUILD_FALSEPOSITIVE_RATE (BLOOM_REDUCED_FALSEPOSITIVE_RATE*10.0)
 
 #define genesis_block_hash(params) UInt256Reverse(&((params)->checkpoints[0].hash))
 
@@ -63,6 +68,7 @@ typedef struct {
     BRPeer *peer;
     BRPeerManager *manager;
     UInt256 hash;
+    uint64_t filterExtension; // filterStats.extensions when a filteradd ping was sent
 } BRPeerCallbackInfo;
 
 // true if peer is contained in the list of peers associated with txHash
@@ -229,6 +235,52 @@ static size_t _BRPeerManagerBlockLocators(BRPeerManager *manager, UInt256 locato
     return ++i;
 }
 
+// hands queued block windows round robin to the download peers with room for more
+static void _BRPeerManagerRequestBlocks(BRPeerManager *manager)
+{
+    UInt256 hashes[BLOCK_DOWNLOAD_WINDOW_SIZE];
+    double now = time(NULL);
+    size_t count, requested;
+
+    do {
+        requested = 0;
+
+        for (size_t i = array_count(manager->connectedPeers); i > 0; i--) {
+            BRPeer *peer = manager->connectedPeers[i - 1];
+
+            if (BRPeerConnectStatus(peer) != BRPeerStatusConnected || (peer->flags & PEER_FLAG_DOWNLOAD) == 0) continue;
+            count = BRBlockDownloadNextWindow(manager->blockDownload, peer, now, hashes, sizeof(hashes)/sizeof(*hashes));
+            if (count == 0) continue;
+            manager->peerMessages->BRPeerSendGetdataMessage(peer, NULL, 0, hashes, count);
+            requested++;
+        }
+    } while (requested > 0);
+}
+
+// loads the current bloom filter into a peer that isn't the download peer so it can help download the chain
+static void _BRPeerManagerAddDownloadPeer(BRPeerManager *manager, BRPeer *peer)
+{
+    if (manager->bloomFilter && peer != manager->downloadPeer && (peer->flags & PEER_FLAG_DOWNLOAD) == 0 &&
+        BRPeerConnectStatus(peer) == BRPeerStatusConnected) {
+        // the filterload is sent ahead of any getdata, so there's no need to wait for a pong
+        manager->peerMessages->BRPeerSendFilterloadMessage(peer, manager->bloomFilter);
+        peer->flags |= PEER_FLAG_DOWNLOAD;
+        _BRPeerManagerRequestBlocks(manager);
+    }
+}
+
+// drops the queued block windows and stops the peers helping the download peer, their filters need reloading
+static void _BRPeerManagerStopBlockDownload(BRPeerManager *manager)
+{
+    for (size_t i = array_count(manager->connectedPeers); i > 0; i--) {
+        BRPeer *peer = manager->connectedPeers[i - 1];
+
+        if (peer != manager->downloadPeer) peer->flags &= ~PEER_FLAG_DOWNLOAD;
+    }
+
+    BRBlockDownloadClear(manager->blockDownload, manager, manager->peerMessages->MerkleBlockFree);
+}
+
 static void _BRPeerManagerLoadBloomFilter(BRPeerManager *manager, BRPeer *peer)
 {
     // every time a new wallet address is added, the bloom filter has to be rebuilt, and each address is only used
@@ -237,9 +289,8 @@ static void _BRPeerManagerLoadBloomFilter(BRPeerManager *manager, BRPeer *peer)
     manager->wallet->WalletUnusedAddrs(manager->wallet, NULL, SEQUENCE_GAP_LIMIT_EXTERNAL + 100, 0);
     manager->wallet->WalletUnusedAddrs(manager->wallet, NULL, SEQUENCE_GAP_LIMIT_INTERNAL + 100, 1);
 
-    BRSetApply(manager->orphans, manager, manager->peerMessages->ApplyFreeBlock);
-    BRSetClear(manager->orphans); // clear out orphans that may have been received on an old filter
-    manager->lastOrphan = NULL;
+    // clear out orphans that may have been received on an old filter
+    BROrphanPoolClear(manager->orphans, manager, manager->peerMessages->MerkleBlockFree);
     manager->filterUpdateHeight = manager->lastBlock->height;
     manager->fpRate = BLOOM_REDUCED_FALSEPOSITIVE_RATE;
 
@@ -306,6 +357,21 @@ static void _BRPeerManagerLoadBloomFilter(BRPeerManager *manager, BRPeer *peer)
     manager->peerMessages->BRPeerSendFilterloadMessage(peer, filter);
 }
 
+// builds the bloom filter from the whole wallet and loads it into peer, keeping track of how long that takes
+static void _BRPeerManagerRebuildFilter(BRPeerManager *manager, BRPeer *peer)
+{
+    struct timespec start, end;
+    double seconds;
+
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    manager->loadBloomFilter(manager, peer);
+    clock_gettime(CLOCK_MONOTONIC, &end);
+    seconds = (end.tv_sec - start.tv_sec) + (end.tv_nsec - start.tv_nsec)/1e9;
+    manager->filterStats.rebuilds++;
+    manager->filterStats.rebuildTime += seconds;
+    peer_log(peer, "rebuilt bloom filter in %.3fs", seconds);
+}
+
 static void _updateFilterRerequestDone(void *info, int success)
 {
     BRPeer *peer = ((BRPeerCallbackInfo *)info)->peer;
@@ -347,6 +413,10 @@ static void _updateFilterLoadDone(void *info, int success)
             peerInfo->manager = manager;
             BRPeerRerequestBlocks(manager->downloadPeer, manager->lastBlock->blockHash);
 			manager->peerMessages->BRPeerSendPingMessage(manager->downloadPeer, peerInfo, _updateFilterRerequestDone);
+
+            for (size_t i = array_count(manager->connectedPeers); i > 0; i--) {
+                _BRPeerManagerAddDownloadPeer(manager, manager->connectedPeers[i - 1]);
+            }
         }
         else manager->peerMessages->BRPeerSendMempoolMessage(peer, NULL, 0, NULL, NULL); // if not syncing, request mempool
 
@@ -367,8 +437,10 @@ static void _updateFilterPingDone(void *info, int success)
         manager->bloomFilter = NULL;
 
         if (manager->lastBlock->height < manager->estimatedHeight) { // if we're syncing, only update download peer
+            _BRPeerManagerStopBlockDownload(manager);
+
             if (manager->downloadPeer) {
-                manager->loadBloomFilter(manager, manager->downloadPeer);
+                _BRPeerManagerRebuildFilter(manager, manager->downloadPeer);
                 manager->peerMessages->BRPeerSendPingMessage(manager->downloadPeer, info, _updateFilterLoadDone); // wait for pong so filter is loaded
             }
             else free(info);
@@ -382,7 +454,7 @@ static void _updateFilterPingDone(void *info, int success)
                 assert(peerInfo != NULL);
                 peerInfo->peer = manager->connectedPeers[i - 1];
                 peerInfo->manager = manager;
-                manager->loadBloomFilter(manager, peerInfo->peer);
+                _BRPeerManagerRebuildFilter(manager, peerInfo->peer);
                 manager->peerMessages->BRPeerSendPingMessage(peerInfo->peer, peerInfo, _updateFilterLoadDone); // wait for pong so filter is loaded
             }
         }
@@ -409,6 +481,94 @@ static void _BRPeerManagerUpdateFilter(BRPeerManager *manager)
     }
 }
 
+static void _extendFilterPingDone(void *info, int success)
+{
+    BRPeer *peer = ((BRPeerCallbackInfo *)info)->peer;
+    BRPeerManager *manager = ((BRPeerCallbackInfo *)info)->manager;
+    uint64_t extension = ((BRPeerCallbackInfo *)info)->filterExtension;
+
+    if (success) {
+        pthread_mutex_lock(&manager->lock);
+
+        if (extension == manager->filterStats.extensions) { // the peer has every filteradd sent so far
+            peer->flags &= ~PEER_FLAG_FILTERADD;
+
+            if (manager->lastBlock->height < manager->estimatedHeight) { // if syncing, rerequest blocks
+                if (peer == manager->downloadPeer) {
+                    BRPeerRerequestBlocks(peer, manager->lastBlock->blockHash);
+                    manager->peerMessages->BRPeerSendPingMessage(peer, info, _updateFilterRerequestDone);
+                    info = NULL;
+                }
+            }
+            else manager->peerMessages->BRPeerSendMempoolMessage(peer, NULL, 0, NULL, NULL); // if not syncing, request mempool
+        }
+
+        pthread_mutex_unlock(&manager->lock);
+    }
+
+    if (info) free(info);
+}
+
+// adds the spare wallet addresses the bloom filter is missing to it, and sends them to the connected peers with
+// filteradd, which keeps the chain sync going rather than stopping it for a filter rebuild; returns false without
+// changing anything when the projected false positive rate would get too high and the filter needs rebuilding instead
+static int _BRPeerManagerExtendFilter(BRPeerManager *manager)
+{
+    BRBloomFilter *filter = manager->bloomFilter;
+    BRAddress addrs[SEQUENCE_GAP_LIMIT_EXTERNAL + SEQUENCE_GAP_LIMIT_INTERNAL + 200];
+    UInt168 hashes[sizeof(addrs)/sizeof(*addrs)];
+    size_t addrsCount, count = 0;
+    BRPeerCallbackInfo *info;
+
+    // generate spare addresses the same way loadBloomFilter() does so the filter isn't extended for every wallet tx
+    addrsCount = manager->wallet->WalletUnusedAddrs(manager->wallet, addrs, SEQUENCE_GAP_LIMIT_EXTERNAL + 100, 0);
+    addrsCount += manager->wallet->WalletUnusedAddrs(manager->wallet, &addrs[addrsCount],
+                                                     SEQUENCE_GAP_LIMIT_INTERNAL + 100, 1);
+
+    for (size_t i = 0; i < addrsCount; i++) {
+        if (BRAddressHash168(&hashes[count], addrs[i].s) &&
+            ! BRBloomFilterContainsData(filter, hashes[count].u8, sizeof(*hashes))) count++;
+    }
+
+    if (count == 0) return 1;
+
+    // a filter that already has the maximum length wouldn't get any better by rebuilding it
+    if (filter->length < BLOOM_MAX_FILTER_LENGTH &&
+        BRBloomFilterFalsePositiveRate(filter, filter->elemCount + count) > BLOOM_REBUILD_FALSEPOSITIVE_RATE) return 0;
+
+    for (size_t i = 0; i < count; i++) BRBloomFilterInsertData(filter, hashes[i].u8, sizeof(*hashes));
+    manager->filterStats.extensions++;
+    manager->filterStats.insertions += count;
+
+    // blocks already requested were filtered without the new addresses, they're requested again once the download
+    // peer answers the ping below
+    if (manager->lastBlock->height < manager->estimatedHeight) {
+        BRBlockDownloadClear(manager->blockDownload, manager, manager->peerMessages->MerkleBlockFree);
+    }
+
+    for (size_t i = array_count(manager->connectedPeers); i > 0; i--) {
+        BRPeer *peer = manager->connectedPeers[i - 1];
+
+        if (BRPeerConnectStatus(peer) != BRPeerStatusConnected || ! ((BRPeerContext *)peer)->sentFilter) continue;
+
+        for (size_t j = 0; j < count; j++) {
+            manager->peerMessages->BRPeerSendFilteraddMessage(peer, hashes[j].u8, sizeof(*hashes));
+        }
+
+        peer_log(peer, "added %zu wallet addresses to bloom filter", count);
+        peer->flags |= PEER_FLAG_FILTERADD;
+        info = calloc(1, sizeof(*info));
+        assert(info != NULL);
+        info->peer = peer;
+        info->manager = manager;
+        info->filterExtension = manager->filterStats.extensions;
+        // blocks the peer sends before the pong may have been filtered without the new addresses
+        manager->peerMessages->BRPeerSendPingMessage(peer, info, _extendFilterPingDone);
+    }
+
+    return 1;
+}
+
 // unconfirmed transactions that aren't in the mempools of any of connected peers have likely dropped off the network
 static void _requestUnrelayedTxGetdataDone(void *info, int success)
 {
@@ -610,7 +770,7 @@ static void _BRPeerManagerLoadMempools(BRPeerManager *manager)
         info->manager = manager;
 
         if (peer != manager->downloadPeer || manager->fpRate > BLOOM_REDUCED_FALSEPOSITIVE_RATE*5.0) {
-            manager->loadBloomFilter(manager, peer);
+            _BRPeerManagerRebuildFilter(manager, peer);
             _BRPeerManagerPublishPendingTx(manager, peer);
             manager->peerMessages->BRPeerSendPingMessage(peer, info, _loadBloomFilterDone); // load mempool after updating bloomfilter
         }
@@ -766,7 +926,7 @@ static void _peerConnected(void *info)
               manager->lastBlock->height >= BRPeerLastBlock(peer))) {
         if (manager->lastBlock->height >= BRPeerLastBlock(peer)) { // only load bloom filter if we're done syncing
             manager->connectFailureCount = 0; // also reset connect failure count if we're already synced
-            manager->loadBloomFilter(manager, peer);
+            _BRPeerManagerRebuildFilter(manager, peer);
             _BRPeerManagerPublishPendingTx(manager, peer);
             peerInfo = calloc(1, sizeof(*peerInfo));
             assert(peerInfo != NULL);
@@ -774,6 +934,7 @@ static void _peerConnected(void *info)
             peerInfo->manager = manager;
             manager->peerMessages->BRPeerSendPingMessage(peer, peerInfo, _loadBloomFilterDone);
         }
+        else _BRPeerManagerAddDownloadPeer(manager, peer); // help the download peer with the chain sync
     }
     else { // select the peer with the lowest ping time to download the chain from if we're behind
         // BUG: XXX a malicious peer can report a higher lastblock to make us select them as the download peer, if
@@ -799,11 +960,13 @@ static void _peerConnected(void *info)
         }
 
         manager->downloadPeer = peer;
+        peer->flags |= PEER_FLAG_DOWNLOAD;
+        BRBlockDownloadClear(manager->blockDownload, manager, manager->peerMessages->MerkleBlockFree);
         manager->syncSucceeded = 0;
         manager->isConnected = 1;
         if (manager->estimatedHeight < BRPeerLastBlock(peer))
             manager->estimatedHeight = BRPeerLastBlock(peer);
-        manager->loadBloomFilter(manager, peer);
+        _BRPeerManagerRebuildFilter(manager, peer);
 		BRPeerSetCurrentBlockHeight(peer, manager->lastBlock->height);
         _BRPeerManagerPublishPendingTx(manager, peer);
         if (havePendingTx == 0)
@@ -907,6 +1070,10 @@ static void _peerDisconnected(void *info, int error)
         break;
     }
 
+    BRBlockDownloadReleasePeer(manager->blockDownload, peer); // the remaining peers take over its block windows
+    BROrphanPoolRemovePeer(manager->orphans, peer, manager, manager->peerMessages->MerkleBlockFree);
+    _BRPeerManagerRequestBlocks(manager);
+
     int havePendingTx = 0;
     for (size_t i = array_count(manager->publishedTx); i > 0; i--) {
         if (manager->publishedTx[i - 1].callback != NULL) {
@@ -1050,7 +1217,9 @@ static void _peerRelayedTx(void *info, BRTransaction *tx)
             for (size_t i = 0; i < SEQUENCE_GAP_LIMIT_EXTERNAL + SEQUENCE_GAP_LIMIT_INTERNAL; i++) {
                 if (! BRAddressHash168(&hash, addrs[i].s) ||
                     BRBloomFilterContainsData(manager->bloomFilter, hash.u8, sizeof(hash))) continue;
-                if (manager->bloomFilter) BRBloomFilterFree(manager->bloomFilter);
+                if ((manager->downloadPeer && (manager->downloadPeer->flags & PEER_FLAG_NEEDSUPDATE)) ||
+                    _BRPeerManagerExtendFilter(manager)) break; // a rebuild already pending picks up new addresses
+                BRBloomFilterFree(manager->bloomFilter);
                 manager->bloomFilter = NULL; // reset bloom filter so it's recreated with new wallet addresses
                 _BRPeerManagerUpdateFilter(manager);
                 break;
@@ -1228,7 +1397,9 @@ static void _peerRelayedPingMsg(void *info)
 	if (manager->syncIsInactivate) manager->syncIsInactivate(manager->info, manager->reconnectSeconds);
 }
 
-static void _peerRelayedBlock(void *info, BRMerkleBlock *block)
+// adds a relayed block to the chain and returns the next block that was waiting for it, if any; held is true when the
+// block was held by the block download, and is set for the block returned
+static BRMerkleBlock *_BRPeerManagerAddBlock(void *info, BRMerkleBlock *block, int *held)
 {
     BRPeer *peer = ((BRPeerCallbackInfo *)info)->peer;
     BRPeerManager *manager = ((BRPeerCallbackInfo *)info)->manager;
@@ -1236,12 +1407,15 @@ static void _peerRelayedBlock(void *info, BRMerkleBlock *block)
     UInt256 _txHashes[(sizeof(UInt256)*txCount <= 0x1000) ? txCount : 0],
             *txHashes = (sizeof(UInt256)*txCount <= 0x1000) ? _txHashes : malloc(txCount*sizeof(*txHashes));
     size_t i, j, fpCount = 0, saveCount = 0;
-    BRMerkleBlock orphan, *b, *b2, *prev, *next = NULL;
+    BRMerkleBlock *b, *b2, *prev, *next = NULL;
     uint32_t txTime = 0;
+    int scheduled, downloading;
 
     assert(txHashes != NULL);
     txCount = BRMerkleBlockTxHashes(block, txHashes, txCount);
     pthread_mutex_lock(&manager->lock);
+    scheduled = BRBlockDownloadReceived(manager->blockDownload, block->blockHash, time(NULL));
+    downloading = scheduled || *held; // the block is part of the chain download spread over several peers
     prev = BRSetGet(manager->blocks, &block->prevBlock);
 
     if (prev) {
@@ -1251,7 +1425,7 @@ static void _peerRelayedBlock(void *info, BRMerkleBlock *block)
     }
 
     // track the observed bloom filter false positive rate using a low pass filter to smooth out variance
-    if (peer == manager->downloadPeer && block->totalTx > 0) {
+    if (((peer == manager->downloadPeer && ! *held) || scheduled) && block->totalTx > 0) {
         for (i = 0; i < txCount; i++) { // wallet tx are not false-positives
             if (! BRWalletTransactionForHash(manager->wallet, txHashes[i])) fpCount++;
         }
@@ -1281,7 +1455,8 @@ static void _peerRelayedBlock(void *info, BRMerkleBlock *block)
         manager->peerMessages->MerkleBlockFree(manager, block);
         block = NULL;
     }
-    else if (manager->bloomFilter == NULL) { // ingore potentially incomplete blocks when a filter update is pending
+    else if (manager->bloomFilter == NULL || (peer->flags & PEER_FLAG_FILTERADD)) {
+        // ingore potentially incomplete blocks when a filter update is pending
         manager->peerMessages->MerkleBlockFree(manager, block);
         block = NULL;
 
@@ -1290,6 +1465,11 @@ static void _peerRelayedBlock(void *info, BRMerkleBlock *block)
             manager->connectFailureCount = 0; // reset failure count once we know our initial request didn't timeout
         }
     }
+    else if (! prev && scheduled) { // block arrived from one download window ahead of its parent from another
+        b = BRBlockDownloadHoldBlock(manager->blockDownload, block);
+        if (b) manager->peerMessages->MerkleBlockFree(manager, b);
+        block = NULL;
+    }
     else if (! prev) { // block is an orphan
         peer_log(peer, "relayed orphan block %s, previous %s, last block is %s, height %"PRIu32,
                  u256hex(block->blockHash), u256hex(block->prevBlock), u256hex(manager->lastBlock->blockHash),
@@ -1300,9 +1480,11 @@ static void _peerRelayedBlock(void *info, BRMerkleBlock *block)
             block = NULL;
         }
         else {
+            BRMerkleBlock *lastOrphan = BROrphanPoolNewest(manager->orphans);
+
             // call getblocks, unless we already did with the previous block, or we're still syncing
             if (manager->lastBlock->height >= BRPeerLastBlock(peer) &&
-                (! manager->lastOrphan || ! UInt256Eq(&manager->lastOrphan->blockHash, &block->prevBlock))) {
+                (! lastOrphan || ! UInt256Eq(&lastOrphan->blockHash, &block->prevBlock))) {
                 UInt256 locators[_BRPeerManagerBlockLocators(manager, NULL, 0)];
                 size_t locatorsCount = _BRPeerManagerBlockLocators(manager, locators,
                                                                    sizeof(locators)/sizeof(*locators));
@@ -1311,8 +1493,11 @@ static void _peerRelayedBlock(void *info, BRMerkleBlock *block)
                 manager->peerMessages->BRPeerSendGetblocksMessage(peer, locators, locatorsCount, UINT256_ZERO);
             }
 
-            BRSetAdd(manager->orphans, block); // BUG: limit total orphans to avoid memory exhaustion attack
-            manager->lastOrphan = block;
+            // the pool frees the oldest orphans of the peer, or of all peers, once it's full
+            if (! BROrphanPoolAdd(manager->orphans, block, peer, manager, manager->peerMessages->MerkleBlockFree)) {
+                block = NULL;
+            }
+
             BRPeerScheduleDisconnect(peer, PROTOCOL_TIMEOUT); // reschedule sync timeout
         }
     }
@@ -1336,8 +1521,9 @@ static void _peerRelayedBlock(void *info, BRMerkleBlock *block)
         if (txCount > 0) BRWalletUpdateTransactions(manager->wallet, txHashes, txCount, block->height, txTime);
         if (manager->downloadPeer) BRPeerSetCurrentBlockHeight(manager->downloadPeer, block->height);
 
-        if (block->height < manager->estimatedHeight && peer == manager->downloadPeer) {
-            BRPeerScheduleDisconnect(peer, PROTOCOL_TIMEOUT); // reschedule sync timeout
+        if (block->height < manager->estimatedHeight && manager->downloadPeer &&
+            (peer == manager->downloadPeer || downloading)) {
+            BRPeerScheduleDisconnect(manager->downloadPeer, PROTOCOL_TIMEOUT); // reschedule sync timeout
             manager->connectFailureCount = 0; // reset failure count once we know our initial request didn't timeout
         }
 
@@ -1364,16 +1550,17 @@ static void _peerRelayedBlock(void *info, BRMerkleBlock *block)
         b = BRSetAdd(manager->blocks, block);
 
         if (b != block) {
-            if (BRSetGet(manager->orphans, b) == b) BRSetRemove(manager->orphans, b);
-            if (manager->lastOrphan == b) manager->lastOrphan = NULL;
+            BROrphanPoolRemove(manager->orphans, b);
             manager->peerMessages->MerkleBlockFree(manager, b);
         }
     }
     else if (manager->lastBlock->height < BRPeerLastBlock(peer) &&
              block->height > manager->lastBlock->height + 1) { // special case, new block mined durring rescan
         peer_log(peer, "marking new block #%"PRIu32" as orphan until rescan completes", block->height);
-        BRSetAdd(manager->orphans, block); // mark as orphan til we're caught up
-        manager->lastOrphan = block;
+        // mark as orphan til we're caught up
+        if (! BROrphanPoolAdd(manager->orphans, block, peer, manager, manager->peerMessages->MerkleBlockFree)) {
+            block = NULL;
+        }
     }
     else if (block->height <= manager->params->checkpoints[manager->params->checkpointsCount - 1].height) { // old fork
         peer_log(peer, "ignoring block on fork older than most recent checkpoint, block #%"PRIu32", hash: %s",
@@ -1440,9 +1627,9 @@ static void _peerRelayedBlock(void *info, BRMerkleBlock *block)
     if (block && block->height != BLOCK_UNKNOWN_HEIGHT) {
         if (block->height > manager->estimatedHeight) manager->estimatedHeight = block->height;
 
-        // check if the next block was received as an orphan
-        orphan.prevBlock = block->blockHash;
-        next = BRSetRemove(manager->orphans, &orphan);
+        // check if the next block was received as an orphan, or ahead of this one by the block download
+        next = BROrphanPoolNextBlock(manager->orphans, block->blockHash);
+        *held = (! next && (next = BRBlockDownloadNextBlock(manager->blockDownload, block->blockHash)) != NULL);
     }
 
     BRMerkleBlock *saveBlocks[saveCount];
@@ -1458,6 +1645,7 @@ static void _peerRelayedBlock(void *info, BRMerkleBlock *block)
     j = (i > 0) ? saveBlocks[i - 1]->height % BLOCK_DIFFICULTY_INTERVAL : 0;
     if (j > 0) i -= (i > BLOCK_DIFFICULTY_INTERVAL - j) ? BLOCK_DIFFICULTY_INTERVAL - j : i;
     assert(i == 0 || (saveBlocks[i - 1]->height % BLOCK_DIFFICULTY_INTERVAL) == 0);
+    if (scheduled) _BRPeerManagerRequestBlocks(manager); // the peer may have finished a window
     pthread_mutex_unlock(&manager->lock);
     if (i > 0 && manager->saveBlocks) manager->saveBlocks(manager->info, (i > 1 ? 1 : 0), saveBlocks, i);
 
@@ -1466,7 +1654,16 @@ static void _peerRelayedBlock(void *info, BRMerkleBlock *block)
         manager->txStatusUpdate(manager->info); // notify that transaction confirmations may have changed
     }
 
-    if (next) _peerRelayedBlock(info, next);
+    return next;
+}
+
+static void _peerRelayedBlock(void *info, BRMerkleBlock *block)
+{
+    int held = 0;
+
+    // blocks waiting for this one are added in a loop rather than recursively, a finished download window can release
+    // a long run of held blocks at once
+    while (block) block = _BRPeerManagerAddBlock(info, block, &held);
 }
 
 static void _peerDataNotfound(void *info, const UInt256 txHashes[], size_t txCount,
@@ -1482,6 +1679,12 @@ static void _peerDataNotfound(void *info, const UInt256 txHashes[], size_t txCou
         _BRTxPeerListRemovePeer(manager->txRequests, txHashes[i], peer);
     }
 
+    if (blockCount > 0 && peer != manager->downloadPeer) { // the peer can't serve the chain download
+        peer->flags &= ~PEER_FLAG_DOWNLOAD;
+        BRBlockDownloadReleasePeer(manager->blockDownload, peer);
+        _BRPeerManagerRequestBlocks(manager);
+    }
+
     pthread_mutex_unlock(&manager->lock);
 }
 
@@ -1565,6 +1768,7 @@ BRPeerManager *BRPeerManagerNew(const BRChainParams *params, BRWallet *wallet, u
 {
     BRPeerManager *manager = calloc(1, sizeof(*manager));
     BRMerkleBlock orphan, *block = NULL;
+    BRSet *saved;
 
     assert(manager != NULL);
     assert(params != NULL);
@@ -1586,8 +1790,11 @@ BRPeerManager *BRPeerManagerNew(const BRChainParams *params, BRWallet *wallet, u
     qsort(manager->peers, array_count(manager->peers), sizeof(*manager->peers), _peerTimestampCompare);
     array_new(manager->connectedPeers, PEER_MAX_CONNECTIONS);
     manager->blocks = BRSetNew(BRMerkleBlockHash, BRMerkleBlockEq, blocksCount);
-    manager->orphans = BRSetNew(_BRPrevBlockHash, _BRPrevBlockEq, blocksCount); // orphans are indexed by prevBlock
+    manager->orphans = BROrphanPoolNew(ORPHAN_POOL_MAX_COUNT, ORPHAN_POOL_MAX_BYTES, ORPHAN_POOL_PEER_MAX_COUNT,
+                                       ORPHAN_POOL_PEER_MAX_BYTES);
     manager->checkpoints = BRSetNew(_BRBlockHeightHash, _BRBlockHeightEq, 100); // checkpoints are indexed by height
+    manager->blockDownload = BRBlockDownloadNew(BLOCK_DOWNLOAD_WINDOW_SIZE, BLOCK_DOWNLOAD_PEER_WINDOWS,
+                                                BLOCK_DOWNLOAD_STALL_TIMEOUT);
 
     for (size_t i = 0; i < manager->params->checkpointsCount; i++) {
         block = manager->peerMessages->MerkleBlockNew(manager);
@@ -1601,10 +1808,11 @@ BRPeerManager *BRPeerManagerNew(const BRChainParams *params, BRWallet *wallet, u
     }
 
     block = NULL;
+    saved = BRSetNew(_BRPrevBlockHash, _BRPrevBlockEq, blocksCount); // saved blocks are indexed by prevBlock
 
     for (size_t i = 0; blocks && i < blocksCount; i++) {
         assert(blocks[i]->height != BLOCK_UNKNOWN_HEIGHT); // height must be saved/restored along with serialized block
-        BRSetAdd(manager->orphans, blocks[i]);
+        BRSetAdd(saved, blocks[i]);
 
         if ((blocks[i]->height % BLOCK_DIFFICULTY_INTERVAL) == 0 &&
             (! block || blocks[i]->height > block->height)) block = blocks[i]; // find last transition block
@@ -1614,11 +1822,20 @@ BRPeerManager *BRPeerManagerNew(const BRChainParams *params, BRWallet *wallet, u
         BRSetAdd(manager->blocks, block);
         manager->lastBlock = block;
         orphan.prevBlock = block->prevBlock;
-        BRSetRemove(manager->orphans, &orphan);
+        BRSetRemove(saved, &orphan);
         orphan.prevBlock = block->blockHash;
-        block = BRSetGet(manager->orphans, &orphan);
+        block = BRSetGet(saved, &orphan);
+    }
+
+    // saved blocks that aren't in the chain are kept as orphans, as far as the orphan pool limits allow
+    while ((block = BRSetIterate(saved, NULL)) != NULL) {
+        BRSetRemove(saved, block);
+        if (BRSetGet(manager->blocks, block) == block) continue;
+        BROrphanPoolAdd(manager->orphans, block, NULL, manager, manager->peerMessages->MerkleBlockFree);
     }
 
+    BRSetFree(saved);
+
     array_new(manager->txRelays, 10);
     array_new(manager->txRequests, 10);
     array_new(manager->publishedTx, 10);
@@ -1671,6 +1888,17 @@ void BRPeerManagerSetCallbacks(BRPeerManager *manager, void *info,
     manager->publishTransactions = publishTransactions;
 }
 
+// limits the number of orphan blocks kept and the memory they take up, in total and for blocks from any one peer
+void BRPeerManagerSetOrphanLimits(BRPeerManager *manager, size_t maxCount, size_t maxBytes, size_t peerMaxCount,
+                                  size_t peerMaxBytes)
+{
+    assert(manager != NULL);
+    pthread_mutex_lock(&manager->lock);
+    BROrphanPoolSetLimits(manager->orphans, maxCount, maxBytes, peerMaxCount, peerMaxBytes, manager,
+                          manager->peerMessages->MerkleBlockFree);
+    pthread_mutex_unlock(&manager->lock);
+}
+
 // specifies a single fixed peer to use when connecting to the bitcoin network
 // set address to UINT128_ZERO to revert to default behavior
 void BRPeerManagerSetFixedPeer(BRPeerManager *manager, UInt128 address, uint16_t port)
@@ -1946,6 +2174,29 @@ static void _publishTxInvDone(void *info, int success)
     pthread_mutex_unlock(&manager->lock);
 }
 
+// hands the block hashes peer announced in an inv message to the download scheduler, which spreads the chain sync
+// over all connected peers; returns true if it took them, in which case the caller must not request them itself
+int BRPeerManagerScheduleBlocks(BRPeerManager *manager, BRPeer *peer, const UInt256 blockHashes[], size_t blockCount)
+{
+    int r = 0;
+
+    assert(manager != NULL);
+    assert(peer != NULL);
+    assert(blockHashes != NULL || blockCount == 0);
+    pthread_mutex_lock(&manager->lock);
+
+    // only the chain sync the download peer drives with getblocks is scheduled, a single new block is relayed as usual
+    if (peer == manager->downloadPeer && blockCount > 1 && manager->bloomFilter &&
+        manager->lastBlock->height < manager->estimatedHeight) {
+        BRBlockDownloadAddHashes(manager->blockDownload, blockHashes, blockCount);
+        _BRPeerManagerRequestBlocks(manager);
+        r = 1;
+    }
+
+    pthread_mutex_unlock(&manager->lock);
+    return r;
+}
+
 // publishes tx to bitcoin network (do not call BRTransactionFree() on tx afterward)
 void BRPeerManagerPublishTx(BRPeerManager *manager, BRTransaction *tx, void *info,
                             void (*callback)(void *info, const UInt256 *hash, int error, const char *reason))
@@ -2023,6 +2274,18 @@ size_t BRPeerManagerRelayCount(BRPeerManager *manager, UInt256 txHash)
     return count;
 }
 
+// bloom filter statistics since the manager was created
+void BRPeerManagerGetFilterStats(BRPeerManager *manager, BRFilterStats *stats)
+{
+    assert(manager != NULL);
+    assert(stats != NULL);
+    pthread_mutex_lock(&manager->lock);
+    *stats = manager->filterStats;
+    stats->fpRate = (manager->bloomFilter) ?
+                    BRBloomFilterFalsePositiveRate(manager->bloomFilter, manager->bloomFilter->elemCount) : 0;
+    pthread_mutex_unlock(&manager->lock);
+}
+
 const BRChainParams *BRPeerManagerChainParams (BRPeerManager *manager) {
     return manager->params;
 }
@@ -2039,9 +2302,9 @@ void BRPeerManagerFree(BRPeerManager *manager)
     array_free(manager->connectedPeers);
     BRSetApply(manager->blocks, manager, manager->peerMessages->ApplyFreeBlock);
     BRSetFree(manager->blocks);
-    BRSetApply(manager->orphans, manager, manager->peerMessages->ApplyFreeBlock);
-    BRSetFree(manager->orphans);
+    BROrphanPoolFree(manager->orphans, manager, manager->peerMessages->MerkleBlockFree);
     BRSetFree(manager->checkpoints);
+    BRBlockDownloadFree(manager->blockDownload, manager, manager->peerMessages->MerkleBlockFree);
     for (size_t i = array_count(manager->txRelays); i > 0; i--) free(manager->txRelays[i - 1].peers);
     array_free(manager->txRelays);
     for (size_t i = array_count(manager->txRequests); i > 0; i--) free(manager->txRequests[i - 1].peers);
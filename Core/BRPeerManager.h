@@ -32,6 +32,8 @@
 #include "BRChainParams.h"
 #include "BRPeerMessages.h"
 #include "BRBloomFilter.h"
+#include "BRBlockDownload.h"
+#include "BROrphanPool.h"
 #include <stddef.h>
 #include <inttypes.h>
 
@@ -39,7 +41,7 @@
 extern "C" {
 #endif
 
-#define PEER_MAX_CONNECTIONS 1
+#define PEER_MAX_CONNECTIONS 3
 
 typedef struct {
 	BRTransaction *tx;
@@ -53,6 +55,13 @@ typedef struct {
 	BRPeer *peers;
 } BRTxPeerList;
 
+typedef struct {
+	uint64_t rebuilds; // bloom filters built from the whole wallet and sent with filterload
+	double rebuildTime; // seconds spent building them
+	uint64_t extensions, insertions; // times the filter was extended with filteradd, and the elements added
+	double fpRate; // projected false positive rate of the current filter, 0 while it's being rebuilt
+} BRFilterStats;
+
 typedef struct BRPeerManagerStruct {
 	const BRChainParams *params;
 	BRWallet *wallet;
@@ -62,9 +71,12 @@ typedef struct BRPeerManagerStruct {
 	char downloadPeerName[INET6_ADDRSTRLEN + 6];
 	uint32_t earliestKeyTime, reconnectSeconds, syncStartHeight, filterUpdateHeight, estimatedHeight;
 	BRBloomFilter *bloomFilter;
+	BRFilterStats filterStats;
 	double fpRate, averageTxPerBlock;
-	BRSet *blocks, *orphans, *checkpoints;
-	BRMerkleBlock *lastBlock, *lastOrphan;
+	BRSet *blocks, *checkpoints;
+	BROrphanPool *orphans;
+	BRMerkleBlock *lastBlock;
+	BRBlockDownload *blockDownload;
 	BRTxPeerList *txRelays, *txRequests;
 	BRPublishedTx *publishedTx;
 	UInt256 *publishedTxHashes;
@@ -144,6 +156,11 @@ void BRPeerManagerSetCallbacks(BRPeerManager *manager, void *info,
 							   void (*loadBloomFilter)(BRPeerManager *manager, BRPeer *peer),
 							   void (*publishTransactions)(BRPeerManager *manager, BRTransaction *tx[], size_t txCount));
 
+// limits the number of orphan blocks kept and the memory they take up, in total and for blocks from any one peer,
+// the defaults are ORPHAN_POOL_MAX_COUNT, ORPHAN_POOL_MAX_BYTES, ORPHAN_POOL_PEER_MAX_COUNT and ORPHAN_POOL_PEER_MAX_BYTES
+void BRPeerManagerSetOrphanLimits(BRPeerManager *manager, size_t maxCount, size_t maxBytes, size_t peerMaxCount,
+								  size_t peerMaxBytes);
+
 // specifies a single fixed peer to use when connecting to the bitcoin network
 // set address to UINT128_ZERO to revert to default behavior
 void BRPeerManagerSetFixedPeer(BRPeerManager *manager, UInt128 address, uint16_t port);
@@ -180,6 +197,14 @@ size_t BRPeerManagerPeerCount(BRPeerManager *manager);
 // description of the peer most recently used to sync blockchain data
 const char *BRPeerManagerDownloadPeerName(BRPeerManager *manager);
 
+// hands the block hashes peer announced in an inv message to the download scheduler, which spreads the chain sync
+// over all connected peers; returns true if it took them, in which case the caller must not request them itself
+int BRPeerManagerScheduleBlocks(BRPeerManager *manager, BRPeer *peer, const UInt256 blockHashes[], size_t blockCount);
+
+// bloom filter statistics since the manager was created: a rising rebuilds count or rebuildTime/rebuilds means the
+// wallet outgrows its filter, most new addresses should be covered by extensions instead
+void BRPeerManagerGetFilterStats(BRPeerManager *manager, BRFilterStats *stats);
+
 // publishes tx to bitcoin network (do not call BRTransactionFree() on tx afterward)
 void BRPeerManagerPublishTx(BRPeerManager *manager, BRTransaction *tx, void *info,
 							void (*callback)(void *info, const UInt256 *hash, int error, const char *reason));
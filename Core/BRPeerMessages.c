@@ -356,6 +356,10 @@ static int _BRPeerAcceptInvMessage(BRPeer *peer, const uint8_t *msg, size_t msgL
 
 			if (ctx->needsFilterUpdate) blockCount = 0;
 
+			size_t requestCount = blockCount;
+			if (blockCount > 0 && BRPeerManagerScheduleBlocks(ctx->manager, peer, blockHashes, blockCount))
+				requestCount = 0; // the peer manager requests them from all its download peers
+
 			for (i = 0, j = 0; i < txCount; i++) {
 				UInt256Get(&hash, transactions[i]);
 
@@ -366,7 +370,7 @@ static int _BRPeerAcceptInvMessage(BRPeer *peer, const uint8_t *msg, size_t msgL
 			}
 
 			BRPeerAddKnownTxHashes(peer, txHashes, j);
-			if (j > 0 || blockCount > 0) BRPeerSendGetdata(peer, txHashes, j, blockHashes, blockCount);
+			if (j > 0 || requestCount > 0) BRPeerSendGetdata(peer, txHashes, j, blockHashes, requestCount);
 
 			// to improve chain download performance, if we received 500 block hashes, request the next 500 block hashes
 			if (blockCount >= 500) {
@@ -614,6 +618,19 @@ void BRPeerSendFilterload(BRPeer *peer, BRBloomFilter *filter)
 	BRPeerSendMessage(peer, data, len, MSG_FILTERLOAD);
 }
 
+void BRPeerSendFilteradd(BRPeer *peer, const uint8_t *data, size_t dataLen)
+{
+	uint8_t msg[BRVarIntSize(dataLen) + dataLen];
+	size_t off = 0;
+
+	assert(data != NULL || dataLen == 0);
+	assert(dataLen <= MAX_FILTERADD_LENGTH);
+	off += BRVarIntSet(&msg[off], sizeof(msg) - off, dataLen);
+	memcpy(&msg[off], data, dataLen);
+	off += dataLen;
+	BRPeerSendMessage(peer, msg, off, MSG_FILTERADD);
+}
+
 void BRPeerSendGetheaders(BRPeer *peer, const UInt256 locators[], size_t locatorsCount, UInt256 hashStop)
 {
 	peer_log(peer, "*********BRPeerSendGetheaders*************");
@@ -1011,6 +1028,7 @@ BRPeerMessages *BRPeerMessageNew(void) {
 	peerMessages->BRPeerAcceptNotFoundMessage = _BRPeerAcceptNotfoundMessage;
 
 	peerMessages->BRPeerSendFilterloadMessage = BRPeerSendFilterload;
+	peerMessages->BRPeerSendFilteraddMessage = BRPeerSendFilteradd;
 
 	peerMessages->BRPeerSendGetheadersMessage = BRPeerSendGetheaders;
 
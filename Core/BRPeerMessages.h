@@ -21,6 +21,7 @@ extern "C" {
 #define HEADER_LENGTH      24
 #define MAX_MSG_LENGTH     0x02000000
 #define MAX_GETDATA_HASHES 50000
+#define MAX_FILTERADD_LENGTH 520 // BIP37 limit on the data of a filteradd message
 #define ENABLED_SERVICES   0ULL  // we don't provide full blocks to remote nodes
 #define PROTOCOL_VERSION   70013
 #define MIN_PROTO_VERSION  70002 // peers earlier than this protocol version not supported (need v0.9 txFee relay rules)
@@ -76,6 +77,8 @@ typedef struct {
 	void *volatile mempoolInfo;
 	void (*volatile mempoolCallback)(void *info, int success);
 	pthread_t thread;
+	pthread_mutex_t lock; // guards connection
+	struct BRPeerConnectionStruct *connection; // socket state while connecting or connected when a reactor is used
 
 	BRPeerManager *manager;
 } BRPeerContext;
@@ -109,6 +112,9 @@ typedef struct {
 
 	void (*BRPeerSendFilterloadMessage)(BRPeer *peer, BRBloomFilter *filter);
 
+	// adds one element to the filter the peer has loaded, data is at most MAX_FILTERADD_LENGTH bytes
+	void (*BRPeerSendFilteraddMessage)(BRPeer *peer, const uint8_t *data, size_t dataLen);
+
 	void (*BRPeerSendGetheadersMessage)(BRPeer *peer, const UInt256 locators[], size_t locatorsCount, UInt256 hashStop);
 
 	void (*BRPeerSendGetdataMessage)(BRPeer *peer, const UInt256 txHashes[], size_t txCount, const UInt256 blockHashes[],
@@ -0,0 +1,480 @@
+// Copyright (c) 2012-2018 The Elastos Open Source Project
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include "BRPeerReactor.h"
+
+#if PEER_REACTOR
+
+#include <stdlib.h>
+#include <stdint.h>
+#include <assert.h>
+#include <errno.h>
+#include <time.h>
+#include <unistd.h>
+#include <pthread.h>
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+
+#define REACTOR_MAX_EVENTS 64
+#define REACTOR_STACK_SIZE (512 * 1024) // same as the peer threads the reactor replaces, callbacks run on it
+
+struct BRPeerReactorTimerStruct {
+    BRPeerReactorTimer *prev, *next; // links in a wheel slot or in the list of timers due, NULL when not armed
+    BRPeerReactor *reactor;
+    uint64_t expires; // wheel tick the timer fires at
+    void *info;
+    void (*fired)(void *info);
+};
+
+struct BRPeerReactorSourceStruct {
+    BRPeerReactorSource *nextRemoved;
+    BRPeerReactor *reactor;
+    int fd, events, removed;
+    void *info;
+    void (*ready)(void *info, int events);
+};
+
+struct BRPeerReactorStruct {
+    int epoll, wake;
+    pthread_t thread;
+    pthread_mutex_t lock;
+    volatile int stopped;
+    uint64_t tick; // last tick the wheel was advanced to
+    size_t timerCount, sourceCount;
+    BRPeerReactorTimer wheel[PEER_REACTOR_WHEEL_SLOTS], due; // list heads
+    BRPeerReactorSource *removed; // sources removed while events for them may still be waiting to be dispatched
+    uint8_t *buffers[PEER_BUFFER_CLASSES]; // free buffers, each one starts with a pointer to the next
+    size_t bufferCounts[PEER_BUFFER_CLASSES];
+    BRPeerBufferStats bufferStats;
+};
+
+static double _BRPeerReactorNow(void)
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + (double)ts.tv_nsec/1000000000;
+}
+
+inline static void _BRPeerReactorTimerUnlink(BRPeerReactorTimer *timer)
+{
+    timer->prev->next = timer->next;
+    timer->next->prev = timer->prev;
+    timer->prev = timer->next = NULL;
+}
+
+inline static void _BRPeerReactorTimerLink(BRPeerReactorTimer *head, BRPeerReactorTimer *timer)
+{
+    timer->prev = head->prev;
+    timer->next = head;
+    head->prev->next = timer;
+    head->prev = timer;
+}
+
+static uint32_t _BRPeerReactorEpollEvents(int events)
+{
+    return ((events & PEER_REACTOR_READ) ? EPOLLIN | EPOLLRDHUP : 0) | ((events & PEER_REACTOR_WRITE) ? EPOLLOUT : 0);
+}
+
+static void _BRPeerReactorWake(BRPeerReactor *reactor)
+{
+    uint64_t one = 1;
+
+    if (write(reactor->wake, &one, sizeof(one)) < 0) assert(errno == EAGAIN); // counter full means a wake is pending
+}
+
+// moves the timers that are due into the due list and fires them, the lock must be held
+static void _BRPeerReactorAdvance(BRPeerReactor *reactor)
+{
+    uint64_t tick = (uint64_t)(_BRPeerReactorNow()/PEER_REACTOR_TICK);
+    BRPeerReactorTimer *head, *timer, *next;
+    void (*fired)(void *);
+    void *info;
+
+    // after a stall one turn of the wheel visits every slot, timers further behind than that are due anyway
+    if (tick - reactor->tick > PEER_REACTOR_WHEEL_SLOTS) reactor->tick = tick - PEER_REACTOR_WHEEL_SLOTS;
+
+    while (reactor->tick < tick) {
+        head = &reactor->wheel[++reactor->tick % PEER_REACTOR_WHEEL_SLOTS];
+
+        for (timer = head->next; timer != head; timer = next) {
+            next = timer->next;
+            if (timer->expires > tick) continue; // due on a later turn
+            _BRPeerReactorTimerUnlink(timer);
+            _BRPeerReactorTimerLink(&reactor->due, timer);
+        }
+    }
+
+    // a fired callback may set or free any timer, including ones still in the due list, so take them one at a time
+    while ((timer = reactor->due.next) != &reactor->due) {
+        _BRPeerReactorTimerUnlink(timer);
+        reactor->timerCount--;
+        fired = timer->fired;
+        info = timer->info;
+        pthread_mutex_unlock(&reactor->lock);
+        fired(info);
+        pthread_mutex_lock(&reactor->lock);
+    }
+}
+
+static void *_BRPeerReactorThreadRoutine(void *arg)
+{
+    BRPeerReactor *reactor = arg;
+    struct epoll_event events[REACTOR_MAX_EVENTS];
+    BRPeerReactorSource *source;
+    void (*ready)(void *, int);
+    void *info;
+    uint64_t n;
+    int count, timeout, flags;
+
+    while (! reactor->stopped) {
+        pthread_mutex_lock(&reactor->lock);
+        timeout = -1; // with no timers armed, sleep until there's I/O or a wake
+
+        if (reactor->timerCount > 0) { // wake up for the next tick
+            timeout = (int)(((reactor->tick + 1)*PEER_REACTOR_TICK - _BRPeerReactorNow())*1000) + 1;
+            if (timeout < 0) timeout = 0;
+        }
+
+        pthread_mutex_unlock(&reactor->lock);
+        count = epoll_wait(reactor->epoll, events, REACTOR_MAX_EVENTS, timeout);
+        if (count < 0) count = 0; // EINTR
+
+        for (int i = 0; i < count; i++) {
+            if (! events[i].data.ptr) { // wake
+                if (read(reactor->wake, &n, sizeof(n)) < 0) assert(errno == EAGAIN);
+                continue;
+            }
+
+            source = events[i].data.ptr;
+            pthread_mutex_lock(&reactor->lock);
+            ready = (source->removed) ? NULL : source->ready;
+            info = source->info;
+            pthread_mutex_unlock(&reactor->lock);
+            flags = ((events[i].events & EPOLLIN) ? PEER_REACTOR_READ : 0) |
+                    ((events[i].events & EPOLLOUT) ? PEER_REACTOR_WRITE : 0) |
+                    ((events[i].events & (EPOLLHUP | EPOLLRDHUP | EPOLLERR)) ? PEER_REACTOR_HUP : 0);
+            if (ready) ready(info, flags);
+        }
+
+        pthread_mutex_lock(&reactor->lock);
+        _BRPeerReactorAdvance(reactor);
+
+        // every event returned by epoll_wait has been dispatched, nothing can refer to removed sources any more
+        while ((source = reactor->removed) != NULL) {
+            reactor->removed = source->nextRemoved;
+            free(source);
+        }
+
+        pthread_mutex_unlock(&reactor->lock);
+    }
+
+    return NULL;
+}
+
+// returns a newly allocated reactor with its own thread that must be freed by calling BRPeerReactorFree()
+BRPeerReactor *BRPeerReactorNew(void)
+{
+    BRPeerReactor *reactor = calloc(1, sizeof(*reactor));
+    struct epoll_event event = { EPOLLIN, { NULL } };
+    pthread_attr_t attr;
+    int r = 1;
+
+    assert(reactor != NULL);
+    reactor->epoll = epoll_create1(EPOLL_CLOEXEC);
+    reactor->wake = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+    assert(reactor->epoll >= 0);
+    assert(reactor->wake >= 0);
+    if (epoll_ctl(reactor->epoll, EPOLL_CTL_ADD, reactor->wake, &event) < 0) r = 0;
+    reactor->tick = (uint64_t)(_BRPeerReactorNow()/PEER_REACTOR_TICK);
+    reactor->due.prev = reactor->due.next = &reactor->due;
+
+    for (size_t i = 0; i < PEER_REACTOR_WHEEL_SLOTS; i++) {
+        reactor->wheel[i].prev = reactor->wheel[i].next = &reactor->wheel[i];
+    }
+
+    pthread_mutex_init(&reactor->lock, NULL);
+
+    if (! r || pthread_attr_init(&attr) != 0) r = 0;
+    else {
+        if (pthread_attr_setstacksize(&attr, REACTOR_STACK_SIZE) != 0 ||
+            pthread_create(&reactor->thread, &attr, _BRPeerReactorThreadRoutine, reactor) != 0) r = 0;
+        pthread_attr_destroy(&attr);
+    }
+
+    assert(r);
+    return reactor;
+}
+
+inline static size_t _BRPeerBufferClass(size_t size)
+{
+    size_t class = 0;
+
+    while (class < PEER_BUFFER_CLASSES - 1 && ((size_t)PEER_BUFFER_MIN_SIZE << (2*class)) < size) class++;
+    return class;
+}
+
+static BRPeerReactor *_sharedReactors[PEER_REACTOR_THREADS];
+static pthread_once_t _sharedReactorsOnce = PTHREAD_ONCE_INIT;
+static unsigned _sharedReactorsNext = 0;
+
+static void _BRPeerReactorSharedInit(void)
+{
+    for (size_t i = 0; i < PEER_REACTOR_THREADS; i++) _sharedReactors[i] = BRPeerReactorNew();
+}
+
+// returns one of the process wide reactors, round robin, they are started on first use and never freed
+BRPeerReactor *BRPeerReactorShared(void)
+{
+    pthread_once(&_sharedReactorsOnce, _BRPeerReactorSharedInit);
+    return _sharedReactors[__sync_fetch_and_add(&_sharedReactorsNext, 1) % PEER_REACTOR_THREADS];
+}
+
+// watches fd for the given events, ready(info, events) is called when fd is ready or has hung up
+BRPeerReactorSource *BRPeerReactorAdd(BRPeerReactor *reactor, int fd, int events, void *info,
+                                      void (*ready)(void *info, int events))
+{
+    BRPeerReactorSource *source = calloc(1, sizeof(*source));
+    struct epoll_event event;
+
+    assert(reactor != NULL);
+    assert(source != NULL);
+    assert(ready != NULL);
+    source->reactor = reactor;
+    source->fd = fd;
+    source->events = events;
+    source->info = info;
+    source->ready = ready;
+    event.events = _BRPeerReactorEpollEvents(events);
+    event.data.ptr = source;
+
+    if (epoll_ctl(reactor->epoll, EPOLL_CTL_ADD, fd, &event) < 0) {
+        free(source);
+        source = NULL;
+    }
+    else {
+        pthread_mutex_lock(&reactor->lock);
+        reactor->sourceCount++;
+        pthread_mutex_unlock(&reactor->lock);
+    }
+
+    return source;
+}
+
+// changes the events source is watched for
+void BRPeerReactorSetEvents(BRPeerReactorSource *source, int events)
+{
+    struct epoll_event event;
+
+    assert(source != NULL);
+    pthread_mutex_lock(&source->reactor->lock);
+
+    if (! source->removed && source->events != events) {
+        source->events = events;
+        event.events = _BRPeerReactorEpollEvents(events);
+        event.data.ptr = source;
+        epoll_ctl(source->reactor->epoll, EPOLL_CTL_MOD, source->fd, &event);
+    }
+
+    pthread_mutex_unlock(&source->reactor->lock);
+}
+
+// stops watching source and frees it, call before closing its fd
+void BRPeerReactorRemove(BRPeerReactorSource *source)
+{
+    BRPeerReactor *reactor;
+
+    assert(source != NULL);
+    reactor = source->reactor;
+    epoll_ctl(reactor->epoll, EPOLL_CTL_DEL, source->fd, NULL);
+    pthread_mutex_lock(&reactor->lock);
+    source->removed = 1;
+    source->nextRemoved = reactor->removed;
+    reactor->removed = source;
+    reactor->sourceCount--;
+    pthread_mutex_unlock(&reactor->lock);
+}
+
+// returns a newly allocated timer that isn't armed, it must be freed by calling BRPeerReactorTimerFree()
+BRPeerReactorTimer *BRPeerReactorTimerNew(BRPeerReactor *reactor, void *info, void (*fired)(void *info))
+{
+    BRPeerReactorTimer *timer = calloc(1, sizeof(*timer));
+
+    assert(reactor != NULL);
+    assert(timer != NULL);
+    assert(fired != NULL);
+    timer->reactor = reactor;
+    timer->info = info;
+    timer->fired = fired;
+    return timer;
+}
+
+// (re)arms timer to call fired(info) once after the given number of seconds, rounded up to the next wheel tick, or
+// cancels it when seconds < 0
+void BRPeerReactorTimerSet(BRPeerReactorTimer *timer, double seconds)
+{
+    BRPeerReactor *reactor;
+    double due;
+    uint64_t expires;
+    int wake = 0;
+
+    assert(timer != NULL);
+    reactor = timer->reactor;
+    due = (_BRPeerReactorNow() + ((seconds > 0) ? seconds : 0))/PEER_REACTOR_TICK;
+    expires = (uint64_t)due;
+    if (expires < due) expires++; // round up, a timer never fires early
+    pthread_mutex_lock(&reactor->lock);
+
+    if (timer->next) {
+        _BRPeerReactorTimerUnlink(timer);
+        reactor->timerCount--;
+    }
+
+    if (seconds >= 0) {
+        if (expires <= reactor->tick) expires = reactor->tick + 1; // the current slot has already been visited
+        timer->expires = expires;
+        _BRPeerReactorTimerLink(&reactor->wheel[expires % PEER_REACTOR_WHEEL_SLOTS], timer);
+        wake = (reactor->timerCount++ == 0 && ! BRPeerReactorIsCurrent(reactor)); // reactor may be waiting forever
+    }
+
+    pthread_mutex_unlock(&reactor->lock);
+    if (wake) _BRPeerReactorWake(reactor);
+}
+
+// cancels and frees timer
+void BRPeerReactorTimerFree(BRPeerReactorTimer *timer)
+{
+    assert(timer != NULL);
+    BRPeerReactorTimerSet(timer, -1);
+    free(timer);
+}
+
+// true when called from the reactor's own thread
+int BRPeerReactorIsCurrent(const BRPeerReactor *reactor)
+{
+    assert(reactor != NULL);
+    return pthread_equal(pthread_self(), reactor->thread);
+}
+
+// returns a buffer of at least size bytes from the reactor's pool and writes its capacity to capacity, the buffer
+// must be given back with BRPeerReactorBufferPut()
+uint8_t *BRPeerReactorBufferGet(BRPeerReactor *reactor, size_t size, size_t *capacity)
+{
+    size_t class = _BRPeerBufferClass(size), classSize = (size_t)PEER_BUFFER_MIN_SIZE << (2*class);
+    uint8_t *buf;
+
+    assert(reactor != NULL);
+    assert(capacity != NULL);
+    assert(size <= classSize);
+    pthread_mutex_lock(&reactor->lock);
+    buf = reactor->buffers[class];
+    reactor->bufferStats.gets++;
+
+    if (buf) {
+        reactor->buffers[class] = *(uint8_t **)buf;
+        reactor->bufferCounts[class]--;
+        reactor->bufferStats.pooledBytes -= classSize;
+        reactor->bufferStats.hits++;
+    }
+    else reactor->bufferStats.allocatedBytes += classSize;
+
+    pthread_mutex_unlock(&reactor->lock);
+
+    if (! buf) {
+        buf = malloc(classSize);
+        assert(buf != NULL);
+    }
+
+    *capacity = classSize;
+    return buf;
+}
+
+// gives a buffer from BRPeerReactorBufferGet() back to the pool of the reactor it came from
+void BRPeerReactorBufferPut(BRPeerReactor *reactor, uint8_t *buf, size_t capacity)
+{
+    size_t class = _BRPeerBufferClass(capacity);
+
+    assert(reactor != NULL);
+    assert(buf != NULL);
+    assert(capacity == (size_t)PEER_BUFFER_MIN_SIZE << (2*class));
+    pthread_mutex_lock(&reactor->lock);
+
+    if (reactor->bufferCounts[class] < PEER_BUFFER_POOL_DEPTH &&
+        reactor->bufferStats.pooledBytes + capacity <= PEER_BUFFER_POOL_BYTES) {
+        *(uint8_t **)buf = reactor->buffers[class];
+        reactor->buffers[class] = buf;
+        reactor->bufferCounts[class]++;
+        reactor->bufferStats.pooledBytes += capacity;
+        buf = NULL;
+    }
+
+    pthread_mutex_unlock(&reactor->lock);
+    if (buf) free(buf);
+}
+
+// adds the reactor's buffer pool statistics to stats
+void BRPeerReactorBufferStats(BRPeerReactor *reactor, BRPeerBufferStats *stats)
+{
+    assert(reactor != NULL);
+    assert(stats != NULL);
+    pthread_mutex_lock(&reactor->lock);
+    stats->gets += reactor->bufferStats.gets;
+    stats->hits += reactor->bufferStats.hits;
+    stats->allocatedBytes += reactor->bufferStats.allocatedBytes;
+    stats->pooledBytes += reactor->bufferStats.pooledBytes;
+    pthread_mutex_unlock(&reactor->lock);
+}
+
+// adds the buffer pool statistics of the process wide reactors that have been started to stats
+void BRPeerReactorSharedBufferStats(BRPeerBufferStats *stats)
+{
+    for (size_t i = 0; i < PEER_REACTOR_THREADS; i++) {
+        if (_sharedReactors[i]) BRPeerReactorBufferStats(_sharedReactors[i], stats);
+    }
+}
+
+// number of sources the reactor is watching
+size_t BRPeerReactorSourceCount(BRPeerReactor *reactor)
+{
+    size_t count;
+
+    assert(reactor != NULL);
+    pthread_mutex_lock(&reactor->lock);
+    count = reactor->sourceCount;
+    pthread_mutex_unlock(&reactor->lock);
+    return count;
+}
+
+// stops the reactor thread and frees the reactor and its pooled buffers, all its sources and timers must have been
+// removed and freed, and its buffers given back
+void BRPeerReactorFree(BRPeerReactor *reactor)
+{
+    BRPeerReactorSource *source;
+    uint8_t *buf;
+
+    assert(reactor != NULL);
+    assert(! BRPeerReactorIsCurrent(reactor));
+    reactor->stopped = 1;
+    _BRPeerReactorWake(reactor);
+    pthread_join(reactor->thread, NULL);
+
+    while ((source = reactor->removed) != NULL) {
+        reactor->removed = source->nextRemoved;
+        free(source);
+    }
+
+    for (size_t i = 0; i < PEER_BUFFER_CLASSES; i++) {
+        while ((buf = reactor->buffers[i]) != NULL) {
+            reactor->buffers[i] = *(uint8_t **)buf;
+            free(buf);
+        }
+    }
+
+    close(reactor->wake);
+    close(reactor->epoll);
+    pthread_mutex_destroy(&reactor->lock);
+    free(reactor);
+}
+
+#endif // PEER_REACTOR
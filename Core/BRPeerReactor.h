@@ -0,0 +1,103 @@
+// Copyright (c) 2012-2018 The Elastos Open Source Project
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#ifndef BRPeerReactor_h
+#define BRPeerReactor_h
+
+#include <stddef.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#if defined(__linux__) // epoll is linux only, other platforms keep a thread per peer
+#define PEER_REACTOR 1
+#endif
+
+#if PEER_REACTOR
+
+#define PEER_REACTOR_THREADS     2    // process wide reactors handed out by BRPeerReactorShared()
+#define PEER_REACTOR_TICK        0.1  // seconds per timer wheel slot
+#define PEER_REACTOR_WHEEL_SLOTS 512  // timers due further out than a turn of the wheel stay in their slot for more turns
+
+#define PEER_BUFFER_MIN_SIZE    0x1000 // smallest pooled buffer, size classes go up by powers of four from it
+#define PEER_BUFFER_CLASSES     8      // up to 64MB, enough for a message of MAX_MSG_LENGTH and its header
+#define PEER_BUFFER_POOL_DEPTH  16     // free buffers a reactor keeps per size class
+#define PEER_BUFFER_POOL_BYTES  0x800000 // total bytes of free buffers a reactor keeps, larger ones are freed
+
+#define PEER_REACTOR_READ  0x01
+#define PEER_REACTOR_WRITE 0x02
+#define PEER_REACTOR_HUP   0x04 // only ever passed to ready(), hangups and errors are always reported
+
+// A reactor is an I/O thread that waits on any number of non-blocking sockets with epoll and runs a hashed timer
+// wheel. All callbacks are called on the reactor thread, one at a time. Sources and timers may be changed from any
+// thread; one that is removed or freed is never called again once that call returns, unless it's removed from
+// another thread while its callback is already running.
+typedef struct BRPeerReactorStruct BRPeerReactor;
+typedef struct BRPeerReactorSourceStruct BRPeerReactorSource;
+typedef struct BRPeerReactorTimerStruct BRPeerReactorTimer;
+
+typedef struct {
+    uint64_t gets, hits; // buffers taken from the pool, and how many of those were reused
+    uint64_t allocatedBytes; // bytes allocated for buffers the pool didn't have
+    size_t pooledBytes; // bytes in free buffers the pool is holding
+} BRPeerBufferStats;
+
+// returns a newly allocated reactor with its own thread that must be freed by calling BRPeerReactorFree()
+BRPeerReactor *BRPeerReactorNew(void);
+
+// returns one of the process wide reactors, round robin, they are started on first use and never freed
+BRPeerReactor *BRPeerReactorShared(void);
+
+// watches fd for the given events, ready(info, events) is called when fd is ready or has hung up
+BRPeerReactorSource *BRPeerReactorAdd(BRPeerReactor *reactor, int fd, int events, void *info,
+                                      void (*ready)(void *info, int events));
+
+// changes the events source is watched for
+void BRPeerReactorSetEvents(BRPeerReactorSource *source, int events);
+
+// stops watching source and frees it, call before closing its fd
+void BRPeerReactorRemove(BRPeerReactorSource *source);
+
+// returns a newly allocated timer that isn't armed, it must be freed by calling BRPeerReactorTimerFree()
+BRPeerReactorTimer *BRPeerReactorTimerNew(BRPeerReactor *reactor, void *info, void (*fired)(void *info));
+
+// (re)arms timer to call fired(info) once after the given number of seconds, rounded up to the next wheel tick, or
+// cancels it when seconds < 0
+void BRPeerReactorTimerSet(BRPeerReactorTimer *timer, double seconds);
+
+// cancels and frees timer
+void BRPeerReactorTimerFree(BRPeerReactorTimer *timer);
+
+// true when called from the reactor's own thread
+int BRPeerReactorIsCurrent(const BRPeerReactor *reactor);
+
+// returns a buffer of at least size bytes from the reactor's pool and writes its capacity to capacity, the buffer
+// must be given back with BRPeerReactorBufferPut()
+uint8_t *BRPeerReactorBufferGet(BRPeerReactor *reactor, size_t size, size_t *capacity);
+
+// gives a buffer from BRPeerReactorBufferGet() back to the pool of the reactor it came from
+void BRPeerReactorBufferPut(BRPeerReactor *reactor, uint8_t *buf, size_t capacity);
+
+// adds the reactor's buffer pool statistics to stats
+void BRPeerReactorBufferStats(BRPeerReactor *reactor, BRPeerBufferStats *stats);
+
+// adds the buffer pool statistics of the process wide reactors that have been started to stats
+void BRPeerReactorSharedBufferStats(BRPeerBufferStats *stats);
+
+// number of sources the reactor is watching
+size_t BRPeerReactorSourceCount(BRPeerReactor *reactor);
+
+// stops the reactor thread and frees the reactor and its pooled buffers, all its sources and timers must have been
+// removed and freed, and its buffers given back
+void BRPeerReactorFree(BRPeerReactor *reactor);
+
+#endif // PEER_REACTOR
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // BRPeerReactor_h
@@ -132,6 +132,24 @@ namespace Elastos {
 			 * @param newPassword new pay password.
 			 */
 			virtual void ChangePassword(const std::string &oldPassword, const std::string &newPassword) = 0;
+
+			/**
+			 * Open a time limited session in which the keys derived from the pay password are kept in locked memory, so signing with the same pay password does not decrypt and stretch the seed again. Keys are zeroized when the session expires, when Lock() is called or when the pay password is changed.
+			 * @param payPassword use to derive the keys of the session. Pay password should between 8 and 128, otherwise will throw invalid argument exception.
+			 * @param seconds how long the session lasts, should between 1 and 86400.
+			 */
+			virtual void Unlock(const std::string &payPassword, uint32_t seconds) = 0;
+
+			/**
+			 * Close the session opened by Unlock() and zeroize its keys.
+			 */
+			virtual void Lock() = 0;
+
+			/**
+			 * Check whether a session opened by Unlock() is still open.
+			 * @return True if unlocked, otherwise return false.
+			 */
+			virtual bool IsUnlocked() const = 0;
 		};
 
 	}
@@ -88,6 +88,16 @@ namespace Elastos {
 			 */
 			virtual uint64_t GetBalanceWithAddress(const std::string &address) = 0;
 
+			/**
+			 * Get balances of a list of addresses at once, all of them taken from the same wallet state.
+			 * @param addresses addresses created by current sub wallet in json format, such as ["Exxx", "Eyyy"].
+			 * @return balances in json format, in the same order as the addresses. An example of result will be displayed as follows:
+			 * {
+			 * 	"Balances": [{"Exxx": 100000000}, {"Eyyy": 0}]
+			 * }
+			 */
+			virtual nlohmann::json GetBalancesWithAddresses(const nlohmann::json &addresses) = 0;
+
 			/**
 			 * Add a sub wallet callback object listened to current sub wallet.
 			 * @param subCallback is a pointer who want to listen events of current sub wallet.
@@ -160,6 +170,16 @@ namespace Elastos {
 					const nlohmann::json &rawTransaction,
 					const std::string &payPassword) = 0;
 
+			/**
+			 * Sign several transactions with one entry of the pay password, the keys are derived once for the whole batch.
+			 * @param rawTransactions array of transactions in json format, such as [{...}, {...}].
+			 * @param payPassword use to decrypt the root private key temporarily. Pay password should between 8 and 128, otherwise will throw invalid argument exception.
+			 * @return If success return the signed transactions in json format, in the same order as given.
+			 */
+			virtual nlohmann::json SignTransactions(
+					const nlohmann::json &rawTransactions,
+					const std::string &payPassword) = 0;
+
 			/**
 			 * Get signers already signed specified transaction.
 			 * @param rawTransaction a multi-sign transaction to find signed signers.
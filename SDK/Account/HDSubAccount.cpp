@@ -2,6 +2,7 @@
 // Distributed under the MIT software license, see the accompanying
 // file COPYING or http://www.opensource.org/licenses/mit-license.php.
 
+#include <boost/date_time/posix_time/posix_time.hpp>
 #include <SDK/Wrapper/Wallet.h>
 #include <SDK/Common/Utils.h>
 #include <SDK/Common/Log.h>
@@ -66,37 +67,41 @@ namespace Elastos {
 
 		void HDSubAccount::SignTransaction(const TransactionPtr &transaction, ELAWallet *wallet,
 										   const std::string &payPassword) {
-			WrapperList<Key, BRKey> keyList = DeriveAccountAvailableKeys(wallet, payPassword, transaction);
-			ParamChecker::checkCondition(!transaction->sign(keyList, 0), Error::Sign,
-										 "Transaction Sign error!");
+			SignTransactions(std::vector<TransactionPtr>(1, transaction), wallet, payPassword);
+		}
+
+		void HDSubAccount::SignTransactions(const std::vector<TransactionPtr> &transactions, ELAWallet *wallet,
+											const std::string &payPassword) {
+			boost::posix_time::ptime start = boost::posix_time::microsec_clock::universal_time();
+			WrapperList<Key, BRKey> keyList = DeriveAccountAvailableKeys(wallet, payPassword, transactions);
+			boost::posix_time::ptime derived = boost::posix_time::microsec_clock::universal_time();
+
+			size_t inputs = 0;
+			for (size_t i = 0; i < transactions.size(); ++i) {
+				ParamChecker::checkCondition(!transactions[i]->sign(keyList, 0), Error::Sign,
+											 "Transaction Sign error!");
+				inputs += transactions[i]->getRaw()->inCount;
+			}
+			boost::posix_time::ptime signedTime = boost::posix_time::microsec_clock::universal_time();
+
+			Log::getLogger()->info("SubWallet signTransaction derived {} keys in {} ms, signed {} transactions with "
+								   "{} inputs in {} ms", keyList.size(), (derived - start).total_milliseconds(),
+								   transactions.size(), inputs, (signedTime - derived).total_milliseconds());
 		}
 
 		WrapperList<Key, BRKey>
 		HDSubAccount::DeriveAccountAvailableKeys(ELAWallet *wallet, const std::string &payPassword,
-												 const TransactionPtr &transaction) {
-			BRTransaction *tx = transaction->getRaw();
-			uint32_t j, internalIdx[tx->inCount], externalIdx[tx->inCount];
+												 const std::vector<TransactionPtr> &transactions) {
+			std::vector<AddressPath> paths = ELAWalletGetInputPaths(wallet, transactions);
+			uint32_t internalIdx[paths.size()], externalIdx[paths.size()];
 			size_t i, internalCount = 0, externalCount = 0;
 
-			Log::getLogger()->info("SubWallet signTransaction begin get indices.");
-			pthread_mutex_lock(&wallet->Raw.lock);
-			for (i = 0; i < tx->inCount; i++) {
-				if (wallet->Raw.internalChain) {
-					for (j = (uint32_t) array_count(wallet->Raw.internalChain); j > 0; j--) {
-						if (BRAddressEq(tx->inputs[i].address, &wallet->Raw.internalChain[j - 1])) {
-							internalIdx[internalCount++] = j - 1;
-						}
-					}
-				}
-
-				for (j = (uint32_t) array_count(wallet->Raw.externalChain); j > 0; j--) {
-					if (BRAddressEq(tx->inputs[i].address, &wallet->Raw.externalChain[j - 1])) {
-						externalIdx[externalCount++] = j - 1;
-					}
-				}
+			for (i = 0; i < paths.size(); i++) {
+				if (paths[i].chain == SEQUENCE_INTERNAL_CHAIN)
+					internalIdx[internalCount++] = paths[i].index;
+				else
+					externalIdx[externalCount++] = paths[i].index;
 			}
-			pthread_mutex_unlock(&wallet->Raw.lock);
-			Log::getLogger()->info("SubWallet signTransaction end get indices.");
 
 			UInt512 seed = _parentAccount->DeriveSeed(payPassword);
 
@@ -107,17 +112,10 @@ namespace Elastos {
 							   SEQUENCE_EXTERNAL_CHAIN, externalIdx);
 			var_clean(&seed);
 
-			Log::getLogger()->info("SubWallet signTransaction calculate private key list done.");
-
 			WrapperList<Key, BRKey> keyList;
-			if (tx) {
-				Log::getLogger()->info("SubWallet signTransaction begin sign method.");
-				for (i = 0; i < internalCount + externalCount; ++i) {
-					Key key(keys[i].secret, keys[i].compressed);
-					keyList.push_back(key);
-				}
-
-				Log::getLogger()->info("SubWallet signTransaction end sign method.");
+			for (i = 0; i < internalCount + externalCount; ++i) {
+				Key key(keys[i].secret, keys[i].compressed);
+				keyList.push_back(key);
 			}
 
 			for (i = 0; i < internalCount + externalCount; i++) BRKeyClean(&keys[i]);
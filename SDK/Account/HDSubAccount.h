@@ -23,12 +23,15 @@ namespace Elastos {
 			virtual void
 			SignTransaction(const TransactionPtr &transaction, ELAWallet *wallet, const std::string &payPassword);
 
+			virtual void SignTransactions(const std::vector<TransactionPtr> &transactions, ELAWallet *wallet,
+										  const std::string &payPassword);
+
 			virtual std::string GetMainAccountPublicKey() const;
 
 		private:
 
 			WrapperList<Key, BRKey> DeriveAccountAvailableKeys(ELAWallet *wallet, const std::string &payPassword,
-															   const TransactionPtr &transaction);
+															   const std::vector<TransactionPtr> &transactions);
 		};
 	}
 }
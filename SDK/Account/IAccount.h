@@ -27,6 +27,13 @@ namespace Elastos {
 
 			virtual Key DeriveKey(const std::string &payPassword) = 0;
 
+			// keep what DeriveSeed() and DeriveKey() derive from payPassword for the next seconds
+			virtual void Unlock(const std::string &payPassword, uint32_t seconds) = 0;
+
+			virtual void Lock() = 0;
+
+			virtual bool IsUnlocked() const = 0;
+
 			virtual std::string GetType() const = 0;
 
 			virtual nlohmann::json ToJson() const = 0;
@@ -32,6 +32,10 @@ namespace Elastos {
 
 			virtual void
 			SignTransaction(const TransactionPtr &transaction, ELAWallet *wallet, const std::string &payPassword) = 0;
+
+			// derives the account keys once for all the transactions and wipes them when the batch is signed
+			virtual void SignTransactions(const std::vector<TransactionPtr> &transactions, ELAWallet *wallet,
+										  const std::string &payPassword) = 0;
 		};
 
 		typedef boost::shared_ptr<ISubAccount> SubAccountPtr;
@@ -0,0 +1,139 @@
+// Copyright (c) 2012-2018 The Elastos Open Source Project
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include <sys/mman.h>
+#include <unistd.h>
+#include <boost/bind.hpp>
+
+#include <Core/BRCrypto.h>
+#include <SDK/Common/Log.h>
+#include <SDK/Common/ParamChecker.h>
+#include "KeySession.h"
+
+namespace Elastos {
+	namespace ElaWallet {
+
+		KeySession::KeySession() :
+			_secrets(nullptr),
+			_secretsSize(0) {
+		}
+
+		KeySession::~KeySession() {
+			Lock();
+		}
+
+		void KeySession::Unlock(const std::string &payPassword, const UInt512 *seed, const UInt256 &secret,
+								uint32_t seconds) {
+			ParamChecker::checkCondition(seconds == 0 || seconds > KEY_SESSION_MAX_SECONDS, Error::InvalidArgument,
+										 "Unlock seconds should between 1 and " +
+										 std::to_string(KEY_SESSION_MAX_SECONDS));
+
+			// held until the new session is installed, so a concurrent Unlock() or Lock() can't interleave
+			boost::mutex::scoped_lock timerLock(_timerLock);
+			stop();
+
+			size_t pageSize = (size_t) sysconf(_SC_PAGESIZE);
+			size_t size = (sizeof(Secrets) + pageSize - 1) / pageSize * pageSize;
+			void *page = mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+			ParamChecker::checkCondition(page == MAP_FAILED, Error::Other, "Allocate key session memory failed");
+			if (mlock(page, size) != 0)
+				Log::getLogger()->warn("Key session memory could not be locked, it may be swapped out");
+#ifdef MADV_DONTDUMP
+			madvise(page, size, MADV_DONTDUMP);
+#endif
+
+			Secrets *secrets = (Secrets *) page;
+			BRSHA256(&secrets->passwordHash, payPassword.c_str(), payPassword.size());
+			secrets->hasSeed = seed != nullptr;
+			secrets->seed = secrets->hasSeed ? *seed : UINT512_ZERO;
+			secrets->secret = secret;
+
+			{
+				boost::mutex::scoped_lock scopedLock(_lock);
+				_secrets = secrets;
+				_secretsSize = size;
+				_expiry = boost::posix_time::microsec_clock::universal_time() + boost::posix_time::seconds(seconds);
+			}
+			_timer = boost::thread(boost::bind(&KeySession::expire, this));
+		}
+
+		void KeySession::Lock() {
+			boost::mutex::scoped_lock timerLock(_timerLock);
+			stop();
+		}
+
+		void KeySession::stop() {
+			{
+				boost::mutex::scoped_lock scopedLock(_lock);
+				clear();
+			}
+			_expired.notify_all();
+			if (_timer.joinable())
+				_timer.join();
+		}
+
+		bool KeySession::IsUnlocked() const {
+			boost::mutex::scoped_lock scopedLock(_lock);
+			return _secrets != nullptr && boost::posix_time::microsec_clock::universal_time() < _expiry;
+		}
+
+		bool KeySession::GetSeed(const std::string &payPassword, UInt512 &seed) const {
+			boost::mutex::scoped_lock scopedLock(_lock);
+			const Secrets *secrets = validSecrets(payPassword);
+			if (secrets == nullptr || !secrets->hasSeed)
+				return false;
+
+			seed = secrets->seed;
+			return true;
+		}
+
+		bool KeySession::GetSecret(const std::string &payPassword, UInt256 &secret) const {
+			boost::mutex::scoped_lock scopedLock(_lock);
+			const Secrets *secrets = validSecrets(payPassword);
+			if (secrets == nullptr)
+				return false;
+
+			secret = secrets->secret;
+			return true;
+		}
+
+		const KeySession::Secrets *KeySession::validSecrets(const std::string &payPassword) const {
+			// the timer may not have run yet
+			if (_secrets == nullptr || boost::posix_time::microsec_clock::universal_time() >= _expiry)
+				return nullptr;
+
+			UInt256 passwordHash;
+			BRSHA256(&passwordHash, payPassword.c_str(), payPassword.size());
+
+			uint8_t diff = 0;
+			for (size_t i = 0; i < sizeof(passwordHash); ++i)
+				diff |= passwordHash.u8[i] ^ _secrets->passwordHash.u8[i];
+			var_clean(&passwordHash);
+
+			return diff == 0 ? _secrets : nullptr;
+		}
+
+		void KeySession::clear() {
+			if (_secrets == nullptr)
+				return;
+
+			mem_clean(_secrets, _secretsSize);
+			munlock(_secrets, _secretsSize);
+			munmap(_secrets, _secretsSize);
+			_secrets = nullptr;
+			_secretsSize = 0;
+		}
+
+		void KeySession::expire() {
+			boost::mutex::scoped_lock scopedLock(_lock);
+			while (_secrets != nullptr && boost::posix_time::microsec_clock::universal_time() < _expiry)
+				_expired.timed_wait(scopedLock, _expiry);
+
+			if (_secrets != nullptr)
+				Log::getLogger()->info("Key session expired");
+			clear();
+		}
+
+	}
+}
@@ -0,0 +1,78 @@
+// Copyright (c) 2012-2018 The Elastos Open Source Project
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#ifndef __ELASTOS_SDK_KEYSESSION_H__
+#define __ELASTOS_SDK_KEYSESSION_H__
+
+#include <string>
+#include <boost/date_time/posix_time/posix_time.hpp>
+#include <boost/thread/condition_variable.hpp>
+#include <boost/thread/mutex.hpp>
+#include <boost/thread/thread.hpp>
+
+#include "BRInt.h"
+
+// longest time an account can stay unlocked, in seconds
+#define KEY_SESSION_MAX_SECONDS (24 * 60 * 60)
+
+namespace Elastos {
+	namespace ElaWallet {
+
+		/*
+		 * Keeps the secrets an account derives from its pay password for a limited time, so signing does not
+		 * decrypt the stored mnemonic and stretch the seed again for every transaction. The secrets live in a
+		 * page of their own that is mlock'd, and are zeroized when the session is locked, when it expires and
+		 * when it is destroyed. They are handed out only for the password the session was unlocked with.
+		 */
+		class KeySession {
+		public:
+			KeySession();
+
+			~KeySession();
+
+			// seed may be null for accounts that have no seed
+			void Unlock(const std::string &payPassword, const UInt512 *seed, const UInt256 &secret, uint32_t seconds);
+
+			void Lock();
+
+			bool IsUnlocked() const;
+
+			bool GetSeed(const std::string &payPassword, UInt512 &seed) const;
+
+			bool GetSecret(const std::string &payPassword, UInt256 &secret) const;
+
+		private:
+			struct Secrets {
+				UInt256 passwordHash;
+				UInt512 seed;
+				UInt256 secret;
+				bool hasSeed;
+			};
+
+			// with _lock held
+			const Secrets *validSecrets(const std::string &payPassword) const;
+
+			// with _lock held
+			void clear();
+
+			// wipes the secrets and joins the timer, with _timerLock held
+			void stop();
+
+			void expire();
+
+		private:
+			mutable boost::mutex _lock;
+			boost::condition_variable _expired;
+			boost::posix_time::ptime _expiry;
+			Secrets *_secrets;
+			size_t _secretsSize;
+
+			boost::mutex _timerLock;
+			boost::thread _timer;
+		};
+
+	}
+}
+
+#endif //__ELASTOS_SDK_KEYSESSION_H__
@@ -38,6 +38,20 @@ namespace Elastos {
 			return _me->DeriveSeed(payPassword);
 		}
 
+		void MultiSignAccount::Unlock(const std::string &payPassword, uint32_t seconds) {
+			checkSigners();
+			_me->Unlock(payPassword, seconds);
+		}
+
+		void MultiSignAccount::Lock() {
+			if (_me != nullptr)
+				_me->Lock();
+		}
+
+		bool MultiSignAccount::IsUnlocked() const {
+			return _me != nullptr && _me->IsUnlocked();
+		}
+
 		void MultiSignAccount::ChangePassword(const std::string &oldPassword, const std::string &newPassword) {
 			if (_me != nullptr)
 				_me->ChangePassword(oldPassword, newPassword);
@@ -51,6 +51,21 @@ namespace Elastos {
 			return _currentAccount->DeriveSeed(payPassword);
 		}
 
+		void MultiSignAccounts::Unlock(const std::string &payPassword, uint32_t seconds) {
+			checkCurrentAccount();
+			_currentAccount->Unlock(payPassword, seconds);
+		}
+
+		void MultiSignAccounts::Lock() {
+			checkCurrentAccount();
+			_currentAccount->Lock();
+		}
+
+		bool MultiSignAccounts::IsUnlocked() const {
+			checkCurrentAccount();
+			return _currentAccount->IsUnlocked();
+		}
+
 		void MultiSignAccounts::ChangePassword(const std::string &oldPassword, const std::string &newPassword) {
 			checkCurrentAccount();
 			_currentAccount->ChangePassword(oldPassword, newPassword);
@@ -31,6 +31,12 @@ namespace Elastos {
 
 			virtual UInt512 DeriveSeed(const std::string &payPassword);
 
+			virtual void Unlock(const std::string &payPassword, uint32_t seconds);
+
+			virtual void Lock();
+
+			virtual bool IsUnlocked() const;
+
 			virtual void ChangePassword(const std::string &oldPassword, const std::string &newPassword);
 
 			virtual nlohmann::json ToJson() const;
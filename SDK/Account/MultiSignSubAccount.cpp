@@ -2,7 +2,9 @@
 // Distributed under the MIT software license, see the accompanying
 // file COPYING or http://www.opensource.org/licenses/mit-license.php.
 
+#include <boost/date_time/posix_time/posix_time.hpp>
 #include <SDK/Common/ParamChecker.h>
+#include <SDK/Common/Log.h>
 #include "MultiSignSubAccount.h"
 #include "Program.h"
 
@@ -18,8 +20,23 @@ namespace Elastos {
 										 "Multi-sign sub account do not allow account that are not multi-sign type.");
 		}
 
-		void MultiSignSubAccount::SignTransaction(const TransactionPtr &transaction, ELAWallet *wallet,
-												  const std::string &payPassword) {
+		void MultiSignSubAccount::SignTransactions(const std::vector<TransactionPtr> &transactions,
+												   ELAWallet *wallet, const std::string &payPassword) {
+			boost::posix_time::ptime start = boost::posix_time::microsec_clock::universal_time();
+			Key key = DeriveMainAccountKey(payPassword);
+			boost::posix_time::ptime derived = boost::posix_time::microsec_clock::universal_time();
+
+			for (size_t i = 0; i < transactions.size(); ++i) {
+				AppendSign(transactions[i], key);
+			}
+			boost::posix_time::ptime signedTime = boost::posix_time::microsec_clock::universal_time();
+
+			Log::getLogger()->info("SubWallet signTransaction derived multi-sign key in {} ms, signed {} transactions "
+								   "in {} ms", (derived - start).total_milliseconds(), transactions.size(),
+								   (signedTime - derived).total_milliseconds());
+		}
+
+		void MultiSignSubAccount::AppendSign(const TransactionPtr &transaction, const Key &key) {
 			ELATransaction *elaTransaction = (ELATransaction *) transaction->getRaw();
 			if (elaTransaction->programs.empty()) {
 				Program *program = new Program;
@@ -37,7 +54,7 @@ namespace Elastos {
 			}
 
 			CMBlock shaData = transaction->GetShaData();
-			CMBlock signData = DeriveMainAccountKey(payPassword).compactSign(shaData);
+			CMBlock signData = key.compactSign(shaData);
 			uint8_t buff[65];
 			memset(buff, 0, 65);
 			memcpy(buff, signData, signData.GetSize());
@@ -17,11 +17,14 @@ namespace Elastos {
 
 			virtual nlohmann::json GetBasicInfo() const;
 
-			virtual void
-			SignTransaction(const TransactionPtr &transaction, ELAWallet *wallet, const std::string &payPassword);
+			virtual void SignTransactions(const std::vector<TransactionPtr> &transactions, ELAWallet *wallet,
+										  const std::string &payPassword);
 
 			std::vector<std::string> GetTransactionSignedSigners(const TransactionPtr &transaction);
 
+		private:
+			void AppendSign(const TransactionPtr &transaction, const Key &key);
+
 		private:
 			MultiSignAccount *_multiSignAccount;
 		};
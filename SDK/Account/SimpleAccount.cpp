@@ -11,7 +11,8 @@
 namespace Elastos {
 	namespace ElaWallet {
 
-		SimpleAccount::SimpleAccount(const std::string &privKey, const std::string &payPassword) {
+		SimpleAccount::SimpleAccount(const std::string &privKey, const std::string &payPassword) :
+			_session(new KeySession()) {
 			CMBlock keyData = Utils::decodeHex(privKey);
 			Utils::Encrypt(_encryptedKey, keyData, payPassword);
 
@@ -25,16 +26,23 @@ namespace Elastos {
 			var_clean(&secret);
 		}
 
-		SimpleAccount::SimpleAccount() {
+		SimpleAccount::SimpleAccount() :
+			_session(new KeySession()) {
 
 		}
 
 		Key SimpleAccount::DeriveKey(const std::string &payPassword) {
+			Key key;
+			UInt256 secret;
+			if (_session->GetSecret(payPassword, secret)) {
+				key.setSecret(secret, true);
+				var_clean(&secret);
+				return key;
+			}
+
 			CMBlock keyData;
 			ParamChecker::CheckDecrypt(!Utils::Decrypt(keyData, GetEncryptedKey(), payPassword));
 
-			Key key;
-			UInt256 secret;
 			memcpy(secret.u8, keyData, keyData.GetSize());
 			key.setSecret(secret, true);
 
@@ -50,6 +58,21 @@ namespace Elastos {
 			return UINT512_ZERO;
 		}
 
+		void SimpleAccount::Unlock(const std::string &payPassword, uint32_t seconds) {
+			_session->Lock();
+			Key key = DeriveKey(payPassword);
+
+			_session->Unlock(payPassword, nullptr, key.getRaw()->secret, seconds);
+		}
+
+		void SimpleAccount::Lock() {
+			_session->Lock();
+		}
+
+		bool SimpleAccount::IsUnlocked() const {
+			return _session->IsUnlocked();
+		}
+
 		void SimpleAccount::ChangePassword(const std::string &oldPassword, const std::string &newPassword) {
 			ParamChecker::checkPassword(newPassword, "New");
 
@@ -57,6 +80,7 @@ namespace Elastos {
 			ParamChecker::CheckDecrypt(!Utils::Decrypt(key, GetEncryptedKey(), oldPassword));
 
 			Utils::Encrypt(_encryptedKey, key, newPassword);
+			_session->Lock();
 
 			memset(key, 0, key.GetSize());
 		}
@@ -6,6 +6,7 @@
 #define __ELASTOS_SDK_SIMPLEACCOUNT_H__
 
 #include "IAccount.h"
+#include "KeySession.h"
 #include "SDK/Common/Mstream.h"
 
 namespace Elastos {
@@ -21,6 +22,12 @@ namespace Elastos {
 
 			virtual UInt512 DeriveSeed(const std::string &payPassword);
 
+			virtual void Unlock(const std::string &payPassword, uint32_t seconds);
+
+			virtual void Lock();
+
+			virtual bool IsUnlocked() const;
+
 			virtual void ChangePassword(const std::string &oldPassword, const std::string &newPassword);
 
 			virtual std::string GetType() const;
@@ -65,6 +72,7 @@ namespace Elastos {
 			std::string _emptyString;
 			std::string _publicKey;
 			std::string _encryptedKey; // encode with base64
+			boost::shared_ptr<KeySession> _session;
 		};
 
 	}
@@ -2,9 +2,11 @@
 // Distributed under the MIT software license, see the accompanying
 // file COPYING or http://www.opensource.org/licenses/mit-license.php.
 
+#include <boost/date_time/posix_time/posix_time.hpp>
 #include <SDK/Wrapper/Wallet.h>
 #include <SDK/Common/ParamChecker.h>
 #include <SDK/Common/Utils.h>
+#include <SDK/Common/Log.h>
 #include "SingleSubAccount.h"
 
 namespace Elastos {
@@ -34,8 +36,8 @@ namespace Elastos {
 		}
 
 		WrapperList<Key, BRKey>
-		SingleSubAccount::DeriveAccountAvailableKeys(const std::string &payPassword,
-													 const Elastos::ElaWallet::TransactionPtr &transaction) {
+		SingleSubAccount::DeriveAccountAvailableKeys(ELAWallet *wallet, const std::string &payPassword,
+													 const std::vector<TransactionPtr> &transactions) {
 			WrapperList<Key, BRKey> result;
 			result.push_back(_parentAccount->DeriveKey(payPassword));
 			return result;
@@ -43,9 +45,26 @@ namespace Elastos {
 
 		void SingleSubAccount::SignTransaction(const TransactionPtr &transaction, ELAWallet *wallet,
 											   const std::string &payPassword) {
-			WrapperList<Key, BRKey> keyList = DeriveAccountAvailableKeys(payPassword, transaction);
-			ParamChecker::checkCondition(!transaction->sign(keyList, 0), Error::Sign,
-										 "Transaction Sign error!");
+			SignTransactions(std::vector<TransactionPtr>(1, transaction), wallet, payPassword);
+		}
+
+		void SingleSubAccount::SignTransactions(const std::vector<TransactionPtr> &transactions, ELAWallet *wallet,
+												const std::string &payPassword) {
+			boost::posix_time::ptime start = boost::posix_time::microsec_clock::universal_time();
+			WrapperList<Key, BRKey> keyList = DeriveAccountAvailableKeys(wallet, payPassword, transactions);
+			boost::posix_time::ptime derived = boost::posix_time::microsec_clock::universal_time();
+
+			size_t inputs = 0;
+			for (size_t i = 0; i < transactions.size(); ++i) {
+				ParamChecker::checkCondition(!transactions[i]->sign(keyList, 0), Error::Sign,
+											 "Transaction Sign error!");
+				inputs += transactions[i]->getRaw()->inCount;
+			}
+			boost::posix_time::ptime signedTime = boost::posix_time::microsec_clock::universal_time();
+
+			Log::getLogger()->info("SubWallet signTransaction derived {} keys in {} ms, signed {} transactions with "
+								   "{} inputs in {} ms", keyList.size(), (derived - start).total_milliseconds(),
+								   transactions.size(), inputs, (signedTime - derived).total_milliseconds());
 		}
 
 		nlohmann::json SingleSubAccount::GetBasicInfo() const {
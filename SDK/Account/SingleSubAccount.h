@@ -27,10 +27,13 @@ namespace Elastos {
 			virtual void
 			SignTransaction(const TransactionPtr &transaction, ELAWallet *wallet, const std::string &payPassword);
 
+			virtual void SignTransactions(const std::vector<TransactionPtr> &transactions, ELAWallet *wallet,
+										  const std::string &payPassword);
+
 		protected:
 			virtual WrapperList<Key, BRKey>
-			DeriveAccountAvailableKeys(const std::string &payPassword,
-									   const TransactionPtr &transaction);
+			DeriveAccountAvailableKeys(ELAWallet *wallet, const std::string &payPassword,
+									   const std::vector<TransactionPtr> &transactions);
 		};
 
 	}
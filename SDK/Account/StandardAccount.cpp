@@ -17,7 +17,8 @@ namespace Elastos {
 										 const std::string &phrase,
 										 const std::string &phrasePassword,
 										 const std::string &payPassword) :
-				_rootPath(rootPath) {
+				_rootPath(rootPath),
+				_session(new KeySession()) {
 
 			_mnemonic = boost::shared_ptr<Mnemonic>(new Mnemonic(boost::filesystem::path(_rootPath)));
 			std::string standardPhrase;
@@ -55,7 +56,8 @@ namespace Elastos {
 		}
 
 		StandardAccount::StandardAccount(const std::string &rootPath) :
-				_rootPath(rootPath) {
+				_rootPath(rootPath),
+				_session(new KeySession()) {
 			_mnemonic = boost::shared_ptr<Mnemonic>(new Mnemonic(_rootPath));
 		}
 
@@ -125,6 +127,8 @@ namespace Elastos {
 
 		UInt512 StandardAccount::DeriveSeed(const std::string &payPassword) {
 			UInt512 result;
+			if (_session->GetSeed(payPassword, result))
+				return result;
 
 			std::string phrase;
 			ParamChecker::CheckDecrypt(!Utils::Decrypt(phrase, GetEncryptedMnemonic(), payPassword));
@@ -138,17 +142,41 @@ namespace Elastos {
 		}
 
 		Key StandardAccount::DeriveKey(const std::string &payPassword) {
+			Key key;
+			UInt256 secret;
+			if (_session->GetSecret(payPassword, secret)) {
+				key.setSecret(secret, true);
+				var_clean(&secret);
+				return key;
+			}
+
 			CMBlock keyData;
 			ParamChecker::CheckDecrypt(!Utils::Decrypt(keyData, GetEncryptedKey(), payPassword));
 
-			Key key;
-			UInt256 secret;
 			memcpy(secret.u8, keyData, keyData.GetSize());
 			key.setSecret(secret, true);
 
 			return key;
 		}
 
+		void StandardAccount::Unlock(const std::string &payPassword, uint32_t seconds) {
+			// derive from the stored data, which also checks the password
+			_session->Lock();
+			UInt512 seed = DeriveSeed(payPassword);
+			Key key = DeriveKey(payPassword);
+
+			_session->Unlock(payPassword, &seed, key.getRaw()->secret, seconds);
+			var_clean(&seed);
+		}
+
+		void StandardAccount::Lock() {
+			_session->Lock();
+		}
+
+		bool StandardAccount::IsUnlocked() const {
+			return _session->IsUnlocked();
+		}
+
 		void StandardAccount::ChangePassword(const std::string &oldPassword, const std::string &newPassword) {
 			ParamChecker::checkPassword(newPassword, "New");
 
@@ -161,6 +189,7 @@ namespace Elastos {
 			Utils::Encrypt(_encryptedKey, key, newPassword);
 			Utils::Encrypt(_encryptedPhrasePass, phrasePasswd, newPassword);
 			Utils::Encrypt(_encryptedMnemonic, phrase, newPassword);
+			_session->Lock();
 
 			memset(key, 0, key.GetSize());
 		}
@@ -8,6 +8,7 @@
 #include <nlohmann/json.hpp>
 
 #include "IAccount.h"
+#include "KeySession.h"
 #include "SDK/KeyStore/Mnemonic.h"
 #include "SDK/Common/CMemBlock.h"
 #include "SDK/Wrapper/MasterPubKey.h"
@@ -29,6 +30,12 @@ namespace Elastos {
 
 			virtual UInt512 DeriveSeed(const std::string &payPassword);
 
+			virtual void Unlock(const std::string &payPassword, uint32_t seconds);
+
+			virtual void Lock();
+
+			virtual bool IsUnlocked() const;
+
 			virtual void ChangePassword(const std::string &oldPassword, const std::string &newPassword);
 
 			virtual std::string GetType() const;
@@ -80,6 +87,7 @@ namespace Elastos {
 
 			boost::shared_ptr<Mnemonic> _mnemonic;
 			std::string _rootPath;
+			boost::shared_ptr<KeySession> _session;
 		};
 
 	}
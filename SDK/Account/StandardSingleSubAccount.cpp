@@ -41,20 +41,31 @@ namespace Elastos {
 			key.setPubKey(pubKey);
 			wallet->SingleAddress = key.address();
 
+			pthread_mutex_lock(&wallet->Raw.lock);
+			ELAWalletAddAddressPath(wallet, wallet->SingleAddress.c_str(), AddressPath(SEQUENCE_EXTERNAL_CHAIN, 0));
+			pthread_mutex_unlock(&wallet->Raw.lock);
+
 			wallet->Raw.WalletUpdateBalance((BRWallet *) wallet);
 		}
 
-		WrapperList<Key, BRKey> StandardSingleSubAccount::DeriveAccountAvailableKeys(const std::string &payPassword,
-																					 const TransactionPtr &transaction) {
+		WrapperList<Key, BRKey> StandardSingleSubAccount::DeriveAccountAvailableKeys(ELAWallet *wallet,
+																					 const std::string &payPassword,
+																					 const std::vector<TransactionPtr> &transactions) {
+			std::vector<AddressPath> paths = ELAWalletGetInputPaths(wallet, transactions);
+			if (paths.empty())
+				paths.push_back(AddressPath(SEQUENCE_EXTERNAL_CHAIN, 0));
+
 			WrapperList<Key, BRKey> result;
 			UInt512 seed = _parentAccount->DeriveSeed(payPassword);
-			Key key;
-			UInt256 chainCode;
-			BRBIP32PrivKeyPath(key.getRaw(), &chainCode, &seed, sizeof(seed), 5, 44 | BIP32_HARD,
-							   _coinIndex | BIP32_HARD, 0 | BIP32_HARD, SEQUENCE_EXTERNAL_CHAIN, 0);
-			key.setPublicKey();
+			for (size_t i = 0; i < paths.size(); ++i) {
+				Key key;
+				UInt256 chainCode;
+				BRBIP32PrivKeyPath(key.getRaw(), &chainCode, &seed, sizeof(seed), 5, 44 | BIP32_HARD,
+								   _coinIndex | BIP32_HARD, 0 | BIP32_HARD, paths[i].chain, paths[i].index);
+				key.setPublicKey();
+				result.push_back(key);
+			}
 			var_clean(&seed);
-			result.push_back(key);
 			return result;
 		}
 	}
@@ -22,8 +22,8 @@ namespace Elastos {
 
 		protected:
 			virtual WrapperList<Key, BRKey>
-			DeriveAccountAvailableKeys(const std::string &payPassword,
-									   const TransactionPtr &transaction);
+			DeriveAccountAvailableKeys(ELAWallet *wallet, const std::string &payPassword,
+									   const std::vector<TransactionPtr> &transactions);
 		};
 
 	}
@@ -14,6 +14,9 @@
 #include <string.h>
 #include <vector>
 #include <cstdint>
+#include <memory>
+#include <new>
+#include <utility>
 
 
 /** As Smart Block, CMemBlock containing any data type recognized by C such as
@@ -90,27 +93,28 @@
  *	}
  */
 
+// payloads of up to this many bytes (hashes, keys, signatures) are kept inline, without a buffer of their own
+#define CMEMBLOCK_INLINE_SIZE 80
+
 template<class T, class SIZETYPE=size_t>
 class CMemBlock {
 public:
 	typedef SIZETYPE size_type;
 public:
-	CMemBlock() {
-		pValue = new Value((size_type) 0);
-		pValue->AddRef();
+	CMemBlock() : pValue(nullptr) {
 	}
 
-	CMemBlock(int size) {
-		pValue = new Value(size_type(size));
-		pValue->AddRef();
+	CMemBlock(int size) : pValue(nullptr) {
+		if (0 < size)
+			Get()->Resize(size_type(size));
 	}
 
-	CMemBlock(size_type size) {
+	CMemBlock(size_type size) : pValue(nullptr) {
 #ifdef USE_VARY_MACRO
 		__glibcxx_requires_subscript(size);
 #endif
-		pValue = new Value(size);
-		pValue->AddRef();
+		if (0 < size)
+			Get()->Resize(size);
 	}
 
 	CMemBlock(const CMemBlock &mem) {
@@ -125,13 +129,18 @@ public:
 			pValue->AddRef();
 	}
 
+	CMemBlock(CMemBlock &&mem) {
+		pValue = mem.pValue;
+		mem.pValue = nullptr;
+	}
+
 	~CMemBlock() {
 		if (nullptr != pValue)
 			pValue->Release();
 	}
 
 	CMemBlock &operator=(const CMemBlock &mem) {
-		if (nullptr != pValue && pValue == mem.pValue)
+		if (pValue == mem.pValue)
 			return *this;
 		if (nullptr != pValue)
 			pValue->Release();
@@ -143,61 +152,40 @@ public:
 	}
 
 	CMemBlock &operator=(CMemBlock &mem) {
-		if (nullptr != pValue && pValue == mem.pValue)
+		return operator=((const CMemBlock &) mem);
+	}
+
+	CMemBlock &operator=(CMemBlock &&mem) {
+		if (this == std::addressof(mem))
 			return *this;
 		if (nullptr != pValue)
 			pValue->Release();
 		pValue = mem.pValue;
-		if (nullptr != pValue)
-			pValue->AddRef();
+		mem.pValue = nullptr;
 
 		return *this;
 	}
 
 	CMemBlock operator+(const CMemBlock &mem) const {
 		CMemBlock ret;
-		size_type l = (nullptr != pValue ? pValue->_len : 0) + (nullptr != mem.Pvalue ? mem.pValue->_len : 0);
-		ret.Resize(l);
-		memcpy(ret, nullptr != pValue ? pValue->data : 0, sizeof(T) * (nullptr != pValue ? pValue->_len : 0));
-		memcpy(ret + (nullptr != pValue ? pValue->_len : 0), nullptr != mem.pValue ? mem.pValue->data : 0,
-			   sizeof(T) * (nullptr != mem.pValue ? mem.pValue->_len : 0));
-
-		return ret;
-	}
-
-	CMemBlock operator+(CMemBlock &mem) const {
-		CMemBlock ret;
-		size_type l = (nullptr != pValue ? pValue->_len : 0) + (nullptr != mem.Pvalue ? mem.pValue->_len : 0);
-		ret.Resize(l);
-		memcpy(ret, nullptr != pValue ? pValue->data : 0, sizeof(T) * (nullptr != pValue ? pValue->_len : 0));
-		memcpy(ret + (nullptr != pValue ? pValue->_len : 0), nullptr != mem.pValue ? mem.pValue->data : 0,
-			   sizeof(T) * (nullptr != mem.pValue ? mem.pValue->_len : 0));
+		size_type l = GetSize(), r = mem.GetSize();
+		ret.Resize(l + r);
+		if (0 < l)
+			memcpy(ret.pValue->data, pValue->data, sizeof(T) * l);
+		if (0 < r)
+			memcpy(ret.pValue->data + l, mem.pValue->data, sizeof(T) * r);
 
 		return ret;
 	}
 
 	CMemBlock &operator+=(const CMemBlock &mem) {
-		if (nullptr == pValue) {
-			pValue = new Value((size_type) 0);
-			pValue->AddRef();
-		}
-		size_type l = pValue->_len + (nullptr != mem.pValue ? mem.pValue->_len : 0);
-		pValue->Resize(l);
-		memcpy(pValue->data + pValue->_len, nullptr != mem.pValue ? mem.pValue->data : 0,
-			   sizeof(T) * (nullptr != mem.pValue ? mem.pValue->_len : 0));
-
-		return *this;
-	}
-
-	CMemBlock &operator+=(CMemBlock &mem) {
-		if (nullptr == pValue) {
-			pValue = new Value((size_type) 0);
-			pValue->AddRef();
-		}
-		size_type l = pValue->_len + (nullptr != mem.pValue ? mem.pValue->_len : 0);
-		pValue->Resize(l);
-		memcpy(pValue->data + pValue->_len, nullptr != mem.pValue ? mem.pValue->data : 0,
-			   sizeof(T) * (nullptr != mem.pValue ? mem.pValue->_len : 0));
+		size_type l = GetSize(), r = mem.GetSize();
+		if (0 == r)
+			return *this;
+		// mem may share our value, it is resized below
+		CMemBlock keep(mem);
+		Get()->Resize(l + r);
+		memcpy(pValue->data + l, keep.pValue->data, sizeof(T) * r);
 
 		return *this;
 	}
@@ -218,11 +206,11 @@ public:
 	}
 
 	size_type SetMem(T *pV, size_type len) {
-		return nullptr != pValue ? pValue->SetMem(pV, len) : 0;
+		return Get()->SetMem(pV, len);
 	}
 
 	size_type SetMemFixed(const T *pV, size_type len) {
-		return nullptr != pValue ? pValue->SetMemFixed(pV, len) : 0;
+		return Get()->SetMemFixed(pV, len);
 	}
 
 	size_type Resize(int size) {
@@ -230,11 +218,13 @@ public:
 	}
 
 	size_type Resize(size_type size) {
-		return nullptr != pValue ? pValue->Resize(size) : 0;
+		if (nullptr == pValue && 0 == size)
+			return 0;
+		return Get()->Resize(size);
 	}
 
 	size_type push_back(T &t) {
-		return nullptr != pValue ? pValue->push_back(t) : 0;
+		return Get()->push_back(t);
 	}
 
 	size_type GetSize() const {
@@ -246,7 +236,8 @@ public:
 	}
 
 	void Reverse() {
-		nullptr != pValue ? pValue->Reverse() : 0;
+		if (nullptr != pValue)
+			pValue->Reverse();
 	}
 
 	operator bool() const {
@@ -355,39 +346,70 @@ public:
 
 private:
 	class Value {
-		bool fixed;
+		// where data lives: nowhere, in _inline, allocated here, malloc'd by the caller of SetMem, or borrowed
+		enum Storage {
+			None,
+			Inline,
+			Heap,
+			Malloc,
+			Fixed
+		};
+
+		static size_type InlineCapacity() {
+			return CMEMBLOCK_INLINE_SIZE / sizeof(T);
+		}
+
+		T *Allocate(size_type size, Storage &storage) {
+			if (size <= InlineCapacity()) {
+				storage = Inline;
+				return (T *) _inline;
+			}
+			storage = Heap;
+			return (T *) ::operator new(size * sizeof(T));
+		}
+
+		void Deallocate() {
+			if (Heap == storage)
+				::operator delete(data);
+			else if (Malloc == storage)
+				free(data);
+			data = 0;
+			storage = None;
+			_capacity = 0;
+		}
+
+		// moves the first min(_len, capacity) elements into storage of our own
+		void Reallocate(size_type capacity) {
+			Storage s;
+			T *t = Allocate(capacity, s);
+			size_type lt = _len > capacity ? capacity : _len;
+			if (nullptr != data && t != data && 0 < lt)
+				memcpy(t, data, lt * sizeof(T));
+			if (t != data)
+				Deallocate();
+			data = t;
+			storage = s;
+			_capacity = Inline == s ? InlineCapacity() : capacity;
+		}
+
 	public:
 		size_type AddRef() {
-			__sync_fetch_and_add(&_ref, 1);
-			return _ref;
+			return __sync_add_and_fetch(&_ref, 1);
 		}
 
 		size_type Release() {
-			__sync_fetch_and_sub(&_ref, 1);
-			if (0 == _ref) {
+			size_type ref = __sync_sub_and_fetch(&_ref, 1);
+			if (0 == ref)
 				delete this;
-				return 0;
-			} else {
-				return _ref;
-			}
+			return ref;
 		}
 
-		Value(size_type size) {
-			fixed = false;
-
-			_ref = 0;
-			if (0 < size) {
-				data = (T *) malloc(size * sizeof(T));
-				_len = size;
-			} else {
-				data = 0;
-				_len = 0;
-			}
+		Value(size_type size) : storage(None), _ref(0), data(0), _len(0), _capacity(0) {
+			Resize(size);
 		}
 
 		~Value() {
-			if (nullptr != data && !fixed)
-				free(data);
+			Deallocate();
 		}
 
 		void Zero() {
@@ -399,48 +421,34 @@ private:
 		}
 
 		void Clear() {
-			if (nullptr != data) {
-				if (!fixed) free(data);
-				data = 0;
-				fixed = false;
-			}
+			Deallocate();
 			_len = 0;
 		}
 
 		void DelAt(size_type st) {
 			if (nullptr != data && _len > 0) {
 				if (0 <= st && st < _len) {
-					T *p = (T *) malloc((_len - 1) * sizeof(T));
-					for (size_type i = 0; i < _len; i++) {
-						if (i < st) {
-							p[i] = data[i];
-						} else if (i > st) {
-							p[i - 1] = data[i];
-						}
-					}
-					if (!fixed) free(data);
-					data = p;
-					fixed = false;
+					if (Fixed == storage)
+						Reallocate(_len);
+					memmove(data + st, data + st + 1, (_len - st - 1) * sizeof(T));
 					_len--;
 				}
 			}
 		}
 
 		size_type SetMem(T *pV, size_type len) {
-			if (nullptr != data && !fixed)
-				free(data);
+			Deallocate();
 			data = pV;
-			fixed = false;
-			_len = len;
+			storage = Malloc;
+			_len = _capacity = len;
 			return _len;
 		}
 
 		size_type SetMemFixed(const T *pV, size_type len) {
-			if (nullptr != data && !fixed)
-				free(data);
+			Deallocate();
 			data = const_cast<T *>(pV);
-			fixed = true;
-			_len = len;
+			storage = Fixed;
+			_len = _capacity = len;
 			return _len;
 		}
 
@@ -448,32 +456,18 @@ private:
 			if (size == _len)
 				return size;
 			if (0 < size) {
-				T *t = (T *) malloc(size * sizeof(T));
-				if (nullptr != data) {
-					size_type lt = _len > size ? size : _len;
-					memcpy(t, data, lt * sizeof(T));
-					if (!fixed) free(data);
-				}
-				data = t;
-				fixed = false;
+				if (size > _capacity || Fixed == storage)
+					Reallocate(size);
 				_len = size;
 			} else {
-				if (nullptr != data) {
-					if (!fixed) free(data);
-					data = 0;
-					fixed = false;
-					_len = 0;
-				}
+				Clear();
 			}
 			return _len;
 		}
 
 		size_type push_back(T &t) {
-			T *pt = (T *) malloc((_len + 1) * sizeof(T));
-			memcpy(pt, data, _len * sizeof(T));
-			if (nullptr != data && !fixed) free(data);
-			data = pt;
-			fixed = false;
+			if (_len == _capacity || Fixed == storage)
+				Reallocate(_len < 4 ? 8 : _len * 2);
 			data[_len++] = t;
 			return _len;
 		}
@@ -494,14 +488,120 @@ private:
 			}
 		}
 
+	private:
+		Storage storage;
+		uint64_t _inline[(CMEMBLOCK_INLINE_SIZE + sizeof(uint64_t) - 1) / sizeof(uint64_t)];
+
+	public:
 		size_type _ref;
 		T *data;
 		size_type _len;
+		size_type _capacity;
 	};
 
+	Value *Get() {
+		if (nullptr == pValue) {
+			pValue = new Value((size_type) 0);
+			pValue->AddRef();
+		}
+		return pValue;
+	}
+
 	Value *pValue;
 };
 
+/** Single owner counterpart of CMemBlock: not reference counted and not copyable, only moved. Payloads of up
+ *  to CMEMBLOCK_INLINE_SIZE bytes are kept in the object itself, so a small scratch buffer costs no allocation
+ *  and a large one costs one, against the stack for a variable length array.
+ */
+template<class T, class SIZETYPE=size_t>
+class CMemBuffer {
+public:
+	typedef SIZETYPE size_type;
+public:
+	CMemBuffer() : data((T *) _inline), _len(0), _capacity(InlineCapacity()) {
+	}
+
+	explicit CMemBuffer(size_type size) : data((T *) _inline), _len(0), _capacity(InlineCapacity()) {
+		Resize(size);
+	}
+
+	CMemBuffer(CMemBuffer &&buf) : data((T *) _inline), _len(0), _capacity(InlineCapacity()) {
+		*this = std::move(buf);
+	}
+
+	~CMemBuffer() {
+		if ((T *) _inline != data)
+			::operator delete(data);
+	}
+
+	CMemBuffer &operator=(CMemBuffer &&buf) {
+		if (this == &buf)
+			return *this;
+		if ((T *) buf._inline == buf.data) {
+			Resize(0);
+			Resize(buf._len);
+			memcpy(data, buf.data, buf._len * sizeof(T));
+		} else {
+			if ((T *) _inline != data)
+				::operator delete(data);
+			data = buf.data;
+			_len = buf._len;
+			_capacity = buf._capacity;
+			buf.data = (T *) buf._inline;
+			buf._capacity = InlineCapacity();
+		}
+		buf._len = 0;
+		return *this;
+	}
+
+	// keeps the first min(GetSize(), size) elements
+	size_type Resize(size_type size) {
+		if (size > _capacity) {
+			T *t = (T *) ::operator new(size * sizeof(T));
+			if (0 < _len)
+				memcpy(t, data, _len * sizeof(T));
+			if ((T *) _inline != data)
+				::operator delete(data);
+			data = t;
+			_capacity = size;
+		}
+		_len = size;
+		return _len;
+	}
+
+	void Zero() {
+		if (0 < _len)
+			memset(data, 0, _len * sizeof(T));
+	}
+
+	size_type GetSize() const {
+		return _len;
+	}
+
+	operator T *() {
+		return data;
+	}
+
+	operator const T *() const {
+		return data;
+	}
+
+private:
+	CMemBuffer(const CMemBuffer &);
+
+	CMemBuffer &operator=(const CMemBuffer &);
+
+	static size_type InlineCapacity() {
+		return CMEMBLOCK_INLINE_SIZE / sizeof(T);
+	}
+
+	uint64_t _inline[(CMEMBLOCK_INLINE_SIZE + sizeof(uint64_t) - 1) / sizeof(uint64_t)];
+	T *data;
+	size_type _len;
+	size_type _capacity;
+};
+
 typedef CMemBlock<uint8_t, size_t> CMBlock;
 
 
@@ -0,0 +1,196 @@
+// Copyright (c) 2012-2018 The Elastos Open Source Project
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include <sstream>
+#include <SDK/Common/ParamChecker.h>
+
+#include "AddressTxDataStore.h"
+
+namespace Elastos {
+	namespace ElaWallet {
+
+		AddressTxDataStore::AddressTxDataStore(Sqlite *sqlite) :
+			TableBase(sqlite) {
+			initializeTable(ATX_DATABASE_CREATE);
+		}
+
+		AddressTxDataStore::AddressTxDataStore(SqliteTransactionType type, Sqlite *sqlite) :
+			TableBase(type, sqlite) {
+			initializeTable(ATX_DATABASE_CREATE);
+		}
+
+		AddressTxDataStore::~AddressTxDataStore() {
+		}
+
+		bool AddressTxDataStore::putAddressTxs(const std::string &iso, const std::vector<AddressTxEntity> &entities) {
+			return doTransaction([&iso, &entities, this]() {
+				std::stringstream ss;
+
+				ss << "INSERT OR REPLACE INTO " << ATX_TABLE_NAME << " (" <<
+				   ATX_ADDRESS << "," <<
+				   ATX_TX_HASH << "," <<
+				   ATX_BLOCK_HEIGHT << "," <<
+				   ATX_ISO <<
+				   ") VALUES (?, ?, ?, ?);";
+
+				for (size_t i = 0; i < entities.size(); ++i) {
+					SqliteStatement stmt(_sqlite, ss.str());
+					ParamChecker::checkCondition(!stmt.isValid(), Error::SqliteError, "Prepare sql " + ss.str());
+
+					_sqlite->bindText(stmt, 1, entities[i].address, nullptr);
+					_sqlite->bindText(stmt, 2, entities[i].txHash, nullptr);
+					_sqlite->bindInt64(stmt, 3, entities[i].blockHeight);
+					_sqlite->bindText(stmt, 4, iso, nullptr);
+
+					ParamChecker::checkCondition(SQLITE_DONE != _sqlite->step(stmt), Error::SqliteError,
+												 "exec sql " + ss.str());
+				}
+			});
+		}
+
+		bool AddressTxDataStore::updateAddressTxHeight(const std::string &iso, const std::string &txHash,
+													   uint32_t blockHeight) {
+			return doTransaction([&iso, &txHash, blockHeight, this]() {
+				std::stringstream ss;
+
+				ss << "UPDATE " << ATX_TABLE_NAME <<
+				   " SET " << ATX_BLOCK_HEIGHT << " = ?" <<
+				   " WHERE " << ATX_TX_HASH << " = ?" <<
+				   " AND " << ATX_ISO << " = ?;";
+
+				SqliteStatement stmt(_sqlite, ss.str());
+				ParamChecker::checkCondition(!stmt.isValid(), Error::SqliteError, "Prepare sql " + ss.str());
+
+				_sqlite->bindInt64(stmt, 1, blockHeight);
+				_sqlite->bindText(stmt, 2, txHash, nullptr);
+				_sqlite->bindText(stmt, 3, iso, nullptr);
+
+				ParamChecker::checkCondition(SQLITE_DONE != _sqlite->step(stmt), Error::SqliteError,
+											 "exec sql " + ss.str());
+			});
+		}
+
+		bool AddressTxDataStore::deleteAddressTxsByHash(const std::string &iso, const std::string &txHash) {
+			return doTransaction([&iso, &txHash, this]() {
+				std::stringstream ss;
+
+				ss << "DELETE FROM " << ATX_TABLE_NAME <<
+				   " WHERE " << ATX_TX_HASH << " = ?" <<
+				   " AND " << ATX_ISO << " = ?;";
+
+				SqliteStatement stmt(_sqlite, ss.str());
+				ParamChecker::checkCondition(!stmt.isValid(), Error::SqliteError, "Prepare sql " + ss.str());
+
+				_sqlite->bindText(stmt, 1, txHash, nullptr);
+				_sqlite->bindText(stmt, 2, iso, nullptr);
+
+				ParamChecker::checkCondition(SQLITE_DONE != _sqlite->step(stmt), Error::SqliteError,
+											 "exec sql " + ss.str());
+			});
+		}
+
+		bool AddressTxDataStore::deleteAllAddressTxs(const std::string &iso) {
+			return doTransaction([&iso, this]() {
+				std::stringstream ss;
+
+				ss << "DELETE FROM " << ATX_TABLE_NAME <<
+				   " WHERE " << ATX_ISO << " = ?;";
+
+				SqliteStatement stmt(_sqlite, ss.str());
+				ParamChecker::checkCondition(!stmt.isValid(), Error::SqliteError, "Prepare sql " + ss.str());
+
+				_sqlite->bindText(stmt, 1, iso, nullptr);
+
+				ParamChecker::checkCondition(SQLITE_DONE != _sqlite->step(stmt), Error::SqliteError,
+											 "exec sql " + ss.str());
+			});
+		}
+
+		size_t AddressTxDataStore::getAddressTxsCount(const std::string &iso, const std::string &address) const {
+			size_t count = 0;
+
+			doSelect([&iso, &address, &count, this](Sqlite *sqlite) {
+				std::stringstream ss;
+
+				ss << "SELECT COUNT(*) FROM " << ATX_TABLE_NAME <<
+				   " WHERE " << ATX_ADDRESS << " = ?" <<
+				   " AND " << ATX_ISO << " = ?;";
+
+				SqliteStatement stmt(sqlite, ss.str());
+				ParamChecker::checkCondition(!stmt.isValid(), Error::SqliteError, "Prepare sql " + ss.str());
+
+				sqlite->bindText(stmt, 1, address, nullptr);
+				sqlite->bindText(stmt, 2, iso, nullptr);
+
+				if (SQLITE_ROW == sqlite->step(stmt)) {
+					count = (size_t) sqlite->columnInt64(stmt, 0);
+				}
+			});
+
+			return count;
+		}
+
+		std::vector<AddressTxEntity> AddressTxDataStore::getAddressTxs(const std::string &iso,
+																	   const std::string &address,
+																	   size_t offset, size_t limit) const {
+			std::vector<AddressTxEntity> entities;
+
+			doSelect([&iso, &address, offset, limit, &entities, this](Sqlite *sqlite) {
+				std::stringstream ss;
+
+				ss << "SELECT " <<
+				   ATX_TX_HASH << ", " <<
+				   ATX_BLOCK_HEIGHT <<
+				   " FROM " << ATX_TABLE_NAME <<
+				   " WHERE " << ATX_ADDRESS << " = ?" <<
+				   " AND " << ATX_ISO << " = ?" <<
+				   " ORDER BY " << ATX_BLOCK_HEIGHT << " DESC, " << ATX_TX_HASH << " ASC" <<
+				   " LIMIT ? OFFSET ?;";
+
+				SqliteStatement stmt(sqlite, ss.str());
+				ParamChecker::checkCondition(!stmt.isValid(), Error::SqliteError, "Prepare sql " + ss.str());
+
+				sqlite->bindText(stmt, 1, address, nullptr);
+				sqlite->bindText(stmt, 2, iso, nullptr);
+				sqlite->bindInt64(stmt, 3, limit);
+				sqlite->bindInt64(stmt, 4, offset);
+
+				while (SQLITE_ROW == sqlite->step(stmt)) {
+					entities.push_back(AddressTxEntity(address, sqlite->columnText(stmt, 0),
+													   (uint32_t) sqlite->columnInt64(stmt, 1)));
+				}
+			});
+
+			return entities;
+		}
+
+		std::vector<AddressTxEntity> AddressTxDataStore::getAllAddressTxs(const std::string &iso) const {
+			std::vector<AddressTxEntity> entities;
+
+			doSelect([&iso, &entities, this](Sqlite *sqlite) {
+				std::stringstream ss;
+
+				ss << "SELECT " <<
+				   ATX_ADDRESS << ", " <<
+				   ATX_TX_HASH << ", " <<
+				   ATX_BLOCK_HEIGHT <<
+				   " FROM " << ATX_TABLE_NAME <<
+				   " WHERE " << ATX_ISO << " = ?;";
+
+				SqliteStatement stmt(sqlite, ss.str());
+				ParamChecker::checkCondition(!stmt.isValid(), Error::SqliteError, "Prepare sql " + ss.str());
+
+				sqlite->bindText(stmt, 1, iso, nullptr);
+
+				while (SQLITE_ROW == sqlite->step(stmt)) {
+					entities.push_back(AddressTxEntity(sqlite->columnText(stmt, 0), sqlite->columnText(stmt, 1),
+													   (uint32_t) sqlite->columnInt64(stmt, 2)));
+				}
+			});
+
+			return entities;
+		}
+
+	}
+}
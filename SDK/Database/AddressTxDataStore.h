@@ -0,0 +1,78 @@
+// Copyright (c) 2012-2018 The Elastos Open Source Project
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#ifndef __ELASTOS_SDK_ADDRESSTXDATASTORE_H__
+#define __ELASTOS_SDK_ADDRESSTXDATASTORE_H__
+
+#include <vector>
+
+#include "Sqlite.h"
+#include "TableBase.h"
+
+namespace Elastos {
+	namespace ElaWallet {
+
+		struct AddressTxEntity {
+			AddressTxEntity() :
+				blockHeight(0)
+			{
+			}
+
+			AddressTxEntity(const std::string &addr, const std::string &hash, uint32_t height) :
+				address(addr),
+				txHash(hash),
+				blockHeight(height)
+			{
+			}
+
+			std::string address;
+			std::string txHash;
+			uint32_t blockHeight;
+		};
+
+		/*
+		 * (address, txHash, blockHeight) rows for every address a wallet transaction spends from or
+		 * pays to, ordered by height (newest first) for history pagination.
+		 */
+		class AddressTxDataStore : public TableBase {
+		public:
+			AddressTxDataStore(Sqlite *sqlite);
+			AddressTxDataStore(SqliteTransactionType type, Sqlite *sqlite);
+			~AddressTxDataStore();
+
+			bool putAddressTxs(const std::string &iso, const std::vector<AddressTxEntity> &entities);
+			bool updateAddressTxHeight(const std::string &iso, const std::string &txHash, uint32_t blockHeight);
+			bool deleteAddressTxsByHash(const std::string &iso, const std::string &txHash);
+			bool deleteAllAddressTxs(const std::string &iso);
+			size_t getAddressTxsCount(const std::string &iso, const std::string &address) const;
+			std::vector<AddressTxEntity> getAddressTxs(const std::string &iso, const std::string &address,
+													   size_t offset, size_t limit) const;
+			std::vector<AddressTxEntity> getAllAddressTxs(const std::string &iso) const;
+
+		private:
+			/*
+			 * address to transaction index table
+			 */
+			const std::string ATX_TABLE_NAME = "addressTxTable";
+			const std::string ATX_ADDRESS = "address";
+			const std::string ATX_TX_HASH = "txHash";
+			const std::string ATX_BLOCK_HEIGHT = "blockHeight";
+			const std::string ATX_ISO = "addressTxISO";
+
+			const std::string ATX_DATABASE_CREATE = "create table if not exists " + ATX_TABLE_NAME + " (" +
+				ATX_ADDRESS + " text not null, " +
+				ATX_TX_HASH + " text not null, " +
+				ATX_BLOCK_HEIGHT + " integer, " +
+				ATX_ISO + " text DEFAULT 'ELA', " +
+				"unique (" + ATX_ADDRESS + ", " + ATX_TX_HASH + ", " + ATX_ISO + "));" +
+				"create index if not exists " + ATX_TABLE_NAME + "AddressIndex on " + ATX_TABLE_NAME + " (" +
+				ATX_ADDRESS + ", " + ATX_ISO + ", " + ATX_BLOCK_HEIGHT + ");" +
+				"create index if not exists " + ATX_TABLE_NAME + "HashIndex on " + ATX_TABLE_NAME + " (" +
+				ATX_TX_HASH + ", " + ATX_ISO + ");";
+		};
+
+	}
+}
+
+#endif //__ELASTOS_SDK_ADDRESSTXDATASTORE_H__
@@ -3,6 +3,10 @@
 // file COPYING or http://www.opensource.org/licenses/mit-license.php.
 
 #include "DatabaseManager.h"
+#include "Log.h"
+
+// Read-only connections serving queries next to the single writer connection
+#define DATABASE_READER_COUNT 2
 
 namespace Elastos {
 	namespace ElaWallet {
@@ -10,12 +14,19 @@ namespace Elastos {
 		DatabaseManager::DatabaseManager(const boost::filesystem::path &path) :
 			_path(path),
 			_sqlite(path),
+			_readerPool(path, DATABASE_READER_COUNT),
 			_peerDataSource(&_sqlite),
-			_transactionDataStore(&_sqlite),
+			_transactionDataStore(IMMEDIATE, &_sqlite),
 			_merkleBlockDataSource(&_sqlite),
 			_externalAddresses(&_sqlite),
-			_internalAddresses(&_sqlite) {
-
+			_internalAddresses(&_sqlite),
+			_addressTxDataStore(&_sqlite) {
+			_externalAddresses.setReaderPool(&_readerPool);
+			_internalAddresses.setReaderPool(&_readerPool);
+			_peerDataSource.setReaderPool(&_readerPool);
+			_transactionDataStore.setReaderPool(&_readerPool);
+			_merkleBlockDataSource.setReaderPool(&_readerPool);
+			_addressTxDataStore.setReaderPool(&_readerPool);
 		}
 
 		DatabaseManager::DatabaseManager() :
@@ -31,6 +42,10 @@ namespace Elastos {
 			return _transactionDataStore.putTransaction(iso, tx);
 		}
 
+		bool DatabaseManager::putTransactions(const std::string &iso, const std::vector<TransactionEntity> &txEntities) {
+			return _transactionDataStore.putTransactions(iso, txEntities);
+		}
+
 		bool DatabaseManager::deleteAllTransactions(const std::string &iso) {
 			return _transactionDataStore.deleteAllTransactions(iso);
 		}
@@ -43,10 +58,19 @@ namespace Elastos {
 			return _transactionDataStore.getAllTransactions(iso);
 		}
 
+		bool DatabaseManager::visitTransactions(const std::string &iso, const TransactionVisitor &visitor) const {
+			return _transactionDataStore.visitTransactions(iso, visitor);
+		}
+
 		bool DatabaseManager::updateTransaction(const std::string &iso, const TransactionEntity &txEntity) {
 			return _transactionDataStore.updateTransaction(iso, txEntity);
 		}
 
+		bool DatabaseManager::updateTransactions(const std::string &iso,
+												 const std::vector<TransactionEntity> &txEntities) {
+			return _transactionDataStore.updateTransactions(iso, txEntities);
+		}
+
 		bool DatabaseManager::deleteTxByHash(const std::string &iso, const std::string &hash) {
 			return _transactionDataStore.deleteTxByHash(iso, hash);
 		}
@@ -92,14 +116,49 @@ namespace Elastos {
 			return _merkleBlockDataSource.deleteAllBlocks(iso);
 		}
 
+		bool DatabaseManager::deleteBlocksBelowHeight(const std::string &iso, uint32_t height) {
+			return _merkleBlockDataSource.deleteBlocksBelowHeight(iso, height);
+		}
+
 		std::vector<MerkleBlockEntity> DatabaseManager::getAllMerkleBlocks(const std::string &iso) const {
 			return _merkleBlockDataSource.getAllMerkleBlocks(iso);
 		}
 
+		bool DatabaseManager::visitMerkleBlocks(const std::string &iso, const MerkleBlockVisitor &visitor) const {
+			return _merkleBlockDataSource.visitMerkleBlocks(iso, visitor);
+		}
+
 		const boost::filesystem::path &DatabaseManager::getPath() const {
 			return _path;
 		}
 
+		bool DatabaseManager::setDurability(SqliteDurability durability) {
+			return _sqlite.setDurability(durability);
+		}
+
+		bool DatabaseManager::doTransaction(const boost::function<void()> &fun) {
+			_sqlite.beginTransaction(IMMEDIATE);
+			try {
+				fun();
+			}
+			catch (const std::exception &ex) {
+				Log::getLogger()->error("Data base error: {}", ex.what());
+				_sqlite.rollbackTransaction();
+				return false;
+			}
+			catch (...) {
+				Log::error("Unknown data base error.");
+				_sqlite.rollbackTransaction();
+				return false;
+			}
+
+			return _sqlite.endTransaction();
+		}
+
+		std::vector<SqliteStatementStats> DatabaseManager::getStatementStats() const {
+			return _sqlite.getStatementStats();
+		}
+
 		bool DatabaseManager::putInternalAddress(uint32_t startIndex, const std::string &address) {
 			return _internalAddresses.putAddress(startIndex, address);
 		}
@@ -140,5 +199,35 @@ namespace Elastos {
 			return _externalAddresses.getAvailableAddresses(startIndex);
 		}
 
+		bool DatabaseManager::putAddressTxs(const std::string &iso, const std::vector<AddressTxEntity> &entities) {
+			return _addressTxDataStore.putAddressTxs(iso, entities);
+		}
+
+		bool DatabaseManager::updateAddressTxHeight(const std::string &iso, const std::string &txHash,
+													uint32_t blockHeight) {
+			return _addressTxDataStore.updateAddressTxHeight(iso, txHash, blockHeight);
+		}
+
+		bool DatabaseManager::deleteAddressTxsByHash(const std::string &iso, const std::string &txHash) {
+			return _addressTxDataStore.deleteAddressTxsByHash(iso, txHash);
+		}
+
+		bool DatabaseManager::deleteAllAddressTxs(const std::string &iso) {
+			return _addressTxDataStore.deleteAllAddressTxs(iso);
+		}
+
+		size_t DatabaseManager::getAddressTxsCount(const std::string &iso, const std::string &address) const {
+			return _addressTxDataStore.getAddressTxsCount(iso, address);
+		}
+
+		std::vector<AddressTxEntity> DatabaseManager::getAddressTxs(const std::string &iso, const std::string &address,
+																	size_t offset, size_t limit) const {
+			return _addressTxDataStore.getAddressTxs(iso, address, offset, limit);
+		}
+
+		std::vector<AddressTxEntity> DatabaseManager::getAllAddressTxs(const std::string &iso) const {
+			return _addressTxDataStore.getAllAddressTxs(iso);
+		}
+
 	}
 }
@@ -5,11 +5,14 @@
 #ifndef __ELASTOS_SDK_DATABASEMANAGER_H__
 #define __ELASTOS_SDK_DATABASEMANAGER_H__
 
+#include <boost/function.hpp>
+
 #include "MerkleBlockDataSource.h"
 #include "TransactionDataStore.h"
 #include "PeerDataSource.h"
 #include "ExternalAddresses.h"
 #include "InternalAddresses.h"
+#include "AddressTxDataStore.h"
 #include "Sqlite.h"
 
 namespace Elastos {
@@ -23,10 +26,13 @@ namespace Elastos {
 
 			// Transaction's database interface
 			bool putTransaction(const std::string &iso, const TransactionEntity &tx);
+			bool putTransactions(const std::string &iso, const std::vector<TransactionEntity> &txEntities);
 			bool deleteAllTransactions(const std::string &iso);
 			size_t getAllTransactionsCount(const std::string &iso) const;
 			std::vector<TransactionEntity> getAllTransactions(const std::string &iso) const;
+			bool visitTransactions(const std::string &iso, const TransactionVisitor &visitor) const;
 			bool updateTransaction(const std::string &iso, const TransactionEntity &txEntity);
+			bool updateTransactions(const std::string &iso, const std::vector<TransactionEntity> &txEntities);
 			bool deleteTxByHash(const std::string &iso, const std::string &hash);
 
 			// Peer's database interface
@@ -42,7 +48,9 @@ namespace Elastos {
 			bool putMerkleBlocks(const std::string &iso, const std::vector<MerkleBlockEntity> &blockEntities);
 			bool deleteMerkleBlock(const std::string &iso, const MerkleBlockEntity &blockEntity);
 			bool deleteAllBlocks(const std::string &iso);
+			bool deleteBlocksBelowHeight(const std::string &iso, uint32_t height);
 			std::vector<MerkleBlockEntity> getAllMerkleBlocks(const std::string &iso) const;
+			bool visitMerkleBlocks(const std::string &iso, const MerkleBlockVisitor &visitor) const;
 
 			// InternalAddresses's database interface
 			bool putInternalAddress(uint32_t startIndex, const std::string &address);
@@ -58,16 +66,36 @@ namespace Elastos {
 			std::vector<std::string> getExternalAddresses(uint32_t startIndex, uint32_t count);
 			uint32_t getExternalAvailableAddresses(uint32_t startIndex);
 
+			// AddressTxDataStore's database interface
+			bool putAddressTxs(const std::string &iso, const std::vector<AddressTxEntity> &entities);
+			bool updateAddressTxHeight(const std::string &iso, const std::string &txHash, uint32_t blockHeight);
+			bool deleteAddressTxsByHash(const std::string &iso, const std::string &txHash);
+			bool deleteAllAddressTxs(const std::string &iso);
+			size_t getAddressTxsCount(const std::string &iso, const std::string &address) const;
+			std::vector<AddressTxEntity> getAddressTxs(const std::string &iso, const std::string &address,
+													   size_t offset, size_t limit) const;
+			std::vector<AddressTxEntity> getAllAddressTxs(const std::string &iso) const;
+
 			const boost::filesystem::path &getPath() const;
 
+			bool setDurability(SqliteDurability durability);
+
+			// Runs fun in one database transaction, the interfaces above called inside it share the commit.
+			bool doTransaction(const boost::function<void()> &fun);
+
+			// Prepared statement cache statistics, one record per cached sql
+			std::vector<SqliteStatementStats> getStatementStats() const;
+
 		private:
 			boost::filesystem::path _path;
 			Sqlite                	_sqlite;
+			SqliteReaderPool		_readerPool;
 			ExternalAddresses		_externalAddresses;
 			InternalAddresses		_internalAddresses;
 			PeerDataSource        	_peerDataSource;
 			TransactionDataStore  	_transactionDataStore;
 			MerkleBlockDataSource 	_merkleBlockDataSource;
+			AddressTxDataStore		_addressTxDataStore;
 		};
 
 	}
@@ -0,0 +1,206 @@
+// Copyright (c) 2012-2018 The Elastos Open Source Project
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include <cerrno>
+#include <cstring>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#include "HeaderStore.h"
+#include "Log.h"
+
+#define HEADER_STORE_MAGIC 0x52444845 // "EHDR"
+#define HEADER_STORE_INITIAL_CAPACITY 4096
+
+namespace Elastos {
+	namespace ElaWallet {
+
+		HeaderStore::HeaderStore() :
+				_fd(-1),
+				_data(nullptr),
+				_capacity(0),
+				_header(nullptr) {
+		}
+
+		HeaderStore::~HeaderStore() {
+			close();
+		}
+
+		bool HeaderStore::open(const boost::filesystem::path &path) {
+			boost::mutex::scoped_lock lock(_mutex);
+
+			if (_fd >= 0)
+				return true;
+
+			boost::filesystem::path parentPath = path.parent_path();
+			if (!parentPath.empty() && !boost::filesystem::exists(parentPath)) {
+				if (!boost::filesystem::create_directories(parentPath)) {
+					Log::getLogger()->error("create directory \"{}\" error", parentPath.string());
+					return false;
+				}
+			}
+
+			_fd = ::open(path.string().c_str(), O_RDWR | O_CREAT, 0644);
+			if (_fd < 0) {
+				Log::getLogger()->error("open header store \"{}\" error: {}", path.string(), strerror(errno));
+				return false;
+			}
+			_path = path;
+
+			struct stat st;
+			if (fstat(_fd, &st) != 0) {
+				::close(_fd);
+				_fd = -1;
+				return false;
+			}
+
+			size_t capacity = HEADER_STORE_INITIAL_CAPACITY;
+			bool fresh = (size_t) st.st_size < sizeof(FileHeader) + sizeof(HeaderRecord);
+			if (!fresh)
+				capacity = ((size_t) st.st_size - sizeof(FileHeader)) / sizeof(HeaderRecord);
+
+			if (!map(capacity)) {
+				::close(_fd);
+				_fd = -1;
+				return false;
+			}
+
+			if (fresh || _header->magic != HEADER_STORE_MAGIC || _header->recordSize != sizeof(HeaderRecord) ||
+				_header->count > _capacity) {
+				if (!fresh)
+					Log::getLogger()->warn("header store \"{}\" is invalid, reset", path.string());
+				memset(_header, 0, sizeof(FileHeader));
+				_header->magic = HEADER_STORE_MAGIC;
+				_header->recordSize = sizeof(HeaderRecord);
+			}
+
+			return true;
+		}
+
+		void HeaderStore::close() {
+			boost::mutex::scoped_lock lock(_mutex);
+
+			if (_fd < 0)
+				return;
+
+			if (_data != nullptr)
+				msync(_data, sizeof(FileHeader) + _capacity * sizeof(HeaderRecord), MS_SYNC);
+			unmap();
+			::close(_fd);
+			_fd = -1;
+		}
+
+		bool HeaderStore::isOpen() const {
+			boost::mutex::scoped_lock lock(_mutex);
+			return _header != nullptr;
+		}
+
+		size_t HeaderStore::size() const {
+			boost::mutex::scoped_lock lock(_mutex);
+			return _header != nullptr ? _header->count : 0;
+		}
+
+		uint32_t HeaderStore::firstHeight() const {
+			boost::mutex::scoped_lock lock(_mutex);
+			return _header != nullptr ? _header->firstHeight : 0;
+		}
+
+		uint32_t HeaderStore::lastHeight() const {
+			boost::mutex::scoped_lock lock(_mutex);
+			if (_header == nullptr || _header->count == 0)
+				return 0;
+			return _header->firstHeight + _header->count - 1;
+		}
+
+		bool HeaderStore::get(uint32_t height, HeaderRecord &record) const {
+			boost::mutex::scoped_lock lock(_mutex);
+
+			if (_header == nullptr || height < _header->firstHeight || height - _header->firstHeight >= _header->count)
+				return false;
+
+			record = *recordAt(height - _header->firstHeight);
+			return true;
+		}
+
+		bool HeaderStore::put(const HeaderRecord &record) {
+			boost::mutex::scoped_lock lock(_mutex);
+
+			if (_header == nullptr)
+				return false;
+
+			uint32_t firstHeight = _header->firstHeight, count = 0;
+			if (_header->count == 0 || record.height < firstHeight || record.height - firstHeight > _header->count) {
+				firstHeight = record.height;
+			} else {
+				count = record.height - firstHeight;
+			}
+
+			// the chain is left as it was if the file can't grow
+			if (count == _capacity && !map(_capacity * 2))
+				return false;
+
+			_header->firstHeight = firstHeight;
+			_header->count = count;
+			*recordAt(_header->count) = record;
+			_header->count++;
+			return true;
+		}
+
+		void HeaderStore::truncate(uint32_t height) {
+			boost::mutex::scoped_lock lock(_mutex);
+
+			if (_header == nullptr)
+				return;
+
+			if (height <= _header->firstHeight)
+				_header->count = 0;
+			else if (height - _header->firstHeight < _header->count)
+				_header->count = height - _header->firstHeight;
+		}
+
+		void HeaderStore::flush() {
+			boost::mutex::scoped_lock lock(_mutex);
+
+			if (_data != nullptr)
+				msync(_data, sizeof(FileHeader) + _capacity * sizeof(HeaderRecord), MS_ASYNC);
+		}
+
+		bool HeaderStore::map(size_t capacity) {
+			// the new mapping replaces the current one only once it's in place
+			size_t length = sizeof(FileHeader) + capacity * sizeof(HeaderRecord);
+			struct stat st;
+			if (fstat(_fd, &st) != 0 || ((size_t) st.st_size < length && ftruncate(_fd, length) != 0)) {
+				Log::getLogger()->error("resize header store \"{}\" error: {}", _path.string(), strerror(errno));
+				return false;
+			}
+
+			void *data = mmap(nullptr, length, PROT_READ | PROT_WRITE, MAP_SHARED, _fd, 0);
+			if (data == MAP_FAILED) {
+				Log::getLogger()->error("mmap header store \"{}\" error: {}", _path.string(), strerror(errno));
+				return false;
+			}
+
+			unmap();
+			_data = (uint8_t *) data;
+			_capacity = capacity;
+			_header = (FileHeader *) _data;
+			return true;
+		}
+
+		void HeaderStore::unmap() {
+			if (_data != nullptr)
+				munmap(_data, sizeof(FileHeader) + _capacity * sizeof(HeaderRecord));
+			_data = nullptr;
+			_header = nullptr;
+			_capacity = 0;
+		}
+
+		HeaderRecord *HeaderStore::recordAt(size_t index) const {
+			return (HeaderRecord *) (_data + sizeof(FileHeader)) + index;
+		}
+
+	}
+}
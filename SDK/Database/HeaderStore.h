@@ -0,0 +1,92 @@
+// Copyright (c) 2012-2018 The Elastos Open Source Project
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#ifndef __ELASTOS_SDK_HEADERSTORE_H__
+#define __ELASTOS_SDK_HEADERSTORE_H__
+
+#include <boost/filesystem.hpp>
+#include <boost/thread/mutex.hpp>
+
+#include "BRInt.h"
+
+namespace Elastos {
+	namespace ElaWallet {
+
+		struct HeaderRecord {
+			HeaderRecord() :
+				blockHash(UINT256_ZERO),
+				prevBlock(UINT256_ZERO),
+				merkleRoot(UINT256_ZERO),
+				height(0),
+				timestamp(0),
+				target(0),
+				version(0),
+				nonce(0),
+				reserved(0)
+			{
+			}
+
+			UInt256 blockHash;
+			UInt256 prevBlock;
+			UInt256 merkleRoot;
+			uint32_t height;
+			uint32_t timestamp;
+			uint32_t target;
+			uint32_t version;
+			uint32_t nonce;
+			uint32_t reserved;
+		};
+
+		/*
+		 * Block header chain kept in a memory-mapped file of fixed-size records, one per height and
+		 * without gaps, so a record is found by its offset and reading the tip only touches the last
+		 * pages of the file. Putting a header at or below the current tip truncates the chain there
+		 * first (reorg), putting one past tip + 1 restarts the chain at that height.
+		 */
+		class HeaderStore {
+		public:
+			HeaderStore();
+			~HeaderStore();
+
+			bool open(const boost::filesystem::path &path);
+			void close();
+			bool isOpen() const;
+
+			size_t size() const;
+			uint32_t firstHeight() const;
+			uint32_t lastHeight() const;
+
+			// false if no header is stored at this height
+			bool get(uint32_t height, HeaderRecord &record) const;
+			bool put(const HeaderRecord &record);
+			// drops every header at or above height
+			void truncate(uint32_t height);
+			void flush();
+
+		private:
+			struct FileHeader {
+				uint32_t magic;
+				uint32_t recordSize;
+				uint32_t firstHeight;
+				uint32_t count;
+				uint64_t reserved;
+			};
+
+			bool map(size_t capacity);
+			void unmap();
+			HeaderRecord *recordAt(size_t index) const;
+
+		private:
+			mutable boost::mutex _mutex;
+			boost::filesystem::path _path;
+			int _fd;
+			uint8_t *_data;
+			size_t _capacity;
+			FileHeader *_header;
+		};
+
+	}
+}
+
+#endif //__ELASTOS_SDK_HEADERSTORE_H__
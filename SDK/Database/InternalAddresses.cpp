@@ -44,15 +44,13 @@ namespace Elastos {
 			   IA_ADDRESS <<
 			   ") VALUES (?, ?);";
 
-			sqlite3_stmt *stmt;
-			ParamChecker::checkCondition(!_sqlite->prepare(ss.str(), &stmt, nullptr), Error::SqliteError,
-										 "Prepare sql " + ss.str());
+			SqliteStatement stmt(_sqlite, ss.str());
+			ParamChecker::checkCondition(!stmt.isValid(), Error::SqliteError, "Prepare sql " + ss.str());
 
 			_sqlite->bindInt(stmt, 1, startIndex);
 			_sqlite->bindText(stmt, 2, address, nullptr);
 
 			_sqlite->step(stmt);
-			_sqlite->finalize(stmt);
 
 			return true;
 		}
@@ -63,7 +61,10 @@ namespace Elastos {
 
 				ss << "DELETE FROM " << IA_TABLE_NAME << ";";
 
-				ParamChecker::checkCondition(!_sqlite->exec(ss.str(), nullptr, nullptr), Error::SqliteError,
+				SqliteStatement stmt(_sqlite, ss.str());
+				ParamChecker::checkCondition(!stmt.isValid(), Error::SqliteError, "Prepare sql " + ss.str());
+
+				ParamChecker::checkCondition(SQLITE_DONE != _sqlite->step(stmt), Error::SqliteError,
 											 "Exec sql " + ss.str());
 			});
 		}
@@ -71,25 +72,25 @@ namespace Elastos {
 		std::vector<std::string> InternalAddresses::getAddresses(uint32_t startIndex, uint32_t count) const {
 			std::vector<std::string> results;
 
-			doTransaction([startIndex, count, &results, this]() {
+			doSelect([startIndex, count, &results, this](Sqlite *sqlite) {
 				std::string addr;
 				std::stringstream ss;
 				ss << "SELECT " <<
 				   IA_ADDRESS <<
 				   " FROM " << IA_TABLE_NAME <<
-				   " WHERE " << IA_COLUMN_ID << " >= " << startIndex <<
-				   " AND " << IA_COLUMN_ID << " < " << startIndex + count << ";";
+				   " WHERE " << IA_COLUMN_ID << " >= ?" <<
+				   " AND " << IA_COLUMN_ID << " < ?;";
+
+				SqliteStatement stmt(sqlite, ss.str());
+				ParamChecker::checkCondition(!stmt.isValid(), Error::SqliteError, "Prepare sql " + ss.str());
 
-				sqlite3_stmt *stmt;
-				ParamChecker::checkCondition(!_sqlite->prepare(ss.str(), &stmt, nullptr), Error::SqliteError,
-											 "Prepare sql " + ss.str());
+				sqlite->bindInt64(stmt, 1, startIndex);
+				sqlite->bindInt64(stmt, 2, (int64_t) startIndex + count);
 
-				while (SQLITE_ROW == _sqlite->step(stmt)) {
-					addr = _sqlite->columnText(stmt, 0);
+				while (SQLITE_ROW == sqlite->step(stmt)) {
+					addr = sqlite->columnText(stmt, 0);
 					results.push_back(addr);
 				}
-
-				_sqlite->finalize(stmt);
 			});
 
 			return results;
@@ -98,22 +99,21 @@ namespace Elastos {
 		uint32_t InternalAddresses::getAvailableAddresses(uint32_t startIndex) const {
 			uint32_t results = 0;
 
-			doTransaction([startIndex, &results, this]() {
+			doSelect([startIndex, &results, this](Sqlite *sqlite) {
 				std::stringstream ss;
 				ss << "SELECT " <<
 				   " COUNT(" << IA_ADDRESS << ") AS nums " <<
 				   " FROM " << IA_TABLE_NAME <<
-				   " WHERE " << IA_COLUMN_ID << " >= " << startIndex << ";";
+				   " WHERE " << IA_COLUMN_ID << " >= ?;";
 
-				sqlite3_stmt *stmt;
-				ParamChecker::checkCondition(!_sqlite->prepare(ss.str(), &stmt, nullptr), Error::SqliteError,
-											 "Prepare sql " + ss.str());
+				SqliteStatement stmt(sqlite, ss.str());
+				ParamChecker::checkCondition(!stmt.isValid(), Error::SqliteError, "Prepare sql " + ss.str());
 
-				while (SQLITE_ROW == _sqlite->step(stmt)) {
-					results = (uint32_t) _sqlite->columnInt(stmt, 0);
-				}
+				sqlite->bindInt64(stmt, 1, startIndex);
 
-				_sqlite->finalize(stmt);
+				while (SQLITE_ROW == sqlite->step(stmt)) {
+					results = (uint32_t) sqlite->columnInt(stmt, 0);
+				}
 			});
 
 			return results;
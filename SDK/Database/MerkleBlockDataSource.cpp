@@ -49,9 +49,8 @@ namespace Elastos {
 			   MB_ISO <<
 			   ") VALUES (?, ?, ?);";
 
-			sqlite3_stmt *stmt;
-			ParamChecker::checkCondition(!_sqlite->prepare(ss.str(), &stmt, nullptr), Error::SqliteError,
-										 "prepare sql " + ss.str());
+			SqliteStatement stmt(_sqlite, ss.str());
+			ParamChecker::checkCondition(!stmt.isValid(), Error::SqliteError, "prepare sql " + ss.str());
 #ifdef NDEBUG
 			_sqlite->bindBlob(stmt, 1, blockEntity.blockBytes, nullptr);
 #else
@@ -64,7 +63,6 @@ namespace Elastos {
 			_sqlite->bindText(stmt, 3, iso, nullptr);
 
 			_sqlite->step(stmt);
-			_sqlite->finalize(stmt);
 			return true;
 		}
 
@@ -73,10 +71,16 @@ namespace Elastos {
 				std::stringstream ss;
 
 				ss << "DELETE FROM " << MB_TABLE_NAME <<
-				   " WHERE " << MB_COLUMN_ID << " = " << blockEntity.id <<
-				   " AND " << MB_ISO << " = " << "'" << iso << "';";
+				   " WHERE " << MB_COLUMN_ID << " = ?" <<
+				   " AND " << MB_ISO << " = ?;";
 
-				ParamChecker::checkCondition(!_sqlite->exec(ss.str(), nullptr, nullptr), Error::SqliteError,
+				SqliteStatement stmt(_sqlite, ss.str());
+				ParamChecker::checkCondition(!stmt.isValid(), Error::SqliteError, "prepare sql " + ss.str());
+
+				_sqlite->bindInt64(stmt, 1, blockEntity.id);
+				_sqlite->bindText(stmt, 2, iso, nullptr);
+
+				ParamChecker::checkCondition(SQLITE_DONE != _sqlite->step(stmt), Error::SqliteError,
 											 "exec sql " + ss.str());
 			});
 		}
@@ -86,9 +90,33 @@ namespace Elastos {
 				std::stringstream ss;
 
 				ss << "DELETE FROM " << MB_TABLE_NAME <<
-				   " WHERE " << MB_ISO << " = '" << iso << "';";
+				   " WHERE " << MB_ISO << " = ?;";
+
+				SqliteStatement stmt(_sqlite, ss.str());
+				ParamChecker::checkCondition(!stmt.isValid(), Error::SqliteError, "prepare sql " + ss.str());
+
+				_sqlite->bindText(stmt, 1, iso, nullptr);
 
-				ParamChecker::checkCondition(!_sqlite->exec(ss.str(), nullptr, nullptr), Error::SqliteError,
+				ParamChecker::checkCondition(SQLITE_DONE != _sqlite->step(stmt), Error::SqliteError,
+											 "exec sql " + ss.str());
+			});
+		}
+
+		bool MerkleBlockDataSource::deleteBlocksBelowHeight(const std::string &iso, uint32_t height) {
+			return doTransaction([&iso, height, this]() {
+				std::stringstream ss;
+
+				ss << "DELETE FROM " << MB_TABLE_NAME <<
+				   " WHERE " << MB_HEIGHT << " < ?" <<
+				   " AND " << MB_ISO << " = ?;";
+
+				SqliteStatement stmt(_sqlite, ss.str());
+				ParamChecker::checkCondition(!stmt.isValid(), Error::SqliteError, "prepare sql " + ss.str());
+
+				_sqlite->bindInt64(stmt, 1, height);
+				_sqlite->bindText(stmt, 2, iso, nullptr);
+
+				ParamChecker::checkCondition(SQLITE_DONE != _sqlite->step(stmt), Error::SqliteError,
 											 "exec sql " + ss.str());
 			});
 		}
@@ -96,48 +124,58 @@ namespace Elastos {
 		std::vector<MerkleBlockEntity> MerkleBlockDataSource::getAllMerkleBlocks(const std::string &iso) const {
 			std::vector<MerkleBlockEntity> merkleBlocks;
 
-			doTransaction([&iso, &merkleBlocks, this]() {
-				MerkleBlockEntity merkleBlock;
+			visitMerkleBlocks(iso, [&merkleBlocks](const MerkleBlockEntityView &view) {
+				CMBlock blockBytes;
+				blockBytes.Resize(view.blockSize);
+				memcpy(blockBytes, view.blockBytes, view.blockSize);
+
+				merkleBlocks.push_back(MerkleBlockEntity(view.id, blockBytes, view.blockHeight));
+				return true;
+			});
+
+			return merkleBlocks;
+		}
+
+		bool MerkleBlockDataSource::visitMerkleBlocks(const std::string &iso, const MerkleBlockVisitor &visitor) const {
+			return doSelect([&iso, &visitor, this](Sqlite *sqlite) {
+				MerkleBlockEntityView view;
 				std::stringstream ss;
 				ss << "SELECT " <<
 				   MB_COLUMN_ID << ", " <<
 				   MB_BUFF << ", " <<
 				   MB_HEIGHT <<
 				   " FROM " << MB_TABLE_NAME <<
-				   " WHERE " << MB_ISO << " = '" << iso << "';";
+				   " WHERE " << MB_ISO << " = ?;";
+
+				SqliteStatement stmt(sqlite, ss.str());
+				ParamChecker::checkCondition(!stmt.isValid(), Error::SqliteError, "prepare sql " + ss.str());
 
-				sqlite3_stmt *stmt;
-				ParamChecker::checkCondition(!_sqlite->prepare(ss.str(), &stmt, nullptr), Error::SqliteError,
-											 "prepare sql " + ss.str());
+				sqlite->bindText(stmt, 1, iso, nullptr);
 
-				while (SQLITE_ROW == _sqlite->step(stmt)) {
-					CMBlock blockBytes;
+				while (SQLITE_ROW == sqlite->step(stmt)) {
 					// id
-					merkleBlock.id = _sqlite->columnInt(stmt, 0);
+					view.id = sqlite->columnInt(stmt, 0);
 
 					// blockBytes
-					const uint8_t *pblob = (const uint8_t *) _sqlite->columnBlob(stmt, 1);
-					size_t len = _sqlite->columnBytes(stmt, 1);
+					const uint8_t *pblob = (const uint8_t *) sqlite->columnBlob(stmt, 1);
+					size_t len = sqlite->columnBytes(stmt, 1);
 #ifdef NDEBUG
-					blockBytes.Resize(len);
-					memcpy(blockBytes, pblob, len);
-
-					merkleBlock.blockBytes = blockBytes;
+					view.blockBytes = pblob;
+					view.blockSize = len;
 #else
 					std::string str((char *) pblob);
-					merkleBlock.blockBytes = Utils::decodeHex(str);
+					CMBlock blockBytes = Utils::decodeHex(str);
+					view.blockBytes = blockBytes;
+					view.blockSize = blockBytes.GetSize();
 #endif
 
 					// blockHeight
-					merkleBlock.blockHeight = _sqlite->columnInt(stmt, 2);
+					view.blockHeight = sqlite->columnInt(stmt, 2);
 
-					merkleBlocks.push_back(merkleBlock);
+					if (!visitor(view))
+						break;
 				}
-
-				_sqlite->finalize(stmt);
 			});
-
-			return merkleBlocks;
 		}
 
 	}
@@ -7,6 +7,7 @@
 
 #include <boost/thread/mutex.hpp>
 #include <boost/thread/shared_mutex.hpp>
+#include <boost/function.hpp>
 
 #include "BRInt.h"
 #include "Sqlite.h"
@@ -35,6 +36,28 @@ namespace Elastos {
 			uint32_t blockHeight;
 		};
 
+		/*
+		 * One row of the merkle block table as handed to a visitor. blockBytes points into SQLite's
+		 * column buffer and is only valid until the visitor returns.
+		 */
+		struct MerkleBlockEntityView {
+			MerkleBlockEntityView() :
+				id(0),
+				blockBytes(nullptr),
+				blockSize(0),
+				blockHeight(0)
+			{
+			}
+
+			long id;
+			const uint8_t *blockBytes;
+			size_t blockSize;
+			uint32_t blockHeight;
+		};
+
+		// Return false to stop the iteration.
+		typedef boost::function<bool(const MerkleBlockEntityView &)> MerkleBlockVisitor;
+
 		class MerkleBlockDataSource : public TableBase {
 
 		public:
@@ -46,7 +69,9 @@ namespace Elastos {
 			bool putMerkleBlocks(const std::string &iso, const std::vector<MerkleBlockEntity> &blockEntities);
 			bool deleteMerkleBlock(const std::string &iso, const MerkleBlockEntity &blockEntity);
 			bool deleteAllBlocks(const std::string &iso);
+			bool deleteBlocksBelowHeight(const std::string &iso, uint32_t height);
 			std::vector<MerkleBlockEntity> getAllMerkleBlocks(const std::string &iso) const;
+			bool visitMerkleBlocks(const std::string &iso, const MerkleBlockVisitor &visitor) const;
 
 		private:
 			bool putMerkleBlockInternal(const std::string &iso, const MerkleBlockEntity &blockEntity);
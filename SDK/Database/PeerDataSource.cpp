@@ -49,9 +49,8 @@ namespace Elastos {
 			   PEER_ISO <<
 			   ") VALUES (?, ?, ?, ?);";
 
-			sqlite3_stmt *stmt;
-			ParamChecker::checkCondition(!_sqlite->prepare(ss.str(), &stmt, nullptr), Error::SqliteError,
-										 "Prepare sql " + ss.str());
+			SqliteStatement stmt(_sqlite, ss.str());
+			ParamChecker::checkCondition(!stmt.isValid(), Error::SqliteError, "Prepare sql " + ss.str());
 
 			CMBlock addr;
 			addr.SetMemFixed(&peerEntity.address.u8[0], sizeof(peerEntity.address.u8));
@@ -68,8 +67,6 @@ namespace Elastos {
 
 			_sqlite->step(stmt);
 
-			_sqlite->finalize(stmt);
-
 			return true;
 		}
 
@@ -78,10 +75,16 @@ namespace Elastos {
 				std::stringstream ss;
 
 				ss << "DELETE FROM " << PEER_TABLE_NAME <<
-				   " WHERE " << PEER_COLUMN_ID << " = " << peerEntity.id <<
-				   " AND " << PEER_ISO << " = '" << iso << "';";
+				   " WHERE " << PEER_COLUMN_ID << " = ?" <<
+				   " AND " << PEER_ISO << " = ?;";
+
+				SqliteStatement stmt(_sqlite, ss.str());
+				ParamChecker::checkCondition(!stmt.isValid(), Error::SqliteError, "Prepare sql " + ss.str());
 
-				ParamChecker::checkCondition(!_sqlite->exec(ss.str(), nullptr, nullptr), Error::SqliteError,
+				_sqlite->bindInt64(stmt, 1, peerEntity.id);
+				_sqlite->bindText(stmt, 2, iso, nullptr);
+
+				ParamChecker::checkCondition(SQLITE_DONE != _sqlite->step(stmt), Error::SqliteError,
 											 "Exec sql " + ss.str());
 			});
 		}
@@ -91,9 +94,14 @@ namespace Elastos {
 				std::stringstream ss;
 
 				ss << "DELETE FROM " << PEER_TABLE_NAME <<
-				   " WHERE " << PEER_ISO << " = '" << iso << "';";
+				   " WHERE " << PEER_ISO << " = ?;";
+
+				SqliteStatement stmt(_sqlite, ss.str());
+				ParamChecker::checkCondition(!stmt.isValid(), Error::SqliteError, "Prepare sql " + ss.str());
 
-				ParamChecker::checkCondition(!_sqlite->exec(ss.str(), nullptr, nullptr), Error::SqliteError,
+				_sqlite->bindText(stmt, 1, iso, nullptr);
+
+				ParamChecker::checkCondition(SQLITE_DONE != _sqlite->step(stmt), Error::SqliteError,
 											 "Exec sql " + ss.str());
 			});
 		}
@@ -101,7 +109,7 @@ namespace Elastos {
 		std::vector<PeerEntity> PeerDataSource::getAllPeers(const std::string &iso) const {
 			std::vector<PeerEntity> peers;
 
-			doTransaction([&iso, &peers, this]() {
+			doSelect([&iso, &peers, this](Sqlite *sqlite) {
 				PeerEntity peer;
 				std::stringstream ss;
 
@@ -111,19 +119,20 @@ namespace Elastos {
 				   PEER_PORT << ", " <<
 				   PEER_TIMESTAMP <<
 				   " FROM " << PEER_TABLE_NAME <<
-				   " WHERE " << PEER_ISO << " = '" << iso << "';";
+				   " WHERE " << PEER_ISO << " = ?;";
+
+				SqliteStatement stmt(sqlite, ss.str());
+				ParamChecker::checkCondition(!stmt.isValid(), Error::SqliteError, "Prepare sql " + ss.str());
 
-				sqlite3_stmt *stmt;
-				ParamChecker::checkCondition(!_sqlite->prepare(ss.str(), &stmt, nullptr), Error::SqliteError,
-											 "Prepare sql " + ss.str());
+				sqlite->bindText(stmt, 1, iso, nullptr);
 
-				while (SQLITE_ROW == _sqlite->step(stmt)) {
+				while (SQLITE_ROW == sqlite->step(stmt)) {
 					// id
-					peer.id = _sqlite->columnInt(stmt, 0);
+					peer.id = sqlite->columnInt(stmt, 0);
 
 					// address
-					const uint8_t *paddr = (const uint8_t *) _sqlite->columnBlob(stmt, 1);
-					size_t len = _sqlite->columnBytes(stmt, 1);
+					const uint8_t *paddr = (const uint8_t *) sqlite->columnBlob(stmt, 1);
+					size_t len = sqlite->columnBytes(stmt, 1);
 #ifdef NDEBUG
 					len = len <= sizeof(peer.address) ? len : sizeof(peer.address);
 					memcpy(peer.address.u8, paddr, len);
@@ -135,15 +144,13 @@ namespace Elastos {
 #endif
 
 					// port
-					peer.port = _sqlite->columnInt(stmt, 2);
+					peer.port = sqlite->columnInt(stmt, 2);
 
 					// timestamp
-					peer.timeStamp = _sqlite->columnInt64(stmt, 3);
+					peer.timeStamp = sqlite->columnInt64(stmt, 3);
 
 					peers.push_back(peer);
 				}
-
-				_sqlite->finalize(stmt);
 			});
 
 			return peers;
@@ -152,22 +159,19 @@ namespace Elastos {
 		size_t PeerDataSource::getAllPeersCount(const std::string &iso) const {
 			size_t count = 0;
 
-			doTransaction([&iso, &count, this]() {
+			doSelect([&iso, &count, this](Sqlite *sqlite) {
 				std::stringstream ss;
 
 				ss << "SELECT " <<
 				   " COUNT(" << PEER_COLUMN_ID << ") AS nums " <<
 				   " FROM " << PEER_TABLE_NAME << ";";
 
-				sqlite3_stmt *stmt;
-				ParamChecker::checkCondition(!_sqlite->prepare(ss.str(), &stmt, nullptr), Error::SqliteError,
-											 "Prepare sql " + ss.str());
+				SqliteStatement stmt(sqlite, ss.str());
+				ParamChecker::checkCondition(!stmt.isValid(), Error::SqliteError, "Prepare sql " + ss.str());
 
-				while (SQLITE_ROW == _sqlite->step(stmt)) {
-					count = (uint32_t) _sqlite->columnInt(stmt, 0);
+				while (SQLITE_ROW == sqlite->step(stmt)) {
+					count = (uint32_t) sqlite->columnInt(stmt, 0);
 				}
-
-				_sqlite->finalize(stmt);
 			});
 
 			return count;
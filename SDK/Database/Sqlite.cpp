@@ -2,6 +2,7 @@
 // Distributed under the MIT software license, see the accompanying
 // file COPYING or http://www.opensource.org/licenses/mit-license.php.
 
+#include <chrono>
 #include <boost/filesystem.hpp>
 #include <boost/locale.hpp>
 
@@ -11,8 +12,16 @@
 namespace Elastos {
 	namespace ElaWallet {
 
-		Sqlite::Sqlite(const boost::filesystem::path &path) {
-			open(path);
+		static uint64_t nowMicroseconds() {
+			return (uint64_t) std::chrono::duration_cast<std::chrono::microseconds>(
+				std::chrono::steady_clock::now().time_since_epoch()).count();
+		}
+
+		Sqlite::Sqlite(const boost::filesystem::path &path, bool readOnly) :
+			_dataBasePtr(NULL),
+			_transactionDepth(0),
+			_rollbackOnly(false) {
+			open(path, readOnly);
 		}
 
 		Sqlite::~Sqlite() {
@@ -44,11 +53,63 @@ namespace Elastos {
 		}
 
 		bool Sqlite::beginTransaction(SqliteTransactionType type) {
+			_transactionMutex.lock();
+			if (_transactionDepth++ > 0)
+				return true;
+
 			return exec("BEGIN " + getTxTypeString(type) + ";", nullptr, nullptr);
 		}
 
 		bool Sqlite::endTransaction() {
-			return exec("COMMIT;", nullptr, nullptr);
+			bool result = true;
+
+			if (--_transactionDepth == 0) {
+				if (_rollbackOnly) {
+					exec("ROLLBACK;", nullptr, nullptr);
+					_rollbackOnly = false;
+					result = false;
+				} else {
+					result = exec("COMMIT;", nullptr, nullptr);
+				}
+			}
+			_transactionMutex.unlock();
+
+			return result;
+		}
+
+		bool Sqlite::rollbackTransaction() {
+			bool result = true;
+
+			if (--_transactionDepth == 0) {
+				result = exec("ROLLBACK;", nullptr, nullptr);
+				_rollbackOnly = false;
+			} else {
+				_rollbackOnly = true;
+			}
+			_transactionMutex.unlock();
+
+			return result;
+		}
+
+		bool Sqlite::inTransaction() {
+			// try_lock() only succeeds if the mutex is free or already held by this thread,
+			// a free mutex always has depth 0.
+			if (!_transactionMutex.try_lock())
+				return false;
+
+			bool result = _transactionDepth > 0;
+			_transactionMutex.unlock();
+
+			return result;
+		}
+
+		bool Sqlite::setDurability(SqliteDurability durability) {
+			boost::recursive_mutex::scoped_lock lock(_transactionMutex);
+
+			if (durability == DURABILITY_NORMAL)
+				return exec("PRAGMA synchronous = NORMAL;", nullptr, nullptr);
+
+			return exec("PRAGMA synchronous = FULL;", nullptr, nullptr);
 		}
 
 //		bool Sqlite::transaction(SqliteTransactionType type, const std::string &sql, ExecCallBack callBack, void *arg) {
@@ -149,6 +210,86 @@ namespace Elastos {
 			return sqlite3_column_bytes(pStmt, iCol);
 		}
 
+		sqlite3_stmt *Sqlite::acquireStatement(const std::string &sql) {
+			boost::mutex::scoped_lock lock(_statementsMutex);
+			sqlite3_stmt *stmt = nullptr;
+
+			CachedStatement &cached = _statements[sql];
+			cached.stats.sql = sql;
+			if (cached.stmt != nullptr && !cached.inUse) {
+				cached.inUse = true;
+				cached.stats.hitCount++;
+				return cached.stmt;
+			}
+
+			if (!prepare(sql, &stmt, nullptr)) {
+				return nullptr;
+			}
+
+			cached.stats.prepareCount++;
+			if (cached.stmt == nullptr) {
+				cached.stmt = stmt;
+				cached.inUse = true;
+			}
+
+			return stmt;
+		}
+
+		void Sqlite::releaseStatement(sqlite3_stmt *pStmt, uint64_t elapsedMicroseconds) {
+			if (pStmt == nullptr)
+				return;
+
+			boost::mutex::scoped_lock lock(_statementsMutex);
+			std::map<std::string, CachedStatement>::iterator it = _statements.find(sqlite3_sql(pStmt));
+			if (it != _statements.end()) {
+				SqliteStatementStats &stats = it->second.stats;
+				stats.execCount++;
+				stats.totalMicroseconds += elapsedMicroseconds;
+				if (elapsedMicroseconds > stats.maxMicroseconds)
+					stats.maxMicroseconds = elapsedMicroseconds;
+			}
+
+			if (it == _statements.end() || it->second.stmt != pStmt) {
+				sqlite3_finalize(pStmt);
+				return;
+			}
+
+			sqlite3_reset(pStmt);
+			sqlite3_clear_bindings(pStmt);
+			it->second.inUse = false;
+		}
+
+		void Sqlite::clearStatementCache() {
+			boost::mutex::scoped_lock lock(_statementsMutex);
+
+			for (std::map<std::string, CachedStatement>::iterator it = _statements.begin();
+				 it != _statements.end();) {
+				if (it->second.inUse) {
+					++it;
+					continue;
+				}
+				if (it->second.stmt != nullptr)
+					sqlite3_finalize(it->second.stmt);
+				_statements.erase(it++);
+			}
+		}
+
+		std::vector<SqliteStatementStats> Sqlite::getStatementStats() const {
+			boost::mutex::scoped_lock lock(_statementsMutex);
+			std::vector<SqliteStatementStats> result;
+
+			for (std::map<std::string, CachedStatement>::const_iterator it = _statements.begin();
+				 it != _statements.end(); ++it) {
+				result.push_back(it->second.stats);
+			}
+
+			return result;
+		}
+
+		int Sqlite::changes() {
+			return isValid() ? sqlite3_changes(_dataBasePtr) : 0;
+		}
+
 		std::string Sqlite::getTxTypeString(SqliteTransactionType type) {
 			if (type == DEFERRED) {
 				return "DEFERRED";
@@ -161,7 +302,7 @@ namespace Elastos {
 			return "IMMEDIATE";
 		}
 
-		bool Sqlite::open(const boost::filesystem::path &path) {
+		bool Sqlite::open(const boost::filesystem::path &path, bool readOnly) {
 			// If the SQLITE_OPEN_NOMUTEX flag is set, then the database connection opens in the multi-thread
 			// threading mode as long as the single-thread mode has not been set at compile-time or start-time.
 			// If the SQLITE_OPEN_FULLMUTEX flag is set then the database connection opens in the serialized
@@ -177,22 +318,94 @@ namespace Elastos {
 			}
 
 //			path.imbue(boost::locale::generator().generate("UTF-8"));
-			int r = sqlite3_open_v2(path.string().c_str(), &_dataBasePtr, SQLITE_OPEN_READWRITE | SQLITE_OPEN_CREATE | SQLITE_OPEN_FULLMUTEX, NULL);
+			int flags = readOnly ? SQLITE_OPEN_READONLY : SQLITE_OPEN_READWRITE | SQLITE_OPEN_CREATE;
+			int r = sqlite3_open_v2(path.string().c_str(), &_dataBasePtr, flags | SQLITE_OPEN_FULLMUTEX, NULL);
 			if (r != SQLITE_OK) {
 				close();
 				return false;
 			}
 
+			// Readers and the writer only contend while the WAL is reset after a checkpoint,
+			// a short busy timeout covers that window.
+			sqlite3_busy_timeout(_dataBasePtr, 5000);
+			if (!readOnly && !exec("PRAGMA journal_mode = WAL;", nullptr, nullptr)) {
+				Log::getLogger()->warn("sqlite \"{}\" can not switch to WAL journal", path.string());
+			}
+
 			return true;
 		}
 
 		void Sqlite::close() {
+			clearStatementCache();
+
 			if (_dataBasePtr != NULL) {
 				sqlite3_close_v2(_dataBasePtr);
 				_dataBasePtr = NULL;
 			}
 		}
 
+		SqliteStatement::SqliteStatement(Sqlite *sqlite, const std::string &sql) :
+			_sqlite(sqlite),
+			_stmt(sqlite->acquireStatement(sql)),
+			_startTime(nowMicroseconds()) {
+		}
+
+		SqliteStatement::~SqliteStatement() {
+			_sqlite->releaseStatement(_stmt, nowMicroseconds() - _startTime);
+		}
+
+		bool SqliteStatement::isValid() const {
+			return _stmt != nullptr;
+		}
+
+		SqliteStatement::operator sqlite3_stmt *() const {
+			return _stmt;
+		}
+
+		SqliteReaderPool::SqliteReaderPool(const boost::filesystem::path &path, size_t size) :
+			_path(path),
+			_size(size > 0 ? size : 1) {
+		}
+
+		SqliteReaderPool::~SqliteReaderPool() {
+		}
+
+		Sqlite *SqliteReaderPool::acquire() {
+			boost::mutex::scoped_lock lock(_mutex);
+
+			while (_idle.empty()) {
+				if (_readers.size() < _size) {
+					boost::shared_ptr<Sqlite> reader(new Sqlite(_path, true));
+					if (!reader->isValid()) {
+						Log::getLogger()->error("open reader of \"{}\" error", _path.string());
+						return nullptr;
+					}
+					_readers.push_back(reader);
+					return reader.get();
+				}
+				_idleCondition.wait(lock);
+			}
+
+			Sqlite *reader = _idle.back();
+			_idle.pop_back();
+			return reader;
+		}
+
+		void SqliteReaderPool::release(Sqlite *reader) {
+			if (reader == nullptr)
+				return;
+
+			{
+				boost::mutex::scoped_lock lock(_mutex);
+				_idle.push_back(reader);
+			}
+			_idleCondition.notify_one();
+		}
+
+		size_t SqliteReaderPool::size() const {
+			return _size;
+		}
+
 	}
 }
 
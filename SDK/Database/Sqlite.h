@@ -5,8 +5,14 @@
 #ifndef __ELASTOS_SDK_SQLITE_H__
 #define __ELASTOS_SDK_SQLITE_H__
 
+#include <map>
+#include <vector>
 #include <sqlite3.h>
 #include <boost/filesystem.hpp>
+#include <boost/shared_ptr.hpp>
+#include <boost/thread/mutex.hpp>
+#include <boost/thread/recursive_mutex.hpp>
+#include <boost/thread/condition_variable.hpp>
 
 #include "CMemBlock.h"
 
@@ -22,9 +28,39 @@ namespace Elastos {
 			EXCLUSIVE
 		} SqliteTransactionType;
 
+		/*
+		 * The database always runs in WAL mode so that readers never block on the writer,
+		 * durability only selects how often the WAL is fsync'ed.
+		 */
+		typedef enum {
+			// synchronous=FULL: every commit is fsync'ed.
+			DURABILITY_FULL,
+			// synchronous=NORMAL: fsync only on checkpoints. Survives application crashes,
+			// a power loss may roll back the most recent commits.
+			DURABILITY_NORMAL
+		} SqliteDurability;
+
+		struct SqliteStatementStats {
+			SqliteStatementStats() :
+				prepareCount(0),
+				hitCount(0),
+				execCount(0),
+				totalMicroseconds(0),
+				maxMicroseconds(0)
+			{
+			}
+
+			std::string sql;
+			uint64_t prepareCount;
+			uint64_t hitCount;
+			uint64_t execCount;
+			uint64_t totalMicroseconds;
+			uint64_t maxMicroseconds;
+		};
+
 		class Sqlite {
 		public:
-			Sqlite(const boost::filesystem::path &path);
+			Sqlite(const boost::filesystem::path &path, bool readOnly = false);
 			~Sqlite();
 
 			bool isValid();
@@ -35,8 +71,20 @@ namespace Elastos {
 			 */
 			bool exec(const std::string &sql, ExecCallBack callBack, void *arg);
 
+			/*
+			 * beginTransaction() holds the connection for the calling thread until the matching
+			 * endTransaction(). Nested calls on the same thread join the outermost transaction,
+			 * so several table operations can be grouped into a single commit.
+			 * rollbackTransaction() ends it like endTransaction() but discards its changes; when
+			 * nested, the outermost transaction is rolled back instead of committed once it ends.
+			 */
 			bool beginTransaction(SqliteTransactionType type);
 			bool endTransaction();
+			bool rollbackTransaction();
+			// true if the calling thread has a transaction open on this connection
+			bool inTransaction();
+
+			bool setDurability(SqliteDurability durability);
 			/*
 			 * Transactions created using BEGIN...COMMIT do not nest. For nested transactions,
 			 * use the SAVEPOINT and RELEASE commands.
@@ -64,14 +112,95 @@ namespace Elastos {
 			int64_t columnInt64(sqlite3_stmt *pStmt, int iCol);
 			std::string columnText(sqlite3_stmt *pStmt, int iCol);
 			int columnBytes(sqlite3_stmt *pStmt, int iCol);
+			// number of rows modified by the most recently completed INSERT, UPDATE or DELETE
+			int changes();
+
+			/*
+			 * Statement cache keyed by sql text. Callers are expected to keep the sql fully
+			 * parameterized so that one table operation maps to one cached statement.
+			 * acquireStatement() returns the statement compiled by a previous call if there is one,
+			 * releaseStatement() resets it and clears its bindings for the next caller.
+			 * If the cached statement is still held by another caller, a transient statement is
+			 * prepared and finalized on release instead.
+			 */
+			sqlite3_stmt *acquireStatement(const std::string &sql);
+			void releaseStatement(sqlite3_stmt *pStmt, uint64_t elapsedMicroseconds);
+			void clearStatementCache();
+			std::vector<SqliteStatementStats> getStatementStats() const;
 
 		private:
+			struct CachedStatement {
+				CachedStatement() :
+					stmt(nullptr),
+					inUse(false)
+				{
+				}
+
+				sqlite3_stmt *stmt;
+				bool inUse;
+				SqliteStatementStats stats;
+			};
+
 			std::string getTxTypeString(SqliteTransactionType type);
-			bool open(const boost::filesystem::path &path);
+			bool open(const boost::filesystem::path &path, bool readOnly);
 			void close();
 
 		private:
 			sqlite3 *_dataBasePtr;
+			boost::recursive_mutex _transactionMutex;
+			int _transactionDepth;
+			bool _rollbackOnly;
+			std::map<std::string, CachedStatement> _statements;
+			mutable boost::mutex _statementsMutex;
+		};
+
+		/*
+		 * Scoped handle over Sqlite::acquireStatement()/releaseStatement(), use it in place of
+		 * prepare()/finalize(). Converts to sqlite3_stmt * so it can be passed to the bind/step/column
+		 * helpers directly.
+		 */
+		class SqliteStatement {
+		public:
+			SqliteStatement(Sqlite *sqlite, const std::string &sql);
+			~SqliteStatement();
+
+			bool isValid() const;
+
+			operator sqlite3_stmt *() const;
+
+		private:
+			SqliteStatement(const SqliteStatement &);
+			SqliteStatement &operator=(const SqliteStatement &);
+
+		private:
+			Sqlite *_sqlite;
+			sqlite3_stmt *_stmt;
+			uint64_t _startTime;
+		};
+
+		/*
+		 * Read-only connections to the database of a writer Sqlite. With the WAL journal each reader
+		 * sees the last commit at the time its read transaction started and never waits for the
+		 * writer. Connections are opened on first use, acquire() blocks only when all of them are
+		 * handed out.
+		 */
+		class SqliteReaderPool {
+		public:
+			SqliteReaderPool(const boost::filesystem::path &path, size_t size);
+			~SqliteReaderPool();
+
+			Sqlite *acquire();
+			void release(Sqlite *reader);
+
+			size_t size() const;
+
+		private:
+			boost::filesystem::path _path;
+			size_t _size;
+			std::vector<boost::shared_ptr<Sqlite> > _readers;
+			std::vector<Sqlite *> _idle;
+			boost::mutex _mutex;
+			boost::condition_variable _idleCondition;
 		};
 
 	}
@@ -2,54 +2,83 @@
 // Distributed under the MIT software license, see the accompanying
 // file COPYING or http://www.opensource.org/licenses/mit-license.php.
 
+#include <boost/bind.hpp>
+
 #include "TableBase.h"
 #include "Log.h"
 
 namespace Elastos {
 	namespace ElaWallet {
 
-#define SQLITE_MUTEX_LOCK_ON
-
 		TableBase::TableBase(Sqlite *sqlite) :
 				_sqlite(sqlite),
-				_txType(EXCLUSIVE) {
+				_txType(EXCLUSIVE),
+				_readerPool(nullptr) {
 		}
 
 		TableBase::TableBase(SqliteTransactionType type, Sqlite *sqlite) :
 				_sqlite(sqlite),
-				_txType(type) {
+				_txType(type),
+				_readerPool(nullptr) {
 		}
 
 		TableBase::~TableBase() {
 
 		}
 
+		void TableBase::setReaderPool(SqliteReaderPool *readerPool) {
+			_readerPool = readerPool;
+		}
+
 		bool TableBase::doTransaction(const boost::function<void()> &fun) const {
-#ifdef SQLITE_MUTEX_LOCK_ON
-			boost::mutex::scoped_lock lock(_lockMutex);
-#endif
-			bool result = true;
+			// Sqlite::beginTransaction() serializes access to the connection, and joins the
+			// caller's transaction when one is already open on this thread.
 			_sqlite->beginTransaction(_txType);
 			try {
 				fun();
 			}
-			catch (std::exception ex) {
+			catch (const std::exception &ex) {
+				Log::getLogger()->error("Data base error: {}", ex.what());
+				_sqlite->rollbackTransaction();
+				return false;
+			}
+			catch (...) {
+				Log::error("Unknown data base error.");
+				_sqlite->rollbackTransaction();
+				return false;
+			}
+
+			return _sqlite->endTransaction();
+		}
+
+		bool TableBase::doSelect(const boost::function<void(Sqlite *)> &fun) const {
+			Sqlite *reader = nullptr;
+			if (_readerPool != nullptr && !_sqlite->inTransaction())
+				reader = _readerPool->acquire();
+
+			if (reader == nullptr)
+				return doTransaction(boost::bind(fun, _sqlite));
+
+			bool result = true;
+			reader->beginTransaction(DEFERRED);
+			try {
+				fun(reader);
+			}
+			catch (const std::exception &ex) {
 				result = false;
-				Log::getLogger()->error("Data base error: ", ex.what());
+				Log::getLogger()->error("Data base error: {}", ex.what());
 			}
 			catch (...) {
 				result = false;
 				Log::error("Unknown data base error.");
 			}
-			_sqlite->endTransaction();
+			reader->endTransaction();
+			_readerPool->release(reader);
 
 			return result;
 		}
 
 		void TableBase::initializeTable(const std::string &constructScript) {
-#ifdef SQLITE_MUTEX_LOCK_ON
-			boost::mutex::scoped_lock lock(_lockMutex);
-#endif
 			_sqlite->beginTransaction(_txType);
 			_sqlite->exec(constructScript, nullptr, nullptr);
 			_sqlite->endTransaction();
@@ -6,7 +6,6 @@
 #define __ELASTOS_SDK_TABLEBASE_H__
 
 #include <boost/function.hpp>
-#include <boost/thread/mutex.hpp>
 
 #include "Sqlite.h"
 
@@ -21,15 +20,25 @@ namespace Elastos {
 
 			virtual ~TableBase();
 
+			void setReaderPool(SqliteReaderPool *readerPool);
+
 		protected:
 			void initializeTable(const std::string &constructScript);
 
 			bool doTransaction(const boost::function<void()> &fun) const;
 
+			/*
+			 * Runs a read-only operation on a pooled reader connection inside its own read transaction,
+			 * so it neither waits for nor blocks the writer. Falls back to the writer connection when
+			 * no pool is set or the calling thread is inside a write transaction and must see its own
+			 * uncommitted changes.
+			 */
+			bool doSelect(const boost::function<void(Sqlite *)> &fun) const;
+
 		protected:
 			Sqlite *_sqlite;
 			SqliteTransactionType _txType;
-			mutable boost::mutex _lockMutex;
+			SqliteReaderPool *_readerPool;
 		};
 
 	}
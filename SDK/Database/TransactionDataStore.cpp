@@ -28,77 +28,81 @@ namespace Elastos {
 		}
 
 		bool TransactionDataStore::putTransaction(const std::string &iso, const TransactionEntity &transactionEntity) {
-			TransactionEntity txEntity;
+			return doTransaction([&iso, &transactionEntity, this]() {
+				this->putTransactionInternal(iso, transactionEntity);
+			});
+		}
 
-			if (selectTxByHash(iso, transactionEntity.txHash, txEntity)) {
-				return doTransaction([&iso, &transactionEntity, this]() {
-					std::stringstream ss;
+		bool TransactionDataStore::putTransactions(const std::string &iso,
+												   const std::vector<TransactionEntity> &transactionEntities) {
+			return doTransaction([&iso, &transactionEntities, this]() {
+				for (size_t i = 0; i < transactionEntities.size(); ++i) {
+					this->putTransactionInternal(iso, transactionEntities[i]);
+				}
+			});
+		}
 
-					ss << "UPDATE " << TX_TABLE_NAME << " SET " <<
-					   TX_BUFF << " = ?, " <<
-					   TX_BLOCK_HEIGHT << " = ?, " <<
-					   TX_TIME_STAMP << " = ?, " <<
-					   TX_REMARK << " = ? " <<
-					   " WHERE " << TX_ISO << " = '" << iso << "'" <<
-					   " AND " << TX_COLUMN_ID << " = '" << transactionEntity.txHash << "';";
+		void TransactionDataStore::putTransactionInternal(const std::string &iso,
+														  const TransactionEntity &transactionEntity) {
+			// Upsert: update the existing row first, insert only if nothing was touched.
+			std::stringstream ss;
 
-					sqlite3_stmt *stmt;
-					ParamChecker::checkCondition(!_sqlite->prepare(ss.str(), &stmt, nullptr), Error::SqliteError,
-												 "Prepare sql " + ss.str());
+			ss << "UPDATE " << TX_TABLE_NAME << " SET " <<
+			   TX_BUFF << " = ?, " <<
+			   TX_BLOCK_HEIGHT << " = ?, " <<
+			   TX_TIME_STAMP << " = ?, " <<
+			   TX_REMARK << " = ? " <<
+			   " WHERE " << TX_ISO << " = ?" <<
+			   " AND " << TX_COLUMN_ID << " = ?;";
 
 #ifdef NDEBUG
-					_sqlite->bindBlob(stmt, 1, transactionEntity.buff, nullptr);
+			const CMBlock &bytes = transactionEntity.buff;
 #else
-					std::string str = Utils::encodeHex(transactionEntity.buff);
-					CMBlock bytes;
-					bytes.SetMemFixed((const uint8_t *) str.c_str(), str.length());
-					_sqlite->bindBlob(stmt, 1, bytes, nullptr);
+			std::string str = Utils::encodeHex(transactionEntity.buff);
+			CMBlock bytes;
+			bytes.SetMemFixed((const uint8_t *) str.c_str(), str.length());
 #endif
-					_sqlite->bindInt(stmt, 2, transactionEntity.blockHeight);
-					_sqlite->bindInt(stmt, 3, transactionEntity.timeStamp);
-					_sqlite->bindText(stmt, 4, transactionEntity.remark, nullptr);
-
-					_sqlite->step(stmt);
-
-					_sqlite->finalize(stmt);
-				});
-			}
 
-			return doTransaction([&iso, &transactionEntity, this]() {
-				std::stringstream ss;
-
-				ss << "INSERT INTO " << TX_TABLE_NAME << "(" <<
-				   TX_COLUMN_ID << "," <<
-				   TX_BUFF << "," <<
-				   TX_BLOCK_HEIGHT << "," <<
-				   TX_TIME_STAMP << "," <<
-				   TX_REMARK << "," <<
-				   TX_ISO <<
-				   ") VALUES (?, ?, ?, ?, ?, ?);";
-
-				sqlite3_stmt *stmt;
-				ParamChecker::checkCondition(!_sqlite->prepare(ss.str(), &stmt, nullptr), Error::SqliteError,
-											 "Prepare sql " + ss.str());
-
-				_sqlite->bindText(stmt, 1, transactionEntity.txHash, nullptr);
-#ifdef NDEBUG
-				_sqlite->bindBlob(stmt, 2, transactionEntity.buff, nullptr);
-#else
-				std::string str = Utils::encodeHex(transactionEntity.buff);
-				CMBlock bytes;
-				bytes.SetMemFixed((const uint8_t *) str.c_str(), str.length());
-				_sqlite->bindBlob(stmt, 2, bytes, nullptr);
-#endif
-				_sqlite->bindInt(stmt, 3, transactionEntity.blockHeight);
-				_sqlite->bindInt(stmt, 4, transactionEntity.timeStamp);
-				_sqlite->bindText(stmt, 5, transactionEntity.remark, nullptr);
-				_sqlite->bindText(stmt, 6, iso, nullptr);
+			{
+				SqliteStatement stmt(_sqlite, ss.str());
+				ParamChecker::checkCondition(!stmt.isValid(), Error::SqliteError, "Prepare sql " + ss.str());
 
-				_sqlite->step(stmt);
+				_sqlite->bindBlob(stmt, 1, bytes, nullptr);
+				_sqlite->bindInt(stmt, 2, transactionEntity.blockHeight);
+				_sqlite->bindInt(stmt, 3, transactionEntity.timeStamp);
+				_sqlite->bindText(stmt, 4, transactionEntity.remark, nullptr);
+				_sqlite->bindText(stmt, 5, iso, nullptr);
+				_sqlite->bindText(stmt, 6, transactionEntity.txHash, nullptr);
 
-				_sqlite->finalize(stmt);
-			});
+				ParamChecker::checkCondition(SQLITE_DONE != _sqlite->step(stmt), Error::SqliteError,
+											 "Exec sql " + ss.str());
+			}
 
+			if (_sqlite->changes() > 0)
+				return;
+
+			ss.str("");
+			ss << "INSERT INTO " << TX_TABLE_NAME << "(" <<
+			   TX_COLUMN_ID << "," <<
+			   TX_BUFF << "," <<
+			   TX_BLOCK_HEIGHT << "," <<
+			   TX_TIME_STAMP << "," <<
+			   TX_REMARK << "," <<
+			   TX_ISO <<
+			   ") VALUES (?, ?, ?, ?, ?, ?);";
+
+			SqliteStatement stmt(_sqlite, ss.str());
+			ParamChecker::checkCondition(!stmt.isValid(), Error::SqliteError, "Prepare sql " + ss.str());
+
+			_sqlite->bindText(stmt, 1, transactionEntity.txHash, nullptr);
+			_sqlite->bindBlob(stmt, 2, bytes, nullptr);
+			_sqlite->bindInt(stmt, 3, transactionEntity.blockHeight);
+			_sqlite->bindInt(stmt, 4, transactionEntity.timeStamp);
+			_sqlite->bindText(stmt, 5, transactionEntity.remark, nullptr);
+			_sqlite->bindText(stmt, 6, iso, nullptr);
+
+			ParamChecker::checkCondition(SQLITE_DONE != _sqlite->step(stmt), Error::SqliteError,
+										 "Exec sql " + ss.str());
 		}
 
 		bool TransactionDataStore::deleteAllTransactions(const std::string &iso) {
@@ -106,9 +110,14 @@ namespace Elastos {
 				std::stringstream ss;
 
 				ss << "DELETE FROM " << TX_TABLE_NAME <<
-				   " WHERE " << TX_ISO << " = '" << iso << "';";
+				   " WHERE " << TX_ISO << " = ?;";
+
+				SqliteStatement stmt(_sqlite, ss.str());
+				ParamChecker::checkCondition(!stmt.isValid(), Error::SqliteError, "Prepare sql " + ss.str());
 
-				ParamChecker::checkCondition(!_sqlite->exec(ss.str(), nullptr, nullptr), Error::SqliteError,
+				_sqlite->bindText(stmt, 1, iso, nullptr);
+
+				ParamChecker::checkCondition(SQLITE_DONE != _sqlite->step(stmt), Error::SqliteError,
 											 "Exec sql " + ss.str());
 			});
 		}
@@ -116,22 +125,19 @@ namespace Elastos {
 		size_t TransactionDataStore::getAllTransactionsCount(const std::string &iso) const {
 			size_t count = 0;
 
-			doTransaction([&iso, &count, this]() {
+			doSelect([&iso, &count, this](Sqlite *sqlite) {
 				std::stringstream ss;
 
 				ss << "SELECT " <<
 				   " COUNT(" << TX_COLUMN_ID << ") AS nums " <<
 				   " FROM " << TX_TABLE_NAME << ";";
 
-				sqlite3_stmt *stmt;
-				ParamChecker::checkCondition(!_sqlite->prepare(ss.str(), &stmt, nullptr), Error::SqliteError,
-											 "Prepare sql " + ss.str());
+				SqliteStatement stmt(sqlite, ss.str());
+				ParamChecker::checkCondition(!stmt.isValid(), Error::SqliteError, "Prepare sql " + ss.str());
 
-				while (SQLITE_ROW == _sqlite->step(stmt)) {
-					count = (uint32_t) _sqlite->columnInt(stmt, 0);
+				while (SQLITE_ROW == sqlite->step(stmt)) {
+					count = (uint32_t) sqlite->columnInt(stmt, 0);
 				}
-
-				_sqlite->finalize(stmt);
 			});
 
 			return count;
@@ -140,7 +146,21 @@ namespace Elastos {
 		std::vector<TransactionEntity> TransactionDataStore::getAllTransactions(const std::string &iso) const {
 			std::vector<TransactionEntity> transactions;
 
-			doTransaction([&iso, &transactions, this]() {
+			visitTransactions(iso, [&transactions](const TransactionEntityView &view) {
+				CMBlock buff;
+				buff.Resize(view.buffSize);
+				memcpy(buff, view.buff, view.buffSize);
+
+				transactions.push_back(TransactionEntity(buff, view.blockHeight, view.timeStamp,
+														 view.remark, view.txHash));
+				return true;
+			});
+
+			return transactions;
+		}
+
+		bool TransactionDataStore::visitTransactions(const std::string &iso, const TransactionVisitor &visitor) const {
+			return doSelect([&iso, &visitor, this](Sqlite *sqlite) {
 				std::stringstream ss;
 
 				ss << "SELECT " <<
@@ -150,63 +170,73 @@ namespace Elastos {
 				   TX_TIME_STAMP << ", " <<
 				   TX_REMARK <<
 				   " FROM " << TX_TABLE_NAME <<
-				   " WHERE " << TX_ISO << " = '" << iso << "';";
+				   " WHERE " << TX_ISO << " = ?;";
 
-				sqlite3_stmt *stmt;
-				ParamChecker::checkCondition(!_sqlite->prepare(ss.str(), &stmt, nullptr), Error::SqliteError,
-											 "Prepare sql " + ss.str());
+				SqliteStatement stmt(sqlite, ss.str());
+				ParamChecker::checkCondition(!stmt.isValid(), Error::SqliteError, "Prepare sql " + ss.str());
 
-				TransactionEntity tx;
-				while (SQLITE_ROW == _sqlite->step(stmt)) {
-					tx.txHash = _sqlite->columnText(stmt, 0);
+				sqlite->bindText(stmt, 1, iso, nullptr);
 
-					const uint8_t *pdata = (const uint8_t *) _sqlite->columnBlob(stmt, 1);
-					size_t len = (size_t) _sqlite->columnBytes(stmt, 1);
+				TransactionEntityView view;
+				while (SQLITE_ROW == sqlite->step(stmt)) {
+					view.txHash = sqlite->columnText(stmt, 0);
+
+					const uint8_t *pdata = (const uint8_t *) sqlite->columnBlob(stmt, 1);
+					size_t len = (size_t) sqlite->columnBytes(stmt, 1);
 
 #ifdef NDEBUG
-					CMBlock buff;
-					buff.Resize(len);
-					memcpy(buff, pdata, len);
-					tx.buff = buff;
+					view.buff = pdata;
+					view.buffSize = len;
 #else
 					std::string str((char *) pdata, len);
-					tx.buff = Utils::decodeHex(str);
+					CMBlock buff = Utils::decodeHex(str);
+					view.buff = buff;
+					view.buffSize = buff.GetSize();
 #endif
 
-					tx.blockHeight = (uint32_t) _sqlite->columnInt(stmt, 2);
-					tx.timeStamp = (uint32_t) _sqlite->columnInt(stmt, 3);
-					tx.remark = _sqlite->columnText(stmt, 4);
+					view.blockHeight = (uint32_t) sqlite->columnInt(stmt, 2);
+					view.timeStamp = (uint32_t) sqlite->columnInt(stmt, 3);
+					view.remark = sqlite->columnText(stmt, 4);
 
-					transactions.push_back(tx);
+					if (!visitor(view))
+						break;
 				}
-
-				_sqlite->finalize(stmt);
 			});
-
-			return transactions;
 		}
 
 		bool TransactionDataStore::updateTransaction(const std::string &iso, const TransactionEntity &txEntity) {
 			return doTransaction([&iso, &txEntity, this]() {
-				std::stringstream ss;
+				this->updateTransactionInternal(iso, txEntity);
+			});
+		}
+
+		bool TransactionDataStore::updateTransactions(const std::string &iso,
+													  const std::vector<TransactionEntity> &transactionEntities) {
+			return doTransaction([&iso, &transactionEntities, this]() {
+				for (size_t i = 0; i < transactionEntities.size(); ++i) {
+					this->updateTransactionInternal(iso, transactionEntities[i]);
+				}
+			});
+		}
 
-				ss << "UPDATE " << TX_TABLE_NAME << " SET " <<
-				   TX_BLOCK_HEIGHT << " = ?, " <<
-				   TX_TIME_STAMP << " = ? " <<
-				   " WHERE " << TX_ISO << " = '" << iso << "'" <<
-				   " AND " << TX_COLUMN_ID << " = '" << txEntity.txHash << "';";
+		void TransactionDataStore::updateTransactionInternal(const std::string &iso, const TransactionEntity &txEntity) {
+			std::stringstream ss;
 
-				sqlite3_stmt *stmt;
-				ParamChecker::checkCondition(!_sqlite->prepare(ss.str(), &stmt, nullptr), Error::SqliteError,
-											 "Prepare sql " + ss.str());
+			ss << "UPDATE " << TX_TABLE_NAME << " SET " <<
+			   TX_BLOCK_HEIGHT << " = ?, " <<
+			   TX_TIME_STAMP << " = ? " <<
+			   " WHERE " << TX_ISO << " = ?" <<
+			   " AND " << TX_COLUMN_ID << " = ?;";
 
-				_sqlite->bindInt(stmt, 1, txEntity.blockHeight);
-				_sqlite->bindInt(stmt, 2, txEntity.timeStamp);
+			SqliteStatement stmt(_sqlite, ss.str());
+			ParamChecker::checkCondition(!stmt.isValid(), Error::SqliteError, "Prepare sql " + ss.str());
 
-				_sqlite->step(stmt);
+			_sqlite->bindInt(stmt, 1, txEntity.blockHeight);
+			_sqlite->bindInt(stmt, 2, txEntity.timeStamp);
+			_sqlite->bindText(stmt, 3, iso, nullptr);
+			_sqlite->bindText(stmt, 4, txEntity.txHash, nullptr);
 
-				_sqlite->finalize(stmt);
-			});
+			_sqlite->step(stmt);
 		}
 
 		bool TransactionDataStore::deleteTxByHash(const std::string &iso, const std::string &hash) {
@@ -214,59 +244,18 @@ namespace Elastos {
 				std::stringstream ss;
 
 				ss << "DELETE FROM " << TX_TABLE_NAME <<
-				   " WHERE " << TX_ISO << " = '" << iso << "'" <<
-				   " AND " << TX_COLUMN_ID << " = '" << hash << "';";
-
-				ParamChecker::checkCondition(!_sqlite->exec(ss.str(), nullptr, nullptr), Error::SqliteError,
-											 "Exec sql " + ss.str());
-			});
-		}
-
-		bool TransactionDataStore::selectTxByHash(const std::string &iso, const std::string &hash,
-												  TransactionEntity &txEntity) const {
-			bool found = false;
-
-			doTransaction([&iso, &hash, &txEntity, &found, this]() {
-				std::stringstream ss;
-
-				ss << "SELECT " <<
-				   TX_BUFF << ", " <<
-				   TX_BLOCK_HEIGHT << ", " <<
-				   TX_TIME_STAMP << ", " <<
-				   TX_REMARK <<
-				   " FROM " << TX_TABLE_NAME <<
-				   " WHERE " << TX_ISO << " = '" << iso << "'" <<
-				   " AND " << TX_COLUMN_ID << " = '" << hash << "';";
-
-				sqlite3_stmt *stmt;
-				ParamChecker::checkCondition(!_sqlite->prepare(ss.str(), &stmt, nullptr), Error::SqliteError,
-											 "Prepare sql " + ss.str());
-
-				while (SQLITE_ROW == _sqlite->step(stmt)) {
-					found = true;
+				   " WHERE " << TX_ISO << " = ?" <<
+				   " AND " << TX_COLUMN_ID << " = ?;";
 
-					txEntity.txHash = hash;
+				SqliteStatement stmt(_sqlite, ss.str());
+				ParamChecker::checkCondition(!stmt.isValid(), Error::SqliteError, "Prepare sql " + ss.str());
 
-					const uint8_t *pdata = (const uint8_t *) _sqlite->columnBlob(stmt, 0);
-					size_t len = (size_t) _sqlite->columnBytes(stmt, 0);
+				_sqlite->bindText(stmt, 1, iso, nullptr);
+				_sqlite->bindText(stmt, 2, hash, nullptr);
 
-#ifdef NDEBUG
-					CMBlock buff;
-					buff.Resize(len);
-					memcpy(buff, pdata, len);
-					txEntity.buff = buff;
-#else
-					std::string str((char *) pdata, len);
-					txEntity.buff = Utils::decodeHex(str);
-#endif
-
-					txEntity.blockHeight = (uint32_t) _sqlite->columnInt(stmt, 1);
-					txEntity.timeStamp = (uint32_t) _sqlite->columnInt(stmt, 2);
-					txEntity.remark = _sqlite->columnText(stmt, 3);
-				}
+				ParamChecker::checkCondition(SQLITE_DONE != _sqlite->step(stmt), Error::SqliteError,
+											 "Exec sql " + ss.str());
 			});
-
-			return found;
 		}
 
 	}
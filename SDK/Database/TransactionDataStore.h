@@ -7,6 +7,7 @@
 
 #include <boost/thread/mutex.hpp>
 #include <boost/thread/shared_mutex.hpp>
+#include <boost/function.hpp>
 #include <utility>
 #include "BRInt.h"
 #include "Sqlite.h"
@@ -42,6 +43,30 @@ namespace Elastos {
 			std::string txHash;
 		};
 
+		/*
+		 * One row of the transaction table as handed to a visitor. buff points into SQLite's column
+		 * buffer and is only valid until the visitor returns.
+		 */
+		struct TransactionEntityView {
+			TransactionEntityView() :
+				buff(nullptr),
+				buffSize(0),
+				blockHeight(0),
+				timeStamp(0)
+			{
+			}
+
+			const uint8_t *buff;
+			size_t buffSize;
+			uint32_t blockHeight;
+			uint32_t timeStamp;
+			std::string remark;
+			std::string txHash;
+		};
+
+		// Return false to stop the iteration.
+		typedef boost::function<bool(const TransactionEntityView &)> TransactionVisitor;
+
 		class TransactionDataStore : public TableBase {
 		public:
 			TransactionDataStore(Sqlite *sqlite);
@@ -49,14 +74,18 @@ namespace Elastos {
 			~TransactionDataStore();
 
 			bool putTransaction(const std::string &iso, const TransactionEntity &transactionEntity);
+			bool putTransactions(const std::string &iso, const std::vector<TransactionEntity> &transactionEntities);
 			bool deleteAllTransactions(const std::string &iso);
 			size_t getAllTransactionsCount(const std::string &iso) const;
 			std::vector<TransactionEntity> getAllTransactions(const std::string &iso) const;
+			bool visitTransactions(const std::string &iso, const TransactionVisitor &visitor) const;
 			bool updateTransaction(const std::string &iso, const TransactionEntity &transactionEntity);
+			bool updateTransactions(const std::string &iso, const std::vector<TransactionEntity> &transactionEntities);
 			bool deleteTxByHash(const std::string &iso, const std::string &hash);
 
 		private:
-			bool selectTxByHash(const std::string &iso, const std::string &hash, TransactionEntity &txEntity) const;
+			void putTransactionInternal(const std::string &iso, const TransactionEntity &transactionEntity);
+			void updateTransactionInternal(const std::string &iso, const TransactionEntity &transactionEntity);
 
 		private:
 			/*
@@ -76,7 +105,9 @@ namespace Elastos {
 				TX_BLOCK_HEIGHT + " integer, " +
 				TX_TIME_STAMP + " integer, " +
 				TX_REMARK + " text DEFAULT '', " +
-				TX_ISO + " text DEFAULT 'ELA' );";
+				TX_ISO + " text DEFAULT 'ELA' );" +
+				"create index if not exists " + TX_TABLE_NAME + "HashIndex on " + TX_TABLE_NAME + " (" +
+				TX_COLUMN_ID + ", " + TX_ISO + ");";
 		};
 
 	}
@@ -46,6 +46,10 @@ namespace Elastos {
 					_usage == Attribute::Usage::Confirmations);
 		}
 
+		size_t Attribute::getSize() const {
+			return sizeof(uint8_t) + ByteStream::varBytesSize(_data.GetSize());
+		}
+
 		void Attribute::Serialize(ByteStream &ostream) const {
 			ostream.put(_usage);
 
@@ -40,6 +40,8 @@ namespace Elastos {
 
 			bool isValid();
 
+			size_t getSize() const;
+
 			virtual void Serialize(ByteStream &ostream) const;
 
 			virtual bool Deserialize(ByteStream &istream);
@@ -269,8 +269,7 @@ namespace Elastos {
 			ByteStream stream;
 			serializeBtcBlockHeader(stream, _parBlockHeader);
 			UInt256 hash = UINT256_ZERO;
-			CMBlock buf = stream.getBuffer();
-			BRSHA256_2(&hash, buf, buf.GetSize());
+			BRSHA256_2(&hash, stream.data(), stream.length());
 			return hash;
 		}
 
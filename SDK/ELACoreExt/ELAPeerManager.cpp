@@ -47,8 +47,11 @@ namespace Elastos {
 			qsort(manager->Raw.peers, array_count(manager->Raw.peers), sizeof(*manager->Raw.peers), _peerTimestampCompare);
 			array_new(manager->Raw.connectedPeers, PEER_MAX_CONNECTIONS);
 			manager->Raw.blocks = BRSetNew(BRMerkleBlockHash, BRMerkleBlockEq, blocksCount);
-			manager->Raw.orphans = BRSetNew(_BRPrevBlockHash, _BRPrevBlockEq, blocksCount); // orphans are indexed by prevBlock
+			manager->Raw.orphans = BROrphanPoolNew(ORPHAN_POOL_MAX_COUNT, ORPHAN_POOL_MAX_BYTES, ORPHAN_POOL_PEER_MAX_COUNT,
+												   ORPHAN_POOL_PEER_MAX_BYTES);
 			manager->Raw.checkpoints = BRSetNew(_BRBlockHeightHash, _BRBlockHeightEq, 100); // checkpoints are indexed by height
+			manager->Raw.blockDownload = BRBlockDownloadNew(BLOCK_DOWNLOAD_WINDOW_SIZE, BLOCK_DOWNLOAD_PEER_WINDOWS,
+															BLOCK_DOWNLOAD_STALL_TIMEOUT);
 			manager->Raw.reconnectTaskCount = 0;
 
 			time_t now = time(nullptr);
@@ -66,10 +69,11 @@ namespace Elastos {
 			}
 
 			block = NULL;
+			BRSet *saved = BRSetNew(_BRPrevBlockHash, _BRPrevBlockEq, blocksCount); // saved blocks are indexed by prevBlock
 
 			for (size_t i = 0; blocks && i < blocksCount; i++) {
 				assert(blocks[i]->height != BLOCK_UNKNOWN_HEIGHT); // height must be saved/restored along with serialized block
-				BRSetAdd(manager->Raw.orphans, blocks[i]);
+				BRSetAdd(saved, blocks[i]);
 
 				if ((blocks[i]->height % BLOCK_DIFFICULTY_INTERVAL) == 0 &&
 					(! block || blocks[i]->height > block->height)) block = blocks[i]; // find last transition block
@@ -79,11 +83,20 @@ namespace Elastos {
 				BRSetAdd(manager->Raw.blocks, block);
 				manager->Raw.lastBlock = block;
 				orphan.prevBlock = block->prevBlock;
-				BRSetRemove(manager->Raw.orphans, &orphan);
+				BRSetRemove(saved, &orphan);
 				orphan.prevBlock = block->blockHash;
-				block = (BRMerkleBlock *)BRSetGet(manager->Raw.orphans, &orphan);
+				block = (BRMerkleBlock *)BRSetGet(saved, &orphan);
 			}
 
+			// saved blocks that aren't in the chain are kept as orphans, as far as the orphan pool limits allow
+			while ((block = (BRMerkleBlock *)BRSetIterate(saved, NULL)) != NULL) {
+				BRSetRemove(saved, block);
+				if (BRSetGet(manager->Raw.blocks, block) == block) continue;
+				BROrphanPoolAdd(manager->Raw.orphans, block, NULL, manager, manager->Raw.peerMessages->MerkleBlockFree);
+			}
+
+			BRSetFree(saved);
+
 			array_new(manager->Raw.txRelays, 10);
 			array_new(manager->Raw.txRequests, 10);
 			array_new(manager->Raw.publishedTx, 10);
@@ -106,9 +119,9 @@ namespace Elastos {
 			array_free(manager->Raw.connectedPeers);
 			BRSetApply(manager->Raw.blocks, manager, manager->Raw.peerMessages->ApplyFreeBlock);
 			BRSetFree(manager->Raw.blocks);
-			BRSetApply(manager->Raw.orphans, manager, manager->Raw.peerMessages->ApplyFreeBlock);
-			BRSetFree(manager->Raw.orphans);
+			BROrphanPoolFree(manager->Raw.orphans, manager, manager->Raw.peerMessages->MerkleBlockFree);
 			BRSetFree(manager->Raw.checkpoints);
+			BRBlockDownloadFree(manager->Raw.blockDownload, manager, manager->Raw.peerMessages->MerkleBlockFree);
 			for (size_t i = array_count(manager->Raw.txRelays); i > 0; i--) array_free(manager->Raw.txRelays[i - 1].peers);
 			array_free(manager->Raw.txRelays);
 			for (size_t i = array_count(manager->Raw.txRequests); i > 0; i--) array_free(manager->Raw.txRequests[i - 1].peers);
@@ -28,6 +28,8 @@ namespace Elastos {
 		#define TX_LOCKTIME          0x00000000
 		#define DEFAULT_PAYLOAD_TYPE  ELATransaction::TransferAsset
 		#define DEFAULT_PAYLOAD_NEW() new PayloadTransferAsset()
+		// serialized size of an unsigned input: previous tx hash, uint16 index and uint32 sequence
+		#define TX_UNSIGNED_INPUT_SIZE (32 + 2 + 4)
 
 		struct ELATransaction {
 
@@ -63,6 +63,11 @@ namespace Elastos {
 			return _precision;
 		}
 
+		size_t Asset::getSize() const {
+			return ByteStream::varStringSize(_name) + ByteStream::varStringSize(_description) +
+				   sizeof(_precision) + 1 + 1;
+		}
+
 		void Asset::Serialize(ByteStream &ostream) const {
 			ostream.writeVarString(_name);
 			ostream.writeVarString(_description);
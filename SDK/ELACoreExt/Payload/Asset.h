@@ -47,6 +47,8 @@ namespace Elastos {
 
 			uint8_t getPrecision() const;
 
+			size_t getSize() const;
+
 			virtual void Serialize(ByteStream &ostream) const;
 
 			virtual bool Deserialize(ByteStream &istream);
@@ -15,7 +15,14 @@ namespace Elastos {
 			ByteStream stream;
 			Serialize(stream);
 
-			return stream.getBuffer();
+			return stream.takeBuffer();
+		}
+
+		size_t IPayload::getSize() const {
+			ByteStream stream;
+			Serialize(stream);
+
+			return stream.length();
 		}
 
 		bool IPayload::isValid() const {
@@ -20,6 +20,9 @@ namespace Elastos {
 
 			virtual CMBlock getData() const;
 
+			// serialized size, payloads compute it from their fields instead of serializing
+			virtual size_t getSize() const;
+
 			virtual bool isValid() const;
 		};
 
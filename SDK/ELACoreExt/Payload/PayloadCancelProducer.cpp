@@ -23,6 +23,10 @@ namespace Elastos {
 			_publicKey = key;
 		}
 
+		size_t PayloadCancelProducer::getSize() const {
+			return ByteStream::varStringSize(_publicKey);
+		}
+
 		void PayloadCancelProducer::Serialize(ByteStream &ostream) const {
 			ostream.writeVarString(_publicKey);
 		}
@@ -20,6 +20,8 @@ namespace Elastos {
 
 			void SetPublicKey(const std::string &key);
 
+			virtual size_t getSize() const;
+
 			virtual void Serialize(ByteStream &ostream) const;
 
 			virtual bool Deserialize(ByteStream &istream);
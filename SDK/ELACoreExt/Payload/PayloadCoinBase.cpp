@@ -29,6 +29,10 @@ namespace Elastos {
 			_coinBaseData = coinBaseData;
 		}
 
+		size_t PayloadCoinBase::getSize() const {
+			return ByteStream::varBytesSize(_coinBaseData.GetSize());
+		}
+
 		void PayloadCoinBase::Serialize(ByteStream &ostream) const {
 			ostream.writeVarBytes(_coinBaseData);
 		}
@@ -26,7 +26,12 @@ namespace Elastos {
 		CMBlock PayloadIssueToken::getData() const {
 			ByteStream stream;
 			Serialize(stream);
-			return stream.getBuffer();
+			return stream.takeBuffer();
+		}
+
+		size_t PayloadIssueToken::getSize() const {
+			return ByteStream::varBytesSize(_merkeProof.GetSize()) +
+				   ByteStream::varBytesSize(_mainChainTransaction.GetSize());
 		}
 
 		void PayloadIssueToken::Serialize(ByteStream &ostream) const {
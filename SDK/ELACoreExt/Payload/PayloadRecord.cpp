@@ -44,7 +44,11 @@ namespace Elastos {
 			ByteStream stream;
 			Serialize(stream);
 
-			return stream.getBuffer();
+			return stream.takeBuffer();
+		}
+
+		size_t PayloadRecord::getSize() const {
+			return ByteStream::varStringSize(_recordType) + ByteStream::varBytesSize(_recordData.GetSize());
 		}
 
 		void PayloadRecord::Serialize(ByteStream &ostream) const {
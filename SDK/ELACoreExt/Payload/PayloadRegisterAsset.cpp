@@ -55,7 +55,11 @@ namespace Elastos {
 		CMBlock PayloadRegisterAsset::getData() const {
 			ByteStream stream;
 			Serialize(stream);
-			return stream.getBuffer();
+			return stream.takeBuffer();
+		}
+
+		size_t PayloadRegisterAsset::getSize() const {
+			return _asset.getSize() + sizeof(_amount) + sizeof(_controller);
 		}
 
 		void PayloadRegisterAsset::Serialize(ByteStream &ostream) const {
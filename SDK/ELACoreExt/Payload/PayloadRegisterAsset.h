@@ -32,6 +32,8 @@ namespace Elastos {
 
 			virtual CMBlock getData() const;
 
+			virtual size_t getSize() const;
+
 			virtual void Serialize(ByteStream &ostream) const;
 
 			virtual bool Deserialize(ByteStream &istream);
@@ -42,6 +42,23 @@ namespace Elastos {
 			return true;
 		}
 
+		size_t PayloadRegisterIdentification::getSize() const {
+			size_t size = ByteStream::varStringSize(_id) + ByteStream::varBytesSize(_sign.GetSize());
+
+			size += ByteStream::varUintSize(_contents.size());
+			for (size_t i = 0; i < _contents.size(); ++i) {
+				size += ByteStream::varStringSize(_contents[i].Path);
+
+				size += ByteStream::varUintSize(_contents[i].Values.size());
+				for (size_t j = 0; j < _contents[i].Values.size(); ++j) {
+					size += sizeof(_contents[i].Values[j].DataHash);
+					size += ByteStream::varStringSize(_contents[i].Values[j].Proof);
+				}
+			}
+
+			return size;
+		}
+
 		void PayloadRegisterIdentification::Serialize(ByteStream &ostream) const {
 
 			assert(!_id.empty());
@@ -56,6 +56,8 @@ namespace Elastos {
 
 			void setSign(const CMBlock &sign);
 
+			virtual size_t getSize() const;
+
 			virtual void Serialize(ByteStream &ostream) const;
 
 			virtual bool Deserialize(ByteStream &istream);
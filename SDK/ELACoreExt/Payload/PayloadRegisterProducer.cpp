@@ -47,6 +47,11 @@ namespace Elastos {
 			_location = location;
 		}
 
+		size_t PayloadRegisterProducer::getSize() const {
+			return ByteStream::varStringSize(_publicKey) + ByteStream::varStringSize(_nickName) +
+				   ByteStream::varStringSize(_url) + sizeof(_location);
+		}
+
 		void PayloadRegisterProducer::Serialize(ByteStream &ostream) const {
 			ostream.writeVarString(_publicKey);
 			ostream.writeVarString(_nickName);
@@ -32,6 +32,8 @@ namespace Elastos {
 
 			void SetLocation(uint64_t location);
 
+			virtual size_t getSize() const;
+
 			virtual void Serialize(ByteStream &ostream) const;
 
 			virtual bool Deserialize(ByteStream &istream);
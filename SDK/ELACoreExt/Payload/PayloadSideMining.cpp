@@ -47,7 +47,12 @@ namespace Elastos {
 		CMBlock PayloadSideMining::getData() const {
 			ByteStream stream;
 			this->Serialize(stream);
-			return stream.getBuffer();
+			return stream.takeBuffer();
+		}
+
+		size_t PayloadSideMining::getSize() const {
+			return sizeof(_sideBlockHash) + sizeof(_sideGenesisHash) + sizeof(_blockHeight) +
+				   ByteStream::varBytesSize(_signedData.GetSize());
 		}
 
 		void PayloadSideMining::Serialize(ByteStream &ostream) const {
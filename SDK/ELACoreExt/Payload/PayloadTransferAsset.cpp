@@ -20,6 +20,10 @@ namespace Elastos {
 			return CMBlock();
 		}
 
+		size_t PayloadTransferAsset::getSize() const {
+			return 0;
+		}
+
 		void PayloadTransferAsset::Serialize(ByteStream &ostream) const {
 
 		}
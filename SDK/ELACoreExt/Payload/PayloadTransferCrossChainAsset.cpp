@@ -36,7 +36,7 @@ namespace Elastos {
 			//todo implement IPayload getData
 			ByteStream stream;
 			Serialize(stream);
-			return stream.getBuffer();
+			return stream.takeBuffer();
 		}
 
 		bool PayloadTransferCrossChainAsset::isValid() const {
@@ -71,6 +71,20 @@ namespace Elastos {
 			return _crossChainAmount;
 		}
 
+		size_t PayloadTransferCrossChainAsset::getSize() const {
+			if (_crossChainAddress.size() != _outputIndex.size() || _outputIndex.size() != _crossChainAmount.size())
+				return 0;
+
+			size_t size = ByteStream::varUintSize(_crossChainAddress.size());
+			for (size_t i = 0; i < _crossChainAddress.size(); ++i) {
+				size += ByteStream::varStringSize(_crossChainAddress[i]);
+				size += ByteStream::varUintSize(_outputIndex[i]);
+				size += sizeof(_crossChainAmount[i]);
+			}
+
+			return size;
+		}
+
 		void PayloadTransferCrossChainAsset::Serialize(ByteStream &ostream) const {
 			if (_crossChainAddress.size() != _outputIndex.size() || _outputIndex.size() != _crossChainAmount.size()) {
 				Log::getLogger()->error("Invalid cross chain asset: len(crossChainAddress)={},"
@@ -36,6 +36,8 @@ namespace Elastos {
 			const std::vector<uint64_t> &getCrossChainAmout() const;
 
 
+			virtual size_t getSize() const;
+
 			virtual void Serialize(ByteStream &ostream) const;
 
 			virtual bool Deserialize(ByteStream &istream);
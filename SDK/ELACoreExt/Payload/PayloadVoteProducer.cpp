@@ -39,6 +39,17 @@ namespace Elastos {
 			_publicKeys = keys;
 		}
 
+		size_t PayloadVoteProducer::getSize() const {
+			size_t size = ByteStream::varStringSize(_voter) + sizeof(_stake);
+
+			size += ByteStream::varUintSize(_publicKeys.size());
+			for (size_t i = 0; i < _publicKeys.size(); ++i) {
+				size += ByteStream::varStringSize(_publicKeys[i]);
+			}
+
+			return size;
+		}
+
 		void PayloadVoteProducer::Serialize(ByteStream &ostream) const {
 			ostream.writeVarString(_voter);
 			ostream.writeUint64(_stake);
@@ -28,6 +28,8 @@ namespace Elastos {
 
 			void SetPublicKeys(const std::vector<std::string> &keys);
 
+			virtual size_t getSize() const;
+
 			virtual void Serialize(ByteStream &ostream) const;
 
 			virtual bool Deserialize(ByteStream &istream);
@@ -53,7 +53,13 @@ namespace Elastos {
 		CMBlock PayloadWithDrawAsset::getData() const {
 			ByteStream stream;
 			Serialize(stream);
-			return stream.getBuffer();
+			return stream.takeBuffer();
+		}
+
+		size_t PayloadWithDrawAsset::getSize() const {
+			return sizeof(_blockHeight) + ByteStream::varStringSize(_genesisBlockAddress) +
+				   ByteStream::varUintSize(_sideChainTransactionHash.size()) +
+				   _sideChainTransactionHash.size() * sizeof(UInt256);
 		}
 
 		void PayloadWithDrawAsset::Serialize(ByteStream &ostream) const {
@@ -609,6 +609,20 @@ namespace Elastos {
 			_localStore.Account()->ChangePassword(oldPassword, newPassword);
 		}
 
+		void MasterWallet::Unlock(const std::string &payPassword, uint32_t seconds) {
+			ParamChecker::checkPassword(payPassword, "Pay");
+
+			_localStore.Account()->Unlock(payPassword, seconds);
+		}
+
+		void MasterWallet::Lock() {
+			_localStore.Account()->Lock();
+		}
+
+		bool MasterWallet::IsUnlocked() const {
+			return _localStore.Account()->IsUnlocked();
+		}
+
 		void MasterWallet::initFromMultiSigners(const std::string &privKey, const std::string &payPassword,
 												const nlohmann::json &coSigners, uint32_t requiredSignCount) {
 			if (privKey.empty())
@@ -89,6 +89,12 @@ namespace Elastos {
 
 			virtual void ChangePassword(const std::string &oldPassword, const std::string &newPassword);
 
+			virtual void Unlock(const std::string &payPassword, uint32_t seconds);
+
+			virtual void Lock();
+
+			virtual bool IsUnlocked() const;
+
 		public: //override from IIdAgent
 			virtual std::string DeriveIdAndKeyForPurpose(
 					uint32_t purpose,
@@ -63,6 +63,7 @@ namespace Elastos {
 									  _info.getForkId(), pluginTypes,
 									  chainParams));
 
+			_walletManager->setDatabaseDurability(_info.getDatabaseFullSync() ? DURABILITY_FULL : DURABILITY_NORMAL);
 			_walletManager->registerWalletListener(this);
 			_walletManager->registerPeerManagerListener(this);
 
@@ -115,6 +116,23 @@ namespace Elastos {
 			return _walletManager->getWallet()->GetBalanceWithAddress(address);
 		}
 
+		nlohmann::json SubWallet::GetBalancesWithAddresses(const nlohmann::json &addresses) {
+			ParamChecker::checkCondition(!addresses.is_array(), Error::InvalidArgument, "Addresses should be an array");
+			std::vector<std::string> addressList = addresses.get<std::vector<std::string>>();
+			std::vector<uint64_t> balances = _walletManager->getWallet()->GetBalancesWithAddresses(addressList);
+
+			std::vector<nlohmann::json> results;
+			for (size_t i = 0; i < addressList.size(); ++i) {
+				nlohmann::json balanceKeyValue;
+				balanceKeyValue[addressList[i]] = balances[i];
+				results.push_back(balanceKeyValue);
+			}
+
+			nlohmann::json j;
+			j["Balances"] = results;
+			return j;
+		}
+
 		void SubWallet::AddCallback(ISubWalletCallback *subCallback) {
 			if (std::find(_callbacks.begin(), _callbacks.end(), subCallback) != _callbacks.end())
 				return;
@@ -141,28 +159,39 @@ namespace Elastos {
 			assert(wallet != nullptr);
 			nlohmann::json j;
 
-			size_t fullTxCount = array_count(wallet->transactions);
-
-			if (start >= fullTxCount) {
-				j["Transactions"] = {};
-				j["MaxCount"] = fullTxCount;
-				return j;
+			size_t maxCount = 0;
+			std::vector<std::string> txHashes;
+			if (!addressOrTxid.empty()) {
+				// filtered history comes from the address index, newest first
+				const AddressTxIndex &addressTxIndex = _walletManager->getAddressTxIndex();
+				maxCount = addressTxIndex.getCount(addressOrTxid);
+				if (maxCount > 0) {
+					txHashes = addressTxIndex.getTxHashes(addressOrTxid, start, count);
+				} else if (addressOrTxid.length() == sizeof(UInt256) * 2 && addressTxIndex.contains(addressOrTxid)) {
+					maxCount = 1;
+					if (start == 0)
+						txHashes.push_back(addressOrTxid);
+				}
 			}
 
-			size_t pageCount = count;
+			std::vector<BRTransaction *> transactions;
 			pthread_mutex_lock(&wallet->lock);
-			if (fullTxCount < start + count)
-				pageCount = fullTxCount - start;
-
-			BRTransaction *transactions[pageCount];
-			uint32_t realCount = 0;
-			for (int i = fullTxCount - 1 - start; i >= 0 && realCount < pageCount; --i) {
-				if (!filterByAddressOrTxId(wallet->transactions[i], addressOrTxid))
-					continue;
-				transactions[realCount++] = wallet->transactions[i];
+			if (addressOrTxid.empty()) {
+				maxCount = array_count(wallet->transactions);
+				for (size_t i = start; i < maxCount && transactions.size() < count; ++i) {
+					transactions.push_back(wallet->transactions[maxCount - 1 - i]);
+				}
+			} else {
+				for (size_t i = 0; i < txHashes.size(); ++i) {
+					UInt256 txHash = Utils::UInt256FromString(txHashes[i], true);
+					BRTransaction *tx = (BRTransaction *) BRSetGet(wallet->allTx, &txHash);
+					if (tx != nullptr)
+						transactions.push_back(tx);
+				}
 			}
 			pthread_mutex_unlock(&wallet->lock);
 
+			size_t realCount = transactions.size();
 			std::vector<nlohmann::json> jsonList(realCount);
 			for (size_t i = 0; i < realCount; ++i) {
 				TransactionPtr transactionPtr(new Transaction((ELATransaction *) transactions[i], false));
@@ -177,7 +206,7 @@ namespace Elastos {
 				jsonList[i] = transactionPtr->GetSummary(_walletManager->getWallet(), confirms, !addressOrTxid.empty());
 			}
 			j["Transactions"] = jsonList;
-			j["MaxCount"] = fullTxCount;
+			j["MaxCount"] = maxCount;
 			return j;
 		}
 
@@ -286,6 +315,28 @@ namespace Elastos {
 			return transaction->toJson();
 		}
 
+		nlohmann::json SubWallet::SignTransactions(const nlohmann::json &rawTransactions,
+												   const std::string &payPassword) {
+			ParamChecker::checkCondition(!rawTransactions.is_array(), Error::InvalidArgument,
+										 "Transactions should be an array");
+
+			std::vector<TransactionPtr> transactions;
+			for (nlohmann::json::const_iterator it = rawTransactions.begin(); it != rawTransactions.end(); ++it) {
+				TransactionPtr transaction(new Transaction());
+				transaction->fromJson(*it);
+				transactions.push_back(transaction);
+			}
+
+			_walletManager->getWallet()->signTransactions(transactions, _info.getForkId(), payPassword);
+
+			nlohmann::json j = nlohmann::json::array();
+			for (size_t i = 0; i < transactions.size(); ++i) {
+				transactions[i]->removeDuplicatePrograms();
+				j.push_back(transactions[i]->toJson());
+			}
+			return j;
+		}
+
 		nlohmann::json SubWallet::PublishTransaction(const nlohmann::json &rawTransaction) {
 			TransactionPtr transaction(new Transaction());
 			transaction->fromJson(rawTransaction);
@@ -318,38 +369,6 @@ namespace Elastos {
 			return completer.Complete(actualFee);
 		}
 
-		bool SubWallet::filterByAddressOrTxId(BRTransaction *transaction, const std::string &addressOrTxid) {
-			ELATransaction *tx = (ELATransaction *) transaction;
-
-			if (addressOrTxid == "") {
-				return true;
-			}
-
-			for (size_t i = 0; i < tx->raw.inCount; ++i) {
-				BRTxInput *input = &tx->raw.inputs[i];
-				std::string addr(input->address);
-				if (addr == addressOrTxid) {
-					return true;
-				}
-			}
-			for (size_t i = 0; i < tx->outputs.size(); ++i) {
-				TransactionOutput *output = tx->outputs[i];
-				if (output->getAddress() == addressOrTxid) {
-					return true;
-				}
-			}
-
-			if (addressOrTxid.length() == sizeof(UInt256) * 2) {
-				Transaction txn(tx, false);
-				UInt256 Txid = Utils::UInt256FromString(addressOrTxid, true);
-				if (UInt256Eq(&Txid, &tx->raw.txHash)) {
-					return true;
-				}
-			}
-
-			return false;
-		}
-
 		void SubWallet::syncStarted() {
 			_syncStartHeight = _walletManager->getPeerManager()->getSyncStartHeight();
 			if (_info.getEarliestPeerTime() == 0) {
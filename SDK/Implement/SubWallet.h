@@ -51,6 +51,8 @@ namespace Elastos {
 
 			virtual uint64_t GetBalanceWithAddress(const std::string &address);
 
+			virtual nlohmann::json GetBalancesWithAddresses(const nlohmann::json &addresses);
+
 			virtual void AddCallback(ISubWalletCallback *subCallback);
 
 			virtual void RemoveCallback(ISubWalletCallback *subCallback);
@@ -80,6 +82,10 @@ namespace Elastos {
 					const nlohmann::json &rawTransaction,
 					const std::string &payPassword);
 
+			virtual nlohmann::json SignTransactions(
+					const nlohmann::json &rawTransactions,
+					const std::string &payPassword);
+
 			virtual nlohmann::json GetTransactionSignedSigners(
 					const nlohmann::json &rawTransaction);
 
@@ -157,8 +163,6 @@ namespace Elastos {
 
 			virtual TransactionPtr completeTransaction(const TransactionPtr &transaction, uint64_t actualFee);
 
-			bool filterByAddressOrTxId(BRTransaction *transaction, const std::string &addressOrTxid);
-
 			virtual void fireTransactionStatusChanged(const std::string &txid,
 													  const std::string &status,
 													  const nlohmann::json &desc,
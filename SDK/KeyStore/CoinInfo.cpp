@@ -15,6 +15,7 @@ namespace Elastos {
 				_usedMaxAddressIndex(0),
 				_singleAddress(false),
 				_enableP2P(true),
+				_databaseFullSync(true),
 				_feePerKb(0),
 				_minFee(0),
 				_walletType(Normal) {
@@ -69,6 +70,14 @@ namespace Elastos {
 			_feePerKb = fee;
 		}
 
+		bool CoinInfo::getDatabaseFullSync() const {
+			return _databaseFullSync;
+		}
+
+		void CoinInfo::setDatabaseFullSync(bool fullSync) {
+			_databaseFullSync = fullSync;
+		}
+
 		nlohmann::json &operator<<(nlohmann::json &j, const CoinInfo &p) {
 			to_json(j, p);
 
@@ -91,6 +100,7 @@ namespace Elastos {
 			j["MinFee"] = p._minFee;
 			j["FeePerKB"] = p._feePerKb;
 			j["EnableP2P"] = p._enableP2P;
+			j["DatabaseFullSync"] = p._databaseFullSync;
 			j["ReconnectSeconds"] = p._reconnectSeconds;
 			j["ChainCode"] = p._chainCode;
 			j["PublicKey"] = p._publicKey;
@@ -110,6 +120,8 @@ namespace Elastos {
 			p._publicKey = j["PublicKey"].get<std::string>();
 			if (j.find("EnableP2P") != j.end())
 				p._enableP2P = j["EnableP2P"].get<bool>();
+			if (j.find("DatabaseFullSync") != j.end())
+				p._databaseFullSync = j["DatabaseFullSync"].get<bool>();
 		}
 
 		int CoinInfo::getForkId() const {
@@ -75,6 +75,11 @@ namespace Elastos {
 
 			void setPublicKey(const std::string &pubKey);
 
+			// false lets the database skip the fsync of every commit (synchronous=NORMAL)
+			bool getDatabaseFullSync() const;
+
+			void setDatabaseFullSync(bool fullSync);
+
 		private:
 			JSON_SM_LS(CoinInfo);
 			JSON_SM_RS(CoinInfo);
@@ -90,6 +95,7 @@ namespace Elastos {
 			int _usedMaxAddressIndex;
 			bool _singleAddress;
 			bool _enableP2P;
+			bool _databaseFullSync;
 			uint64_t _minFee;
 			uint64_t _feePerKb;
 			SubWalletType _walletType;
@@ -70,7 +70,7 @@ namespace Elastos {
 
 			virtual void setHeight(uint32_t height);
 
-			virtual bool isValid(uint32_t currentTime) const;
+			virtual bool isValid(uint32_t currentTime, std::vector<UInt256> *txHashes = nullptr) const;
 
 			const AuxPow &getAuxPow() const;
 
@@ -84,7 +84,9 @@ namespace Elastos {
 
 			static void serializeNoAux(ByteStream &ostream, const BRMerkleBlock &raw);
 
-			static UInt256 MerkleBlockRootR(size_t *hashIdx, size_t *flagIdx, int depth, const BRMerkleBlock &raw);
+			// merkle root of the partial merkle tree, computed a level at a time, with the matched tx hashes to txHashes
+			// if not null
+			static UInt256 MerkleBlockRoot(const BRMerkleBlock &raw, std::vector<UInt256> *txHashes);
 
 		private:
 			ELAMerkleBlock *_merkleBlock;
@@ -234,8 +234,7 @@ namespace Elastos {
 				ByteStream ostream;
 				MerkleBlock::serializeNoAux(ostream, _merkleBlock->raw);
 				UInt256 hash = UINT256_ZERO;
-				CMBlock buf = ostream.getBuffer();
-				BRSHA256_2(&hash, buf, buf.GetSize());
+				BRSHA256_2(&hash, ostream.data(), ostream.length());
 				UInt256Set(&_merkleBlock->raw.blockHash, hash);
 			}
 			return _merkleBlock->raw.blockHash;
@@ -249,13 +248,12 @@ namespace Elastos {
 			_merkleBlock->raw.height = height;
 		}
 
-		bool SidechainMerkleBlock::isValid(uint32_t currentTime) const {
+		bool SidechainMerkleBlock::isValid(uint32_t currentTime, std::vector<UInt256> *txHashes) const {
 			// target is in "compact" format, where the most significant byte is the size of resulting value in bytes, the next
 			// bit is the sign, and the remaining 23bits is the value after having been right shifted by (size - 3)*8 bits
 			static const uint32_t maxsize = MAX_PROOF_OF_WORK >> 24, maxtarget = MAX_PROOF_OF_WORK & 0x00ffffff;
 			const uint32_t size = _merkleBlock->raw.target >> 24, target = _merkleBlock->raw.target & 0x00ffffff;
-			size_t hashIdx = 0, flagIdx = 0;
-			UInt256 merkleRoot = MerkleBlock::MerkleBlockRootR(&hashIdx, &flagIdx, 0, _merkleBlock->raw), t = UINT256_ZERO;
+			UInt256 merkleRoot = MerkleBlock::MerkleBlockRoot(_merkleBlock->raw, txHashes), t = UINT256_ZERO;
 			int r = 1;
 
 			// check if merkle root is correct
@@ -51,7 +51,7 @@ namespace Elastos {
 
 			virtual void setHeight(uint32_t height);
 
-			virtual bool isValid(uint32_t currentTime) const;
+			virtual bool isValid(uint32_t currentTime, std::vector<UInt256> *txHashes = nullptr) const;
 
 			virtual std::string getBlockType() const;
 
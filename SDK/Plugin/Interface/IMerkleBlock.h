@@ -5,6 +5,7 @@
 #ifndef __ELASTOS_SDK_IMERKLEBLOCK_H__
 #define __ELASTOS_SDK_IMERKLEBLOCK_H__
 
+#include <vector>
 #include <boost/shared_ptr.hpp>
 
 #include "BRMerkleBlock.h"
@@ -35,7 +36,8 @@ namespace Elastos {
 
 			virtual void setHeight(uint32_t height) = 0;
 
-			virtual bool isValid(uint32_t currentTime) const = 0;
+			// the matched tx hashes go to txHashes, if not null, from the walk that checks the merkle root
+			virtual bool isValid(uint32_t currentTime, std::vector<UInt256> *txHashes = nullptr) const = 0;
 
 			virtual std::string getBlockType() const = 0;
 		};
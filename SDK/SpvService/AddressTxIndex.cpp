@@ -0,0 +1,105 @@
+// Copyright (c) 2012-2018 The Elastos Open Source Project
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include "AddressTxIndex.h"
+
+namespace Elastos {
+	namespace ElaWallet {
+
+		AddressTxIndex::AddressTxIndex() {
+		}
+
+		void AddressTxIndex::add(const std::string &txHash, uint32_t blockHeight,
+								 const std::vector<std::string> &addresses) {
+			boost::mutex::scoped_lock lock(_mutex);
+
+			std::map<std::string, TxInfo>::iterator it = _txs.find(txHash);
+			if (it != _txs.end()) {
+				removeKeys(txHash, it->second);
+			}
+
+			TxInfo &info = _txs[txHash];
+			info.blockHeight = blockHeight;
+			info.addresses = addresses;
+			for (size_t i = 0; i < addresses.size(); ++i) {
+				_addressTxs[addresses[i]].insert(Key(blockHeight, txHash));
+			}
+		}
+
+		void AddressTxIndex::update(const std::string &txHash, uint32_t blockHeight) {
+			boost::mutex::scoped_lock lock(_mutex);
+
+			std::map<std::string, TxInfo>::iterator it = _txs.find(txHash);
+			if (it == _txs.end() || it->second.blockHeight == blockHeight)
+				return;
+
+			removeKeys(txHash, it->second);
+			it->second.blockHeight = blockHeight;
+			for (size_t i = 0; i < it->second.addresses.size(); ++i) {
+				_addressTxs[it->second.addresses[i]].insert(Key(blockHeight, txHash));
+			}
+		}
+
+		void AddressTxIndex::remove(const std::string &txHash) {
+			boost::mutex::scoped_lock lock(_mutex);
+
+			std::map<std::string, TxInfo>::iterator it = _txs.find(txHash);
+			if (it == _txs.end())
+				return;
+
+			removeKeys(txHash, it->second);
+			_txs.erase(it);
+		}
+
+		void AddressTxIndex::clear() {
+			boost::mutex::scoped_lock lock(_mutex);
+
+			_addressTxs.clear();
+			_txs.clear();
+		}
+
+		bool AddressTxIndex::contains(const std::string &txHash) const {
+			boost::mutex::scoped_lock lock(_mutex);
+			return _txs.find(txHash) != _txs.end();
+		}
+
+		size_t AddressTxIndex::getCount(const std::string &address) const {
+			boost::mutex::scoped_lock lock(_mutex);
+
+			std::map<std::string, std::set<Key> >::const_iterator it = _addressTxs.find(address);
+			return it != _addressTxs.end() ? it->second.size() : 0;
+		}
+
+		std::vector<std::string> AddressTxIndex::getTxHashes(const std::string &address, size_t start,
+															 size_t count) const {
+			boost::mutex::scoped_lock lock(_mutex);
+			std::vector<std::string> txHashes;
+
+			std::map<std::string, std::set<Key> >::const_iterator it = _addressTxs.find(address);
+			if (it == _addressTxs.end() || start >= it->second.size())
+				return txHashes;
+
+			std::set<Key>::const_iterator key = it->second.begin();
+			std::advance(key, start);
+			for (; key != it->second.end() && txHashes.size() < count; ++key) {
+				txHashes.push_back(key->txHash);
+			}
+
+			return txHashes;
+		}
+
+		void AddressTxIndex::removeKeys(const std::string &txHash, const TxInfo &info) {
+			for (size_t i = 0; i < info.addresses.size(); ++i) {
+				std::map<std::string, std::set<Key> >::iterator it = _addressTxs.find(info.addresses[i]);
+				if (it == _addressTxs.end())
+					continue;
+
+				it->second.erase(Key(info.blockHeight, txHash));
+				if (it->second.empty())
+					_addressTxs.erase(it);
+			}
+		}
+
+	}
+}
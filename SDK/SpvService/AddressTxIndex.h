@@ -0,0 +1,70 @@
+// Copyright (c) 2012-2018 The Elastos Open Source Project
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#ifndef __ELASTOS_SDK_ADDRESSTXINDEX_H__
+#define __ELASTOS_SDK_ADDRESSTXINDEX_H__
+
+#include <map>
+#include <set>
+#include <string>
+#include <vector>
+#include <boost/thread/mutex.hpp>
+
+namespace Elastos {
+	namespace ElaWallet {
+
+		/*
+		 * In-memory address -> transaction index mirroring the addressTxTable rows. Transactions of an
+		 * address are kept newest first (highest block height, unconfirmed on top), ties broken by hash,
+		 * so a page of history is a walk over a sorted set.
+		 */
+		class AddressTxIndex {
+		public:
+			AddressTxIndex();
+
+			void add(const std::string &txHash, uint32_t blockHeight, const std::vector<std::string> &addresses);
+
+			void update(const std::string &txHash, uint32_t blockHeight);
+
+			void remove(const std::string &txHash);
+
+			void clear();
+
+			bool contains(const std::string &txHash) const;
+
+			size_t getCount(const std::string &address) const;
+
+			std::vector<std::string> getTxHashes(const std::string &address, size_t start, size_t count) const;
+
+		private:
+			struct Key {
+				Key(uint32_t height, const std::string &hash) : blockHeight(height), txHash(hash) {}
+
+				bool operator<(const Key &other) const {
+					if (blockHeight != other.blockHeight)
+						return blockHeight > other.blockHeight;
+					return txHash < other.txHash;
+				}
+
+				uint32_t blockHeight;
+				std::string txHash;
+			};
+
+			struct TxInfo {
+				uint32_t blockHeight;
+				std::vector<std::string> addresses;
+			};
+
+			void removeKeys(const std::string &txHash, const TxInfo &info);
+
+		private:
+			mutable boost::mutex _mutex;
+			std::map<std::string, std::set<Key> > _addressTxs;
+			std::map<std::string, TxInfo> _txs;
+		};
+
+	}
+}
+
+#endif //__ELASTOS_SDK_ADDRESSTXINDEX_H__
@@ -0,0 +1,356 @@
+// Copyright (c) 2012-2018 The Elastos Open Source Project
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include <stdexcept>
+
+#include "PersistenceQueue.h"
+#include "Log.h"
+
+namespace Elastos {
+	namespace ElaWallet {
+
+		// throws so that doTransaction() rolls back the whole batch
+		static void checkWrite(bool result, const std::string &what) {
+			if (!result)
+				throw std::runtime_error(what + " failed");
+		}
+
+		PersistenceQueue::Batch::Batch() :
+				replaceBlocks(false),
+				pruneHeight(0) {
+		}
+
+		bool PersistenceQueue::Batch::empty() const {
+			return txPuts.empty() && txUpdates.empty() && txDeletes.empty() && !replaceBlocks && blocks.empty() &&
+				   pruneHeight == 0;
+		}
+
+		void PersistenceQueue::Batch::swap(Batch &other) {
+			// std::list::swap keeps the iterators of txPutIndex valid
+			txPuts.swap(other.txPuts);
+			txPutIndex.swap(other.txPutIndex);
+			txAddresses.swap(other.txAddresses);
+			txUpdates.swap(other.txUpdates);
+			txDeletes.swap(other.txDeletes);
+			std::swap(replaceBlocks, other.replaceBlocks);
+			blocks.swap(other.blocks);
+			std::swap(pruneHeight, other.pruneHeight);
+		}
+
+		void PersistenceQueue::Batch::append(const Batch &newer) {
+			for (std::set<std::string>::const_iterator it = newer.txDeletes.begin(); it != newer.txDeletes.end(); ++it) {
+				std::map<std::string, std::list<TransactionEntity>::iterator>::iterator put = txPutIndex.find(*it);
+				if (put != txPutIndex.end()) {
+					txPuts.erase(put->second);
+					txPutIndex.erase(put);
+				}
+				txAddresses.erase(*it);
+				txUpdates.erase(*it);
+				txDeletes.insert(*it);
+			}
+
+			for (std::list<TransactionEntity>::const_iterator it = newer.txPuts.begin(); it != newer.txPuts.end(); ++it) {
+				txDeletes.erase(it->txHash);
+				txUpdates.erase(it->txHash);
+
+				std::map<std::string, std::list<TransactionEntity>::iterator>::iterator put = txPutIndex.find(it->txHash);
+				if (put != txPutIndex.end()) {
+					*put->second = *it;
+				} else {
+					txPutIndex[it->txHash] = txPuts.insert(txPuts.end(), *it);
+				}
+			}
+
+			for (std::map<std::string, std::vector<std::string> >::const_iterator it = newer.txAddresses.begin();
+				 it != newer.txAddresses.end(); ++it) {
+				txAddresses[it->first] = it->second;
+			}
+
+			for (std::map<std::string, TransactionEntity>::const_iterator it = newer.txUpdates.begin();
+				 it != newer.txUpdates.end(); ++it) {
+				std::map<std::string, std::list<TransactionEntity>::iterator>::iterator put = txPutIndex.find(it->first);
+				if (put != txPutIndex.end()) {
+					put->second->blockHeight = it->second.blockHeight;
+					put->second->timeStamp = it->second.timeStamp;
+				} else {
+					txUpdates[it->first] = it->second;
+				}
+			}
+
+			if (newer.replaceBlocks) {
+				replaceBlocks = true;
+				blocks.clear();
+			}
+			blocks.insert(blocks.end(), newer.blocks.begin(), newer.blocks.end());
+
+			if (newer.pruneHeight > pruneHeight)
+				pruneHeight = newer.pruneHeight;
+		}
+
+		PersistenceQueue::PersistenceQueue(DatabaseManager *databaseManager, const std::string &iso,
+										   size_t batchSize, uint32_t flushInterval) :
+				_databaseManager(databaseManager),
+				_iso(iso),
+				_batchSize(batchSize),
+				_flushInterval(flushInterval),
+				_pendingCount(0),
+				_enqueuedSeq(0),
+				_committedSeq(0),
+				_failedWrites(0),
+				_flushRequested(false),
+				_stopped(false) {
+			_thread = boost::thread(boost::bind(&PersistenceQueue::run, this));
+		}
+
+		PersistenceQueue::~PersistenceQueue() {
+			stop();
+		}
+
+		void PersistenceQueue::putTransaction(const TransactionEntity &txEntity,
+											  const std::vector<std::string> &addresses) {
+			boost::mutex::scoped_lock lock(_mutex);
+
+			_pending.txDeletes.erase(txEntity.txHash);
+			_pending.txUpdates.erase(txEntity.txHash);
+
+			std::map<std::string, std::list<TransactionEntity>::iterator>::iterator it;
+			it = _pending.txPutIndex.find(txEntity.txHash);
+			if (it != _pending.txPutIndex.end()) {
+				*it->second = txEntity;
+			} else {
+				_pending.txPutIndex[txEntity.txHash] = _pending.txPuts.insert(_pending.txPuts.end(), txEntity);
+			}
+			if (!addresses.empty())
+				_pending.txAddresses[txEntity.txHash] = addresses;
+
+			enqueued();
+		}
+
+		void PersistenceQueue::updateTransaction(const std::string &hash, uint32_t blockHeight, uint32_t timeStamp) {
+			boost::mutex::scoped_lock lock(_mutex);
+
+			std::map<std::string, std::list<TransactionEntity>::iterator>::iterator it;
+			it = _pending.txPutIndex.find(hash);
+			if (it != _pending.txPutIndex.end()) {
+				it->second->blockHeight = blockHeight;
+				it->second->timeStamp = timeStamp;
+			} else {
+				TransactionEntity &txEntity = _pending.txUpdates[hash];
+				txEntity.txHash = hash;
+				txEntity.blockHeight = blockHeight;
+				txEntity.timeStamp = timeStamp;
+			}
+
+			enqueued();
+		}
+
+		void PersistenceQueue::deleteTransaction(const std::string &hash) {
+			boost::mutex::scoped_lock lock(_mutex);
+
+			std::map<std::string, std::list<TransactionEntity>::iterator>::iterator it;
+			it = _pending.txPutIndex.find(hash);
+			if (it != _pending.txPutIndex.end()) {
+				_pending.txPuts.erase(it->second);
+				_pending.txPutIndex.erase(it);
+			}
+			_pending.txAddresses.erase(hash);
+			_pending.txUpdates.erase(hash);
+			_pending.txDeletes.insert(hash);
+
+			enqueued();
+		}
+
+		void PersistenceQueue::putMerkleBlocks(bool replace, const std::vector<MerkleBlockEntity> &blockEntities) {
+			boost::mutex::scoped_lock lock(_mutex);
+
+			if (replace) {
+				_pending.replaceBlocks = true;
+				_pending.blocks.clear();
+			}
+			_pending.blocks.insert(_pending.blocks.end(), blockEntities.begin(), blockEntities.end());
+
+			enqueued();
+		}
+
+		void PersistenceQueue::pruneMerkleBlocks(uint32_t height) {
+			boost::mutex::scoped_lock lock(_mutex);
+
+			if (height > _pending.pruneHeight)
+				_pending.pruneHeight = height;
+
+			enqueued();
+		}
+
+		bool PersistenceQueue::flush() {
+			boost::unique_lock<boost::mutex> lock(_mutex);
+
+			if (_stopped) {
+				Batch batch;
+				batch.swap(_pending);
+				_pendingCount = 0;
+				uint64_t seq = _enqueuedSeq;
+				lock.unlock();
+
+				bool result = write(batch);
+				lock.lock();
+				if (result) {
+					_committedSeq = seq;
+				} else {
+					requeue(batch);
+				}
+				return result;
+			}
+
+			uint64_t target = _enqueuedSeq, failedWrites = _failedWrites;
+			if (_committedSeq >= target)
+				return true;
+
+			_flushRequested = true;
+			_pendingCondition.notify_one();
+			while (_committedSeq < target && _failedWrites == failedWrites) {
+				_committedCondition.wait(lock);
+			}
+
+			return _committedSeq >= target;
+		}
+
+		void PersistenceQueue::stop() {
+			{
+				boost::mutex::scoped_lock lock(_mutex);
+				_stopped = true;
+				_pendingCondition.notify_one();
+			}
+
+			if (_thread.joinable())
+				_thread.join();
+		}
+
+		void PersistenceQueue::enqueued() {
+			_enqueuedSeq++;
+			// wake the writer to arm its flush timer, or to commit a full batch right away
+			if (++_pendingCount == 1 || _pendingCount >= _batchSize)
+				_pendingCondition.notify_one();
+		}
+
+		void PersistenceQueue::requeue(Batch &batch) {
+			// the failed batch is older than whatever was queued while it was being written
+			batch.append(_pending);
+			_pending.swap(batch);
+			if (_pendingCount == 0)
+				_pendingCount = 1;
+		}
+
+		void PersistenceQueue::run() {
+			boost::unique_lock<boost::mutex> lock(_mutex);
+
+			for (;;) {
+				while (!_stopped && !_flushRequested && _pendingCount < _batchSize) {
+					if (_pendingCount == 0) {
+						_pendingCondition.wait(lock);
+					} else if (!_pendingCondition.timed_wait(lock, boost::posix_time::milliseconds(_flushInterval))) {
+						break;
+					}
+				}
+
+				Batch batch;
+				batch.swap(_pending);
+				_pendingCount = 0;
+				_flushRequested = false;
+				uint64_t seq = _enqueuedSeq;
+
+				bool result = true;
+				if (!batch.empty()) {
+					lock.unlock();
+					result = write(batch);
+					lock.lock();
+				}
+
+				if (result) {
+					_committedSeq = seq;
+				} else if (!_stopped) {
+					// keep the batch for the next commit, but let flush() callers know it didn't make it
+					requeue(batch);
+					_failedWrites++;
+					_committedCondition.notify_all();
+					_pendingCondition.timed_wait(lock, boost::posix_time::milliseconds(_flushInterval));
+					continue;
+				} else {
+					Log::getLogger()->error("persistence queue stopped, dropping the batch that failed to commit");
+				}
+				_committedCondition.notify_all();
+
+				if (_stopped && _pendingCount == 0)
+					break;
+			}
+		}
+
+		bool PersistenceQueue::write(const Batch &batch) {
+			if (batch.empty())
+				return true;
+
+			bool result = _databaseManager->doTransaction([&batch, this]() {
+				for (std::set<std::string>::const_iterator it = batch.txDeletes.begin();
+					 it != batch.txDeletes.end(); ++it) {
+					checkWrite(_databaseManager->deleteTxByHash(_iso, *it), "delete transaction " + *it);
+					checkWrite(_databaseManager->deleteAddressTxsByHash(_iso, *it), "delete address index of " + *it);
+				}
+
+				if (!batch.txPuts.empty()) {
+					std::vector<TransactionEntity> txEntities(batch.txPuts.begin(), batch.txPuts.end());
+					checkWrite(_databaseManager->putTransactions(_iso, txEntities), "put transactions");
+
+					std::vector<AddressTxEntity> addressTxs;
+					for (size_t i = 0; i < txEntities.size(); ++i) {
+						std::map<std::string, std::vector<std::string> >::const_iterator addresses;
+						addresses = batch.txAddresses.find(txEntities[i].txHash);
+						if (addresses == batch.txAddresses.end())
+							continue;
+
+						for (size_t j = 0; j < addresses->second.size(); ++j) {
+							addressTxs.push_back(AddressTxEntity(addresses->second[j], txEntities[i].txHash,
+																 txEntities[i].blockHeight));
+						}
+					}
+					if (!addressTxs.empty())
+						checkWrite(_databaseManager->putAddressTxs(_iso, addressTxs), "put address index");
+				}
+
+				if (!batch.txUpdates.empty()) {
+					std::vector<TransactionEntity> txEntities;
+					for (std::map<std::string, TransactionEntity>::const_iterator it = batch.txUpdates.begin();
+						 it != batch.txUpdates.end(); ++it) {
+						txEntities.push_back(it->second);
+						checkWrite(_databaseManager->updateAddressTxHeight(_iso, it->first, it->second.blockHeight),
+								   "update address index of " + it->first);
+					}
+					checkWrite(_databaseManager->updateTransactions(_iso, txEntities), "update transactions");
+				}
+
+				if (batch.replaceBlocks) {
+					checkWrite(_databaseManager->deleteAllBlocks(_iso), "delete blocks");
+				}
+
+				if (!batch.blocks.empty()) {
+					checkWrite(_databaseManager->putMerkleBlocks(_iso, batch.blocks), "put blocks");
+				}
+
+				if (batch.pruneHeight > 0) {
+					checkWrite(_databaseManager->deleteBlocksBelowHeight(_iso, batch.pruneHeight), "prune blocks");
+				}
+			});
+
+			if (!result) {
+				Log::getLogger()->error("failed to persist {} tx, {} tx updates, {} tx deletes, {} blocks",
+										batch.txPuts.size(), batch.txUpdates.size(), batch.txDeletes.size(),
+										batch.blocks.size());
+				return false;
+			}
+
+			Log::getLogger()->debug("persisted {} tx, {} tx updates, {} tx deletes, {} blocks",
+									batch.txPuts.size(), batch.txUpdates.size(), batch.txDeletes.size(), batch.blocks.size());
+			return true;
+		}
+
+	}
+}
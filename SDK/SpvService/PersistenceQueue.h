@@ -0,0 +1,104 @@
+// Copyright (c) 2012-2018 The Elastos Open Source Project
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#ifndef __ELASTOS_SDK_PERSISTENCEQUEUE_H__
+#define __ELASTOS_SDK_PERSISTENCEQUEUE_H__
+
+#include <list>
+#include <map>
+#include <set>
+#include <vector>
+#include <boost/thread.hpp>
+
+#include "DatabaseManager.h"
+
+namespace Elastos {
+	namespace ElaWallet {
+
+		/*
+		 * Write-behind queue between the wallet/peer manager callbacks and the database.
+		 * Writes are coalesced in memory and committed by a dedicated thread in one database
+		 * transaction, either when batchSize operations are pending or when flushInterval
+		 * milliseconds have passed since the previous commit.
+		 */
+		class PersistenceQueue {
+		public:
+			PersistenceQueue(DatabaseManager *databaseManager, const std::string &iso,
+							 size_t batchSize = 500, uint32_t flushInterval = 500);
+
+			~PersistenceQueue();
+
+			// addresses are the ones the transaction spends from or pays to, stored in the address index
+			void putTransaction(const TransactionEntity &txEntity,
+								const std::vector<std::string> &addresses = std::vector<std::string>());
+
+			void updateTransaction(const std::string &hash, uint32_t blockHeight, uint32_t timeStamp);
+
+			void deleteTransaction(const std::string &hash);
+
+			// replace drops every block queued before and deletes stored blocks at commit time
+			void putMerkleBlocks(bool replace, const std::vector<MerkleBlockEntity> &blockEntities);
+
+			// deletes stored blocks below height once the queued blocks are written
+			void pruneMerkleBlocks(uint32_t height);
+
+			// Blocks until everything queued before the call is committed, returns false if a commit
+			// failed first. Failed batches stay queued and are retried with the next commit.
+			bool flush();
+
+			void stop();
+
+		private:
+			struct Batch {
+				Batch();
+
+				bool empty() const;
+
+				void swap(Batch &other);
+
+				// applies the operations of a batch queued after this one on top of it
+				void append(const Batch &newer);
+
+				std::list<TransactionEntity> txPuts;
+				std::map<std::string, std::list<TransactionEntity>::iterator> txPutIndex;
+				std::map<std::string, std::vector<std::string> > txAddresses;
+				std::map<std::string, TransactionEntity> txUpdates;
+				std::set<std::string> txDeletes;
+				bool replaceBlocks;
+				std::vector<MerkleBlockEntity> blocks;
+				uint32_t pruneHeight;
+			};
+
+			void run();
+
+			void enqueued();
+
+			// puts batch back in front of the pending operations, _mutex must be held
+			void requeue(Batch &batch);
+
+			bool write(const Batch &batch);
+
+		private:
+			DatabaseManager *_databaseManager;
+			std::string _iso;
+			size_t _batchSize;
+			uint32_t _flushInterval;
+
+			boost::mutex _mutex;
+			boost::condition_variable _pendingCondition;
+			boost::condition_variable _committedCondition;
+			Batch _pending;
+			size_t _pendingCount;
+			uint64_t _enqueuedSeq;
+			uint64_t _committedSeq;
+			uint64_t _failedWrites;
+			bool _flushRequested;
+			bool _stopped;
+			boost::thread _thread;
+		};
+
+	}
+}
+
+#endif //__ELASTOS_SDK_PERSISTENCEQUEUE_H__
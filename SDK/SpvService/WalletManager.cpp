@@ -2,6 +2,7 @@
 // Distributed under the MIT software license, see the accompanying
 // file COPYING or http://www.opensource.org/licenses/mit-license.php.
 
+#include <fstream>
 #include <boost/thread.hpp>
 
 #include "BRMerkleBlock.h"
@@ -17,18 +18,61 @@
 #define BACKGROUND_THREAD_COUNT 1
 
 #define DATABASE_PATH "spv_wallet.db"
+#define HEADER_STORE_EXTENSION ".headers"
+#define WALLET_SNAPSHOT_EXTENSION ".snapshot"
 #define ISO "ela"
 
 namespace Elastos {
 	namespace ElaWallet {
 
+		namespace {
+			// lowest height of the blocks BRPeerManager hands to saveBlocks(replace) at this tip
+			uint32_t blockWindowStart(uint32_t lastHeight) {
+				uint32_t offset = lastHeight % BLOCK_DIFFICULTY_INTERVAL + BLOCK_DIFFICULTY_INTERVAL;
+				return lastHeight > offset ? lastHeight - offset : 0;
+			}
+
+			HeaderRecord headerRecordFromBlock(const BRMerkleBlock *raw) {
+				HeaderRecord record;
+				record.blockHash = raw->blockHash;
+				record.prevBlock = raw->prevBlock;
+				record.merkleRoot = raw->merkleRoot;
+				record.height = raw->height;
+				record.timestamp = raw->timestamp;
+				record.target = raw->target;
+				record.version = raw->version;
+				record.nonce = raw->nonce;
+				return record;
+			}
+
+			bool headerRecordHeightLess(const HeaderRecord &a, const HeaderRecord &b) {
+				return a.height < b.height;
+			}
+
+			// addresses a transaction spends from or pays to, each once
+			std::vector<std::string> transactionAddresses(const TransactionPtr &tx) {
+				std::set<std::string> unique;
+
+				std::vector<std::string> addresses = tx->getInputAddresses();
+				unique.insert(addresses.begin(), addresses.end());
+				addresses = tx->getOutputAddresses();
+				unique.insert(addresses.begin(), addresses.end());
+				unique.erase("");
+
+				return std::vector<std::string>(unique.begin(), unique.end());
+			}
+		}
+
 		WalletManager::WalletManager(const WalletManager &proto) :
 				CoreWalletManager(proto._pluginTypes, proto._chainParams),
 				_executor(BACKGROUND_THREAD_COUNT),
 				_reconnectExecutor(BACKGROUND_THREAD_COUNT),
 				_databaseManager(proto._databaseManager.getPath()),
+				_persistenceQueue(&_databaseManager, ISO),
 				_reconnectTimer(nullptr),
 				_forkId(proto._forkId) {
+			_headerStore.open(boost::filesystem::path(proto._databaseManager.getPath()).replace_extension(
+					HEADER_STORE_EXTENSION));
 			init(proto._subAccount, proto._earliestPeerTime, proto._reconnectSeconds);
 		}
 
@@ -39,8 +83,10 @@ namespace Elastos {
 				_executor(BACKGROUND_THREAD_COUNT),
 				_reconnectExecutor(BACKGROUND_THREAD_COUNT),
 				_databaseManager(dbPath),
+				_persistenceQueue(&_databaseManager, ISO),
 				_reconnectTimer(nullptr),
 				_forkId(forkId) {
+			_headerStore.open(boost::filesystem::path(dbPath).replace_extension(HEADER_STORE_EXTENSION));
 			init(subAccount, earliestPeerTime, reconnectSeconds);
 		}
 
@@ -74,25 +120,29 @@ namespace Elastos {
 			_executor.stopThread();
 			_reconnectExecutor.stopThread();
 
+			if (!_persistenceQueue.flush())
+				Log::error("Wallet manager stopped with writes that failed to commit, retrying them on exit.");
+			saveWalletSnapshot();
 		}
 
 		SharedWrapperList<Transaction, BRTransaction *> WalletManager::getTransactions(
-				const boost::function<bool(const TransactionPtr &)> filter) const {
+				const boost::function<bool(const TransactionPtr &)> filter) {
 			SharedWrapperList<Transaction, BRTransaction *> txs;
 
-			std::vector<TransactionEntity> txsEntity = _databaseManager.getAllTransactions(ISO);
+			_persistenceQueue.flush();
 
-			for (size_t i = 0; i < txsEntity.size(); ++i) {
+			_databaseManager.visitTransactions(ISO, [&txs, &filter](const TransactionEntityView &view) {
 				TransactionPtr transaction(new Transaction());
-				ByteStream byteStream(txsEntity[i].buff, txsEntity[i].buff.GetSize(), false);
+				ByteStream byteStream(view.buff, view.buffSize);
 				transaction->Deserialize(byteStream);
 				BRTransaction *raw = transaction->getRaw();
-				raw->blockHeight = txsEntity[i].blockHeight;
-				raw->timestamp = txsEntity[i].timeStamp;
+				raw->blockHeight = view.blockHeight;
+				raw->timestamp = view.timeStamp;
 				if (filter(transaction)) {
 					txs.push_back(transaction);
 				}
-			}
+				return true;
+			});
 			return txs;
 		}
 
@@ -111,6 +161,20 @@ namespace Elastos {
 
 			getPeerManager()->publishTransaction(transaction);
 			getWallet()->RegisterRemark(transaction);
+
+			// Sent transactions must survive a crash right after publishing, so don't leave them in the queue
+			if (BRWalletTransactionForHash(getWallet()->getRaw(), transaction->getHash()) != nullptr) {
+				std::string hash = Utils::UInt256ToString(transaction->getHash(), true);
+				transaction->setRemark(getWallet()->GetRemark(hash));
+				ByteStream stream;
+				transaction->Serialize(stream);
+				TransactionEntity txEntity(stream.takeBuffer(), transaction->getBlockHeight(), transaction->getTimestamp(),
+										   transaction->getRemark(), hash);
+				std::vector<std::string> addresses = transactionAddresses(transaction);
+				_addressTxIndex.add(hash, transaction->getBlockHeight(), addresses);
+				_persistenceQueue.putTransaction(txEntity, addresses);
+				_persistenceQueue.flush();
+			}
 		}
 
 		void WalletManager::recover(int limitGap) {
@@ -145,7 +209,7 @@ namespace Elastos {
 			ByteStream stream;
 			tx->Serialize(stream);
 
-			CMBlock data = stream.getBuffer();
+			CMBlock data = stream.takeBuffer();
 
 			UInt256 hash = tx->getHash();
 			std::string hashStr = Utils::UInt256ToString(hash, true);
@@ -154,7 +218,9 @@ namespace Elastos {
 
 			TransactionEntity txEntity(data, tx->getBlockHeight(),
 									   tx->getTimestamp(), tx->getRemark(), Utils::UInt256ToString(tx->getHash(), true));
-			_databaseManager.putTransaction(ISO, txEntity);
+			std::vector<std::string> addresses = transactionAddresses(tx);
+			_addressTxIndex.add(hashStr, tx->getBlockHeight(), addresses);
+			_persistenceQueue.putTransaction(txEntity, addresses);
 
 			std::for_each(_walletListeners.begin(), _walletListeners.end(),
 						  [&tx](Wallet::Listener *listener) {
@@ -163,13 +229,8 @@ namespace Elastos {
 		}
 
 		void WalletManager::onTxUpdated(const std::string &hash, uint32_t blockHeight, uint32_t timeStamp) {
-			TransactionEntity txEntity;
-
-			txEntity.buff.Clear();
-			txEntity.blockHeight = blockHeight;
-			txEntity.timeStamp = timeStamp;
-			txEntity.txHash = hash;
-			_databaseManager.updateTransaction(ISO, txEntity);
+			_addressTxIndex.update(hash, blockHeight);
+			_persistenceQueue.updateTransaction(hash, blockHeight, timeStamp);
 
 			std::for_each(_walletListeners.begin(), _walletListeners.end(),
 						  [&hash, blockHeight, timeStamp](Wallet::Listener *listener) {
@@ -178,7 +239,8 @@ namespace Elastos {
 		}
 
 		void WalletManager::onTxDeleted(const std::string &hash, bool notifyUser, bool recommendRescan) {
-			_databaseManager.deleteTxByHash(ISO, hash);
+			_addressTxIndex.remove(hash);
+			_persistenceQueue.deleteTransaction(hash);
 
 			std::for_each(_walletListeners.begin(), _walletListeners.end(),
 						  [&hash, notifyUser, recommendRescan](Wallet::Listener *listener) {
@@ -217,12 +279,9 @@ namespace Elastos {
 
 		void WalletManager::saveBlocks(bool replace, const SharedWrapperList<IMerkleBlock, BRMerkleBlock *> &blocks) {
 
-			if (replace) {
-				_databaseManager.deleteAllBlocks(ISO);
-			}
-
 			ByteStream ostream;
 			std::vector<MerkleBlockEntity> merkleBlockList;
+			std::vector<HeaderRecord> headers;
 			MerkleBlockEntity blockEntity;
 			for (size_t i = 0; i < blocks.size(); ++i) {
 				if (blocks[i]->getHeight() == 0)
@@ -238,13 +297,33 @@ namespace Elastos {
 				}
 #endif
 
+				blocks[i]->getBlockHash();
+				headers.push_back(headerRecordFromBlock(blocks[i]->getRawBlock()));
+
+				// blocks rebuilt from the header store have no AuxPow, they must not replace stored ones
+				if (isHeaderOnlyBlock(blocks[i]))
+					continue;
+
 				ostream.setPosition(0);
 				blocks[i]->Serialize(ostream);
 				blockEntity.blockBytes = ostream.getBuffer();
 				blockEntity.blockHeight = blocks[i]->getHeight();
 				merkleBlockList.push_back(blockEntity);
 			}
-			_databaseManager.putMerkleBlocks(ISO, merkleBlockList);
+
+			// BRPeerManager hands blocks tip first, the header chain is extended from the lowest one
+			std::sort(headers.begin(), headers.end(), headerRecordHeightLess);
+			for (size_t i = 0; i < headers.size(); ++i) {
+				_headerStore.put(headers[i]);
+			}
+			_headerStore.flush();
+
+			_persistenceQueue.putMerkleBlocks(replace, merkleBlockList);
+			// full blocks (with AuxPow) are only kept for the last difficulty window
+			if (!replace && !headers.empty() && headers.back().height % BLOCK_DIFFICULTY_INTERVAL == 0) {
+				_persistenceQueue.pruneMerkleBlocks(blockWindowStart(headers.back().height));
+				saveWalletSnapshot();
+			}
 
 			std::for_each(_peerManagerListeners.begin(), _peerManagerListeners.end(),
 						  [replace, &blocks](PeerManager::Listener *listener) {
@@ -330,6 +409,7 @@ namespace Elastos {
 		}
 
 		size_t WalletManager::getAllTransactionsCount() {
+			_persistenceQueue.flush();
 			return _databaseManager.getAllTransactionsCount(ISO);
 		}
 
@@ -337,45 +417,186 @@ namespace Elastos {
 		SharedWrapperList<Transaction, BRTransaction *> WalletManager::loadTransactions() {
 			SharedWrapperList<Transaction, BRTransaction *> txs;
 
-			std::vector<TransactionEntity> txsEntity = _databaseManager.getAllTransactions(ISO);
+			std::map<std::string, std::vector<std::string> > txAddresses;
+			std::vector<AddressTxEntity> addressTxs = _databaseManager.getAllAddressTxs(ISO);
+			for (size_t i = 0; i < addressTxs.size(); ++i) {
+				txAddresses[addressTxs[i].txHash].push_back(addressTxs[i].address);
+			}
+			addressTxs.clear();
 
-			for (size_t i = 0; i < txsEntity.size(); ++i) {
+			_addressTxIndex.clear();
+			_databaseManager.visitTransactions(ISO, [&txs, &txAddresses, &addressTxs, this](
+					const TransactionEntityView &view) {
 				ELATransaction *tx = ELATransactionNew();
 				TransactionPtr transaction(new Transaction(tx, false));
 
-				ByteStream byteStream(txsEntity[i].buff, txsEntity[i].buff.GetSize(), false);
+				// deserialize straight from the database row, no intermediate copy of the blob
+				ByteStream byteStream(view.buff, view.buffSize);
 				transaction->Deserialize(byteStream);
-				transaction->setRemark(txsEntity[i].remark);
+				transaction->setRemark(view.remark);
 
 				BRTransaction *raw = transaction->getRaw();
-				raw->blockHeight = txsEntity[i].blockHeight;
-				raw->timestamp = txsEntity[i].timeStamp;
+				raw->blockHeight = view.blockHeight;
+				raw->timestamp = view.timeStamp;
+
+				std::map<std::string, std::vector<std::string> >::iterator it = txAddresses.find(view.txHash);
+				if (it != txAddresses.end()) {
+					_addressTxIndex.add(view.txHash, view.blockHeight, it->second);
+				} else {
+					// stored before the address index existed
+					std::vector<std::string> addresses = transactionAddresses(transaction);
+					_addressTxIndex.add(view.txHash, view.blockHeight, addresses);
+					for (size_t i = 0; i < addresses.size(); ++i) {
+						addressTxs.push_back(AddressTxEntity(addresses[i], view.txHash, view.blockHeight));
+					}
+				}
 
 				txs.push_back(transaction);
+				return true;
+			});
+
+			if (!addressTxs.empty()) {
+				_databaseManager.putAddressTxs(ISO, addressTxs);
 			}
 
 			return txs;
 		}
 
+		CMBlock WalletManager::loadWalletSnapshot() {
+			CMBlock snapshot;
+			boost::filesystem::path path = getWalletSnapshotPath();
+
+			if (!boost::filesystem::exists(path))
+				return snapshot;
+
+			std::ifstream file(path.string().c_str(), std::ios::binary);
+			snapshot.Resize((size_t) boost::filesystem::file_size(path));
+			if (!file.read((char *) (uint8_t *) snapshot, snapshot.GetSize())) {
+				Log::getLogger()->warn("read wallet snapshot {} error", path.string());
+				return CMBlock();
+			}
+
+			return snapshot;
+		}
+
+		void WalletManager::saveWalletSnapshot() {
+			if (getWallet() == nullptr)
+				return;
+
+			CMBlock snapshot = getWallet()->GetSnapshot();
+			if (snapshot.GetSize() == 0)
+				return;
+
+			// write aside and rename, so a crash never leaves a torn snapshot behind
+			boost::filesystem::path path = getWalletSnapshotPath();
+			boost::filesystem::path tmpPath = boost::filesystem::path(path).replace_extension(
+					WALLET_SNAPSHOT_EXTENSION ".tmp");
+			{
+				std::ofstream file(tmpPath.string().c_str(), std::ios::binary | std::ios::trunc);
+				if (!file.write((const char *) (uint8_t *) snapshot, snapshot.GetSize()) || !file.flush()) {
+					Log::getLogger()->warn("write wallet snapshot {} error", tmpPath.string());
+					return;
+				}
+			}
+
+			boost::system::error_code ec;
+			boost::filesystem::rename(tmpPath, path, ec);
+			if (ec) {
+				Log::getLogger()->warn("rename wallet snapshot {} error: {}", path.string(), ec.message());
+			}
+		}
+
+		boost::filesystem::path WalletManager::getWalletSnapshotPath() const {
+			return boost::filesystem::path(_databaseManager.getPath()).replace_extension(WALLET_SNAPSHOT_EXTENSION);
+		}
+
 		SharedWrapperList<IMerkleBlock, BRMerkleBlock *> WalletManager::loadBlocks() {
 			SharedWrapperList<IMerkleBlock, BRMerkleBlock *> blocks;
 
-			std::vector<MerkleBlockEntity> blocksEntity = _databaseManager.getAllMerkleBlocks(ISO);
+			if (_headerStore.size() > 0) {
+				// The peer manager only needs the blocks of the last difficulty window to resume. The database
+				// keeps the full blocks (with AuxPow) of that window, heights it lacks are rebuilt from the mapped
+				// header records.
+				uint32_t lastHeight = _headerStore.lastHeight();
+				uint32_t startHeight = std::max(blockWindowStart(lastHeight), _headerStore.firstHeight());
+				std::map<uint32_t, MerkleBlockPtr> storedBlocks;
+				_databaseManager.visitMerkleBlocks(ISO, [&storedBlocks, startHeight, this](
+						const MerkleBlockEntityView &view) {
+					if (view.blockHeight < startHeight)
+						return true;
+
+					MerkleBlockPtr block(Registry::Instance()->CreateMerkleBlock(_pluginTypes.BlockType, false));
+					block->setHeight(view.blockHeight);
+					ByteStream stream(view.blockBytes, view.blockSize);
+					stream.setPosition(0);
+					if (block->Deserialize(stream)) {
+						block->getBlockHash();
+						storedBlocks[view.blockHeight] = block;
+					}
+					return true;
+				});
+
+				boost::mutex::scoped_lock lock(_headerOnlyBlocksMutex);
+				_headerOnlyBlocks.clear();
+				HeaderRecord record;
+				for (uint32_t height = startHeight; height <= lastHeight && _headerStore.get(height, record); ++height) {
+					std::map<uint32_t, MerkleBlockPtr>::iterator stored = storedBlocks.find(height);
+					if (stored != storedBlocks.end() &&
+						UInt256Eq(&stored->second->getRawBlock()->blockHash, &record.blockHash)) {
+						blocks.push_back(stored->second);
+						continue;
+					}
+
+					MerkleBlockPtr block(Registry::Instance()->CreateMerkleBlock(_pluginTypes.BlockType, false));
+					BRMerkleBlock *raw = block->getRawBlock();
+					raw->blockHash = record.blockHash;
+					raw->prevBlock = record.prevBlock;
+					raw->merkleRoot = record.merkleRoot;
+					raw->timestamp = record.timestamp;
+					raw->target = record.target;
+					raw->version = record.version;
+					raw->nonce = record.nonce;
+					raw->height = record.height;
+					blocks.push_back(block);
+					_headerOnlyBlocks.insert(Utils::UInt256ToString(record.blockHash));
+				}
+
+				return blocks;
+			}
 
-			for (size_t i = 0; i < blocksEntity.size(); ++i) {
+			std::vector<HeaderRecord> headers;
+			_databaseManager.visitMerkleBlocks(ISO, [&blocks, &headers, this](const MerkleBlockEntityView &view) {
 				MerkleBlockPtr block(Registry::Instance()->CreateMerkleBlock(_pluginTypes.BlockType, false));
-				block->setHeight(blocksEntity[i].blockHeight);
-				ByteStream stream(blocksEntity[i].blockBytes, blocksEntity[i].blockBytes.GetSize(), false);
+				block->setHeight(view.blockHeight);
+				ByteStream stream(view.blockBytes, view.blockSize);
 				stream.setPosition(0);
 				if (!block->Deserialize(stream)) {
 					Log::getLogger()->error("block deserialize fail");
+				} else {
+					block->getBlockHash();
+					headers.push_back(headerRecordFromBlock(block->getRawBlock()));
 				}
 				blocks.push_back(block);
+				return true;
+			});
+
+			// database written before the header store existed, seed the store from it
+			std::sort(headers.begin(), headers.end(), headerRecordHeightLess);
+			for (size_t i = 0; i < headers.size(); ++i) {
+				_headerStore.put(headers[i]);
 			}
+			_headerStore.flush();
 
 			return blocks;
 		}
 
+		bool WalletManager::isHeaderOnlyBlock(const MerkleBlockPtr &block) {
+			boost::mutex::scoped_lock lock(_headerOnlyBlocksMutex);
+			return !_headerOnlyBlocks.empty() &&
+				   _headerOnlyBlocks.find(Utils::UInt256ToString(block->getRawBlock()->blockHash)) !=
+				   _headerOnlyBlocks.end();
+		}
+
 		SharedWrapperList<Peer, BRPeer *> WalletManager::loadPeers() {
 			SharedWrapperList<Peer, BRPeer *> peers;
 
@@ -456,5 +677,14 @@ namespace Elastos {
 			}
 		}
 
+		const AddressTxIndex &WalletManager::getAddressTxIndex() const {
+			return _addressTxIndex;
+		}
+
+		void WalletManager::setDatabaseDurability(SqliteDurability durability) {
+			_persistenceQueue.flush();
+			_databaseManager.setDurability(durability);
+		}
+
 	}
 }
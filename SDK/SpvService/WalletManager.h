@@ -5,6 +5,7 @@
 #ifndef __ELASTOS_SDK_WALLETMANAGER_H__
 #define __ELASTOS_SDK_WALLETMANAGER_H__
 
+#include <set>
 #include <vector>
 #include <boost/function.hpp>
 #include <boost/filesystem.hpp>
@@ -14,6 +15,9 @@
 #include "TransactionCreationParams.h"
 #include "CoreWalletManager.h"
 #include "DatabaseManager.h"
+#include "HeaderStore.h"
+#include "PersistenceQueue.h"
+#include "AddressTxIndex.h"
 #include "BackgroundExecutor.h"
 #include "KeyStore/KeyStore.h"
 #include "SDK/Transaction/Transaction.h"
@@ -43,10 +47,14 @@ namespace Elastos {
 			void stop();
 
 			SharedWrapperList<Transaction, BRTransaction *> getTransactions(
-					const boost::function<bool(const TransactionPtr &)> filter) const;
+					const boost::function<bool(const TransactionPtr &)> filter);
 
 			size_t getAllTransactionsCount();
 
+			void setDatabaseDurability(SqliteDurability durability);
+
+			const AddressTxIndex &getAddressTxIndex() const;
+
 			void registerWalletListener(Wallet::Listener *listener);
 
 			void registerPeerManagerListener(PeerManager::Listener *listener);
@@ -105,6 +113,8 @@ namespace Elastos {
 
 			virtual SharedWrapperList<Peer, BRPeer *> loadPeers();
 
+			virtual CMBlock loadWalletSnapshot();
+
 			virtual int getForkId() const;
 
 			virtual const PeerManagerListenerPtr &createPeerManagerListener();
@@ -117,8 +127,20 @@ namespace Elastos {
 
 			void asyncConnect(const boost::system::error_code& error);
 
+			void saveWalletSnapshot();
+
+			boost::filesystem::path getWalletSnapshotPath() const;
+
+			// true for blocks loadBlocks() rebuilt from bare header records
+			bool isHeaderOnlyBlock(const MerkleBlockPtr &block);
+
 		private:
 			DatabaseManager _databaseManager;
+			PersistenceQueue _persistenceQueue;
+			HeaderStore _headerStore;
+			std::set<std::string> _headerOnlyBlocks;
+			boost::mutex _headerOnlyBlocksMutex;
+			AddressTxIndex _addressTxIndex;
 			BackgroundExecutor _executor;
 			BackgroundExecutor _reconnectExecutor;
 			int _forkId;
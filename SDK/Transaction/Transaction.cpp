@@ -3,6 +3,8 @@
 // file COPYING or http://www.opensource.org/licenses/mit-license.php.
 
 #include <cstring>
+#include <boost/bind.hpp>
+#include <boost/thread/thread.hpp>
 #include <BRTransaction.h>
 #include <SDK/Common/Log.h>
 #include <Core/BRTransaction.h>
@@ -113,8 +115,7 @@ namespace Elastos {
 			if (UInt256Eq(&_transaction->raw.txHash, &emptyHash)) {
 				ByteStream ostream;
 				serializeUnsigned(ostream);
-				CMBlock buff = ostream.getBuffer();
-				BRSHA256_2(&_transaction->raw.txHash, buff, buff.GetSize());
+				BRSHA256_2(&_transaction->raw.txHash, ostream.data(), ostream.length());
 			}
 			return _transaction->raw.txHash;
 		}
@@ -212,9 +213,33 @@ namespace Elastos {
 		}
 
 		size_t Transaction::getSize() {
-			ByteStream stream;
-			Serialize(stream);
-			return stream.getBuffer().GetSize();
+			ParamChecker::checkCondition(_transaction->payload == nullptr, Error::Transaction,
+										 "payload should not be null");
+
+			size_t size = sizeof(uint8_t) + sizeof(_transaction->payloadVersion) + _transaction->payload->getSize();
+
+			size += ByteStream::varUintSize(_transaction->attributes.size());
+			for (size_t i = 0; i < _transaction->attributes.size(); i++) {
+				size += _transaction->attributes[i]->getSize();
+			}
+
+			size += ByteStream::varUintSize(_transaction->raw.inCount);
+			size += _transaction->raw.inCount * TX_UNSIGNED_INPUT_SIZE;
+
+			const std::vector<TransactionOutput *> &outputs = getOutputs();
+			size += ByteStream::varUintSize(outputs.size());
+			for (size_t i = 0; i < outputs.size(); i++) {
+				size += outputs[i]->getSize();
+			}
+
+			size += sizeof(_transaction->raw.lockTime);
+
+			size += ByteStream::varUintSize(_transaction->programs.size());
+			for (size_t i = 0; i < _transaction->programs.size(); i++) {
+				size += _transaction->programs[i]->getSize();
+			}
+
+			return size;
 		}
 
 		uint64_t Transaction::getStandardFee() {
@@ -236,10 +261,43 @@ namespace Elastos {
 			return sign(keys, forkId);
 		}
 
-		bool Transaction::transactionSign(int forkId, const WrapperList<Key, BRKey> keys) {
+		// an input to sign, with the key and program it was matched with
+		struct InputSignJob {
+			BRTxInput *input;
+			Program *program;
+			const Key *key;
+			const CMBlock *pubKey;
+			bool payToPubKeyHash;
+			CMBlock script;
+			CMBlock signData;
+		};
+
+		static void signInputs(InputSignJob *jobs, size_t count, const UInt256 &md, const CMBlock &shaData,
+							   int forkId) {
 			const int SIGHASH_ALL = 0x01; // default, sign all of the outputs
+
+			for (size_t i = 0; i < count; i++) {
+				InputSignJob &job = jobs[i];
+				size_t pkLen = job.pubKey->GetSize();
+				uint8_t sig[73], script[1 + sizeof(sig) + 1 + pkLen];
+				size_t sigLen, scriptLen;
+
+				sigLen = BRKeySign(job.key->getRaw(), sig, sizeof(sig) - 1, md);
+				sig[sigLen++] = forkId | SIGHASH_ALL;
+				scriptLen = BRScriptPushData(script, sizeof(script), sig, sigLen);
+				if (job.payToPubKeyHash)
+					scriptLen += BRScriptPushData(&script[scriptLen], sizeof(script) - scriptLen, *job.pubKey, pkLen);
+				job.script.Resize(scriptLen);
+				memcpy(job.script, script, scriptLen);
+
+				job.signData = job.key->compactSign(shaData);
+			}
+		}
+
+		bool Transaction::transactionSign(int forkId, const WrapperList<Key, BRKey> keys) {
 			size_t i, j, keysCount = keys.size();
 			BRAddress addrs[keysCount];
+			std::vector<CMBlock> pubKeys(keysCount);
 
 			ParamChecker::checkCondition(keysCount <= 0, Error::Transaction,
 										 "Transaction sign key not found");
@@ -251,8 +309,19 @@ namespace Elastos {
 				if (!tempAddr.empty()) {
 					strncpy(addrs[i].s, tempAddr.c_str(), sizeof(BRAddress) - 1);
 				}
+				// read once here, the signing threads share the keys
+				pubKeys[i] = keys[i].getPubkey();
 			}
 
+			// the digest covers the unsigned transaction only, it is the same for every input
+			ByteStream ostream;
+			serializeUnsigned(ostream);
+			UInt256 md = UINT256_ZERO;
+			BRSHA256_2(&md, ostream.data(), ostream.length());
+			CMBlock shaData(sizeof(UInt256));
+			BRSHA256(shaData, ostream.data(), ostream.length());
+
+			std::vector<InputSignJob> jobs;
 			size_t size = _transaction->raw.inCount;
 			for (i = 0; i < size; i++) {
 				BRTxInput *input = &_transaction->raw.inputs[i];
@@ -278,34 +347,38 @@ namespace Elastos {
 				const uint8_t *elems[BRScriptElements(NULL, 0, program->getCode(), program->getCode().GetSize())];
 				size_t elemsCount = BRScriptElements(elems, sizeof(elems) / sizeof(*elems), program->getCode(),
 													 program->getCode().GetSize());
-				CMBlock pubKey = keys[j].getPubkey();
-				size_t pkLen = pubKey.GetSize();
-				uint8_t sig[73], script[1 + sizeof(sig) + 1 + pkLen];
-				size_t sigLen, scriptLen;
-				UInt256 md = UINT256_ZERO;
-				ByteStream ostream;
-				serializeUnsigned(ostream);
-				CMBlock data = ostream.getBuffer();
-				if (elemsCount >= 2 && *elems[elemsCount - 2] == OP_EQUALVERIFY) { // pay-to-pubkey-hash
-
-					BRSHA256_2(&md, data, data.GetSize());
-					sigLen = BRKeySign(keys[j].getRaw(), sig, sizeof(sig) - 1, md);
-					sig[sigLen++] = forkId | SIGHASH_ALL;
-					scriptLen = BRScriptPushData(script, sizeof(script), sig, sigLen);
-					scriptLen += BRScriptPushData(&script[scriptLen], sizeof(script) - scriptLen, pubKey, pkLen);
-					BRTxInputSetSignature(input, script, scriptLen);
-				} else { // pay-to-pubkey
-					BRSHA256_2(&md, data, data.GetSize());
-					sigLen = BRKeySign(keys[j].getRaw(), sig, sizeof(sig) - 1, md);
-					sig[sigLen++] = forkId | SIGHASH_ALL;
-					scriptLen = BRScriptPushData(script, sizeof(script), sig, sigLen);
-					BRTxInputSetSignature(input, script, scriptLen);
+
+				InputSignJob job;
+				job.input = input;
+				job.program = program;
+				job.key = &keys[j];
+				job.pubKey = pubKeys.data() + j;
+				job.payToPubKeyHash = elemsCount >= 2 && *elems[elemsCount - 2] == OP_EQUALVERIFY;
+				jobs.push_back(job);
+			}
+
+			size_t workers = boost::thread::hardware_concurrency();
+			if (workers > jobs.size() / TX_SIGN_BATCH)
+				workers = jobs.size() / TX_SIGN_BATCH;
+
+			if (workers <= 1) {
+				if (!jobs.empty())
+					signInputs(&jobs[0], jobs.size(), md, shaData, forkId);
+			} else {
+				boost::thread_group threads;
+				size_t offset = 0;
+				for (i = 0; i < workers; i++) {
+					size_t n = jobs.size() / workers + (i < jobs.size() % workers ? 1 : 0);
+					threads.create_thread(boost::bind(&signInputs, &jobs[offset], n, boost::cref(md),
+														  boost::cref(shaData), forkId));
+					offset += n;
 				}
+				threads.join_all();
+			}
 
-				CMBlock shaData(sizeof(UInt256));
-				BRSHA256(shaData, data, data.GetSize());
-				CMBlock signData = keys[j].compactSign(shaData);
-				program->setParameter(signData);
+			for (i = 0; i < jobs.size(); i++) {
+				BRTxInputSetSignature(jobs[i].input, jobs[i].script, jobs[i].script.GetSize());
+				jobs[i].program->setParameter(jobs[i].signData);
 			}
 
 			return isSigned();
@@ -520,8 +593,7 @@ namespace Elastos {
 
 			ByteStream ostream;
 			serializeUnsigned(ostream);
-			CMBlock buff = ostream.getBuffer();
-			BRSHA256_2(&_transaction->raw.txHash, buff, buff.GetSize());
+			BRSHA256_2(&_transaction->raw.txHash, ostream.data(), ostream.length());
 
 			return true;
 		}
@@ -772,9 +844,8 @@ namespace Elastos {
 		CMBlock Transaction::GetShaData() const {
 			ByteStream ostream;
 			serializeUnsigned(ostream);
-			CMBlock data = ostream.getBuffer();
 			CMBlock shaData(sizeof(UInt256));
-			BRSHA256(shaData, data, data.GetSize());
+			BRSHA256(shaData, ostream.data(), ostream.length());
 			return shaData;
 		}
 	}
@@ -20,6 +20,9 @@
 #include "ELACoreExt/Payload/IPayload.h"
 #include "ELACoreExt/ELATransaction.h"
 
+// fewest inputs a signing worker thread is started for
+#define TX_SIGN_BATCH 16
+
 
 namespace Elastos {
 	namespace ElaWallet {
@@ -113,9 +116,8 @@ namespace Elastos {
 			void shuffleOutputs();
 
 			/**
-			 * The the transactions' size in bytes if signed, or the estimated size assuming
-			 * compact pubkey sigs
-		
+			 * The serialized size of the transaction, summed from the sizes of its parts without serializing it.
+			 * Unsigned inputs count TX_UNSIGNED_INPUT_SIZE bytes each, programs are counted as they are.
 			 * @return the size in bytes.
 			 */
 			size_t getSize();
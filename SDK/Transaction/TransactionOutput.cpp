@@ -102,9 +102,8 @@ namespace Elastos {
 		}
 
 		size_t TransactionOutput::getSize() const {
-			ByteStream stream;
-			Serialize(stream);
-			return stream.getBuffer().GetSize();
+			return sizeof(_output->assetId) + sizeof(_output->raw.amount) + sizeof(_output->outputLock) +
+				   sizeof(_output->programHash);
 		}
 
 		void TransactionOutput::Serialize(ByteStream &ostream) const {
@@ -0,0 +1,98 @@
+// Copyright (c) 2012-2018 The Elastos Open Source Project
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include <string.h>
+#include <boost/bind.hpp>
+#include <boost/scoped_array.hpp>
+#include <boost/thread/thread.hpp>
+
+#include "AddressDerivation.h"
+
+namespace Elastos {
+	namespace ElaWallet {
+
+		AddressDerivation::AddressDerivation() :
+			_masterPubKey(BR_MASTER_PUBKEY_NONE),
+			_chainKeyDerivations(0) {
+		}
+
+		std::vector<BRAddress> AddressDerivation::derive(const BRMasterPubKey &mpk, uint32_t chain, uint32_t start,
+														 size_t count, KeyToAddressFunc keyToAddress) {
+			std::vector<BRAddress> addrs(count, BR_ADDRESS_NONE);
+			if (count == 0)
+				return addrs;
+
+			BRMasterPubKey chainPubKey = getChainPubKey(mpk, chain);
+			boost::scoped_array<bool> valid(new bool[count]);
+
+			size_t workers = boost::thread::hardware_concurrency();
+			if (workers > count / ADDRESS_DERIVATION_BATCH)
+				workers = count / ADDRESS_DERIVATION_BATCH;
+
+			if (workers <= 1) {
+				deriveRange(chainPubKey, start, &addrs[0], &valid[0], count, keyToAddress);
+			} else {
+				boost::thread_group threads;
+				size_t offset = 0;
+				for (size_t i = 0; i < workers; ++i) {
+					size_t n = count / workers + (i < count % workers ? 1 : 0);
+					threads.create_thread(boost::bind(&AddressDerivation::deriveRange, boost::cref(chainPubKey),
+													  start + (uint32_t) offset, &addrs[offset], &valid[offset], n,
+													  keyToAddress));
+					offset += n;
+				}
+				threads.join_all();
+			}
+
+			for (size_t i = 0; i < count; ++i) {
+				if (!valid[i]) {
+					addrs.resize(i);
+					break;
+				}
+			}
+
+			mem_clean(&chainPubKey, sizeof(chainPubKey));
+			return addrs;
+		}
+
+		size_t AddressDerivation::getChainKeyDerivations() const {
+			boost::mutex::scoped_lock scopedLock(_lock);
+			return _chainKeyDerivations;
+		}
+
+		BRMasterPubKey AddressDerivation::getChainPubKey(const BRMasterPubKey &mpk, uint32_t chain) {
+			boost::mutex::scoped_lock scopedLock(_lock);
+
+			if (memcmp(&_masterPubKey, &mpk, sizeof(mpk)) != 0) {
+				_masterPubKey = mpk;
+				_chainPubKeys.clear();
+			}
+
+			std::map<uint32_t, BRMasterPubKey>::const_iterator it = _chainPubKeys.find(chain);
+			if (it != _chainPubKeys.end())
+				return it->second;
+
+			_chainKeyDerivations++;
+			return _chainPubKeys[chain] = BRBIP32ChainPubKey(mpk, chain);
+		}
+
+		void AddressDerivation::deriveRange(const BRMasterPubKey &chainPubKey, uint32_t start, BRAddress *addrs,
+											bool *valid, size_t count, KeyToAddressFunc keyToAddress) {
+			BRKey key;
+			uint8_t pubKey[33];
+
+			for (size_t i = 0; i < count; ++i) {
+				// the ELA curve isn't secp256k1, so the point is set as it is, like Key::setPubKey() does
+				memset(&key, 0, sizeof(key));
+				valid[i] = BRBIP32PubKeyPath(pubKey, sizeof(pubKey), chainPubKey, 1, start + (uint32_t) i) > 0;
+				if (valid[i]) {
+					memcpy(key.pubKey, pubKey, sizeof(pubKey));
+					key.compressed = 1;
+					valid[i] = keyToAddress(&key, addrs[i].s, sizeof(addrs[i].s)) > 0 && addrs[i].s[0] != '\0';
+				}
+			}
+		}
+
+	}
+}
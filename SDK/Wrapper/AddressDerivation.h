@@ -0,0 +1,55 @@
+// Copyright (c) 2012-2018 The Elastos Open Source Project
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#ifndef __ELASTOS_SDK_ADDRESSDERIVATION_H__
+#define __ELASTOS_SDK_ADDRESSDERIVATION_H__
+
+#include <map>
+#include <vector>
+#include <boost/thread/mutex.hpp>
+#include <BRAddress.h>
+#include <BRBIP32Sequence.h>
+#include <BRKey.h>
+
+// fewest addresses a derivation worker thread is started for
+#define ADDRESS_DERIVATION_BATCH 256
+
+namespace Elastos {
+	namespace ElaWallet {
+
+		/*
+		 * Derives the addresses of the BIP32 chains of a master public key. The extended key of each chain,
+		 * N(m/0H/chain), is derived once and cached, so an address takes one CKD step instead of two, and
+		 * ranges of ADDRESS_DERIVATION_BATCH addresses or more are split across worker threads.
+		 */
+		class AddressDerivation {
+		public:
+			typedef size_t (*KeyToAddressFunc)(const BRKey *key, char *addr, size_t addrLen);
+
+			AddressDerivation();
+
+			// addresses [start, start + count) of chain in index order, cut short at the first one that fails
+			// to derive
+			std::vector<BRAddress> derive(const BRMasterPubKey &mpk, uint32_t chain, uint32_t start, size_t count,
+										  KeyToAddressFunc keyToAddress);
+
+			size_t getChainKeyDerivations() const;
+
+		private:
+			BRMasterPubKey getChainPubKey(const BRMasterPubKey &mpk, uint32_t chain);
+
+			static void deriveRange(const BRMasterPubKey &chainPubKey, uint32_t start, BRAddress *addrs, bool *valid,
+									size_t count, KeyToAddressFunc keyToAddress);
+
+		private:
+			mutable boost::mutex _lock;
+			BRMasterPubKey _masterPubKey;
+			std::map<uint32_t, BRMasterPubKey> _chainPubKeys;
+			size_t _chainKeyDerivations;
+		};
+
+	}
+}
+
+#endif //__ELASTOS_SDK_ADDRESSDERIVATION_H__
@@ -0,0 +1,386 @@
+// Copyright (c) 2012-2018 The Elastos Open Source Project
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include <algorithm>
+
+#include "BRArray.h"
+
+#include "BalanceEngine.h"
+#include "Wallet.h"
+#include "ELACoreExt/ELATransaction.h"
+
+#define BALANCE_UNDO_LIMIT 1000
+
+namespace Elastos {
+	namespace ElaWallet {
+
+		BalanceEngine::BalanceEngine() :
+			_indexed(true),
+			_allAddrsCount(0),
+			_ownedUsedAddrs(0),
+			_scannedSpentCount(0),
+			_appliedCount(0),
+			_recomputeCount(0) {
+		}
+
+		void BalanceEngine::update(ELAWallet *wallet) {
+			BRWallet *raw = &wallet->Raw;
+			size_t count = array_count(raw->transactions);
+
+			if (!wallet->IsSingleAddress && BRSetCount(raw->allAddrs) != _allAddrsCount) {
+				_allAddrsCount = BRSetCount(raw->allAddrs);
+				if (countOwnedUsedAddrs(wallet) != _ownedUsedAddrs) {
+					recompute(wallet);
+					return;
+				}
+			}
+
+			// first transaction that was inserted, removed or moved since the last update
+			size_t start = 0, common = std::min(_entries.size(), count);
+			while (start < common && _entries[start].tx == raw->transactions[start])
+				start++;
+
+			// unconfirmed transactions sort last, both the ones applied before and the current ones are redone
+			size_t unconfirmed = _entries.size();
+			while (unconfirmed > 0 && _entries[unconfirmed - 1].blockHeight == TX_UNCONFIRMED)
+				unconfirmed--;
+			start = std::min(start, unconfirmed);
+
+			unconfirmed = count;
+			while (unconfirmed > 0 && raw->transactions[unconfirmed - 1]->blockHeight == TX_UNCONFIRMED)
+				unconfirmed--;
+			start = std::min(start, unconfirmed);
+
+			if (_entries.size() - start > _undo.size()) {
+				recompute(wallet);
+				return;
+			}
+
+			while (_entries.size() > start)
+				revert(wallet);
+
+			for (size_t i = start; i < count; i++) {
+				push(wallet, raw->transactions[i]);
+			}
+		}
+
+		void BalanceEngine::recompute(ELAWallet *wallet) {
+			BRWallet *raw = &wallet->Raw;
+
+			array_clear(raw->utxos);
+			array_clear(raw->balanceHist);
+			BRSetClear(raw->spentOutputs);
+			BRSetClear(raw->invalidTx);
+			BRSetClear(raw->pendingTx);
+			BRSetClear(raw->usedAddrs);
+			raw->totalSent = 0;
+			raw->totalReceived = 0;
+			raw->balance = 0;
+
+			_entries.clear();
+			_undo.clear();
+			_allAddrsCount = BRSetCount(raw->allAddrs);
+			_ownedUsedAddrs = 0;
+			_scannedSpentCount = 0;
+			_addressBalances.clear();
+			_coins.clear();
+			_recomputeCount++;
+
+			for (size_t i = 0; i < array_count(raw->transactions); i++) {
+				push(wallet, raw->transactions[i]);
+			}
+		}
+
+		void BalanceEngine::reset(ELAWallet *wallet, size_t count) {
+			BRWallet *raw = &wallet->Raw;
+
+			_entries.clear();
+			_undo.clear();
+			for (size_t i = 0; i < count && i < array_count(raw->transactions); i++) {
+				_entries.push_back(Entry(raw->transactions[i], raw->transactions[i]->blockHeight));
+			}
+			_allAddrsCount = BRSetCount(raw->allAddrs);
+			_ownedUsedAddrs = countOwnedUsedAddrs(wallet);
+			_scannedSpentCount = BRSetCount(raw->spentOutputs);
+			rebuildIndexes(wallet);
+		}
+
+		void BalanceEngine::replay(ELAWallet *wallet, size_t start, size_t end) {
+			BalanceEngine engine;
+
+			engine._indexed = false;
+			for (size_t i = start; i < end; i++) {
+				engine.apply(wallet, wallet->Raw.transactions[i], nullptr);
+			}
+		}
+
+		uint64_t BalanceEngine::getAddressBalance(const std::string &address) const {
+			AddressBalanceMap::const_iterator it = _addressBalances.find(address);
+			return it != _addressBalances.end() ? it->second.balance : 0;
+		}
+
+		const BalanceEngine::AddressBalanceMap &BalanceEngine::getAddressBalances() const {
+			return _addressBalances;
+		}
+
+		const CoinSet &BalanceEngine::getCoins() const {
+			return _coins;
+		}
+
+		size_t BalanceEngine::getAppliedCount() const {
+			return _appliedCount;
+		}
+
+		size_t BalanceEngine::getRecomputeCount() const {
+			return _recomputeCount;
+		}
+
+		void BalanceEngine::apply(ELAWallet *wallet, BRTransaction *transaction, Undo *undo) {
+			BRWallet *raw = &wallet->Raw;
+			ELATransaction *tx = (ELATransaction *) transaction, *t;
+			uint64_t balance = raw->balance, prevBalance = raw->balance;
+			time_t now = time(NULL);
+			int isInvalid, isPending;
+			size_t j, utxoCount = array_count(raw->utxos);
+
+			if (undo) {
+				undo->balance = raw->balance;
+				undo->totalSent = raw->totalSent;
+				undo->totalReceived = raw->totalReceived;
+				undo->scannedSpentCount = _scannedSpentCount;
+			}
+
+			// check if any inputs are invalid or already spent
+			if (tx->raw.blockHeight == TX_UNCONFIRMED) {
+				for (j = 0, isInvalid = 0; !isInvalid && j < tx->raw.inCount; j++) {
+					if (BRSetContains(raw->spentOutputs, &tx->raw.inputs[j]) ||
+						BRSetContains(raw->invalidTx, &tx->raw.inputs[j].txHash))
+						isInvalid = 1;
+				}
+
+				if (isInvalid) {
+					BRSetAdd(raw->invalidTx, tx);
+					array_add(raw->balanceHist, balance);
+					if (undo) undo->state = Invalid;
+					return;
+				}
+			}
+
+			// add inputs to spent output set
+			for (j = 0; j < tx->raw.inCount; j++) {
+				if (BRSetContains(raw->spentOutputs, &tx->raw.inputs[j]))
+					continue;
+				BRSetAdd(raw->spentOutputs, &tx->raw.inputs[j]);
+				if (undo) undo->spentOutputs.push_back(&tx->raw.inputs[j]);
+			}
+
+			// check if tx is pending
+			if (tx->raw.blockHeight == TX_UNCONFIRMED) {
+				isPending = (ELATransactionSize(tx) > TX_MAX_SIZE) ? 1 : 0; // check tx size is under TX_MAX_SIZE
+
+				for (j = 0; !isPending && j < tx->outputs.size(); j++) {
+					if (tx->outputs[j]->getAmount() < TX_MIN_OUTPUT_AMOUNT)
+						isPending = 1; // check that no outputs are dust
+				}
+
+				for (j = 0; !isPending && j < tx->raw.inCount; j++) {
+					if (tx->raw.inputs[j].sequence < UINT32_MAX - 1) isPending = 1; // check for replace-by-fee
+					if (tx->raw.inputs[j].sequence < UINT32_MAX && tx->raw.lockTime < TX_MAX_LOCK_HEIGHT &&
+						tx->raw.lockTime > raw->blockHeight + 1)
+						isPending = 1; // future lockTime
+					if (tx->raw.inputs[j].sequence < UINT32_MAX && tx->raw.lockTime > now)
+						isPending = 1; // future lockTime
+					if (BRSetContains(raw->pendingTx, &tx->raw.inputs[j].txHash))
+						isPending = 1; // check for pending inputs
+					// TODO: XXX handle BIP68 check lock time verify rules
+				}
+
+				if (isPending) {
+					BRSetAdd(raw->pendingTx, tx);
+					array_add(raw->balanceHist, balance);
+					if (undo) undo->state = Pending;
+					return;
+				}
+			}
+
+			// add outputs to UTXO set
+			// TODO: don't add outputs below TX_MIN_OUTPUT_AMOUNT
+			// TODO: don't add coin generation outputs < 100 blocks deep
+			// NOTE: balance/UTXOs will then need to be recalculated when last block changes
+			for (j = 0; tx->raw.blockHeight != TX_UNCONFIRMED && j < tx->outputs.size(); j++) {
+				const char *address = tx->outputs[j]->getRaw()->address;
+				if (address[0] == '\0')
+					continue;
+
+				if (wallet->IsSingleAddress) {
+					if (wallet->SingleAddress == std::string(address)) {
+						array_add(raw->utxos, ((BRUTXO) {tx->raw.txHash, (uint32_t) j}));
+						indexUTXO(wallet, raw->utxos[array_count(raw->utxos) - 1]);
+						balance += tx->outputs[j]->getAmount();
+					}
+				} else {
+					int owned = BRSetContains(raw->allAddrs, address);
+
+					if (!BRSetContains(raw->usedAddrs, address)) {
+						BRSetAdd(raw->usedAddrs, (void *) address);
+						if (owned) _ownedUsedAddrs++;
+						if (undo) {
+							undo->usedAddrs.push_back(address);
+							if (owned) undo->ownedUsedAddrs++;
+						}
+					}
+
+					if (owned) {
+						array_add(raw->utxos, ((BRUTXO) {tx->raw.txHash, (uint32_t) j}));
+						indexUTXO(wallet, raw->utxos[array_count(raw->utxos) - 1]);
+						balance += tx->outputs[j]->getAmount();
+					}
+				}
+			}
+			if (undo) undo->utxosAdded = array_count(raw->utxos) - utxoCount;
+
+			// after a scan no UTXO is in the spent output set, a UTXO can only be spent again once the set grew
+			// (pending transactions add their inputs without a scan) or by one of the outputs just added
+			bool spendsUtxo = BRSetCount(raw->spentOutputs) != _scannedSpentCount;
+			for (j = utxoCount; !spendsUtxo && j < array_count(raw->utxos); j++) {
+				spendsUtxo = BRSetContains(raw->spentOutputs, &raw->utxos[j]) != 0;
+			}
+
+			// transaction ordering is not guaranteed, so check the entire UTXO set against the entire spent output set
+			for (j = array_count(raw->utxos); spendsUtxo && j > 0; j--) {
+				if (!BRSetContains(raw->spentOutputs, &raw->utxos[j - 1])) continue;
+				t = (ELATransaction *) BRSetGet(raw->allTx, &raw->utxos[j - 1].hash);
+				balance -= t->outputs[raw->utxos[j - 1].n]->getAmount();
+				if (undo) undo->utxosRemoved.push_back(std::make_pair(j - 1, raw->utxos[j - 1]));
+				unindexUTXO(wallet, raw->utxos[j - 1]);
+				array_rm(raw->utxos, j - 1);
+			}
+			_scannedSpentCount = BRSetCount(raw->spentOutputs);
+
+			if (prevBalance < balance) raw->totalReceived += balance - prevBalance;
+			if (balance < prevBalance) raw->totalSent += prevBalance - balance;
+			array_add(raw->balanceHist, balance);
+			raw->balance = balance;
+		}
+
+		void BalanceEngine::push(ELAWallet *wallet, BRTransaction *transaction) {
+			_undo.push_back(Undo());
+			apply(wallet, transaction, &_undo.back());
+			_entries.push_back(Entry(transaction, transaction->blockHeight));
+			_appliedCount++;
+
+			if (_undo.size() > BALANCE_UNDO_LIMIT)
+				_undo.pop_front();
+		}
+
+		void BalanceEngine::revert(ELAWallet *wallet) {
+			BRWallet *raw = &wallet->Raw;
+			BRTransaction *tx = _entries.back().tx;
+			const Undo &undo = _undo.back();
+
+			array_set_count(raw->balanceHist, array_count(raw->balanceHist) - 1);
+
+			if (undo.state == Invalid) {
+				BRSetRemove(raw->invalidTx, tx);
+			} else {
+				if (undo.state == Pending)
+					BRSetRemove(raw->pendingTx, tx);
+
+				// removals went from the highest index down, put them back from the lowest one up, which leaves
+				// the outputs this transaction added at the end
+				for (size_t i = undo.utxosRemoved.size(); i > 0; i--) {
+					array_insert(raw->utxos, undo.utxosRemoved[i - 1].first, undo.utxosRemoved[i - 1].second);
+					indexUTXO(wallet, undo.utxosRemoved[i - 1].second);
+				}
+				for (size_t i = 0; i < undo.utxosAdded; i++) {
+					unindexUTXO(wallet, raw->utxos[array_count(raw->utxos) - 1]);
+					array_rm_last(raw->utxos);
+				}
+
+				for (size_t i = 0; i < undo.usedAddrs.size(); i++) {
+					BRSetRemove(raw->usedAddrs, undo.usedAddrs[i]);
+				}
+				_ownedUsedAddrs -= undo.ownedUsedAddrs;
+
+				for (size_t i = 0; i < undo.spentOutputs.size(); i++) {
+					BRSetRemove(raw->spentOutputs, undo.spentOutputs[i]);
+				}
+			}
+
+			raw->balance = undo.balance;
+			raw->totalSent = undo.totalSent;
+			raw->totalReceived = undo.totalReceived;
+			_scannedSpentCount = undo.scannedSpentCount;
+
+			_undo.pop_back();
+			_entries.pop_back();
+		}
+
+		size_t BalanceEngine::countOwnedUsedAddrs(ELAWallet *wallet) const {
+			BRWallet *raw = &wallet->Raw;
+			size_t count = 0;
+
+			if (wallet->IsSingleAddress)
+				return 0;
+
+			std::vector<void *> usedAddrs(BRSetCount(raw->usedAddrs));
+			BRSetAll(raw->usedAddrs, usedAddrs.data(), usedAddrs.size());
+			for (size_t i = 0; i < usedAddrs.size(); i++) {
+				if (BRSetContains(raw->allAddrs, usedAddrs[i]))
+					count++;
+			}
+
+			return count;
+		}
+
+		void BalanceEngine::indexUTXO(ELAWallet *wallet, const BRUTXO &utxo) {
+			if (!_indexed)
+				return;
+
+			ELATransaction *tx = (ELATransaction *) BRSetGet(wallet->Raw.allTx, &utxo.hash);
+			if (tx == nullptr || utxo.n >= tx->outputs.size())
+				return;
+
+			AddressBalance &addressBalance = _addressBalances[tx->outputs[utxo.n]->getRaw()->address];
+			addressBalance.balance += tx->outputs[utxo.n]->getAmount();
+			addressBalance.utxos.push_back(utxo);
+			_coins.insert(Coin(tx->outputs[utxo.n]->getAmount(), utxo, tx));
+		}
+
+		void BalanceEngine::unindexUTXO(ELAWallet *wallet, const BRUTXO &utxo) {
+			if (!_indexed)
+				return;
+
+			ELATransaction *tx = (ELATransaction *) BRSetGet(wallet->Raw.allTx, &utxo.hash);
+			if (tx == nullptr || utxo.n >= tx->outputs.size())
+				return;
+
+			_coins.erase(Coin(tx->outputs[utxo.n]->getAmount(), utxo, tx));
+
+			AddressBalanceMap::iterator it = _addressBalances.find(tx->outputs[utxo.n]->getRaw()->address);
+			if (it == _addressBalances.end())
+				return;
+
+			std::vector<BRUTXO> &utxos = it->second.utxos;
+			for (size_t i = utxos.size(); i > 0; i--) {
+				if (!BRUTXOEq(&utxos[i - 1], &utxo)) continue;
+				it->second.balance -= tx->outputs[utxo.n]->getAmount();
+				utxos.erase(utxos.begin() + (i - 1));
+				break;
+			}
+
+			if (utxos.empty())
+				_addressBalances.erase(it);
+		}
+
+		void BalanceEngine::rebuildIndexes(ELAWallet *wallet) {
+			_addressBalances.clear();
+			_coins.clear();
+			for (size_t i = 0; i < array_count(wallet->Raw.utxos); i++) {
+				indexUTXO(wallet, wallet->Raw.utxos[i]);
+			}
+		}
+
+	}
+}
@@ -0,0 +1,133 @@
+// Copyright (c) 2012-2018 The Elastos Open Source Project
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#ifndef __ELASTOS_SDK_BALANCEENGINE_H__
+#define __ELASTOS_SDK_BALANCEENGINE_H__
+
+#include <deque>
+#include <map>
+#include <string>
+#include <vector>
+#include <BRWallet.h>
+
+#include "CoinSelection.h"
+
+namespace Elastos {
+	namespace ElaWallet {
+
+		struct ELAWallet;
+
+		/*
+		 * Keeps the balance state of an ELAWallet (utxos, spentOutputs, invalidTx, pendingTx, usedAddrs,
+		 * balanceHist and the totals) in line with its sorted transaction list. An update reverts the
+		 * transactions from the first one that changed and applies the list from there, instead of replaying
+		 * every transaction. Unconfirmed transactions are re-evaluated on each update, their pending state
+		 * depends on the clock and the chain tip.
+		 *
+		 * Undo records are only kept for the last BALANCE_UNDO_LIMIT transactions. A change further back
+		 * (a deep reorg, or an old transaction found by a rescan) falls back to a full recompute, and so does
+		 * a newly generated address that outputs applied before already paid to.
+		 *
+		 * The UTXOs are also indexed by the address they pay to, each address with its running balance, so
+		 * per address balances don't scan the whole UTXO set, and ordered by amount for coin selection. Like
+		 * the rest of the state the indexes are only accessed with the wallet lock held.
+		 */
+		class BalanceEngine {
+		public:
+			struct AddressBalance {
+				AddressBalance() : balance(0) {}
+
+				uint64_t balance;
+				std::vector<BRUTXO> utxos;
+			};
+
+			typedef std::map<std::string, AddressBalance> AddressBalanceMap;
+
+		public:
+			BalanceEngine();
+
+			void update(ELAWallet *wallet);
+
+			void recompute(ELAWallet *wallet);
+
+			// the state of wallet->transactions[0, count) was restored from outside, e.g. from a snapshot
+			void reset(ELAWallet *wallet, size_t count);
+
+			// applies wallet->transactions[start, end) onto the containers of wallet, without undo records
+			static void replay(ELAWallet *wallet, size_t start, size_t end);
+
+			uint64_t getAddressBalance(const std::string &address) const;
+
+			// addresses that have UTXOs, in address order
+			const AddressBalanceMap &getAddressBalances() const;
+
+			const CoinSet &getCoins() const;
+
+			size_t getAppliedCount() const;
+
+			size_t getRecomputeCount() const;
+
+		private:
+			enum TxState {
+				Applied,
+				Invalid,
+				Pending
+			};
+
+			struct Entry {
+				Entry(BRTransaction *transaction, uint32_t height) : tx(transaction), blockHeight(height) {}
+
+				BRTransaction *tx;
+				uint32_t blockHeight;
+			};
+
+			struct Undo {
+				Undo() : state(Applied), balance(0), totalSent(0), totalReceived(0), utxosAdded(0), ownedUsedAddrs(0),
+					scannedSpentCount(0) {}
+
+				TxState state;
+				uint64_t balance, totalSent, totalReceived;
+				std::vector<const BRTxInput *> spentOutputs;
+				std::vector<const char *> usedAddrs;
+				size_t utxosAdded;
+				// in removal order, each with its index at the time it was removed
+				std::vector<std::pair<size_t, BRUTXO> > utxosRemoved;
+				size_t ownedUsedAddrs;
+				size_t scannedSpentCount;
+			};
+
+			void apply(ELAWallet *wallet, BRTransaction *transaction, Undo *undo);
+
+			void push(ELAWallet *wallet, BRTransaction *transaction);
+
+			void revert(ELAWallet *wallet);
+
+			size_t countOwnedUsedAddrs(ELAWallet *wallet) const;
+
+			void indexUTXO(ELAWallet *wallet, const BRUTXO &utxo);
+
+			void unindexUTXO(ELAWallet *wallet, const BRUTXO &utxo);
+
+			void rebuildIndexes(ELAWallet *wallet);
+
+		private:
+			std::vector<Entry> _entries;
+			// undo records of the last _undo.size() entries
+			std::deque<Undo> _undo;
+			AddressBalanceMap _addressBalances;
+			CoinSet _coins;
+			// replay() only needs the wallet containers
+			bool _indexed;
+			size_t _allAddrsCount;
+			size_t _ownedUsedAddrs;
+			// size of the spent output set when the UTXO set was last checked against it
+			size_t _scannedSpentCount;
+			size_t _appliedCount;
+			size_t _recomputeCount;
+		};
+
+	}
+}
+
+#endif //__ELASTOS_SDK_BALANCEENGINE_H__
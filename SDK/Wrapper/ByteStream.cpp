@@ -1,55 +1,96 @@
+#include <new>
+
 #include "CMemBlock.h"
 #include "ByteStream.h"
 #include "BRAddress.h"
 
+#define BYTESTREAM_MIN_CAPACITY 64
+
 namespace Elastos {
 	namespace ElaWallet {
 
+		static inline uint16_t byteSwap(uint16_t v) {
+			return __builtin_bswap16(v);
+		}
+
+		static inline uint32_t byteSwap(uint32_t v) {
+			return __builtin_bswap32(v);
+		}
+
+		static inline uint64_t byteSwap(uint64_t v) {
+			return __builtin_bswap64(v);
+		}
+
+		// converts between host order and the given order, the same way in both directions
+		template<class T>
+		static inline T toByteOrder(T v, bool bigEndian) {
+#if defined(__BYTE_ORDER__) && __BYTE_ORDER__ == __ORDER_BIG_ENDIAN__
+			return bigEndian ? v : byteSwap(v);
+#else
+			return bigEndian ? byteSwap(v) : v;
+#endif
+		}
 
 		ByteStream::ByteStream(bool isBe)
-				: _pos(0), _count(0), _size(0), _buf(nullptr), _autorelease(true) ,_isBe(isBe) {
+				: _pos(0), _count(0), _size(0), _buf(nullptr), _autorelease(true) ,_isBe(isBe), _error(false) {
 		}
 
 		ByteStream::ByteStream(uint64_t size, bool isBe)
-				: _pos(0), _count(0), _size(size), _buf(new uint8_t[size]), _autorelease(true) ,_isBe(isBe) {
-			memset(_buf, 0, sizeof(uint8_t) * size);
+				: _pos(0), _count(0), _size(0), _buf(nullptr), _autorelease(true) ,_isBe(isBe), _error(false) {
+			ensureCapacity(size);
 		}
 
 		ByteStream::ByteStream(uint8_t *buf, uint64_t size, bool autorelease, bool isBe)
-				: _pos(0), _count(size), _size(size), _buf(buf), _autorelease(autorelease) ,_isBe(isBe) {}
+				: _pos(0), _count(size), _size(size), _buf(buf), _autorelease(autorelease) ,_isBe(isBe),
+				  _error(false) {}
+
+		ByteStream::ByteStream(const uint8_t *buf, size_t size)
+				: _pos(0), _count(size), _size(size), _buf(const_cast<uint8_t *>(buf)), _autorelease(false),
+				  _isBe(false), _error(false) {}
 
 		ByteStream::~ByteStream() {
 			if (_autorelease) {
-				delete[]_buf;
+				free(_buf);
 				_buf = nullptr;
 			}
 
 		}
 
 		void ByteStream::ensureCapacity(uint64_t newsize) {
-			if ((int64_t)(newsize - _size) > 0) {
-				uint64_t oldCapacity = _size;
-				uint64_t newCapacity = oldCapacity << 1;
-				int64_t diff = newCapacity - newsize;
-				if (diff < 0)
-					newCapacity = newsize;
-				if (newCapacity <= 0) {
-					if (newsize <= 0) // overflow
-						return;
-					newCapacity = UINT64_MAX;
-				}
-				uint8_t *newBuf = new uint8_t[newCapacity];
-				memset(newBuf, 0, newCapacity);
-				memcpy(newBuf, _buf, oldCapacity);
-				delete[] _buf;
-				_buf = newBuf;
-				_size = newCapacity;
+			// a borrowed buffer is never written, the data moves into a buffer of our own
+			if (newsize <= _size && _autorelease)
+				return;
+
+			uint64_t newCapacity = _size < BYTESTREAM_MIN_CAPACITY ? BYTESTREAM_MIN_CAPACITY : _size;
+			while (newCapacity < newsize && newCapacity <= UINT64_MAX / 2)
+				newCapacity <<= 1;
+			if (newCapacity < newsize)
+				newCapacity = newsize;
+			if (newCapacity > SIZE_MAX)
+				throw std::bad_alloc();
+
+			// the new space is left uninitialized, only [0, _count) is ever read
+			uint8_t *newBuf;
+			if (_autorelease) {
+				newBuf = (uint8_t *) realloc(_buf, (size_t) newCapacity);
+			} else {
+				newBuf = (uint8_t *) malloc((size_t) newCapacity);
+				if (newBuf != nullptr && _count > 0)
+					memcpy(newBuf, _buf, (size_t) _count);
 			}
+			if (newBuf == nullptr)
+				throw std::bad_alloc();
+
+			_buf = newBuf;
+			_size = newCapacity;
+			_autorelease = true;
 		}
 
 		bool ByteStream::checkSize(uint64_t readSize) {
-			if (_pos + readSize > _count)
+			if (_error || _pos > _count || readSize > _count - _pos) {
+				_error = true;
 				return false;
+			}
 			return true;
 		}
 
@@ -57,24 +98,30 @@ namespace Elastos {
 			_pos = position;
 		}
 
-		uint64_t ByteStream::position() {
+		uint64_t ByteStream::position() const {
 			return _pos;
 		}
 
-		uint64_t ByteStream::length() {
+		uint64_t ByteStream::length() const {
 			return _count;
 		}
 
+		bool ByteStream::good() const {
+			return !_error;
+		}
+
+		const uint8_t *ByteStream::data() const {
+			return _buf;
+		}
+
 		void ByteStream::put(uint8_t byte) {
-			ensureCapacity(position() + sizeof(uint8_t));
-			_buf[_pos++] = byte;
-			_count = _pos;
+			writeUint8(byte);
 		}
 
 		uint8_t ByteStream::get() {
-			if (!checkSize(sizeof(uint8_t)))
-				return 0;
-			return _buf[_pos++];
+			uint8_t v = 0;
+			readUint8(v);
+			return v;
 		}
 
 		uint8_t ByteStream::getUByte() {
@@ -82,316 +129,104 @@ namespace Elastos {
 		}
 
 		int8_t ByteStream::getByte() {
-			if (!checkSize(sizeof(uint8_t)))
-				return 0;
-			return _buf[_pos++];
+			return (int8_t) get();
 		}
 
 		void ByteStream::putShort(int16_t v) {
-			ensureCapacity(position() + sizeof(int16_t));
-			if (_isBe) {
-				_buf[_pos++] = (v >> 8) & 0xff;
-				_buf[_pos++] = v & 0xff;
-			}
-			else {
-				_buf[_pos++] = (v) & 0xff;
-				_buf[_pos++] = (v >> 8) & 0xff;
-			}
-			_count = _pos;
+			writeUint16((uint16_t) v, _isBe ? BigEndian : LittleEndian);
 		}
 
 		void ByteStream::putUint16(uint16_t v) {
-			ensureCapacity(position() + sizeof(uint16_t));
-			if (_isBe) {
-				_buf[_pos++] = (v >> 8) & 0xff;
-				_buf[_pos++] = v & 0xff;
-			}
-			else {
-				_buf[_pos++] = v & 0xff;
-				_buf[_pos++] = (v >> 8) & 0xff;
-			}
-			_count = _pos;
+			writeUint16(v, _isBe ? BigEndian : LittleEndian);
 		}
 
 		int16_t ByteStream::getShort() {
-			if (!checkSize(sizeof(int16_t)))
-				return 0;
-			if (_isBe) {
-				int16_t r1 = (int16_t) _buf[_pos++] << 8;
-				int16_t r2 = (int16_t) _buf[_pos++];
-				int16_t ret = r1 | r2;
-				return ret;
-			}
-			else {
-				int16_t r1 = (int16_t) _buf[_pos++];
-				int16_t r2 = (int16_t) _buf[_pos++] << 8;
-				int16_t ret = r1 | r2;
-				return ret;
-			}
+			return (int16_t) getUint16();
 		}
 
 		uint16_t ByteStream::getUint16() {
-			if (!checkSize(sizeof(uint16_t)))
-				return 0;
-			if (_isBe) {
-				uint16_t r1 = (uint16_t) _buf[_pos++] << 8;
-				uint16_t r2 = (uint16_t) _buf[_pos++];
-				uint16_t ret = r1 | r2;
-				return ret;
-			}
-			else {
-				uint16_t r1 = (uint16_t) _buf[_pos++];
-				uint16_t r2 = (uint16_t) _buf[_pos++] << 8;
-				uint16_t ret = r1 | r2;
-				return ret;
-			}
+			uint16_t v = 0;
+			readUint16(v, _isBe ? BigEndian : LittleEndian);
+			return v;
 		}
 
 		void ByteStream::putInt(int32_t v) {
-			ensureCapacity(position() + sizeof(int32_t));
-			if (_isBe) {
-				_buf[_pos++] = (v >> 24) & 0xff;
-				_buf[_pos++] = (v >> 16) & 0xff;
-				_buf[_pos++] = (v >> 8) & 0xff;
-				_buf[_pos++] = v & 0xff;
-			}
-			else {
-				_buf[_pos++] = v & 0xff;
-				_buf[_pos++] = (v >> 8) & 0xff;
-				_buf[_pos++] = (v >> 16) & 0xff;
-				_buf[_pos++] = (v >> 24) & 0xff;
-			}
-			_count = _pos;
+			writeUint32((uint32_t) v, _isBe ? BigEndian : LittleEndian);
 		}
 
 		void ByteStream::putUint32(uint32_t v) {
-			ensureCapacity(position() + sizeof(uint32_t));
-			if (_isBe) {
-				_buf[_pos++] = (v >> 24) & 0xff;
-				_buf[_pos++] = (v >> 16) & 0xff;
-				_buf[_pos++] = (v >> 8) & 0xff;
-				_buf[_pos++] = v & 0xff;
-			}
-			else {
-				_buf[_pos++] = v & 0xff;
-				_buf[_pos++] = (v >> 8) & 0xff;
-				_buf[_pos++] = (v >> 16) & 0xff;
-				_buf[_pos++] = (v >> 24) & 0xff;
-			}
-			_count = _pos;
+			writeUint32(v, _isBe ? BigEndian : LittleEndian);
 		}
 
 		int32_t ByteStream::getInt() {
-			if (!checkSize(sizeof(int32_t)))
-				return 0;
-			if (_isBe) {
-				int32_t ret = (int32_t) _buf[_pos++] << 24;
-				ret |= (int32_t) _buf[_pos++] << 16;
-				ret |= (int32_t) _buf[_pos++] << 8;
-				ret |= (int32_t) _buf[_pos++];
-				return ret;
-			}
-			else {
-				int32_t ret = (int32_t) _buf[_pos++];
-				ret |= (int32_t) _buf[_pos++] << 8;
-				ret |= (int32_t) _buf[_pos++] << 16;
-				ret |= (int32_t) _buf[_pos++] << 24;
-				return ret;
-			}
+			return (int32_t) getUint32();
 		}
 
 		uint32_t ByteStream::getUint32() {
-			if (!checkSize(sizeof(uint32_t)))
-				return 0;
-			if (_isBe) {
-				uint32_t ret = (uint32_t) _buf[_pos++] << 24;
-				ret |= (int32_t) _buf[_pos++] << 16;
-				ret |= (int32_t) _buf[_pos++] << 8;
-				ret |= (int32_t) _buf[_pos++];
-				return ret;
-			}
-			else {
-				uint32_t ret = (uint32_t) _buf[_pos++];
-				ret |= (int32_t) _buf[_pos++] << 8;
-				ret |= (int32_t) _buf[_pos++] << 16;
-				ret |= (int32_t) _buf[_pos++] << 24;
-				return ret;
-			}
+			uint32_t v = 0;
+			readUint32(v, _isBe ? BigEndian : LittleEndian);
+			return v;
 		}
 
 		void ByteStream::getInts(int32_t *buf, int32_t len) {
-			if (!checkSize(sizeof(int32_t) * len))
+			if (len <= 0 || !checkSize(sizeof(int32_t) * (uint64_t) len))
 				return;
-			if (_isBe) {
-				for (int32_t i = 0; i < len; i++) {
-					buf[i] = (int32_t) _buf[_pos++] << 24;
-					buf[i] |= (int32_t) _buf[_pos++] << 16;
-					buf[i] |= (int32_t) _buf[_pos++] << 8;
-					buf[i] |= (int32_t) _buf[_pos++];
-				}
-			}
-			else {
-				for (int32_t i = 0; i < len; i++) {
-					buf[i] = (int32_t) _buf[_pos++];
-					buf[i] |= (int32_t) _buf[_pos++] << 8;
-					buf[i] |= (int32_t) _buf[_pos++] << 16;
-					buf[i] |= (int32_t) _buf[_pos++] << 24;
-				}
-			}
+			memcpy(buf, &_buf[_pos], sizeof(int32_t) * len);
+			for (int32_t i = 0; i < len; i++)
+				buf[i] = (int32_t) toByteOrder((uint32_t) buf[i], _isBe);
+			_pos += sizeof(int32_t) * len;
 		}
 
 		void ByteStream::putLong(int64_t v) {
-			ensureCapacity(position() + sizeof(int64_t));
-			if (_isBe) {
-				_buf[_pos++] = (v >> 56) & 0xff;
-				_buf[_pos++] = (v >> 48) & 0xff;
-				_buf[_pos++] = (v >> 40) & 0xff;
-				_buf[_pos++] = (v >> 32) & 0xff;
-				_buf[_pos++] = (v >> 24) & 0xff;
-				_buf[_pos++] = (v >> 16) & 0xff;
-				_buf[_pos++] = (v >> 8) & 0xff;
-				_buf[_pos++] = v & 0xff;
-			}
-			else {
-				_buf[_pos++] = v & 0xff;
-				_buf[_pos++] = (v >> 8) & 0xff;
-				_buf[_pos++] = (v >> 16) & 0xff;
-				_buf[_pos++] = (v >> 24) & 0xff;
-				_buf[_pos++] = (v >> 32) & 0xff;
-				_buf[_pos++] = (v >> 40) & 0xff;
-				_buf[_pos++] = (v >> 48) & 0xff;
-				_buf[_pos++] = (v >> 56) & 0xff;
-			}
-			_count = _pos;
+			writeUint64((uint64_t) v, _isBe ? BigEndian : LittleEndian);
 		}
 
 		void ByteStream::putUint64(uint64_t v) {
-			ensureCapacity(position() + sizeof(uint64_t));
-			if (_isBe) {
-				_buf[_pos++] = (v >> 56) & 0xff;
-				_buf[_pos++] = (v >> 48) & 0xff;
-				_buf[_pos++] = (v >> 40) & 0xff;
-				_buf[_pos++] = (v >> 32) & 0xff;
-				_buf[_pos++] = (v >> 24) & 0xff;
-				_buf[_pos++] = (v >> 16) & 0xff;
-				_buf[_pos++] = (v >> 8) & 0xff;
-				_buf[_pos++] = v & 0xff;
-			}
-			else {
-				_buf[_pos++] = v & 0xff;
-				_buf[_pos++] = (v >> 8) & 0xff;
-				_buf[_pos++] = (v >> 16) & 0xff;
-				_buf[_pos++] = (v >> 24) & 0xff;
-				_buf[_pos++] = (v >> 32) & 0xff;
-				_buf[_pos++] = (v >> 40) & 0xff;
-				_buf[_pos++] = (v >> 48) & 0xff;
-				_buf[_pos++] = (v >> 56) & 0xff;
-			}
-			_count = _pos;
+			writeUint64(v, _isBe ? BigEndian : LittleEndian);
 		}
 
 		int64_t ByteStream::getLong() {
-
-			if (!checkSize(sizeof(int64_t)))
-				return 0;
-			uint64_t ret = 0;
-			if (_isBe) {
-				ret = (int64_t) _buf[_pos++] << 56;
-				ret |= (int64_t) _buf[_pos++] << 48;
-				ret |= (int64_t) _buf[_pos++] << 40;
-				ret |= (int64_t) _buf[_pos++] << 32;
-				ret |= (int64_t) _buf[_pos++] << 24;
-				ret |= (int64_t) _buf[_pos++] << 16;
-				ret |= (int64_t) _buf[_pos++] << 8;
-				ret |= (int64_t) _buf[_pos++];
-			}
-			else {
-				ret = (int64_t) _buf[_pos++];
-				ret |= (int64_t) _buf[_pos++] << 8;
-				ret |= (int64_t) _buf[_pos++] << 16;
-				ret |= (int64_t) _buf[_pos++] << 24;
-				ret |= (int64_t) _buf[_pos++] << 32;
-				ret |= (int64_t) _buf[_pos++] << 40;
-				ret |= (int64_t) _buf[_pos++] << 48;
-				ret |= (int64_t) _buf[_pos++] << 56;
-			}
-			return ret;
+			return (int64_t) getUint64();
 		}
 
 		uint64_t ByteStream::getUint64() {
-			if (!checkSize(sizeof(uint64_t)))
-				return 0;
-			uint64_t ret = 0;
-			if (_isBe) {
-				ret = (int64_t) _buf[_pos++] << 56;
-				ret |= (int64_t) _buf[_pos++] << 48;
-				ret |= (int64_t) _buf[_pos++] << 40;
-				ret |= (int64_t) _buf[_pos++] << 32;
-				ret |= (int64_t) _buf[_pos++] << 24;
-				ret |= (int64_t) _buf[_pos++] << 16;
-				ret |= (int64_t) _buf[_pos++] << 8;
-				ret |= (int64_t) _buf[_pos++];
-			}
-			else {
-				ret = (int64_t) _buf[_pos++];
-				ret |= (int64_t) _buf[_pos++] << 8;
-				ret |= (int64_t) _buf[_pos++] << 16;
-				ret |= (int64_t) _buf[_pos++] << 24;
-				ret |= (int64_t) _buf[_pos++] << 32;
-				ret |= (int64_t) _buf[_pos++] << 40;
-				ret |= (int64_t) _buf[_pos++] << 48;
-				ret |= (int64_t) _buf[_pos++] << 56;
-			}
-			return ret;
+			uint64_t v = 0;
+			readUint64(v, _isBe ? BigEndian : LittleEndian);
+			return v;
 		}
 
 		void ByteStream::putBytes(const uint8_t *byte, uint64_t len) {
-			ensureCapacity(position() + sizeof(uint8_t) * len);
-			memcpy(&_buf[position()], byte, len);
-			_pos += len;
-			_count = _pos;
+			writeBytes(byte, (size_t) len);
 		}
 
 		void ByteStream::getBytes(uint8_t *buf, uint64_t len) {
-			if (!checkSize(sizeof(uint8_t) * len))
-				return;
-			memcpy(buf, &_buf[_pos], len);
-			_pos += len;
+			readBytes(buf, (size_t) len);
 		}
 
 		uint64_t ByteStream::getVarUint() {
-			size_t len = 0;
-			uint8_t tbuff[sizeof(uint8_t)*9];
-			memcpy(tbuff, &_buf[_pos], sizeof(tbuff));
-			uint64_t value = BRVarInt(tbuff, sizeof(tbuff), &len);
-			getBytes(tbuff, len);
+			uint64_t value = 0;
+			readVarUint(value);
 			return value;
 		}
 
 		void ByteStream::putUTF8(const char *str) {
-			int len = 0;
-			int idx = 0;
-			while (str[idx] != '\0') {
-				len++;
-				idx++;
-			}
-			putShort(len);
-			putBytes((uint8_t *) str, len);
+			size_t len = strlen(str);
+			putShort((int16_t) len);
+			putBytes((const uint8_t *) str, len);
 		}
 
 		void ByteStream::putVarUint(uint64_t value) {
-			uint8_t tbuff[sizeof(uint8_t)*9];
-			uint64_t len = BRVarIntSet(tbuff, sizeof(tbuff), value);
-			putBytes(tbuff, len);
+			writeVarUint(value);
 		}
 
 		char *ByteStream::getUTF8(int32_t &len) {
 			short utfLen = getShort();
+			if (utfLen < 0)
+				utfLen = 0;
 			char *utfBuffer = new char[utfLen + 1];
-			if (!checkSize(utfLen)) {
+			if (!readBytes(utfBuffer, (size_t) utfLen)) {
 				utfBuffer[0] = '\0';
 			} else {
-				getBytes((uint8_t *) utfBuffer, utfLen);
 				utfBuffer[utfLen] = '\0';
 			}
 
@@ -400,10 +235,8 @@ namespace Elastos {
 			return utfBuffer;
 		}
 
-		uint64_t ByteStream::availableSize() {
-			uint64_t ret = _size - _count;
-
-			return ((int64_t)ret) < 0 ? 0 : ret;
+		uint64_t ByteStream::availableSize() const {
+			return _size > _count ? _size - _count : 0;
 		}
 
 		char *ByteStream::getUTF8() {
@@ -417,23 +250,43 @@ namespace Elastos {
 			}
 
 			CMBlock buff((size_t)_count);
-			memcpy(buff, _buf, _count);
+			memcpy(buff, _buf, (size_t)_count);
+			return buff;
+		}
+
+		CMBlock ByteStream::takeBuffer() {
+			if (!_autorelease || _count <= 0) {
+				CMBlock buff = getBuffer();
+				reset();
+				return buff;
+			}
+
+			// shrinking in place, the block may be kept for long
+			uint8_t *buf = (uint8_t *) realloc(_buf, (size_t) _count);
+			if (buf == nullptr)
+				buf = _buf;
+
+			CMBlock buff;
+			buff.SetMem(buf, (size_t) _count);
+			_buf = nullptr;
+			reset();
 			return buff;
 		}
 
 		void ByteStream::skip(int bytes) {
-			if (checkSize(bytes))
+			if (bytes >= 0 && checkSize((uint64_t) bytes))
 				_pos += bytes;
 		}
 
 		void ByteStream::reset() {
 			this->setPosition(0);
 			this->_size = 0;
-			if (this->_buf != nullptr) {
-				delete[] this->_buf;
-				this->_buf = nullptr;
-			}
+			if (this->_autorelease)
+				free(this->_buf);
+			this->_buf = nullptr;
+			this->_autorelease = true;
 			this->_count = 0;
+			this->_error = false;
 		}
 
 		void ByteStream::increasePosition(size_t len) {
@@ -449,27 +302,39 @@ namespace Elastos {
 		}
 
 		bool ByteStream::readUint16(uint16_t &val, ByteOrder byteOrder) {
-			return readBytes(&val, sizeof(uint16_t), byteOrder);
+			if (!readBytes(&val, sizeof(uint16_t)))
+				return false;
+			val = toByteOrder(val, byteOrder == BigEndian);
+			return true;
 		}
 
 		void ByteStream::writeUint16(uint16_t val, ByteOrder byteOrder) {
-			writeBytes(&val, sizeof(uint16_t), byteOrder);
+			val = toByteOrder(val, byteOrder == BigEndian);
+			writeBytes(&val, sizeof(uint16_t));
 		}
 
 		bool ByteStream::readUint32(uint32_t &val, ByteOrder byteOrder) {
-			return readBytes(&val, sizeof(uint32_t), byteOrder);
+			if (!readBytes(&val, sizeof(uint32_t)))
+				return false;
+			val = toByteOrder(val, byteOrder == BigEndian);
+			return true;
 		}
 
 		void ByteStream::writeUint32(uint32_t val, ByteOrder byteOrder) {
-			writeBytes(&val, sizeof(uint32_t), byteOrder);
+			val = toByteOrder(val, byteOrder == BigEndian);
+			writeBytes(&val, sizeof(uint32_t));
 		}
 
 		bool ByteStream::readUint64(uint64_t &val, ByteOrder byteOrder) {
-			return readBytes(&val, sizeof(uint64_t), byteOrder);
+			if (!readBytes(&val, sizeof(uint64_t)))
+				return false;
+			val = toByteOrder(val, byteOrder == BigEndian);
+			return true;
 		}
 
 		void ByteStream::writeUint64(uint64_t val, ByteOrder byteOrder) {
-			writeBytes(&val, sizeof(uint64_t), byteOrder);
+			val = toByteOrder(val, byteOrder == BigEndian);
+			writeBytes(&val, sizeof(uint64_t));
 		}
 
 		bool ByteStream::readBytes(void *buf, size_t len, ByteOrder byteOrder) {
@@ -478,7 +343,7 @@ namespace Elastos {
 
 			size_t pos = position();
 
-			if (buf != nullptr) {
+			if (buf != nullptr && len > 0) {
 				if (byteOrder == LittleEndian) {
 					memcpy(buf, &_buf[pos], len);
 				} else {
@@ -499,10 +364,11 @@ namespace Elastos {
 			size_t pos = position();
 
 			if (byteOrder == LittleEndian) {
-				memcpy(&_buf[pos], buf, len);
+				if (len > 0)
+					memcpy(&_buf[pos], buf, len);
 			} else {
 				for (size_t i = 0; i < len; ++i) {
-					_buf[pos + i] = ((uint8_t *)buf)[len - i - 1];
+					_buf[pos + i] = ((const uint8_t *)buf)[len - i - 1];
 				}
 			}
 
@@ -511,13 +377,28 @@ namespace Elastos {
 		}
 
 		bool ByteStream::readVarBytes(CMBlock &bytes) {
+			const uint8_t *data = nullptr;
+			size_t len = 0;
+			if (!readVarBytes(data, len)) {
+				return false;
+			}
+
+			bytes.Resize(len);
+			if (len > 0)
+				memcpy(bytes, data, len);
+			return true;
+		}
+
+		bool ByteStream::readVarBytes(const uint8_t *&bytes, size_t &len) {
 			uint64_t length = 0;
-			if (!readVarUint(length)) {
+			if (!readVarUint(length) || !checkSize(length)) {
 				return false;
 			}
 
-			bytes.Resize((size_t)length);
-			return readBytes(bytes, bytes.GetSize());
+			bytes = &_buf[_pos];
+			len = (size_t)length;
+			increasePosition(len);
+			return true;
 		}
 
 		void ByteStream::writeVarBytes(const void *bytes, size_t len) {
@@ -531,9 +412,16 @@ namespace Elastos {
 		}
 
 		bool ByteStream::readVarUint(uint64_t &value) {
+			if (!checkSize(1))
+				return false;
+
 			size_t len = 0;
-			value = BRVarInt(&_buf[_pos], 9, &len);
-			return readBytes(nullptr, len);
+			uint64_t v = BRVarInt(&_buf[_pos], (size_t)(_count - _pos), &len);
+			if (!readBytes(nullptr, len))
+				return false;
+
+			value = v;
+			return true;
 		}
 
 		void ByteStream::writeVarUint(uint64_t value) {
@@ -547,23 +435,25 @@ namespace Elastos {
 		}
 
 		bool ByteStream::readVarString(char *str, size_t strSize) {
-			CMBlock bytes;
-			if (!readVarBytes(bytes)) {
+			const uint8_t *bytes = nullptr;
+			size_t len = 0;
+			if (!readVarBytes(bytes, len)) {
 				return false;
 			}
-			size_t len = bytes.GetSize() > strSize - 1 ? strSize - 1 : bytes.GetSize();
-			strncpy(str, (const char *)(const void *)bytes, len);
+			len = len > strSize - 1 ? strSize - 1 : len;
+			strncpy(str, (const char *)bytes, len);
 			str[len] = '\0';
 
 			return true;
 		}
 
 		bool ByteStream::readVarString(std::string &str) {
-			CMBlock bytes;
-			if (!readVarBytes(bytes)) {
+			const uint8_t *bytes = nullptr;
+			size_t len = 0;
+			if (!readVarBytes(bytes, len)) {
 				return false;
 			}
-			str = std::string((const char *)(const void *)bytes, (size_t)bytes.GetSize());
+			str.assign((const char *)bytes, len);
 
 			return true;
 		}
@@ -576,5 +466,17 @@ namespace Elastos {
 			writeVarBytes(str.c_str(), str.length());
 		}
 
+		size_t ByteStream::varUintSize(uint64_t value) {
+			return BRVarIntSize(value);
+		}
+
+		size_t ByteStream::varBytesSize(size_t len) {
+			return varUintSize(len) + len;
+		}
+
+		size_t ByteStream::varStringSize(const std::string &str) {
+			return varBytesSize(str.length());
+		}
+
 	}
-}
\ No newline at end of file
+}
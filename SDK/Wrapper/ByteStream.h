@@ -10,6 +10,12 @@
 namespace Elastos {
 	namespace ElaWallet {
 
+		/*
+		 * Reads and writes serialized data. A stream either owns a malloc'd buffer that grows geometrically as it
+		 * is written, or reads a borrowed buffer that is never freed; writing to a borrowed buffer moves the data
+		 * into a buffer of its own first. A read past the end fails and leaves the stream failed, every read after
+		 * it fails too, so a deserializer may check good() once instead of after every field.
+		 */
 		class ByteStream {
 			enum ByteOrder {
 				LittleEndian,
@@ -21,8 +27,12 @@ namespace Elastos {
 
 			ByteStream(uint64_t size, bool isBe = false);
 
+			// an owned buf must be allocated with malloc, it is freed with free
 			ByteStream(uint8_t *buf, uint64_t size, bool autorelease = true, bool isBe = false);
 
+			// reads buf in place, buf must outlive the stream
+			ByteStream(const uint8_t *buf, size_t size);
+
 			~ByteStream();
 
 		public:
@@ -30,16 +40,26 @@ namespace Elastos {
 
 			void setPosition(uint64_t position);
 
-			uint64_t position();
+			uint64_t position() const;
 
-			uint64_t length();
+			uint64_t length() const;
 
-			uint64_t availableSize();
+			uint64_t availableSize() const;
 
 			void skip(int bytes);
 
+			// false once a read has run past the end
+			bool good() const;
+
+			// the bytes written so far, valid until the next write
+			const uint8_t *data() const;
+
+			// a copy of the bytes written so far
 			CMBlock getBuffer();
 
+			// hands the bytes written so far to the returned block without copying and leaves the stream empty
+			CMBlock takeBuffer();
+
 		public:
 			void put(uint8_t byte);
 
@@ -105,6 +125,8 @@ namespace Elastos {
 			bool readBytes(void *buf, size_t len, ByteOrder byteOrder = LittleEndian);
 			void writeBytes(const void *buf, size_t len, ByteOrder byteOrder = LittleEndian);
 			bool readVarBytes(CMBlock &bytes);
+			// bytes points into the stream, it is valid as long as the data read is
+			bool readVarBytes(const uint8_t *&bytes, size_t &len);
 			void writeVarBytes(const void *bytes, size_t len);
 			void writeVarBytes(const CMBlock &bytes);
 			bool readVarUint(uint64_t &value);
@@ -114,8 +136,17 @@ namespace Elastos {
 			void writeVarString(const char *str);
 			void writeVarString(const std::string &str);
 
+			// bytes written by writeVarUint(), writeVarBytes() and writeVarString()
+			static size_t varUintSize(uint64_t value);
+			static size_t varBytesSize(size_t len);
+			static size_t varStringSize(const std::string &str);
+
 
 		private:
+			ByteStream(const ByteStream &);
+
+			ByteStream &operator=(const ByteStream &);
+
 			void ensureCapacity(uint64_t newsize);
 
 			bool checkSize(uint64_t readSize);
@@ -126,6 +157,7 @@ namespace Elastos {
 			uint8_t *_buf;
 			bool _autorelease;
 			bool _isBe;
+			bool _error;
 		};
 
 	}
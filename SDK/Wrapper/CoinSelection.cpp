@@ -0,0 +1,224 @@
+// Copyright (c) 2012-2018 The Elastos Open Source Project
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include <string.h>
+
+#include "BRAddress.h"
+#include "BRTransaction.h"
+
+#include "CoinSelection.h"
+#include "SDK/Transaction/TransactionOutput.h"
+
+namespace Elastos {
+	namespace ElaWallet {
+
+		bool Coin::operator<(const Coin &other) const {
+			if (amount != other.amount)
+				return amount < other.amount;
+
+			int r = memcmp(&utxo.hash, &other.utxo.hash, sizeof(utxo.hash));
+			if (r != 0)
+				return r < 0;
+
+			return utxo.n < other.utxo.n;
+		}
+
+		CoinSelection::CoinSelection(const CoinSet &coins, uint64_t amount, uint64_t feePerKb, size_t baseSize,
+									 const SpendableFilter &spendable) :
+			_coins(coins),
+			_amount(amount),
+			_feePerKb(feePerKb),
+			_baseSize(baseSize),
+			_spendable(spendable),
+			_selectedAmount(0),
+			_changeless(false),
+			_oversized(false),
+			_oversizedFee(0) {
+		}
+
+		const CoinSet &CoinSelection::getCoins() const {
+			return _coins;
+		}
+
+		bool CoinSelection::isSpendable(const Coin &coin) const {
+			return _spendable.empty() || _spendable(coin);
+		}
+
+		uint64_t CoinSelection::getAmount() const {
+			return _amount;
+		}
+
+		uint64_t CoinSelection::getFeePerKb() const {
+			return _feePerKb;
+		}
+
+		size_t CoinSelection::getSize(size_t inCount) const {
+			return _baseSize - BRVarIntSize(0) + BRVarIntSize(inCount) + inCount * TX_UNSIGNED_INPUT_SIZE;
+		}
+
+		uint64_t CoinSelection::getFee(size_t inCount) const {
+			// same rounding as Transaction::calculateFee()
+			return ((getSize(inCount) + 999) / 1000) * _feePerKb;
+		}
+
+		bool CoinSelection::add(const Coin &coin) {
+			if (getSize(_selected.size() + 1) + TX_RECHARGE_OUTPUT_SIZE > TX_MAX_SIZE) {
+				_oversized = true;
+				_oversizedFee = getFee(_selected.size() + 1) + _feePerKb;
+				return false;
+			}
+
+			_selected.push_back(coin);
+			_selectedAmount += coin.amount;
+			return true;
+		}
+
+		void CoinSelection::removeLast() {
+			_selectedAmount -= _selected.back().amount;
+			_selected.pop_back();
+		}
+
+		void CoinSelection::clear() {
+			_selected.clear();
+			_selectedAmount = 0;
+			_changeless = false;
+			_oversized = false;
+			_oversizedFee = 0;
+		}
+
+		const std::vector<Coin> &CoinSelection::getSelected() const {
+			return _selected;
+		}
+
+		uint64_t CoinSelection::getSelectedAmount() const {
+			return _selectedAmount;
+		}
+
+		uint64_t CoinSelection::getFee() const {
+			if (_changeless && _selectedAmount >= _amount)
+				return _selectedAmount - _amount;
+			return getFee(_selected.size());
+		}
+
+		bool CoinSelection::isEnough() const {
+			return _selectedAmount >= _amount + getFee(_selected.size());
+		}
+
+		void CoinSelection::setChangeless(bool changeless) {
+			_changeless = changeless;
+		}
+
+		bool CoinSelection::isChangeless() const {
+			return _changeless;
+		}
+
+		bool CoinSelection::isOversized() const {
+			return _oversized;
+		}
+
+		uint64_t CoinSelection::getOversizedFee() const {
+			return _oversizedFee;
+		}
+
+		bool ThresholdCoinSelection::select(CoinSelection &selection) const {
+			const CoinSet &coins = selection.getCoins();
+			uint64_t threshold = selection.getAmount() * 2 + selection.getFeePerKb();
+			BRUTXO first = {UINT256_ZERO, 0};
+
+			CoinSet::const_iterator split = threshold == UINT64_MAX ? coins.end() :
+											coins.lower_bound(Coin(threshold + 1, first, nullptr));
+
+			for (CoinSet::const_iterator it = split; it != coins.begin();) {
+				--it;
+				if (!selection.isSpendable(*it)) continue;
+				if (!selection.add(*it)) return false;
+				if (selection.isEnough()) return true;
+			}
+
+			for (CoinSet::const_iterator it = split; it != coins.end(); ++it) {
+				if (!selection.isSpendable(*it)) continue;
+				if (!selection.add(*it)) return false;
+				if (selection.isEnough()) return true;
+			}
+
+			return false;
+		}
+
+		bool BranchAndBoundCoinSelection::select(CoinSelection &selection) const {
+			if (search(selection))
+				return true;
+
+			selection.clear();
+			return ThresholdCoinSelection().select(selection);
+		}
+
+		bool BranchAndBoundCoinSelection::search(CoinSelection &selection) const {
+			const CoinSet &coins = selection.getCoins();
+			uint64_t amount = selection.getAmount(), feePerKb = selection.getFeePerKb();
+			// an excess up to the fee of a change output and of spending it later isn't worth the change
+			uint64_t costOfChange = ((TX_RECHARGE_OUTPUT_SIZE + TX_UNSIGNED_INPUT_SIZE) * feePerKb + 999) / 1000;
+
+			// an extra input raises the fee by at most feePerKb, coins above that always raise the excess, which
+			// is what makes cutting off a branch once the excess is too large safe
+			std::vector<Coin> candidates;
+			for (CoinSet::const_reverse_iterator it = coins.rbegin(); it != coins.rend(); ++it) {
+				if (it->amount > feePerKb && selection.isSpendable(*it))
+					candidates.push_back(*it);
+			}
+
+			std::vector<uint64_t> remaining(candidates.size() + 1, 0);
+			for (size_t i = candidates.size(); i > 0; i--) {
+				remaining[i - 1] = remaining[i] + candidates[i - 1].amount;
+			}
+
+			std::vector<size_t> included;
+			size_t i = 0;
+			for (size_t tries = 0; tries < COIN_SELECTION_MAX_TRIES; tries++) {
+				uint64_t selected = selection.getSelectedAmount();
+				uint64_t target = amount + selection.getFee(included.size());
+				bool backtrack = false;
+
+				if (selected + remaining[i] < target) {
+					backtrack = true; // can't reach the target with what is left
+				} else if (selected >= target) {
+					if (selected - target <= costOfChange) {
+						selection.setChangeless(true);
+						return true;
+					}
+					backtrack = true;
+				} else if (!selection.add(candidates[i])) {
+					backtrack = true;
+				} else {
+					included.push_back(i++);
+					continue;
+				}
+
+				if (included.empty())
+					return false;
+
+				// leave out the last coin taken, and the coins of the same amount after it, they lead to the
+				// same sums
+				size_t last = included.back();
+				included.pop_back();
+				selection.removeLast();
+				for (i = last + 1; i < candidates.size() && candidates[i].amount == candidates[last].amount; i++);
+			}
+
+			return false;
+		}
+
+		bool LargestFirstCoinSelection::select(CoinSelection &selection) const {
+			const CoinSet &coins = selection.getCoins();
+
+			for (CoinSet::const_reverse_iterator it = coins.rbegin(); it != coins.rend(); ++it) {
+				if (!selection.isSpendable(*it)) continue;
+				if (!selection.add(*it)) return false;
+				if (selection.isEnough()) return true;
+			}
+
+			return false;
+		}
+
+	}
+}
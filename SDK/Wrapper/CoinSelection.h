@@ -0,0 +1,141 @@
+// Copyright (c) 2012-2018 The Elastos Open Source Project
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#ifndef __ELASTOS_SDK_COINSELECTION_H__
+#define __ELASTOS_SDK_COINSELECTION_H__
+
+#include <set>
+#include <vector>
+#include <boost/function.hpp>
+#include <boost/shared_ptr.hpp>
+#include <BRWallet.h>
+
+#include "SDK/ELACoreExt/ELATransaction.h"
+
+#define COIN_SELECTION_MAX_TRIES 100000
+
+namespace Elastos {
+	namespace ElaWallet {
+
+		struct Coin {
+			Coin(uint64_t value, const BRUTXO &o, ELATransaction *transaction) :
+				amount(value), utxo(o), tx(transaction) {}
+
+			// ordered by amount, ties broken by outpoint so every UTXO is a distinct key
+			bool operator<(const Coin &other) const;
+
+			uint64_t amount;
+			BRUTXO utxo;
+			ELATransaction *tx;
+		};
+
+		typedef std::set<Coin> CoinSet;
+
+		/*
+		 * State of one coin selection: the amount-ordered candidates, the coins taken so far and the size and
+		 * fee of the unsigned transaction with that many inputs. The size grows by TX_UNSIGNED_INPUT_SIZE per
+		 * input (plus the input count prefix), so strategies never have to serialize the transaction.
+		 */
+		class CoinSelection {
+		public:
+			typedef boost::function<bool(const Coin &coin)> SpendableFilter;
+
+			// baseSize is the serialized size of the transaction without inputs
+			CoinSelection(const CoinSet &coins, uint64_t amount, uint64_t feePerKb, size_t baseSize,
+						  const SpendableFilter &spendable = SpendableFilter());
+
+			const CoinSet &getCoins() const;
+
+			bool isSpendable(const Coin &coin) const;
+
+			uint64_t getAmount() const;
+
+			uint64_t getFeePerKb() const;
+
+			size_t getSize(size_t inCount) const;
+
+			uint64_t getFee(size_t inCount) const;
+
+			// false, and nothing added, if the input would push the transaction past TX_MAX_SIZE
+			bool add(const Coin &coin);
+
+			void removeLast();
+
+			void clear();
+
+			const std::vector<Coin> &getSelected() const;
+
+			uint64_t getSelectedAmount() const;
+
+			// fee of the current selection, all of the excess if it goes without a change output
+			uint64_t getFee() const;
+
+			bool isEnough() const;
+
+			// the excess is too small to pay for a change output and goes to the fee instead
+			void setChangeless(bool changeless);
+
+			bool isChangeless() const;
+
+			bool isOversized() const;
+
+			// fee of the transaction that hit TX_MAX_SIZE, including the input that didn't fit
+			uint64_t getOversizedFee() const;
+
+		private:
+			const CoinSet &_coins;
+			uint64_t _amount;
+			uint64_t _feePerKb;
+			size_t _baseSize;
+			SpendableFilter _spendable;
+
+			std::vector<Coin> _selected;
+			uint64_t _selectedAmount;
+			bool _changeless;
+			bool _oversized;
+			uint64_t _oversizedFee;
+		};
+
+		class ICoinSelectionStrategy {
+		public:
+			virtual ~ICoinSelectionStrategy() {}
+
+			// true if the selection covers the amount and the fee
+			virtual bool select(CoinSelection &selection) const = 0;
+		};
+
+		typedef boost::shared_ptr<ICoinSelectionStrategy> CoinSelectionStrategyPtr;
+
+		/*
+		 * The original wallet heuristic: coins up to amount * 2 + feePerKb from the largest down, so small
+		 * coins get consumed without spending many of them, then the larger coins from the smallest up.
+		 */
+		class ThresholdCoinSelection : public ICoinSelectionStrategy {
+		public:
+			virtual bool select(CoinSelection &selection) const;
+		};
+
+		/*
+		 * Depth first search for a set of coins that pays the amount and fee with an excess too small to be
+		 * worth a change output. Falls back to ThresholdCoinSelection when no such set is found within
+		 * COIN_SELECTION_MAX_TRIES steps.
+		 */
+		class BranchAndBoundCoinSelection : public ICoinSelectionStrategy {
+		public:
+			virtual bool select(CoinSelection &selection) const;
+
+		private:
+			bool search(CoinSelection &selection) const;
+		};
+
+		// fewest inputs: the largest coins first
+		class LargestFirstCoinSelection : public ICoinSelectionStrategy {
+		public:
+			virtual bool select(CoinSelection &selection) const;
+		};
+
+	}
+}
+
+#endif //__ELASTOS_SDK_COINSELECTION_H__
@@ -32,7 +32,8 @@ namespace Elastos {
 			_reconnectSeconds = reconnectSeconds;
 
 			if (_wallet == nullptr) {
-				_wallet = WalletPtr(new Wallet(loadTransactions(), _subAccount, createWalletListener()));
+				_wallet = WalletPtr(new Wallet(loadTransactions(), _subAccount, createWalletListener(),
+													   loadWalletSnapshot()));
 			}
 		}
 
@@ -136,6 +137,10 @@ namespace Elastos {
 			return SharedWrapperList<Peer, BRPeer *>();
 		}
 
+		CMBlock CoreWalletManager::loadWalletSnapshot() {
+			return CMBlock();
+		}
+
 		int CoreWalletManager::getForkId() const {
 			//todo complete me
 			return -1;
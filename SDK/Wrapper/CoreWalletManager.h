@@ -83,6 +83,9 @@ namespace Elastos {
 
 			virtual SharedWrapperList<Peer, BRPeer *> loadPeers();
 
+			// wallet balance state saved by a previous run, empty to replay all transactions
+			virtual CMBlock loadWalletSnapshot();
+
 			virtual int getForkId() const;
 
 			typedef boost::shared_ptr<PeerManager::Listener> PeerManagerListenerPtr;
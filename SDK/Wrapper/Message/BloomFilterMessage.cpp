@@ -40,8 +40,7 @@ namespace Elastos {
 			wrappedFilter.Serialize(byteStream);
 			((BRPeerContext *)peer)->sentFilter = 1;
 			((BRPeerContext *)peer)->sentMempool = 0;
-			CMBlock buf = byteStream.getBuffer();
-			BRPeerSendMessage(peer, buf, buf.GetSize(), MSG_FILTERLOAD);
+			BRPeerSendMessage(peer, byteStream.data(), byteStream.length(), MSG_FILTERLOAD);
 		}
 	}
 }
\ No newline at end of file
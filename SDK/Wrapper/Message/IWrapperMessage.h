@@ -18,6 +18,7 @@ namespace Elastos {
 
 			virtual ~IWrapperMessage();
 
+			// msg points into the connection's pooled receive buffer, it is only valid until Accept returns
 			virtual int Accept(BRPeer *peer, const uint8_t *msg, size_t msgLen) = 0;
 
 			virtual void Send(BRPeer *peer, void *serializable) = 0;
@@ -92,6 +92,10 @@ namespace Elastos {
 
 					if (ctx->needsFilterUpdate) blockCount = 0;
 
+					size_t requestCount = blockCount;
+					if (blockCount > 0 && BRPeerManagerScheduleBlocks(ctx->manager, peer, blockHashes, blockCount))
+						requestCount = 0; // the peer manager requests them from all its download peers
+
 					for (i = 0, j = 0; i < txCount; i++) {
 						UInt256Get(&hash, transactions[i]);
 
@@ -102,8 +106,8 @@ namespace Elastos {
 
 					peer_log(peer, "got inv with txCount=%zu, blockCount=%zu", j, blockCount);
 					BRPeerAddKnownTxHashes(peer, txHashes, j);
-					if (j > 0 || blockCount > 0)
-						ctx->manager->peerMessages->BRPeerSendGetdataMessage(peer, txHashes, j, blockHashes, blockCount);
+					if (j > 0 || requestCount > 0)
+						ctx->manager->peerMessages->BRPeerSendGetdataMessage(peer, txHashes, j, blockHashes, requestCount);
 
 					// to improve chain download performance, if we received 500 block hashes, request the next 500 block hashes
 					if (blockCount >= MAX_BLOCKS_COUNT) {
@@ -136,7 +140,7 @@ namespace Elastos {
 
 			if (txCount > 0) {
 				size_t i, off = 0, msgLen = sizeof(uint32_t) + (sizeof(uint32_t) + sizeof(*txHashes)) * txCount;
-				uint8_t msg[msgLen];
+				CMemBuffer<uint8_t> msg(msgLen);
 				UInt32SetLE(&msg[off], txCount);
 				off += sizeof(uint32_t);
 				for (size_t i = 0; i < txCount; i++) {
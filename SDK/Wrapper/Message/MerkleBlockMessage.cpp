@@ -25,8 +25,7 @@ namespace Elastos {
 
 		int MerkleBlockMessage::Accept(BRPeer *peer, const uint8_t *msg, size_t msgLen) {
 			BRPeerContext *ctx = (BRPeerContext *) peer;
-			// msg is holding by payload pointer create by malloc, do not match delete[] in ByteStream
-			ByteStream stream(const_cast<uint8_t *>(msg), msgLen, false);
+			ByteStream stream(msg, msgLen);
 
 			ELAPeerManager *elaPeerManager = (ELAPeerManager *)ctx->manager;
 
@@ -40,9 +39,10 @@ namespace Elastos {
 			}
 
 			BRMerkleBlock *blockRaw = block->getRawBlock();
+			std::vector<UInt256> hashes;
 			int r = 1;
 
-			if (!block->isValid((uint32_t) time(nullptr))) {
+			if (!block->isValid((uint32_t) time(nullptr), &hashes)) {
 				peer_log(peer, "error: invalid merkleblock: %s", Utils::UInt256ToString(block->getBlockHash(), true).c_str());
 				block->deleteRawBlock();
 				blockRaw = nullptr;
@@ -53,18 +53,10 @@ namespace Elastos {
 				blockRaw = nullptr;
 				r = 0;
 			} else {
-				size_t count = BRMerkleBlockTxHashes(block->getRawBlock(), NULL, 0);
-				UInt256 _hashes[(sizeof(UInt256) * count <= 0x1000) ? count : 0],
-						*hashes = (sizeof(UInt256) * count <= 0x1000) ? _hashes : (UInt256 *) malloc(
-						count * sizeof(*hashes));
-				assert(hashes != nullptr);
-				count = BRMerkleBlockTxHashes(block->getRawBlock(), hashes, count);
-				for (size_t i = count; i > 0; i--) { // reverse order for more efficient removal as tx arrive
+				for (size_t i = hashes.size(); i > 0; i--) { // reverse order for more efficient removal as tx arrive
 					if (BRSetContains(ctx->knownTxHashSet, &hashes[i - 1])) continue;
 					array_add(ctx->currentBlockTxHashes, hashes[i - 1]);
 				}
-
-				if (hashes != _hashes) free(hashes);
 			}
 
 			if (blockRaw) {
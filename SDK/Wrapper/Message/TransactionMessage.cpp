@@ -25,7 +25,7 @@ namespace Elastos {
 
 			BRPeerContext *ctx = (BRPeerContext *) peer;
 
-			ByteStream stream(const_cast<uint8_t *>(msg), msgLen, false);
+			ByteStream stream(msg, msgLen);
 			ELATransaction *tx = ELATransactionNew();
 			Transaction trans(tx, false);
 
@@ -75,9 +75,8 @@ namespace Elastos {
 			Transaction transaction(tx, false);
 			ByteStream stream;
 			transaction.Serialize(stream);
-			CMBlock buf = stream.getBuffer();
 			peer_log(peer, "Sending tx: tx hash = %s", Utils::UInt256ToString(tx->raw.txHash, true).c_str());
-			BRPeerSendMessage(peer, buf, buf.GetSize(), MSG_TX);
+			BRPeerSendMessage(peer, stream.data(), stream.length(), MSG_TX);
 		}
 	}
 }
@@ -301,6 +301,12 @@ namespace Elastos {
 			return BRPeerManagerRelayCount((BRPeerManager *) _manager, txHash);
 		}
 
+		BRFilterStats PeerManager::getFilterStats() const {
+			BRFilterStats stats;
+			BRPeerManagerGetFilterStats((BRPeerManager *) _manager, &stats);
+			return stats;
+		}
+
 		void PeerManager::createGenesisBlock() const {
 			ELAMerkleBlock *block = ELAMerkleBlockNew();
 			block->raw.height = 0;
@@ -388,9 +394,8 @@ namespace Elastos {
 			manager->wallet->WalletUnusedAddrs(manager->wallet, NULL, SEQUENCE_GAP_LIMIT_EXTERNAL + 100, 0);
 			manager->wallet->WalletUnusedAddrs(manager->wallet, NULL, SEQUENCE_GAP_LIMIT_INTERNAL + 100, 1);
 
-			BRSetApply(manager->orphans, manager, manager->peerMessages->ApplyFreeBlock);
-			BRSetClear(manager->orphans); // clear out orphans that may have been received on an old filter
-			manager->lastOrphan = NULL;
+			// clear out orphans that may have been received on an old filter
+			BROrphanPoolClear(manager->orphans, manager, manager->peerMessages->MerkleBlockFree);
 			manager->filterUpdateHeight = manager->lastBlock->height;
 			manager->fpRate = BLOOM_REDUCED_FALSEPOSITIVE_RATE;
 
@@ -126,6 +126,8 @@ namespace Elastos {
 
 			uint64_t getRelayCount(const UInt256 &txHash) const;
 
+			BRFilterStats getFilterStats() const;
+
 		private:
 			void createGenesisBlock() const;
 
@@ -114,6 +114,10 @@ namespace Elastos {
 			_parameter = parameter;
 		}
 
+		size_t Program::getSize() const {
+			return ByteStream::varBytesSize(_parameter.GetSize()) + ByteStream::varBytesSize(_code.GetSize());
+		}
+
 		void Program::Serialize(ByteStream &ostream) const {
 			ostream.putVarUint(_parameter.GetSize());
 			ostream.putBytes(_parameter, _parameter.GetSize());
@@ -36,6 +36,8 @@ namespace Elastos {
 
 			void setParameter(const CMBlock &parameter);
 
+			size_t getSize() const;
+
 			virtual void Serialize(ByteStream &ostream) const;
 
 			virtual bool Deserialize(ByteStream &istream);
@@ -3,10 +3,12 @@
 // file COPYING or http://www.opensource.org/licenses/mit-license.php.
 
 #include <stdlib.h>
+#include <set>
 #include <boost/scoped_ptr.hpp>
 #include <Core/BRTransaction.h>
 #include <SDK/ELACoreExt/ELATxOutput.h>
 #include <boost/function.hpp>
+#include <boost/bind.hpp>
 #include <SDK/Common/Log.h>
 #include <Core/BRAddress.h>
 #include <Core/BRBIP32Sequence.h>
@@ -17,6 +19,7 @@
 #include "BRAddress.h"
 #include "BRBIP39Mnemonic.h"
 #include "BRArray.h"
+#include "BRCrypto.h"
 #include "BRTransaction.h"
 
 #include "Wallet.h"
@@ -28,10 +31,8 @@
 namespace Elastos {
 	namespace ElaWallet {
 
-		typedef struct UTXO {
-			BRUTXO o;
-			uint64_t amount;
-		} UTXO_t;
+#define WALLET_SNAPSHOT_MAGIC 0x50534c57 // "WLSP"
+#define WALLET_SNAPSHOT_VERSION 1
 
 		ELAWallet *ELAWalletNew(BRTransaction *transactions[], size_t txCount,
 								size_t (*WalletUnusedAddrs)(BRWallet *wallet, BRAddress addrs[], uint32_t gapLimit,
@@ -135,16 +136,368 @@ namespace Elastos {
 			}
 		}
 
-		int UTXOCompareAscending(const void *o1, const void *o2) {
-			if (((const UTXO_t *)o1)->amount > ((const UTXO_t *)o2)->amount) return 1;
-			if (((const UTXO_t *)o1)->amount < ((const UTXO_t *)o2)->amount) return -1;
-			return 0;
+		// balance state containers of scratch, sized for count transactions, everything else shared with wallet
+		static void ELAWalletNewBalanceState(ELAWallet *scratch, ELAWallet *wallet, size_t count) {
+			scratch->Raw = wallet->Raw;
+			scratch->IsSingleAddress = wallet->IsSingleAddress;
+			scratch->SingleAddress = wallet->SingleAddress;
+			array_new(scratch->Raw.utxos, 100);
+			array_new(scratch->Raw.balanceHist, count + 1);
+			scratch->Raw.spentOutputs = BRSetNew(BRUTXOHash, BRUTXOEq, count + 100);
+			scratch->Raw.invalidTx = BRSetNew(BRTransactionHash, BRTransactionEq, 10);
+			scratch->Raw.pendingTx = BRSetNew(BRTransactionHash, BRTransactionEq, 10);
+			scratch->Raw.usedAddrs = BRSetNew(BRAddressHash, BRAddressEq, count + 100);
+			scratch->Raw.totalSent = 0;
+			scratch->Raw.totalReceived = 0;
+			scratch->Raw.balance = 0;
+		}
+
+		static void ELAWalletFreeBalanceState(ELAWallet *scratch) {
+			BRSetFree(scratch->Raw.usedAddrs);
+			BRSetFree(scratch->Raw.pendingTx);
+			BRSetFree(scratch->Raw.invalidTx);
+			BRSetFree(scratch->Raw.spentOutputs);
+			array_free(scratch->Raw.balanceHist);
+			array_free(scratch->Raw.utxos);
+		}
+
+		// every item of a is also in b, and the counts match
+		static bool ELAWalletSameSet(const char *name, const BRSet *a, const BRSet *b) {
+			if (BRSetCount(a) != BRSetCount(b)) {
+				Log::getLogger()->error("Wallet {} count {} != {}", name, BRSetCount(b), BRSetCount(a));
+				return false;
+			}
+
+			std::vector<void *> items(BRSetCount(a));
+			BRSetAll(a, items.data(), items.size());
+			for (size_t i = 0; i < items.size(); i++) {
+				if (!BRSetContains(b, items[i])) {
+					Log::getLogger()->error("Wallet {} differ", name);
+					return false;
+				}
+			}
+
+			return true;
 		}
 
-		int UTXOCompareDescending(const void *o1, const void *o2) {
-			if (((const UTXO_t *)o1)->amount < ((const UTXO_t *)o2)->amount) return 1;
-			if (((const UTXO_t *)o1)->amount > ((const UTXO_t *)o2)->amount) return -1;
-			return 0;
+		// number of transactions before the first unconfirmed one
+		static size_t ELAWalletConfirmedCount(BRWallet *wallet) {
+			size_t count = 0;
+
+			while (count < array_count(wallet->transactions) &&
+				   wallet->transactions[count]->blockHeight != TX_UNCONFIRMED)
+				count++;
+
+			return count;
+		}
+
+		static UInt256 ELAWalletTransactionsDigest(BRWallet *wallet, size_t count) {
+			UInt256 digest = UINT256_ZERO;
+			CMBlock hashes(count * sizeof(UInt256));
+
+			for (size_t i = 0; i < count; i++) {
+				memcpy(&hashes[i * sizeof(UInt256)], &wallet->transactions[i]->txHash, sizeof(UInt256));
+			}
+			BRSHA256(&digest, hashes, hashes.GetSize());
+
+			return digest;
+		}
+
+		CMBlock ELAWalletSnapshot(ELAWallet *wallet) {
+			BRWallet *raw = &wallet->Raw;
+			ByteStream stream;
+			ELAWallet prefix;
+			BRWallet *state = raw;
+
+			pthread_mutex_lock(&raw->lock);
+			size_t count = ELAWalletConfirmedCount(raw);
+			if (count == 0) {
+				pthread_mutex_unlock(&raw->lock);
+				return CMBlock();
+			}
+
+			// the live state also covers the unconfirmed transactions, replay the confirmed ones alone
+			if (count < array_count(raw->transactions)) {
+				ELAWalletNewBalanceState(&prefix, wallet, count);
+				BalanceEngine::replay(&prefix, 0, count);
+				state = &prefix.Raw;
+			}
+
+			UInt256 digest = ELAWalletTransactionsDigest(raw, count);
+			stream.writeUint32(WALLET_SNAPSHOT_MAGIC);
+			stream.writeUint32(WALLET_SNAPSHOT_VERSION);
+			stream.writeUint8(wallet->IsSingleAddress ? 1 : 0);
+			stream.writeVarString(wallet->SingleAddress);
+			stream.writeUint32(raw->transactions[count - 1]->blockHeight);
+			stream.writeVarUint(count);
+			stream.writeBytes(&digest, sizeof(digest));
+			stream.writeUint64(state->balance);
+			stream.writeUint64(state->totalSent);
+			stream.writeUint64(state->totalReceived);
+
+			stream.writeVarUint(array_count(state->utxos));
+			for (size_t i = 0; i < array_count(state->utxos); i++) {
+				stream.writeBytes(&state->utxos[i].hash, sizeof(UInt256));
+				stream.writeUint32(state->utxos[i].n);
+			}
+
+			for (size_t i = 0; i < count; i++) {
+				stream.writeUint64(state->balanceHist[i]);
+			}
+
+			// UTXOs were only taken from used addresses that belong to the wallet
+			std::vector<const char *> ownedAddrs;
+			if (!wallet->IsSingleAddress) {
+				std::vector<void *> usedAddrs(BRSetCount(state->usedAddrs));
+				BRSetAll(state->usedAddrs, usedAddrs.data(), usedAddrs.size());
+				for (size_t i = 0; i < usedAddrs.size(); i++) {
+					if (BRSetContains(raw->allAddrs, usedAddrs[i]))
+						ownedAddrs.push_back((const char *) usedAddrs[i]);
+				}
+			}
+			stream.writeVarUint(ownedAddrs.size());
+			for (size_t i = 0; i < ownedAddrs.size(); i++) {
+				stream.writeVarString(ownedAddrs[i]);
+			}
+
+			if (state == &prefix.Raw)
+				ELAWalletFreeBalanceState(&prefix);
+			pthread_mutex_unlock(&raw->lock);
+
+			return stream.getBuffer();
+		}
+
+		static bool ELAWalletRestoreSnapshot(ELAWallet *wallet, const CMBlock &snapshot) {
+			BRWallet *raw = &wallet->Raw;
+			ByteStream stream(snapshot, snapshot.GetSize(), false);
+			uint32_t magic, version, height;
+			uint8_t isSingleAddress;
+			std::string singleAddress;
+			uint64_t count, balance, totalSent, totalReceived, utxoCount, ownedCount, amount = 0;
+			UInt256 digest, expectedDigest;
+
+			if (!stream.readUint32(magic) || magic != WALLET_SNAPSHOT_MAGIC ||
+				!stream.readUint32(version) || version != WALLET_SNAPSHOT_VERSION ||
+				!stream.readUint8(isSingleAddress) || !stream.readVarString(singleAddress) ||
+				!stream.readUint32(height) || !stream.readVarUint(count) ||
+				!stream.readBytes(&digest, sizeof(digest)) || !stream.readUint64(balance) ||
+				!stream.readUint64(totalSent) || !stream.readUint64(totalReceived))
+				return false;
+
+			if ((isSingleAddress != 0) != wallet->IsSingleAddress || singleAddress != wallet->SingleAddress)
+				return false;
+
+			// the snapshot must describe a prefix of the confirmed transactions, in the same order
+			if (count == 0 || count > ELAWalletConfirmedCount(raw) || raw->transactions[count - 1]->blockHeight != height)
+				return false;
+			expectedDigest = ELAWalletTransactionsDigest(raw, count);
+			if (!UInt256Eq(&digest, &expectedDigest))
+				return false;
+
+			array_clear(raw->utxos);
+			array_clear(raw->balanceHist);
+			BRSetClear(raw->spentOutputs);
+			BRSetClear(raw->invalidTx);
+			BRSetClear(raw->pendingTx);
+			BRSetClear(raw->usedAddrs);
+
+			if (!stream.readVarUint(utxoCount))
+				return false;
+			for (uint64_t i = 0; i < utxoCount; i++) {
+				BRUTXO utxo;
+				if (!stream.readBytes(&utxo.hash, sizeof(UInt256)) || !stream.readUint32(utxo.n))
+					return false;
+
+				ELATransaction *tx = (ELATransaction *) BRSetGet(raw->allTx, &utxo.hash);
+				if (tx == nullptr || utxo.n >= tx->outputs.size())
+					return false;
+				amount += tx->outputs[utxo.n]->getAmount();
+				array_add(raw->utxos, utxo);
+			}
+
+			for (uint64_t i = 0; i < count; i++) {
+				uint64_t balanceHist;
+				if (!stream.readUint64(balanceHist))
+					return false;
+				array_add(raw->balanceHist, balanceHist);
+			}
+
+			if (amount != balance || raw->balanceHist[count - 1] != balance)
+				return false;
+
+			std::set<std::string> ownedAddrs;
+			if (!stream.readVarUint(ownedCount))
+				return false;
+			for (uint64_t i = 0; i < ownedCount; i++) {
+				std::string address;
+				if (!stream.readVarString(address))
+					return false;
+				ownedAddrs.insert(address);
+			}
+
+			// the sets keep pointers into the transactions, rebuild them from the prefix
+			for (size_t i = 0; i < count; i++) {
+				ELATransaction *tx = (ELATransaction *) raw->transactions[i];
+
+				for (size_t j = 0; j < tx->raw.inCount; j++) {
+					BRSetAdd(raw->spentOutputs, &tx->raw.inputs[j]);
+				}
+
+				for (size_t j = 0; !wallet->IsSingleAddress && j < tx->outputs.size(); j++) {
+					const char *address = tx->outputs[j]->getRaw()->address;
+					if (address[0] == '\0')
+						continue;
+
+					BRSetAdd(raw->usedAddrs, (void *) address);
+					// an address generated after the snapshot that the prefix pays to
+					if ((BRSetContains(raw->allAddrs, address) != 0) != (ownedAddrs.count(address) != 0))
+						return false;
+				}
+			}
+
+			for (size_t i = 0; i < array_count(raw->utxos); i++) {
+				if (BRSetContains(raw->spentOutputs, &raw->utxos[i]))
+					return false;
+			}
+
+			raw->totalSent = totalSent;
+			raw->totalReceived = totalReceived;
+			raw->balance = balance;
+			wallet->Balance.reset(wallet, count);
+			wallet->Balance.update(wallet);
+
+			Log::getLogger()->info("Wallet state restored from snapshot at height {}, replayed {} of {} transactions",
+								   height, array_count(raw->transactions) - count, array_count(raw->transactions));
+
+			return array_count(raw->balanceHist) == array_count(raw->transactions);
+		}
+
+		bool ELAWalletApplySnapshot(ELAWallet *wallet, const CMBlock &snapshot) {
+			if (ELAWalletRestoreSnapshot(wallet, snapshot))
+				return true;
+
+			wallet->Balance.recompute(wallet);
+			return false;
+		}
+
+		void ELAWalletAddAddressPath(ELAWallet *wallet, const char *address, const AddressPath &path) {
+			UInt168 programHash = UINT168_ZERO;
+			if (Utils::UInt168FromAddress(programHash, address))
+				wallet->AddressPaths[programHash] = path;
+		}
+
+		// called with the wallet lock held
+		static void ELAWalletAddInputPaths(ELAWallet *wallet, const BRTransaction *tx, std::set<AddressPath> &paths) {
+			UInt168 programHash;
+
+			for (size_t i = 0; i < tx->inCount; i++) {
+				if (!Utils::UInt168FromAddress(programHash, tx->inputs[i].address))
+					continue;
+
+				AddressPathMap::const_iterator it = wallet->AddressPaths.find(programHash);
+				if (it != wallet->AddressPaths.end())
+					paths.insert(it->second);
+			}
+		}
+
+		std::vector<AddressPath> ELAWalletGetInputPaths(ELAWallet *wallet, const BRTransaction *tx) {
+			std::set<AddressPath> paths;
+
+			pthread_mutex_lock(&wallet->Raw.lock);
+			ELAWalletAddInputPaths(wallet, tx, paths);
+			pthread_mutex_unlock(&wallet->Raw.lock);
+
+			return std::vector<AddressPath>(paths.begin(), paths.end());
+		}
+
+		std::vector<AddressPath> ELAWalletGetInputPaths(ELAWallet *wallet,
+														const std::vector<TransactionPtr> &transactions) {
+			std::set<AddressPath> paths;
+
+			pthread_mutex_lock(&wallet->Raw.lock);
+			for (size_t i = 0; i < transactions.size(); i++) {
+				ELAWalletAddInputPaths(wallet, transactions[i]->getRaw(), paths);
+			}
+			pthread_mutex_unlock(&wallet->Raw.lock);
+
+			return std::vector<AddressPath>(paths.begin(), paths.end());
+		}
+
+		bool ELAWalletVerifyBalance(ELAWallet *wallet) {
+			BRWallet *raw = &wallet->Raw;
+			ELAWallet expected;
+			bool same = true;
+
+			pthread_mutex_lock(&raw->lock);
+			ELAWalletNewBalanceState(&expected, wallet, array_count(raw->transactions));
+			BalanceEngine::replay(&expected, 0, array_count(raw->transactions));
+
+			if (raw->balance != expected.Raw.balance || raw->totalSent != expected.Raw.totalSent ||
+				raw->totalReceived != expected.Raw.totalReceived) {
+				Log::getLogger()->error("Wallet balance {}/{}/{} != {}/{}/{}", raw->balance, raw->totalSent,
+										raw->totalReceived, expected.Raw.balance, expected.Raw.totalSent,
+										expected.Raw.totalReceived);
+				same = false;
+			}
+
+			if (array_count(raw->utxos) != array_count(expected.Raw.utxos)) {
+				Log::getLogger()->error("Wallet utxo count {} != {}", array_count(raw->utxos),
+										array_count(expected.Raw.utxos));
+				same = false;
+			}
+			for (size_t i = 0; same && i < array_count(raw->utxos); i++) {
+				if (!BRUTXOEq(&raw->utxos[i], &expected.Raw.utxos[i])) {
+					Log::getLogger()->error("Wallet utxo {} differ", i);
+					same = false;
+				}
+			}
+
+			if (array_count(raw->balanceHist) != array_count(expected.Raw.balanceHist)) {
+				Log::getLogger()->error("Wallet balance history count {} != {}", array_count(raw->balanceHist),
+										array_count(expected.Raw.balanceHist));
+				same = false;
+			}
+			for (size_t i = 0; same && i < array_count(raw->balanceHist); i++) {
+				if (raw->balanceHist[i] != expected.Raw.balanceHist[i]) {
+					Log::getLogger()->error("Wallet balance history {} differ", i);
+					same = false;
+				}
+			}
+
+			same = ELAWalletSameSet("spent outputs", expected.Raw.spentOutputs, raw->spentOutputs) && same;
+			same = ELAWalletSameSet("invalid transactions", expected.Raw.invalidTx, raw->invalidTx) && same;
+			same = ELAWalletSameSet("pending transactions", expected.Raw.pendingTx, raw->pendingTx) && same;
+			same = ELAWalletSameSet("used addresses", expected.Raw.usedAddrs, raw->usedAddrs) && same;
+
+			std::map<std::string, uint64_t> addressBalances;
+			for (size_t i = 0; i < array_count(expected.Raw.utxos); i++) {
+				ELATransaction *tx = (ELATransaction *) BRSetGet(raw->allTx, &expected.Raw.utxos[i].hash);
+				addressBalances[tx->outputs[expected.Raw.utxos[i].n]->getRaw()->address] +=
+					tx->outputs[expected.Raw.utxos[i].n]->getAmount();
+			}
+			if (wallet->Balance.getCoins().size() != array_count(expected.Raw.utxos)) {
+				Log::getLogger()->error("Wallet coin count {} != {}", wallet->Balance.getCoins().size(),
+										array_count(expected.Raw.utxos));
+				same = false;
+			}
+			const BalanceEngine::AddressBalanceMap &indexed = wallet->Balance.getAddressBalances();
+			if (indexed.size() != addressBalances.size()) {
+				Log::getLogger()->error("Wallet address balance count {} != {}", indexed.size(),
+										addressBalances.size());
+				same = false;
+			}
+			for (std::map<std::string, uint64_t>::iterator it = addressBalances.begin();
+				 it != addressBalances.end(); ++it) {
+				if (wallet->Balance.getAddressBalance(it->first) != it->second) {
+					Log::getLogger()->error("Wallet balance of address {} differ", it->first);
+					same = false;
+				}
+			}
+
+			ELAWalletFreeBalanceState(&expected);
+			pthread_mutex_unlock(&raw->lock);
+
+			return same;
 		}
 
 		Wallet::Wallet() {
@@ -153,7 +506,8 @@ namespace Elastos {
 
 		Wallet::Wallet(const SharedWrapperList<Transaction, BRTransaction *> &transactions,
 					   const SubAccountPtr &subAccount,
-					   const boost::shared_ptr<Listener> &listener) :
+					   const boost::shared_ptr<Listener> &listener,
+					   const CMBlock &snapshot) :
 			_subAccount(subAccount) {
 
 			_wallet = ELAWalletNew(transactions.getRawPointerArray().data(), transactions.size(),
@@ -161,6 +515,7 @@ namespace Elastos {
 								   WalletContainsTx, WalletAddUsedAddrs, WalletCreateTxForOutputs,
 								   WalletMaxOutputAmount, WalletFeeForTx, TransactionIsSigned, KeyToAddress,
 								   BalanceAfterTx);
+			_wallet->Snapshot = snapshot;
 			_subAccount->InitWallet(transactions.getRawPointerArray().data(), transactions.size(), _wallet);
 
 			assert(listener != nullptr);
@@ -214,60 +569,45 @@ namespace Elastos {
 		}
 
 		nlohmann::json Wallet::GetBalanceInfo() {
-
-			size_t utxosCount = BRWalletUTXOs((BRWallet *) _wallet, nullptr, 0);
-			BRUTXO utxos[utxosCount];
-			BRWalletUTXOs((BRWallet *) _wallet, utxos, utxosCount);
-
 			nlohmann::json j;
 
-			ELATransaction *t;
-			std::map<std::string, uint64_t> addressesBalanceMap;
+			std::vector<nlohmann::json> balances;
 			pthread_mutex_lock(&_wallet->Raw.lock);
-			for (size_t i = 0; i < utxosCount; ++i) {
-				void *tempPtr = BRSetGet(_wallet->Raw.allTx, &utxos[utxosCount].hash);
-				if (tempPtr == nullptr) continue;
-				t = static_cast<ELATransaction *>(tempPtr);
-
-				if (addressesBalanceMap.find(t->outputs[utxos->n]->getAddress()) != addressesBalanceMap.end()) {
-					addressesBalanceMap[t->outputs[utxos->n]->getAddress()] += t->outputs[utxos->n]->getAmount();
-				} else {
-					addressesBalanceMap[t->outputs[utxos->n]->getAddress()] = t->outputs[utxos->n]->getAmount();
-				}
+			const BalanceEngine::AddressBalanceMap &addressBalances = _wallet->Balance.getAddressBalances();
+			for (BalanceEngine::AddressBalanceMap::const_iterator it = addressBalances.begin();
+				 it != addressBalances.end(); ++it) {
+				nlohmann::json balanceKeyValue;
+				balanceKeyValue[it->first] = it->second.balance;
+				balances.push_back(balanceKeyValue);
 			}
 			pthread_mutex_unlock(&_wallet->Raw.lock);
 
-			std::vector<nlohmann::json> balances;
-			std::for_each(addressesBalanceMap.begin(), addressesBalanceMap.end(),
-						  [&addressesBalanceMap, &balances](const std::map<std::string, uint64_t>::value_type &item) {
-							  nlohmann::json balanceKeyValue;
-							  balanceKeyValue[item.first] = item.second;
-							  balances.push_back(balanceKeyValue);
-						  });
-
 			j["Balances"] = balances;
 			return j;
 		}
 
 		uint64_t Wallet::GetBalanceWithAddress(const std::string &address) {
-			size_t utxosCount = BRWalletUTXOs((BRWallet *) _wallet, nullptr, 0);
-			BRUTXO utxos[utxosCount];
-			BRWalletUTXOs((BRWallet *) _wallet, utxos, utxosCount);
+			pthread_mutex_lock(&_wallet->Raw.lock);
+			uint64_t balance = _wallet->Balance.getAddressBalance(address);
+			pthread_mutex_unlock(&_wallet->Raw.lock);
+
+			return balance;
+		}
+
+		std::vector<uint64_t> Wallet::GetBalancesWithAddresses(const std::vector<std::string> &addresses) {
+			std::vector<uint64_t> balances(addresses.size());
 
-			ELATransaction *t;
-			uint64_t balance = 0;
 			pthread_mutex_lock(&_wallet->Raw.lock);
-			for (size_t i = 0; i < utxosCount; ++i) {
-				void *tempPtr = BRSetGet(_wallet->Raw.allTx, &utxos[i].hash);
-				if (tempPtr == nullptr) continue;
-				t = static_cast<ELATransaction *>(tempPtr);
-				if (BRAddressEq(t->outputs[utxos[i].n]->getRaw()->address, address.c_str())) {
-					balance += t->outputs[utxos[i].n]->getAmount();
-				}
+			for (size_t i = 0; i < addresses.size(); ++i) {
+				balances[i] = _wallet->Balance.getAddressBalance(addresses[i]);
 			}
 			pthread_mutex_unlock(&_wallet->Raw.lock);
 
-			return balance;
+			return balances;
+		}
+
+		CMBlock Wallet::GetSnapshot() {
+			return ELAWalletSnapshot(_wallet);
 		}
 
 		SharedWrapperList<Transaction, BRTransaction *> Wallet::getTransactions() const {
@@ -338,47 +678,22 @@ namespace Elastos {
 			return filterAddress == fromAddress;
 		}
 
-		void Wallet::SortUTXOForAmount(BRWallet *wallet, uint64_t amount) {
-			if (array_count(wallet->utxos) <= 1)
-				return;
-
-			UTXO_t *utxos;
-			BRUTXO *o;
-			ELATransaction *tx;
-			array_new(utxos, array_count(wallet->utxos));
-
-			for (size_t i = 0; i < array_count(wallet->utxos); ++i) {
-				o = &wallet->utxos[i];
-				tx = (ELATransaction *) BRSetGet(wallet->allTx, o);
-				if (!tx || o->n >= tx->outputs.size()) {
-					Log::getLogger()->error("Invalid utxo {} n={}", Utils::UInt256ToString(o->hash, true), o->n);
-					continue;
-				}
-
-				array_add(utxos, ((UTXO_t){*o, tx->outputs[o->n]->getAmount()}));
-			}
-
-			qsort(utxos, array_count(utxos), sizeof(*utxos), UTXOCompareAscending);
-
-			uint64_t Threshold = amount * 2 + wallet->feePerKb;
-			size_t ThresholdIndex = 0;
-			for (size_t i = 0; i < array_count(utxos); ++i) {
-				if (utxos[i].amount > Threshold) {
-					ThresholdIndex = i;
-					break;
-				}
-			}
-
-			if (ThresholdIndex > 0)
-				qsort(utxos, ThresholdIndex, sizeof(*utxos), UTXOCompareDescending);
+		bool Wallet::IsSpendable(BRWallet *wallet, const std::string &fromAddress,
+								 bool(*filter)(const std::string &fromAddress, const std::string &addr),
+								 const Coin &coin) {
+			const ELATransaction *tx = coin.tx;
 
-			array_set_count(wallet->utxos, 0);
+			if (filter && !fromAddress.empty() && !filter(fromAddress, tx->outputs[coin.utxo.n]->getAddress()))
+				return false;
 
-			for (size_t i = 0; i < array_count(utxos); ++i) {
-				array_add(wallet->utxos, utxos[i].o);
+			if (tx->raw.blockHeight >= wallet->lastBlockHeight) {
+				Log::getLogger()->warn("utxo: '{}' n: '{}', confirming, can't spend for now, tx height = {}, wallet block height = {}",
+									   Utils::UInt256ToString(tx->raw.txHash, true), coin.utxo.n, tx->raw.blockHeight,
+									   wallet->lastBlockHeight);
+				return false;
 			}
 
-			array_free(utxos);
+			return true;
 		}
 
 		BRTransaction *Wallet::CreateTxForOutputs(BRWallet *wallet, const BRTxOutput outputs[], size_t outCount,
@@ -388,7 +703,7 @@ namespace Elastos {
 			ELATransaction *tx, *transaction = ELATransactionNew();
 			uint64_t feeAmount, amount = 0, balance = 0;
 			size_t i, cpfpSize = 0;
-			BRUTXO *o;
+			const BRUTXO *o;
 			BRAddress addr = BR_ADDRESS_NONE;
 			TransactionPtr txn(new Transaction(transaction, false));
 
@@ -404,26 +719,71 @@ namespace Elastos {
 			}
 
 			pthread_mutex_lock(&wallet->lock);
-			feeAmount = txn->calculateFee(wallet->feePerKb);
+			const BalanceEngine &engine = ((ELAWallet *) wallet)->Balance;
+			CoinSet addressCoins;
+			const CoinSet *coins = &engine.getCoins();
+			if (filter == AddressFilter && !fromAddress.empty()) {
+				// only the UTXOs of the spender address are candidates
+				BalanceEngine::AddressBalanceMap::const_iterator it = engine.getAddressBalances().find(fromAddress);
+				for (size_t j = 0; it != engine.getAddressBalances().end() && j < it->second.utxos.size(); j++) {
+					o = &it->second.utxos[j];
+					tx = (ELATransaction *) BRSetGet(wallet->allTx, o);
+					if (!tx || o->n >= tx->outputs.size()) continue;
+					addressCoins.insert(Coin(tx->outputs[o->n]->getAmount(), *o, tx));
+				}
+				coins = &addressCoins;
+			}
 
-			SortUTXOForAmount(wallet, amount);
 			// TODO: use up all UTXOs for all used addresses to avoid leaving funds in addresses whose public key is revealed
 			// TODO: avoid combining addresses in a single transaction when possible to reduce information leakage
 			// TODO: use up UTXOs received from any of the output scripts that this transaction sends funds to, to mitigate an
 			//       attacker double spending and requesting a refund
-			for (i = 0; i < array_count(wallet->utxos); i++) {
-				o = &wallet->utxos[i];
-				tx = (ELATransaction *) BRSetGet(wallet->allTx, o);
-				if (!tx || o->n >= tx->outputs.size()) continue;
-				if (filter && !fromAddress.empty() && !filter(fromAddress, tx->outputs[o->n]->getAddress())) {
-					continue;
+			CoinSelection selection(*coins, amount, wallet->feePerKb, txn->getSize(),
+									boost::bind(&Wallet::IsSpendable, wallet, fromAddress, filter, _1));
+			const CoinSelectionStrategyPtr &strategy = ((ELAWallet *) wallet)->CoinSelectionStrategy;
+			bool selected = strategy->select(selection);
+
+			if (!selected && selection.isOversized()) { // transaction size-in-bytes too large
+				bool balanceEnough = true;
+				feeAmount = selection.getOversizedFee();
+				balance = selection.getSelectedAmount();
+				ELATransactionFree(transaction);
+				transaction = nullptr;
+
+				// check for sufficient total funds before building a smaller transaction
+				if (wallet->balance < amount + feeAmount) {
+					Log::getLogger()->error("Not enough sufficient total funds for building a smaller tx.");
+					balanceEnough = false;
 				}
 
-				if (tx->raw.blockHeight >= wallet->lastBlockHeight) {
-					Log::getLogger()->warn("utxo: '{}' n: '{}', confirming, can't spend for now, tx height = {}, wallet block height = {}",
-										   Utils::UInt256ToString(tx->raw.txHash, true), o->n, tx->raw.blockHeight, wallet->lastBlockHeight);
-					continue;
+				pthread_mutex_unlock(&wallet->lock);
+
+				ParamChecker::checkCondition(!balanceEnough, Error::CreateTransaction,
+											 "Available token is not enough");
+
+				uint64_t maxAmount = 0;
+				if (outputs[outCount - 1].amount > (amount + feeAmount - balance)) {
+					for (int j = 0; j < outCount - 1; ++j) {
+						maxAmount += outputs[j].amount;
+					}
+					maxAmount += outputs[outCount - 1].amount - (amount + feeAmount - balance);
+					ParamChecker::checkCondition(true, Error::CreateTransactionExceedSize,
+												 "Tx size too large, amount should less than " +
+												 std::to_string(maxAmount), maxAmount);
+				} else {
+					for (int j = 0; j < outCount - 1; ++j) {
+						maxAmount += outputs[j].amount;
+					}
+					ParamChecker::checkCondition(true, Error::CreateTransactionExceedSize,
+												 "Tx size too large, amount should less than " +
+												 std::to_string(maxAmount), maxAmount);
 				}
+			}
+
+			const std::vector<Coin> &selectedCoins = selection.getSelected();
+			for (i = 0; i < selectedCoins.size(); i++) {
+				o = &selectedCoins[i].utxo;
+				tx = selectedCoins[i].tx;
 
 				BRTransactionAddInput(&transaction->raw, tx->raw.txHash, o->n, tx->outputs[o->n]->getAmount(),
 									  tx->outputs[o->n]->getRaw()->script, tx->outputs[o->n]->getRaw()->scriptLen,
@@ -434,61 +794,13 @@ namespace Elastos {
 				memset(input->address, 0, sizeof(input->address));
 				strncpy(input->address, addr.c_str(), sizeof(input->address) - 1);
 
-				if (txn->getSize() + TX_RECHARGE_OUTPUT_SIZE > TX_MAX_SIZE) { // transaction size-in-bytes too large
-					bool balanceEnough = true;
-					feeAmount = txn->calculateFee(wallet->feePerKb) + wallet->feePerKb;
-					ELATransactionFree(transaction);
-					transaction = nullptr;
-
-					// check for sufficient total funds before building a smaller transaction
-					if (wallet->balance < amount + feeAmount) {
-						Log::getLogger()->error("Not enough sufficient total funds for building a smaller tx.");
-						balanceEnough = false;
-					}
-
-					pthread_mutex_unlock(&wallet->lock);
-
-					ParamChecker::checkCondition(!balanceEnough, Error::CreateTransaction,
-												 "Available token is not enough");
-
-					uint64_t maxAmount = 0;
-					if (outputs[outCount - 1].amount > (amount + feeAmount - balance)) {
-						for (int j = 0; j < outCount - 1; ++j) {
-							maxAmount += outputs[j].amount;
-						}
-						maxAmount += outputs[outCount - 1].amount - (amount + feeAmount - balance);
-						ParamChecker::checkCondition(true, Error::CreateTransactionExceedSize,
-													 "Tx size too large, amount should less than " +
-													 std::to_string(maxAmount), maxAmount);
-					} else {
-						for (int j = 0; j < outCount - 1; ++j) {
-							maxAmount += outputs[j].amount;
-						}
-						ParamChecker::checkCondition(true, Error::CreateTransactionExceedSize,
-													 "Tx size too large, amount should less than " +
-													 std::to_string(maxAmount), maxAmount);
-					}
-
-					balance = amount = feeAmount = 0;
-					pthread_mutex_lock(&wallet->lock);
-					break;
-				}
-
-				balance += tx->outputs[o->n]->getAmount();
-
 //        // size of unconfirmed, non-change inputs for child-pays-for-parent fee
 //        // don't include parent tx with more than 10 inputs or 10 outputs
 //        if (tx->blockHeight == TX_UNCONFIRMED && tx->inCount <= 10 && tx->outCount <= 10 &&
 //            ! _BRWalletTxIsSend(wallet, tx)) cpfpSize += BRTransactionSize(tx);
-
-				// fee amount after adding a change output
-				feeAmount = txn->calculateFee(wallet->feePerKb);
-
-				// increase fee to round off remaining wallet balance to nearest 100 satoshi
-				//if (wallet->balance > amount + feeAmount) feeAmount += (wallet->balance - (amount + feeAmount)) % 100;
-
-				if (balance >= amount + feeAmount) break;
 			}
+			balance = selection.getSelectedAmount();
+			feeAmount = selection.getFee();
 
 			pthread_mutex_unlock(&wallet->lock);
 
@@ -519,6 +831,13 @@ namespace Elastos {
 			return CreateTxForOutputs(wallet, outputs, outCount, 0, "", nullptr);
 		}
 
+		void Wallet::setCoinSelectionStrategy(const CoinSelectionStrategyPtr &strategy) {
+			ParamChecker::checkCondition(strategy == nullptr, Error::InvalidArgument, "Invalid coin selection strategy");
+			pthread_mutex_lock(&_wallet->Raw.lock);
+			_wallet->CoinSelectionStrategy = strategy;
+			pthread_mutex_unlock(&_wallet->Raw.lock);
+		}
+
 		TransactionPtr
 		Wallet::createTransaction(const std::string &fromAddress, uint64_t fee, uint64_t amount,
 								  const std::string &toAddress, const std::string &remark,
@@ -770,111 +1089,18 @@ namespace Elastos {
 		}
 
 		void Wallet::WalletUpdateBalance(BRWallet *wallet) {
-			int isInvalid, isPending;
-			uint64_t balance = 0, prevBalance = 0;
-			time_t now = time(NULL);
-			size_t i, j;
-			ELATransaction *tx, *t;
-
-			array_clear(wallet->utxos);
-			array_clear(wallet->balanceHist);
-			BRSetClear(wallet->spentOutputs);
-			BRSetClear(wallet->invalidTx);
-			BRSetClear(wallet->pendingTx);
-			BRSetClear(wallet->usedAddrs);
-			wallet->totalSent = 0;
-			wallet->totalReceived = 0;
-
-			for (i = 0; i < array_count(wallet->transactions); i++) {
-				tx = (ELATransaction *) wallet->transactions[i];
-
-				// check if any inputs are invalid or already spent
-				if (tx->raw.blockHeight == TX_UNCONFIRMED) {
-					for (j = 0, isInvalid = 0; !isInvalid && j < tx->raw.inCount; j++) {
-						if (BRSetContains(wallet->spentOutputs, &tx->raw.inputs[j]) ||
-							BRSetContains(wallet->invalidTx, &tx->raw.inputs[j].txHash))
-							isInvalid = 1;
-					}
-
-					if (isInvalid) {
-						BRSetAdd(wallet->invalidTx, tx);
-						array_add(wallet->balanceHist, balance);
-						continue;
-					}
-				}
-
-				// add inputs to spent output set
-				for (j = 0; j < tx->raw.inCount; j++) {
-					BRSetAdd(wallet->spentOutputs, &tx->raw.inputs[j]);
-				}
-
-				// check if tx is pending
-				if (tx->raw.blockHeight == TX_UNCONFIRMED) {
-					isPending = (ELATransactionSize(tx) > TX_MAX_SIZE) ? 1 : 0; // check tx size is under TX_MAX_SIZE
-
-					for (j = 0; !isPending && j < tx->outputs.size(); j++) {
-						if (tx->outputs[j]->getAmount() < TX_MIN_OUTPUT_AMOUNT)
-							isPending = 1; // check that no outputs are dust
-					}
-
-					for (j = 0; !isPending && j < tx->raw.inCount; j++) {
-						if (tx->raw.inputs[j].sequence < UINT32_MAX - 1) isPending = 1; // check for replace-by-fee
-						if (tx->raw.inputs[j].sequence < UINT32_MAX && tx->raw.lockTime < TX_MAX_LOCK_HEIGHT &&
-							tx->raw.lockTime > wallet->blockHeight + 1)
-							isPending = 1; // future lockTime
-						if (tx->raw.inputs[j].sequence < UINT32_MAX && tx->raw.lockTime > now)
-							isPending = 1; // future lockTime
-						if (BRSetContains(wallet->pendingTx, &tx->raw.inputs[j].txHash))
-							isPending = 1; // check for pending inputs
-						// TODO: XXX handle BIP68 check lock time verify rules
-					}
-
-					if (isPending) {
-						BRSetAdd(wallet->pendingTx, tx);
-						array_add(wallet->balanceHist, balance);
-						continue;
-					}
-				}
-
-				// add outputs to UTXO set
-				// TODO: don't add outputs below TX_MIN_OUTPUT_AMOUNT
-				// TODO: don't add coin generation outputs < 100 blocks deep
-				// NOTE: balance/UTXOs will then need to be recalculated when last block changes
-				for (j = 0; tx->raw.blockHeight != TX_UNCONFIRMED && j < tx->outputs.size(); j++) {
-					if (tx->outputs[j]->getRaw()->address[0] != '\0') {
-						if (((ELAWallet *) wallet)->IsSingleAddress) {
-							ELAWallet *elaWallet = (ELAWallet *) wallet;
-							if (elaWallet->SingleAddress == std::string(tx->outputs[j]->getRaw()->address)) {
-								array_add(wallet->utxos, ((BRUTXO) {tx->raw.txHash, (uint32_t) j}));
-								balance += tx->outputs[j]->getAmount();
-							}
-						} else {
-							BRSetAdd(wallet->usedAddrs, tx->outputs[j]->getRaw()->address);
-
-							if (BRSetContains(wallet->allAddrs, tx->outputs[j]->getRaw()->address)) {
-								array_add(wallet->utxos, ((BRUTXO) {tx->raw.txHash, (uint32_t) j}));
-								balance += tx->outputs[j]->getAmount();
-							}
-						}
-					}
-				}
-
-				// transaction ordering is not guaranteed, so check the entire UTXO set against the entire spent output set
-				for (j = array_count(wallet->utxos); j > 0; j--) {
-					if (!BRSetContains(wallet->spentOutputs, &wallet->utxos[j - 1])) continue;
-					t = (ELATransaction *) BRSetGet(wallet->allTx, &wallet->utxos[j - 1].hash);
-					balance -= t->outputs[wallet->utxos[j - 1].n]->getAmount();
-					array_rm(wallet->utxos, j - 1);
-				}
+			ELAWallet *elaWallet = (ELAWallet *) wallet;
 
-				if (prevBalance < balance) wallet->totalReceived += balance - prevBalance;
-				if (balance < prevBalance) wallet->totalSent += prevBalance - balance;
-				array_add(wallet->balanceHist, balance);
-				prevBalance = balance;
+			if (elaWallet->Snapshot.GetSize() > 0) {
+				CMBlock snapshot = elaWallet->Snapshot;
+				elaWallet->Snapshot = CMBlock();
+				if (!ELAWalletApplySnapshot(elaWallet, snapshot))
+					Log::getLogger()->warn("Wallet snapshot does not match the transactions, replayed all of them");
+				return;
 			}
 
+			elaWallet->Balance.update(elaWallet);
 			assert(array_count(wallet->balanceHist) == array_count(wallet->transactions));
-			wallet->balance = balance;
 		}
 
 		int Wallet::WalletContainsTx(BRWallet *wallet, const BRTransaction *tx) {
@@ -1018,35 +1244,61 @@ namespace Elastos {
 				return 1;
 			}
 
-			BRAddress *addrChain, emptyAddress = BR_ADDRESS_NONE;
-			size_t i, j = 0, count, startCount;
+			BRAddress *addrChain;
+			size_t i, j = 0, count;
 			uint32_t chain = (internal) ? SEQUENCE_INTERNAL_CHAIN : SEQUENCE_EXTERNAL_CHAIN;
 
 			assert(wallet != NULL);
 			assert(gapLimit > 0);
 			pthread_mutex_lock(&wallet->lock);
-			addrChain = (internal) ? wallet->internalChain : wallet->externalChain;
-			i = count = startCount = array_count(addrChain);
+			for (;;) {
+				addrChain = (internal) ? wallet->internalChain : wallet->externalChain;
+				i = count = array_count(addrChain);
+
+				// keep only the trailing contiguous block of addresses with no transactions
+				while (i > 0 && !BRSetContains(wallet->usedAddrs, &addrChain[i - 1])) i--;
+				if (i + gapLimit <= count) break;
+
+				// generate new addresses up to gapLimit without holding the lock, then add them in one step
+				size_t needed = i + gapLimit - count;
+				BRMasterPubKey masterPubKey = wallet->masterPubKey;
+				pthread_mutex_unlock(&wallet->lock);
+				std::vector<BRAddress> addresses = elaWallet->Derivation.derive(masterPubKey, chain, (uint32_t) count,
+																				needed, wallet->KeyToAddress);
+				pthread_mutex_lock(&wallet->lock);
+
+				addrChain = (internal) ? wallet->internalChain : wallet->externalChain;
+				if (array_count(addrChain) != count) continue; // another caller extended the chain meanwhile
+
+				for (size_t k = 0; k < addresses.size(); k++) {
+					array_add(addrChain, addresses[k]);
+					ELAWalletAddAddressPath(elaWallet, addresses[k].s, AddressPath(chain, (uint32_t) (count + k)));
+				}
 
-			// keep only the trailing contiguous block of addresses with no transactions
-			while (i > 0 && !BRSetContains(wallet->usedAddrs, &addrChain[i - 1])) i--;
+				// was addrChain moved to a new memory location?
+				if (addrChain == (internal ? wallet->internalChain : wallet->externalChain)) {
+					for (size_t k = count; k < array_count(addrChain); k++) {
+						BRSetAdd(wallet->allAddrs, &addrChain[k]);
+					}
+				} else {
+					if (internal) wallet->internalChain = addrChain;
+					if (!internal) wallet->externalChain = addrChain;
+					BRSetClear(wallet->allAddrs); // clear and rebuild allAddrs
 
-			while (i + gapLimit > count) { // generate new addresses up to gapLimit
-				Key key;
-				BRAddress address = BR_ADDRESS_NONE;
+					for (size_t k = array_count(wallet->internalChain); k > 0; k--) {
+						BRSetAdd(wallet->allAddrs, &wallet->internalChain[k - 1]);
+					}
 
-				size_t len = BRBIP32PubKey(NULL, 0, wallet->masterPubKey, chain, count);
-				CMBlock pubKey(len);
-				BRBIP32PubKey(pubKey, pubKey.GetSize(), wallet->masterPubKey, chain, count);
+					for (size_t k = array_count(wallet->externalChain); k > 0; k--) {
+						BRSetAdd(wallet->allAddrs, &wallet->externalChain[k - 1]);
+					}
+				}
 
-				if (!key.setPubKey(pubKey)) break;
-				if (!wallet->KeyToAddress(key.getRaw(), address.s, sizeof(BRAddress)) ||
-					BRAddressEq(&address, &emptyAddress))
+				if (addresses.size() < needed) { // derivation failed, keep what was generated
+					i = count = array_count(addrChain);
+					while (i > 0 && !BRSetContains(wallet->usedAddrs, &addrChain[i - 1])) i--;
 					break;
-
-				array_add(addrChain, address);
-				count++;
-				if (BRSetContains(wallet->usedAddrs, &address)) i = count;
+				}
 			}
 
 			if (addrs && i + gapLimit <= count) {
@@ -1055,25 +1307,6 @@ namespace Elastos {
 				}
 			}
 
-			// was addrChain moved to a new memory location?
-			if (addrChain == (internal ? wallet->internalChain : wallet->externalChain)) {
-				for (i = startCount; i < count; i++) {
-					BRSetAdd(wallet->allAddrs, &addrChain[i]);
-				}
-			} else {
-				if (internal) wallet->internalChain = addrChain;
-				if (!internal) wallet->externalChain = addrChain;
-				BRSetClear(wallet->allAddrs); // clear and rebuild allAddrs
-
-				for (i = array_count(wallet->internalChain); i > 0; i--) {
-					BRSetAdd(wallet->allAddrs, &wallet->internalChain[i - 1]);
-				}
-
-				for (i = array_count(wallet->externalChain); i > 0; i--) {
-					BRSetAdd(wallet->allAddrs, &wallet->externalChain[i - 1]);
-				}
-			}
-
 			pthread_mutex_unlock(&wallet->lock);
 			return j;
 		}
@@ -1115,5 +1348,13 @@ namespace Elastos {
 			_subAccount->SignTransaction(transaction, _wallet, payPassword);
 		}
 
+		void Wallet::signTransactions(const std::vector<TransactionPtr> &transactions, int forkId,
+									  const std::string &payPassword) {
+			for (size_t i = 0; i < transactions.size(); ++i) {
+				ParamChecker::checkCondition(transactions[i].get() == nullptr, Error::InvalidArgument, "Sign null tx");
+			}
+			_subAccount->SignTransactions(transactions, _wallet, payPassword);
+		}
+
 	}
 }
\ No newline at end of file
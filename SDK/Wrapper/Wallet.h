@@ -5,8 +5,10 @@
 #ifndef __ELASTOS_SDK_SPVCLIENT_WALLET_H__
 #define __ELASTOS_SDK_SPVCLIENT_WALLET_H__
 
+#include <cstring>
 #include <map>
 #include <string>
+#include <unordered_map>
 #include <BRWallet.h>
 #include <boost/weak_ptr.hpp>
 #include <boost/function.hpp>
@@ -22,13 +24,46 @@
 #include "SDK/Transaction/TransactionOutput.h"
 #include "WrapperList.h"
 #include "Account/ISubAccount.h"
+#include "BalanceEngine.h"
+#include "AddressDerivation.h"
 
 namespace Elastos {
 	namespace ElaWallet {
 
+		// derivation path of a wallet address below the account key
+		struct AddressPath {
+			AddressPath() : chain(0), index(0) {}
+
+			AddressPath(uint32_t c, uint32_t i) : chain(c), index(i) {}
+
+			bool operator<(const AddressPath &other) const {
+				return chain != other.chain ? chain < other.chain : index < other.index;
+			}
+
+			uint32_t chain;
+			uint32_t index;
+		};
+
+		struct ProgramHashHasher {
+			size_t operator()(const UInt168 &u) const {
+				// skip the prefix byte, it is the same for most addresses of a wallet
+				size_t h;
+				memcpy(&h, &u.u8[1], sizeof(h));
+				return h;
+			}
+		};
+
+		struct ProgramHashEqual {
+			bool operator()(const UInt168 &a, const UInt168 &b) const {
+				return UInt168Eq(&a, &b) != 0;
+			}
+		};
+
+		typedef std::unordered_map<UInt168, AddressPath, ProgramHashHasher, ProgramHashEqual> AddressPathMap;
+
 		struct ELAWallet {
 
-			ELAWallet() {
+			ELAWallet() : CoinSelectionStrategy(new ThresholdCoinSelection()) {
 				memset(&Raw, 0, sizeof(Raw));
 				IsSingleAddress = false;
 			}
@@ -40,6 +75,21 @@ namespace Elastos {
 
 			bool IsSingleAddress;
 			std::string SingleAddress;
+
+			// state saved by ELAWalletSnapshot(), consumed by the first WalletUpdateBalance()
+			CMBlock Snapshot;
+
+			// keeps utxos, balanceHist and the sets of Raw in line with Raw.transactions
+			BalanceEngine Balance;
+
+			// picks the UTXOs spent by transactions the wallet creates
+			CoinSelectionStrategyPtr CoinSelectionStrategy;
+
+			// program hash of every address in Raw.internalChain and Raw.externalChain, guarded by Raw.lock
+			AddressPathMap AddressPaths;
+
+			// generates the addresses appended to Raw.internalChain and Raw.externalChain
+			AddressDerivation Derivation;
 		};
 
 		ELAWallet *ELAWalletNew(BRTransaction *transactions[], size_t txCount,
@@ -67,6 +117,32 @@ namespace Elastos {
 
 		void ELAWalletLoadRemarks(ELAWallet *wallet, const SharedWrapperList<Transaction, BRTransaction *> &transaction);
 
+		// records the path of an address the wallet generated, called with the wallet lock held
+		void ELAWalletAddAddressPath(ELAWallet *wallet, const char *address, const AddressPath &path);
+
+		// distinct derivation paths of the inputs of tx that spend from wallet addresses, in path order
+		std::vector<AddressPath> ELAWalletGetInputPaths(ELAWallet *wallet, const BRTransaction *tx);
+
+		// the same for all inputs of several transactions
+		std::vector<AddressPath> ELAWalletGetInputPaths(ELAWallet *wallet,
+														const std::vector<TransactionPtr> &transactions);
+
+		/*
+		 * Balance state derived from the leading confirmed transactions of the wallet: UTXOs, balance history,
+		 * totals and which used addresses belong to the wallet. Replaying confirmed transactions doesn't
+		 * depend on the clock or the chain tip, so a later start restores this prefix and only replays the
+		 * transactions after it. Returns an empty block if there is nothing worth saving.
+		 */
+		CMBlock ELAWalletSnapshot(ELAWallet *wallet);
+
+		// false if the snapshot is malformed or doesn't match the transactions of the wallet, the wallet
+		// state is then rebuilt by replaying all transactions
+		bool ELAWalletApplySnapshot(ELAWallet *wallet, const CMBlock &snapshot);
+
+		// compares the incrementally maintained balance state with a full replay of the transactions, logs
+		// the first difference found
+		bool ELAWalletVerifyBalance(ELAWallet *wallet);
+
 		class Wallet :
 				public Wrapper<BRWallet> {
 
@@ -90,7 +166,8 @@ namespace Elastos {
 
 			Wallet(const SharedWrapperList<Transaction, BRTransaction *> &transactions,
 				   const SubAccountPtr &subAccount,
-				   const boost::shared_ptr<Listener> &listener);
+				   const boost::shared_ptr<Listener> &listener,
+				   const CMBlock &snapshot = CMBlock());
 
 			virtual ~Wallet();
 
@@ -110,6 +187,15 @@ namespace Elastos {
 
 			uint64_t GetBalanceWithAddress(const std::string &address);
 
+			// balances of addresses, in the same order, taken under one lock
+			std::vector<uint64_t> GetBalancesWithAddresses(const std::vector<std::string> &addresses);
+
+			// see ELAWalletSnapshot()
+			CMBlock GetSnapshot();
+
+			// ThresholdCoinSelection unless set
+			void setCoinSelectionStrategy(const CoinSelectionStrategyPtr &strategy);
+
 			// returns the first unused external address
 			std::string getReceiveAddress() const;
 
@@ -238,13 +324,19 @@ namespace Elastos {
 			void signTransaction(const boost::shared_ptr<Transaction> &transaction, int forkId,
 								 const std::string &payPassword);
 
+			// signs every transaction with the keys derived once for the whole batch
+			void signTransactions(const std::vector<TransactionPtr> &transactions, int forkId,
+								  const std::string &payPassword);
+
 
 		protected:
 			Wallet();
 
 			static bool AddressFilter(const std::string &fromAddress, const std::string &filterAddress);
 
-			static void SortUTXOForAmount(BRWallet *wallet, uint64_t amount);
+			static bool IsSpendable(BRWallet *wallet, const std::string &fromAddress,
+									bool(*filter)(const std::string &fromAddress, const std::string &addr),
+									const Coin &coin);
 
 			static BRTransaction *CreateTxForOutputs(BRWallet *wallet, const BRTxOutput outputs[], size_t outCount,
 													 uint64_t fee, const std::string &fromAddress,
@@ -0,0 +1,93 @@
+// Copyright (c) 2012-2018 The Elastos Open Source Project
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#define CATCH_CONFIG_MAIN
+
+#include <iostream>
+#include <boost/date_time/posix_time/posix_time.hpp>
+
+#include "catch.hpp"
+#include "AddressDerivation.h"
+#include "Key.h"
+#include "MasterPubKey.h"
+
+using namespace Elastos::ElaWallet;
+
+static const std::string Phrase = "abandon abandon abandon abandon abandon abandon abandon abandon abandon abandon "
+	"abandon about";
+
+// what Wallet::KeyToAddress does
+static size_t keyToAddress(const BRKey *key, char *addr, size_t addrLen) {
+	BRKey *brKey = new BRKey;
+	memcpy(brKey, key, sizeof(BRKey));
+	Key k(brKey);
+
+	std::string address = k.address();
+	memset(addr, '\0', addrLen);
+	strncpy(addr, address.c_str(), addrLen - 1);
+	return address.size();
+}
+
+// the derivation WalletUnusedAddrs did before, both CKD steps for every address
+static BRAddress deriveAddress(const BRMasterPubKey &mpk, uint32_t chain, uint32_t index) {
+	BRAddress address = BR_ADDRESS_NONE;
+
+	size_t len = BRBIP32PubKey(NULL, 0, mpk, chain, index);
+	CMBlock pubKey(len);
+	BRBIP32PubKey(pubKey, pubKey.GetSize(), mpk, chain, index);
+
+	Key key;
+	key.setPubKey(pubKey);
+	keyToAddress(key.getRaw(), address.s, sizeof(address.s));
+	return address;
+}
+
+TEST_CASE("Address derivation", "[AddressDerivation]") {
+	MasterPubKey masterPubKey(Phrase, "");
+	const BRMasterPubKey &mpk = *masterPubKey.getRaw();
+	AddressDerivation derivation;
+
+	SECTION("Batches match one address at a time") {
+		const uint32_t chains[] = {SEQUENCE_EXTERNAL_CHAIN, SEQUENCE_INTERNAL_CHAIN};
+		for (size_t c = 0; c < 2; ++c) {
+			// large enough to be split across workers on a multi-core machine
+			std::vector<BRAddress> addrs = derivation.derive(mpk, chains[c], 5, ADDRESS_DERIVATION_BATCH * 2 + 3,
+															 keyToAddress);
+			REQUIRE(addrs.size() == ADDRESS_DERIVATION_BATCH * 2 + 3);
+
+			for (size_t i = 0; i < addrs.size(); ++i) {
+				BRAddress expected = deriveAddress(mpk, chains[c], (uint32_t) (5 + i));
+				REQUIRE(BRAddressEq(&addrs[i], &expected));
+			}
+		}
+
+		REQUIRE(derivation.derive(mpk, SEQUENCE_EXTERNAL_CHAIN, 0, 10, keyToAddress).size() == 10);
+		REQUIRE(derivation.getChainKeyDerivations() == 2);
+	}
+
+	SECTION("Empty range") {
+		REQUIRE(derivation.derive(mpk, SEQUENCE_EXTERNAL_CHAIN, 0, 0, keyToAddress).empty());
+		REQUIRE(derivation.getChainKeyDerivations() == 0);
+	}
+}
+
+TEST_CASE("Address derivation benchmark", "[.benchmark][AddressDerivation]") {
+	const size_t count = 10000;
+	MasterPubKey masterPubKey(Phrase, "");
+	const BRMasterPubKey &mpk = *masterPubKey.getRaw();
+
+	boost::posix_time::ptime start = boost::posix_time::microsec_clock::universal_time();
+	for (size_t i = 0; i < count; ++i) {
+		deriveAddress(mpk, SEQUENCE_EXTERNAL_CHAIN, (uint32_t) i);
+	}
+	boost::posix_time::time_duration single = boost::posix_time::microsec_clock::universal_time() - start;
+
+	AddressDerivation derivation;
+	start = boost::posix_time::microsec_clock::universal_time();
+	REQUIRE(derivation.derive(mpk, SEQUENCE_EXTERNAL_CHAIN, 0, count, keyToAddress).size() == count);
+	boost::posix_time::time_duration batched = boost::posix_time::microsec_clock::universal_time() - start;
+
+	std::cout << count << " addresses, one at a time: " << single.total_milliseconds() << " ms, batched: "
+			  << batched.total_milliseconds() << " ms" << std::endl;
+}
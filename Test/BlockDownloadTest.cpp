@@ -0,0 +1,333 @@
+// Copyright (c) 2012-2018 The Elastos Open Source Project
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#define CATCH_CONFIG_MAIN
+
+#include <deque>
+#include <iostream>
+#include <map>
+#include <boost/bind.hpp>
+#include <boost/thread.hpp>
+#include <boost/date_time/posix_time/posix_time.hpp>
+
+#include "catch.hpp"
+#include "TestHelper.h"
+#include <Core/BRBlockDownload.h>
+
+using namespace Elastos::ElaWallet;
+
+static std::vector<UInt256> createChain(size_t count) {
+	std::vector<UInt256> hashes;
+	for (size_t i = 0; i < count; ++i)
+		hashes.push_back(getRandUInt256());
+	return hashes;
+}
+
+static BRMerkleBlock *createBlock(const std::vector<UInt256> &chain, size_t height) {
+	BRMerkleBlock *block = BRMerkleBlockNew(nullptr);
+	block->blockHash = chain[height];
+	block->prevBlock = height > 0 ? chain[height - 1] : UINT256_ZERO;
+	block->height = (uint32_t) height;
+	return block;
+}
+
+TEST_CASE("Block download windows", "[BlockDownload]") {
+	std::vector<UInt256> chain = createChain(100);
+	BRPeer peers[3];
+	UInt256 hashes[10];
+	BRBlockDownload *download = BRBlockDownloadNew(10, 2, 5.0);
+
+	REQUIRE(BRBlockDownloadAddHashes(download, &chain[0], 45) == 45);
+	REQUIRE(BRBlockDownloadAddHashes(download, &chain[40], 10) == 5);
+	REQUIRE(BRBlockDownloadPendingCount(download) == 50);
+
+	SECTION("Windows are handed out in chain order, a few per peer") {
+		REQUIRE(BRBlockDownloadNextWindow(download, &peers[0], 0, hashes, 10) == 10);
+		REQUIRE(UInt256Eq(&hashes[0], &chain[0]));
+		REQUIRE(BRBlockDownloadNextWindow(download, &peers[1], 0, hashes, 10) == 10);
+		REQUIRE(UInt256Eq(&hashes[0], &chain[10]));
+		REQUIRE(BRBlockDownloadNextWindow(download, &peers[0], 0, hashes, 10) == 10);
+		REQUIRE(UInt256Eq(&hashes[9], &chain[29]));
+		REQUIRE(BRBlockDownloadNextWindow(download, &peers[0], 0, hashes, 10) == 0);
+		REQUIRE(BRBlockDownloadNextWindow(download, &peers[2], 0, hashes, 10) == 10);
+		REQUIRE(BRBlockDownloadNextWindow(download, &peers[2], 0, hashes, 10) == 10);
+		REQUIRE(UInt256Eq(&hashes[9], &chain[49]));
+		REQUIRE(BRBlockDownloadNextWindow(download, &peers[1], 0, hashes, 10) == 0);
+
+		// a window of a requested tail isn't filled up, the new hashes start one of their own
+		REQUIRE(BRBlockDownloadAddHashes(download, &chain[50], 3) == 3);
+		REQUIRE(BRBlockDownloadNextWindow(download, &peers[1], 0, hashes, 10) == 3);
+		REQUIRE(UInt256Eq(&hashes[0], &chain[50]));
+	}
+
+	SECTION("Finished windows make room for more") {
+		REQUIRE(BRBlockDownloadNextWindow(download, &peers[0], 0, hashes, 10) == 10);
+		REQUIRE(BRBlockDownloadNextWindow(download, &peers[0], 0, hashes, 10) == 10);
+		for (size_t i = 0; i < 10; ++i)
+			REQUIRE(BRBlockDownloadReceived(download, chain[i], 1));
+		REQUIRE(!BRBlockDownloadReceived(download, chain[0], 1));
+		REQUIRE(!BRBlockDownloadReceived(download, chain[60], 1));
+		REQUIRE(BRBlockDownloadPendingCount(download) == 40);
+		REQUIRE(BRBlockDownloadNextWindow(download, &peers[0], 1, hashes, 10) == 10);
+		REQUIRE(UInt256Eq(&hashes[0], &chain[20]));
+	}
+
+	SECTION("Stalled and released windows go to other peers") {
+		REQUIRE(BRBlockDownloadNextWindow(download, &peers[0], 0, hashes, 10) == 10);
+		REQUIRE(BRBlockDownloadReceived(download, chain[3], 4));
+		for (size_t i = 0; i < 4; ++i)
+			REQUIRE(BRBlockDownloadNextWindow(download, &peers[1 + i / 2], 0, hashes, 10) == 10);
+		REQUIRE(BRBlockDownloadNextWindow(download, &peers[0], 3, hashes, 10) == 0);
+
+		BRBlockDownloadReleasePeer(download, &peers[2]);
+		REQUIRE(BRBlockDownloadNextWindow(download, &peers[0], 3, hashes, 10) == 10);
+		REQUIRE(UInt256Eq(&hashes[0], &chain[30]));
+
+		// windows nobody has come first, then the windows of peer 1 requested at 0 have stalled
+		REQUIRE(BRBlockDownloadNextWindow(download, &peers[2], 6, hashes, 10) == 10);
+		REQUIRE(UInt256Eq(&hashes[0], &chain[40]));
+		REQUIRE(BRBlockDownloadNextWindow(download, &peers[2], 6, hashes, 10) == 10);
+		REQUIRE(UInt256Eq(&hashes[0], &chain[10]));
+
+		// peer 0 received a block at 4, so its first window isn't stalled until 9, and only the missing blocks are
+		// requested again
+		REQUIRE(BRBlockDownloadNextWindow(download, &peers[1], 8, hashes, 10) == 0);
+		REQUIRE(BRBlockDownloadNextWindow(download, &peers[1], 9.5, hashes, 10) == 9);
+		REQUIRE(UInt256Eq(&hashes[2], &chain[2]));
+		REQUIRE(UInt256Eq(&hashes[3], &chain[4]));
+	}
+
+	SECTION("Blocks ahead of their parent are held") {
+		BRMerkleBlock *block = createBlock(chain, 5), *other = createBlock(chain, 6);
+		other->prevBlock = block->prevBlock;
+
+		REQUIRE(BRBlockDownloadHoldBlock(download, block) == nullptr);
+		REQUIRE(BRBlockDownloadHoldBlock(download, createBlock(chain, 8)) == nullptr);
+		REQUIRE(BRBlockDownloadHoldBlock(download, other) == block);
+		BRMerkleBlockFree(nullptr, block);
+		REQUIRE(BRBlockDownloadHeldCount(download) == 2);
+
+		REQUIRE(BRBlockDownloadNextBlock(download, chain[3]) == nullptr);
+		REQUIRE(BRBlockDownloadNextBlock(download, chain[4]) == other);
+		REQUIRE(BRBlockDownloadHeldCount(download) == 1);
+		BRMerkleBlockFree(nullptr, other);
+
+		BRBlockDownloadClear(download, nullptr, BRMerkleBlockFree);
+		REQUIRE(BRBlockDownloadHeldCount(download) == 0);
+		REQUIRE(BRBlockDownloadPendingCount(download) == 0);
+		REQUIRE(BRBlockDownloadNextWindow(download, &peers[0], 0, hashes, 10) == 0);
+	}
+
+	BRBlockDownloadFree(download, nullptr, BRMerkleBlockFree);
+}
+
+namespace {
+
+	class MockNode;
+
+	// the part of the peer manager the block download runs in: it queues the announced hashes, requests windows
+	// from the nodes and adds arriving blocks to the chain in height order
+	class MockSync {
+	public:
+		MockSync(const std::vector<UInt256> &chain, std::vector<MockNode *> &nodes) :
+				_chain(chain),
+				_nodes(nodes),
+				_download(BRBlockDownloadNew(BLOCK_DOWNLOAD_WINDOW_SIZE, BLOCK_DOWNLOAD_PEER_WINDOWS,
+											 BLOCK_DOWNLOAD_STALL_TIMEOUT)),
+				_height(0),
+				_maxHeld(0),
+				_outOfOrder(0) {
+		}
+
+		~MockSync() {
+			BRBlockDownloadFree(_download, nullptr, BRMerkleBlockFree);
+		}
+
+		void Announce(size_t start, size_t count);
+
+		void Relayed(MockNode *node, BRMerkleBlock *block);
+
+		void WaitForChain() {
+			boost::mutex::scoped_lock lock(_lock);
+			while (_height + 1 < _chain.size())
+				_synced.wait(lock);
+		}
+
+		size_t MaxHeld() const {
+			return _maxHeld;
+		}
+
+		size_t OutOfOrder() const {
+			return _outOfOrder;
+		}
+
+	private:
+		void RequestBlocks();
+
+		const std::vector<UInt256> &_chain;
+		std::vector<MockNode *> &_nodes;
+		BRBlockDownload *_download;
+		size_t _height, _maxHeld, _outOfOrder;
+		boost::mutex _lock;
+		boost::condition_variable _synced;
+	};
+
+	// a node that answers getdata after a round trip, and then sends the merkle blocks at a fixed rate
+	class MockNode {
+	public:
+		MockNode(const std::vector<UInt256> &chain, MockSync &sync, int latencyMs, int blockUs) :
+				_chain(chain),
+				_sync(sync),
+				_latency(boost::posix_time::milliseconds(latencyMs)),
+				_blockTime(boost::posix_time::microseconds(blockUs)),
+				_stop(false) {
+			for (size_t i = 0; i < chain.size(); ++i)
+				_heights[chain[i]] = i;
+			_thread = boost::thread(boost::bind(&MockNode::Run, this));
+		}
+
+		~MockNode() {
+			{
+				boost::mutex::scoped_lock lock(_lock);
+				_stop = true;
+			}
+			_requested.notify_one();
+			_thread.join();
+		}
+
+		BRPeer *Peer() {
+			return &_peer;
+		}
+
+		void SendGetdata(const UInt256 hashes[], size_t count) {
+			boost::mutex::scoped_lock lock(_lock);
+			boost::posix_time::ptime due = boost::posix_time::microsec_clock::universal_time() + _latency;
+			for (size_t i = 0; i < count; ++i)
+				_requests.push_back(std::make_pair(due, _heights[hashes[i]]));
+			_requested.notify_one();
+		}
+
+	private:
+		struct UInt256Less {
+			bool operator()(const UInt256 &a, const UInt256 &b) const {
+				return memcmp(&a, &b, sizeof(a)) < 0;
+			}
+		};
+
+		void Run() {
+			boost::mutex::scoped_lock lock(_lock);
+			while (true) {
+				while (!_stop && _requests.empty())
+					_requested.wait(lock);
+				if (_stop)
+					return;
+
+				std::pair<boost::posix_time::ptime, size_t> request = _requests.front();
+				_requests.pop_front();
+				lock.unlock();
+				boost::posix_time::ptime now = boost::posix_time::microsec_clock::universal_time();
+				if (request.first > now)
+					boost::this_thread::sleep(request.first - now);
+				boost::this_thread::sleep(_blockTime);
+				_sync.Relayed(this, createBlock(_chain, request.second));
+				lock.lock();
+			}
+		}
+
+		const std::vector<UInt256> &_chain;
+		MockSync &_sync;
+		BRPeer _peer;
+		std::map<UInt256, size_t, UInt256Less> _heights;
+		boost::posix_time::time_duration _latency, _blockTime;
+		std::deque<std::pair<boost::posix_time::ptime, size_t> > _requests;
+		bool _stop;
+		boost::mutex _lock;
+		boost::condition_variable _requested;
+		boost::thread _thread;
+	};
+
+	void MockSync::Announce(size_t start, size_t count) {
+		boost::mutex::scoped_lock lock(_lock);
+		BRBlockDownloadAddHashes(_download, &_chain[start], count);
+		RequestBlocks();
+	}
+
+	void MockSync::Relayed(MockNode *node, BRMerkleBlock *block) {
+		boost::mutex::scoped_lock lock(_lock);
+		double now = (double) time(nullptr);
+
+		if (!BRBlockDownloadReceived(_download, block->blockHash, now)) {
+			BRMerkleBlockFree(nullptr, block);
+			return;
+		}
+
+		if (!UInt256Eq(&block->prevBlock, &_chain[_height])) {
+			BRMerkleBlock *replaced = BRBlockDownloadHoldBlock(_download, block);
+			if (replaced)
+				BRMerkleBlockFree(nullptr, replaced);
+			_maxHeld = std::max(_maxHeld, BRBlockDownloadHeldCount(_download));
+		} else {
+			while (block) {
+				if (block->height != _height + 1)
+					_outOfOrder++;
+				_height = block->height;
+				BRMerkleBlockFree(nullptr, block);
+				block = BRBlockDownloadNextBlock(_download, _chain[_height]);
+			}
+		}
+
+		RequestBlocks();
+		if (_height + 1 == _chain.size())
+			_synced.notify_all();
+	}
+
+	void MockSync::RequestBlocks() {
+		UInt256 hashes[BLOCK_DOWNLOAD_WINDOW_SIZE];
+		double now = (double) time(nullptr);
+		size_t requested;
+
+		do {
+			requested = 0;
+			for (size_t i = 0; i < _nodes.size(); ++i) {
+				size_t count = BRBlockDownloadNextWindow(_download, _nodes[i]->Peer(), now, hashes,
+														 BLOCK_DOWNLOAD_WINDOW_SIZE);
+				if (count > 0) {
+					_nodes[i]->SendGetdata(hashes, count);
+					requested++;
+				}
+			}
+		} while (requested > 0);
+	}
+
+}
+
+TEST_CASE("Block download benchmark", "[.benchmark][BlockDownload]") {
+	// 20 ms round trips, 1000 filtered blocks per second from each node, and an inv of 100 hashes per round trip
+	const size_t blocks = 4000, invSize = 100;
+	const int latencyMs = 20, blockUs = 1000;
+	std::vector<UInt256> chain = createChain(blocks + 1);
+	const size_t peerCounts[] = {1, 2, 4, 8};
+
+	for (size_t p = 0; p < ARRAY_SIZE(peerCounts); ++p) {
+		std::vector<MockNode *> nodes;
+		MockSync sync(chain, nodes);
+		for (size_t i = 0; i < peerCounts[p]; ++i)
+			nodes.push_back(new MockNode(chain, sync, latencyMs, blockUs));
+
+		boost::posix_time::ptime start = boost::posix_time::microsec_clock::universal_time();
+		for (size_t height = 1; height <= blocks; height += invSize) {
+			sync.Announce(height, std::min(invSize, blocks + 1 - height));
+			boost::this_thread::sleep(boost::posix_time::milliseconds(latencyMs)); // the next getblocks round trip
+		}
+		sync.WaitForChain();
+		boost::posix_time::time_duration elapsed = boost::posix_time::microsec_clock::universal_time() - start;
+
+		for (size_t i = 0; i < nodes.size(); ++i)
+			delete nodes[i];
+		REQUIRE(sync.OutOfOrder() == 0);
+
+		std::cout << peerCounts[p] << " peer(s): " << blocks * 1000 / elapsed.total_milliseconds()
+				  << " blocks/s, at most " << sync.MaxHeld() << " blocks held for their parent" << std::endl;
+	}
+}
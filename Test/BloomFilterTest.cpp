@@ -0,0 +1,55 @@
+// Copyright (c) 2012-2018 The Elastos Open Source Project
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#define CATCH_CONFIG_MAIN
+
+#include "catch.hpp"
+#include "BRBloomFilter.h"
+#include "BRInt.h"
+
+TEST_CASE("Bloom filter false positive rate projection", "[BloomFilter]") {
+	const size_t capacity = 1000;
+	BRBloomFilter *filter = BRBloomFilterNew(BLOOM_REDUCED_FALSEPOSITIVE_RATE, capacity, 0, BLOOM_UPDATE_ALL);
+	uint8_t data[sizeof(uint32_t)];
+
+	SECTION("A filter filled to capacity projects the rate it was built for") {
+		double rate = BRBloomFilterFalsePositiveRate(filter, capacity);
+		REQUIRE(rate > BLOOM_REDUCED_FALSEPOSITIVE_RATE/2);
+		REQUIRE(rate < BLOOM_REDUCED_FALSEPOSITIVE_RATE*2);
+		REQUIRE(BRBloomFilterFalsePositiveRate(filter, 0) == 0);
+	}
+
+	SECTION("The projection rises with the elements added past capacity") {
+		double previous = 0;
+
+		for (size_t count = capacity/2; count <= capacity*4; count += capacity/2) {
+			double rate = BRBloomFilterFalsePositiveRate(filter, count);
+			REQUIRE(rate > previous);
+			previous = rate;
+		}
+
+		REQUIRE(BRBloomFilterFalsePositiveRate(filter, capacity*2) > BLOOM_REDUCED_FALSEPOSITIVE_RATE*10);
+	}
+
+	SECTION("The projection matches the observed rate") {
+		size_t matches = 0;
+
+		for (uint32_t i = 0; i < capacity*2; i++) {
+			UInt32SetLE(data, i);
+			BRBloomFilterInsertData(filter, data, sizeof(data));
+		}
+
+		for (uint32_t i = capacity*2; i < capacity*2 + 100000; i++) {
+			UInt32SetLE(data, i);
+			if (BRBloomFilterContainsData(filter, data, sizeof(data))) matches++;
+		}
+
+		double rate = BRBloomFilterFalsePositiveRate(filter, filter->elemCount);
+		REQUIRE(filter->elemCount == capacity*2);
+		REQUIRE(matches/100000.0 > rate/2);
+		REQUIRE(matches/100000.0 < rate*2);
+	}
+
+	BRBloomFilterFree(filter);
+}
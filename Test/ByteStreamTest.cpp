@@ -0,0 +1,178 @@
+// Copyright (c) 2012-2018 The Elastos Open Source Project
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#define CATCH_CONFIG_MAIN
+
+#include <iostream>
+#include <boost/date_time/posix_time/posix_time.hpp>
+
+#include "catch.hpp"
+#include "ByteStream.h"
+#include "TestHelper.h"
+
+using namespace Elastos::ElaWallet;
+
+TEST_CASE("ByteStream read and write", "[ByteStream]") {
+	srand(time(nullptr));
+
+	SECTION("Integers in both byte orders") {
+		ByteStream stream;
+		stream.writeUint8(0x12);
+		stream.writeUint16(0x1234);
+		stream.writeUint32(0x12345678);
+		stream.writeUint64(0x123456789abcdef0ULL);
+		stream.putUint32(0x12345678);
+		REQUIRE(stream.length() == 19);
+
+		const uint8_t expected[] = {0x12, 0x34, 0x12, 0x78, 0x56, 0x34, 0x12, 0xf0, 0xde, 0xbc, 0x9a, 0x78, 0x56, 0x34,
+									0x12, 0x78, 0x56, 0x34, 0x12};
+		REQUIRE(memcmp(stream.data(), expected, sizeof(expected)) == 0);
+
+		ByteStream be(true);
+		be.putUint16(0x1234);
+		be.putInt(0x12345678);
+		be.putUint64(0x123456789abcdef0ULL);
+		const uint8_t expectedBe[] = {0x12, 0x34, 0x12, 0x34, 0x56, 0x78, 0x12, 0x34, 0x56, 0x78, 0x9a, 0xbc, 0xde,
+									  0xf0};
+		REQUIRE(be.length() == sizeof(expectedBe));
+		REQUIRE(memcmp(be.data(), expectedBe, sizeof(expectedBe)) == 0);
+
+		be.setPosition(0);
+		REQUIRE(be.getUint16() == 0x1234);
+		REQUIRE(be.getInt() == 0x12345678);
+		REQUIRE(be.getUint64() == 0x123456789abcdef0ULL);
+		REQUIRE(be.good());
+	}
+
+	SECTION("Variable length fields") {
+		const uint64_t values[] = {0, 0xfc, 0xfd, 0xffff, 0x10000, 0xffffffffULL, 0x100000000ULL};
+		CMBlock bytes = getRandCMBlock(300);
+		std::string str = getRandString(70);
+
+		ByteStream stream;
+		for (size_t i = 0; i < ARRAY_SIZE(values); ++i)
+			stream.writeVarUint(values[i]);
+		stream.writeVarBytes(bytes);
+		stream.writeVarString(str);
+
+		stream.setPosition(0);
+		for (size_t i = 0; i < ARRAY_SIZE(values); ++i) {
+			uint64_t value = 0;
+			REQUIRE(stream.readVarUint(value));
+			REQUIRE(value == values[i]);
+		}
+		CMBlock bytes1;
+		REQUIRE(stream.readVarBytes(bytes1));
+		REQUIRE(bytes1.GetSize() == bytes.GetSize());
+		REQUIRE(memcmp(bytes1, bytes, bytes.GetSize()) == 0);
+		std::string str1;
+		REQUIRE(stream.readVarString(str1));
+		REQUIRE(str1 == str);
+		REQUIRE(stream.position() == stream.length());
+	}
+
+	SECTION("Borrowed buffers are read in place and never written") {
+		uint8_t buf[] = {0x02, 0xaa, 0xbb, 0x01};
+		ByteStream stream((const uint8_t *) buf, sizeof(buf));
+		REQUIRE(stream.data() == buf);
+
+		const uint8_t *bytes = nullptr;
+		size_t len = 0;
+		REQUIRE(stream.readVarBytes(bytes, len));
+		REQUIRE(bytes == &buf[1]);
+		REQUIRE(len == 2);
+
+		stream.setPosition(0);
+		stream.writeUint8(0x03);
+		REQUIRE(buf[0] == 0x02);
+		REQUIRE(stream.data() != buf);
+		REQUIRE(stream.length() == 1);
+	}
+
+	SECTION("Taking the buffer leaves the stream empty") {
+		CMBlock bytes = getRandCMBlock(1000);
+		ByteStream stream;
+		stream.writeBytes(bytes, bytes.GetSize());
+		const uint8_t *data = stream.data();
+
+		CMBlock taken = stream.takeBuffer();
+		REQUIRE((const uint8_t *) taken == data);
+		REQUIRE(taken.GetSize() == bytes.GetSize());
+		REQUIRE(memcmp(taken, bytes, bytes.GetSize()) == 0);
+		REQUIRE(stream.length() == 0);
+		REQUIRE(stream.data() == nullptr);
+
+		stream.writeUint32(1);
+		REQUIRE(stream.takeBuffer().GetSize() == 4);
+	}
+
+	SECTION("Reading past the end fails for good") {
+		const uint8_t buf[] = {0x01, 0x02, 0x03};
+		ByteStream stream(buf, sizeof(buf));
+
+		uint32_t v32 = 0;
+		REQUIRE(!stream.readUint32(v32));
+		REQUIRE(!stream.good());
+		REQUIRE(stream.position() == 0);
+
+		uint8_t v8 = 0;
+		REQUIRE(!stream.readUint8(v8));
+		REQUIRE(stream.getUint16() == 0);
+
+		stream.reset();
+		REQUIRE(stream.good());
+	}
+
+	SECTION("Lengths longer than the data are rejected before allocating") {
+		const uint8_t buf[] = {0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0x7f, 0x00};
+		ByteStream stream(buf, sizeof(buf));
+
+		CMBlock bytes;
+		REQUIRE(!stream.readVarBytes(bytes));
+		REQUIRE(bytes.GetSize() == 0);
+		REQUIRE(!stream.good());
+
+		const uint8_t truncated[] = {0xfe, 0x01};
+		ByteStream stream1(truncated, sizeof(truncated));
+		uint64_t value = 0;
+		REQUIRE(!stream1.readVarUint(value));
+	}
+}
+
+TEST_CASE("ByteStream benchmark", "[.benchmark][ByteStream]") {
+	const size_t rounds = 20000;
+	AuxPow auxPow = createDummyAuxPow();
+
+	boost::posix_time::ptime start = boost::posix_time::microsec_clock::universal_time();
+	size_t size = 0;
+	for (size_t i = 0; i < rounds; ++i) {
+		ByteStream stream;
+		auxPow.Serialize(stream);
+		size += stream.takeBuffer().GetSize();
+	}
+	boost::posix_time::time_duration serialize = boost::posix_time::microsec_clock::universal_time() - start;
+
+	ByteStream ostream;
+	auxPow.Serialize(ostream);
+	start = boost::posix_time::microsec_clock::universal_time();
+	for (size_t i = 0; i < rounds; ++i) {
+		ByteStream stream(ostream.data(), ostream.length());
+		AuxPow auxPow1;
+		REQUIRE(auxPow1.Deserialize(stream));
+	}
+	boost::posix_time::time_duration deserialize = boost::posix_time::microsec_clock::universal_time() - start;
+
+	const size_t fields = 1000000;
+	start = boost::posix_time::microsec_clock::universal_time();
+	ByteStream stream;
+	for (size_t i = 0; i < fields; ++i) {
+		stream.writeUint32((uint32_t) i);
+		stream.writeVarUint(i);
+	}
+	boost::posix_time::time_duration fieldWrites = boost::posix_time::microsec_clock::universal_time() - start;
+
+	std::cout << "aux pow of " << size / rounds << " bytes, serialize: " << serialize.total_nanoseconds() / rounds
+			  << " ns, deserialize: " << deserialize.total_nanoseconds() / rounds << " ns, "
+			  << fields << " integer and varint writes: " << fieldWrites.total_milliseconds() << " ms" << std::endl;
+}
@@ -0,0 +1,176 @@
+// Copyright (c) 2012-2018 The Elastos Open Source Project
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#define CATCH_CONFIG_MAIN
+
+#include <new>
+
+#include "catch.hpp"
+#include "CMemBlock.h"
+#include "ELATransaction.h"
+#include "SDK/Transaction/Transaction.h"
+#include "TestHelper.h"
+
+using namespace Elastos::ElaWallet;
+
+static size_t allocations = 0;
+
+void *operator new(size_t size) {
+	++allocations;
+	void *p = malloc(size ? size : 1);
+	if (p == nullptr)
+		throw std::bad_alloc();
+	return p;
+}
+
+void operator delete(void *p) noexcept {
+	free(p);
+}
+
+static ELATransaction *createTransaction() {
+	ELATransaction *tx = ELATransactionNew();
+
+	for (size_t i = 0; i < 10; ++i) {
+		CMBlock script = getRandCMBlock(25);
+		CMBlock signature = getRandCMBlock(65);
+		BRTransactionAddInput(&tx->raw, getRandUInt256(), i, rand(), script, script.GetSize(), signature,
+							  signature.GetSize(), TXIN_SEQUENCE);
+	}
+
+	for (size_t i = 0; i < 10; ++i) {
+		ELATxOutput *o = ELATxOutputNew();
+		o->assetId = getRandUInt256();
+		o->programHash = getRandUInt168();
+		o->raw.amount = rand();
+		tx->outputs.push_back(new TransactionOutput(o));
+	}
+
+	tx->type = ELATransaction::TransferAsset;
+	delete tx->payload;
+	tx->payload = ELAPayloadNew(tx->type);
+
+	for (size_t i = 0; i < 10; ++i) {
+		tx->attributes.push_back(new Attribute(Attribute::Script, getRandCMBlock(32)));
+		tx->programs.push_back(new Program(getRandCMBlock(35), getRandCMBlock(65)));
+	}
+
+	return tx;
+}
+
+TEST_CASE("CMemBlock storage", "[CMemBlock]") {
+	SECTION("Empty blocks do not allocate") {
+		allocations = 0;
+		CMBlock a, b(0);
+		CMBlock c = a;
+		b = c;
+		REQUIRE(allocations == 0);
+		REQUIRE(a.GetSize() == 0);
+		REQUIRE(!a);
+	}
+
+	SECTION("Small payloads live in the block") {
+		allocations = 0;
+		CMBlock hash(32), script(CMEMBLOCK_INLINE_SIZE);
+		REQUIRE(allocations == 2);
+
+		CMBlock large(CMEMBLOCK_INLINE_SIZE + 1);
+		REQUIRE(allocations == 4);
+
+		// growing within the inline space keeps the same storage
+		hash[0] = 0x12;
+		hash.Resize(CMEMBLOCK_INLINE_SIZE);
+		REQUIRE(allocations == 4);
+		REQUIRE(hash[0] == 0x12);
+
+		hash.Resize(CMEMBLOCK_INLINE_SIZE * 4);
+		REQUIRE(allocations == 5);
+		REQUIRE(hash[0] == 0x12);
+		REQUIRE(hash.GetSize() == CMEMBLOCK_INLINE_SIZE * 4);
+	}
+
+	SECTION("Copies share, moves transfer") {
+		CMBlock block = getRandCMBlock(20);
+
+		allocations = 0;
+		CMBlock copy = block;
+		copy[0] = (uint8_t) (block[0] + 1);
+		REQUIRE(copy[0] == block[0]);
+
+		CMBlock moved(std::move(copy));
+		REQUIRE(copy.GetSize() == 0);
+		REQUIRE(moved.GetSize() == 20);
+		REQUIRE((const uint8_t *) moved == (const uint8_t *) block);
+
+		copy = std::move(moved);
+		REQUIRE(moved.GetSize() == 0);
+		REQUIRE(copy.GetSize() == 20);
+		REQUIRE(allocations == 0);
+	}
+
+	SECTION("Editing") {
+		CMBlock block;
+		for (uint8_t i = 0; i < 100; ++i)
+			block.push_back(i);
+		REQUIRE(block.GetSize() == 100);
+		block.DelAt(0);
+		REQUIRE(block.GetSize() == 99);
+		REQUIRE(block[0] == 1);
+		REQUIRE(block[98] == 99);
+
+		CMBlock tail = getRandCMBlock(3);
+		CMBlock sum = block + tail;
+		block += tail;
+		REQUIRE(block.GetSize() == 102);
+		REQUIRE(memcmp(block, sum, sum.GetSize()) == 0);
+		REQUIRE(memcmp(block + 99, tail, tail.GetSize()) == 0);
+
+		block += block;
+		REQUIRE(block.GetSize() == 204);
+		REQUIRE(memcmp(block + 102, sum, sum.GetSize()) == 0);
+
+		uint8_t *adopted = (uint8_t *) malloc(4);
+		block.SetMem(adopted, 4);
+		REQUIRE((uint8_t *) block == adopted);
+
+		const uint8_t fixed[] = {1, 2, 3};
+		block.SetMemFixed(fixed, sizeof(fixed));
+		block.DelAt(0);
+		REQUIRE(fixed[0] == 1);
+		REQUIRE(block[0] == 2);
+	}
+
+	SECTION("Single owner buffers") {
+		allocations = 0;
+		CMemBuffer<uint8_t> small(CMEMBLOCK_INLINE_SIZE), large(1000);
+		REQUIRE(allocations == 1);
+
+		memset(small, 0x12, small.GetSize());
+		memset(large, 0x34, large.GetSize());
+		CMemBuffer<uint8_t> small1(std::move(small)), large1(std::move(large));
+		REQUIRE(allocations == 1);
+		REQUIRE(small.GetSize() == 0);
+		REQUIRE(large.GetSize() == 0);
+		REQUIRE(small1.GetSize() == CMEMBLOCK_INLINE_SIZE);
+		REQUIRE(small1[CMEMBLOCK_INLINE_SIZE - 1] == 0x12);
+		REQUIRE(large1[999] == 0x34);
+	}
+}
+
+TEST_CASE("CMemBlock allocations in transaction round trip", "[CMemBlock]") {
+	Transaction txn(createTransaction());
+
+	allocations = 0;
+	ByteStream stream;
+	txn.Serialize(stream);
+	stream.setPosition(0);
+	Transaction txn1;
+	REQUIRE(txn1.Deserialize(stream));
+	size_t roundTrip = allocations;
+
+	REQUIRE(txn1.getHash().u64[0] == txn.getHash().u64[0]);
+
+	// the attribute and program payloads are small enough to live in their blocks; it was 130 when every block
+	// allocated its data separately
+	REQUIRE(roundTrip <= 100);
+}
@@ -0,0 +1,152 @@
+// Copyright (c) 2012-2018 The Elastos Open Source Project
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#define CATCH_CONFIG_MAIN
+
+#include <iostream>
+#include <boost/date_time/posix_time/posix_time.hpp>
+
+#include "catch.hpp"
+#include "CoinSelection.h"
+#include "SDK/Transaction/TransactionOutput.h"
+
+using namespace Elastos::ElaWallet;
+
+#define BASIC_UINT 100000000ULL
+#define FEE_PER_KB 10000ULL
+#define BASE_SIZE 200
+
+static Coin newCoin(uint64_t amount, uint32_t index) {
+	BRUTXO utxo = {UINT256_ZERO, 0};
+	memcpy(utxo.hash.u8, &index, sizeof(index));
+	return Coin(amount, utxo, nullptr);
+}
+
+static CoinSet newCoins(const std::vector<uint64_t> &amounts) {
+	CoinSet coins;
+	for (size_t i = 0; i < amounts.size(); ++i) {
+		coins.insert(newCoin(amounts[i], (uint32_t) i));
+	}
+	return coins;
+}
+
+static std::vector<uint64_t> selectedAmounts(const CoinSelection &selection) {
+	std::vector<uint64_t> amounts;
+	for (size_t i = 0; i < selection.getSelected().size(); ++i) {
+		amounts.push_back(selection.getSelected()[i].amount / BASIC_UINT);
+	}
+	return amounts;
+}
+
+static bool excludeFive(const Coin &coin) {
+	return coin.amount != 5 * BASIC_UINT;
+}
+
+TEST_CASE("Coin selection strategies", "[CoinSelection]") {
+	CoinSet coins = newCoins({1 * BASIC_UINT, 2 * BASIC_UINT, 5 * BASIC_UINT, 10 * BASIC_UINT, 50 * BASIC_UINT,
+							  100 * BASIC_UINT});
+
+	SECTION("Size and fee grow with the inputs") {
+		CoinSelection selection(coins, 1, FEE_PER_KB, BASE_SIZE);
+		REQUIRE(selection.getSize(0) == BASE_SIZE);
+		REQUIRE(selection.getSize(3) == BASE_SIZE + 3 * TX_UNSIGNED_INPUT_SIZE);
+		REQUIRE(selection.getSize(300) == BASE_SIZE + 2 + 300 * TX_UNSIGNED_INPUT_SIZE);
+		REQUIRE(selection.getFee(0) == FEE_PER_KB);
+		REQUIRE(selection.getFee(30) == 2 * FEE_PER_KB);
+	}
+
+	SECTION("Threshold takes the coins below the threshold from the largest down") {
+		CoinSelection selection(coins, 7 * BASIC_UINT, FEE_PER_KB, BASE_SIZE);
+		REQUIRE(ThresholdCoinSelection().select(selection));
+		REQUIRE(selectedAmounts(selection) == std::vector<uint64_t>({10}));
+
+		CoinSelection large(coins, 40 * BASIC_UINT, FEE_PER_KB, BASE_SIZE);
+		REQUIRE(ThresholdCoinSelection().select(large));
+		REQUIRE(selectedAmounts(large) == std::vector<uint64_t>({50}));
+
+		CoinSelection filtered(coins, 4 * BASIC_UINT, FEE_PER_KB, BASE_SIZE, excludeFive);
+		REQUIRE(ThresholdCoinSelection().select(filtered));
+		REQUIRE(selectedAmounts(filtered) == std::vector<uint64_t>({2, 1, 10}));
+		REQUIRE(!filtered.isChangeless());
+		REQUIRE(filtered.getFee() == filtered.getFee(3));
+	}
+
+	SECTION("Largest first") {
+		CoinSelection selection(coins, 120 * BASIC_UINT, FEE_PER_KB, BASE_SIZE);
+		REQUIRE(LargestFirstCoinSelection().select(selection));
+		REQUIRE(selectedAmounts(selection) == std::vector<uint64_t>({100, 50}));
+
+		CoinSelection tooMuch(coins, 200 * BASIC_UINT, FEE_PER_KB, BASE_SIZE);
+		REQUIRE(!LargestFirstCoinSelection().select(tooMuch));
+		REQUIRE(!tooMuch.isOversized());
+	}
+
+	SECTION("Branch and bound finds a set without change") {
+		CoinSelection probe(coins, 0, FEE_PER_KB, BASE_SIZE);
+		uint64_t amount = 16 * BASIC_UINT - probe.getFee(3);
+
+		CoinSelection selection(coins, amount, FEE_PER_KB, BASE_SIZE);
+		REQUIRE(BranchAndBoundCoinSelection().select(selection));
+		REQUIRE(selection.isChangeless());
+		REQUIRE(selectedAmounts(selection) == std::vector<uint64_t>({10, 5, 1}));
+		REQUIRE(selection.getFee() == probe.getFee(3));
+
+		// a little below the exact amount the excess still isn't worth a change output
+		CoinSelection close(coins, amount - 100, FEE_PER_KB, BASE_SIZE);
+		REQUIRE(BranchAndBoundCoinSelection().select(close));
+		REQUIRE(close.isChangeless());
+		REQUIRE(close.getFee() == probe.getFee(3) + 100);
+
+		// no exact set, same as the threshold heuristic
+		CoinSelection fallback(coins, 7 * BASIC_UINT, FEE_PER_KB, BASE_SIZE);
+		REQUIRE(BranchAndBoundCoinSelection().select(fallback));
+		REQUIRE(!fallback.isChangeless());
+		REQUIRE(selectedAmounts(fallback) == std::vector<uint64_t>({10}));
+	}
+
+	SECTION("Oversized transaction") {
+		std::vector<uint64_t> amounts(5000, BASIC_UINT);
+		CoinSet many = newCoins(amounts);
+
+		CoinSelection selection(many, 4000 * BASIC_UINT, FEE_PER_KB, BASE_SIZE);
+		REQUIRE(!ThresholdCoinSelection().select(selection));
+		REQUIRE(selection.isOversized());
+		REQUIRE(selection.getSize(selection.getSelected().size()) + TX_RECHARGE_OUTPUT_SIZE <= TX_MAX_SIZE);
+		REQUIRE(selection.getOversizedFee() == selection.getFee(selection.getSelected().size() + 1) + FEE_PER_KB);
+	}
+}
+
+TEST_CASE("Coin selection benchmark", "[.benchmark][CoinSelection]") {
+	const size_t counts[] = {1000, 10000, 50000};
+	const int rounds = 1000;
+
+	for (size_t c = 0; c < sizeof(counts) / sizeof(counts[0]); ++c) {
+		std::vector<uint64_t> amounts(counts[c]);
+		srand(1);
+		for (size_t i = 0; i < amounts.size(); ++i) {
+			amounts[i] = (uint64_t) (rand() % 100000 + 1) * 10000;
+		}
+		CoinSet coins = newCoins(amounts);
+
+		ThresholdCoinSelection threshold;
+		BranchAndBoundCoinSelection branchAndBound;
+		LargestFirstCoinSelection largestFirst;
+		const ICoinSelectionStrategy *strategies[] = {&threshold, &branchAndBound, &largestFirst};
+		const char *names[] = {"threshold", "branch and bound", "largest first"};
+
+		for (size_t s = 0; s < sizeof(strategies) / sizeof(strategies[0]); ++s) {
+			size_t inputs = 0;
+			boost::posix_time::ptime start = boost::posix_time::microsec_clock::universal_time();
+			for (int r = 0; r < rounds; ++r) {
+				CoinSelection selection(coins, (uint64_t) (rand() % 5000 + 1) * BASIC_UINT / 100, FEE_PER_KB, BASE_SIZE);
+				REQUIRE(strategies[s]->select(selection));
+				inputs += selection.getSelected().size();
+			}
+			boost::posix_time::time_duration elapsed = boost::posix_time::microsec_clock::universal_time() - start;
+
+			std::cout << counts[c] << " utxos, " << names[s] << ": " << (double) elapsed.total_microseconds() / rounds
+					  << " us per selection, " << (double) inputs / rounds << " inputs" << std::endl;
+		}
+	}
+}
@@ -5,6 +5,8 @@
 #define CATCH_CONFIG_MAIN
 
 #include <fstream>
+#include <atomic>
+#include <boost/thread.hpp>
 
 #include "TransactionDataStore.h"
 #include "DatabaseManager.h"
@@ -64,6 +66,18 @@ TEST_CASE("DatabaseManager test", "[DatabaseManager]") {
 			}
 		}
 
+		SECTION("Merkle Block visit test") {
+			DatabaseManager dbm(DBFILE);
+			size_t visited = 0;
+			REQUIRE(dbm.visitMerkleBlocks(ISO, [&visited](const MerkleBlockEntityView &view) {
+				REQUIRE(view.blockHeight == blocksToSave[visited].blockHeight);
+				REQUIRE(view.blockSize == blocksToSave[visited].blockBytes.GetSize());
+				REQUIRE(0 == memcmp(view.blockBytes, blocksToSave[visited].blockBytes, view.blockSize));
+				return ++visited < 5;
+			}));
+			REQUIRE(visited == 5);
+		}
+
 		SECTION("Merkle Block delete test") {
 			DatabaseManager dbm(DBFILE);
 
@@ -255,6 +269,44 @@ TEST_CASE("DatabaseManager test", "[DatabaseManager]") {
 			}
 		}
 
+		SECTION("Transaction statement cache test") {
+			DatabaseManager dbm(DBFILE);
+
+			for (int i = 0; i < txToUpdate.size(); ++i) {
+				REQUIRE(dbm.updateTransaction(ISO, txToUpdate[i]));
+			}
+
+			std::vector<SqliteStatementStats> stats = dbm.getStatementStats();
+			bool found = false;
+			for (size_t i = 0; i < stats.size(); ++i) {
+				if (stats[i].sql.find("UPDATE transactionTable") == 0) {
+					found = true;
+					REQUIRE(stats[i].prepareCount == 1);
+					REQUIRE(stats[i].hitCount == txToUpdate.size() - 1);
+					REQUIRE(stats[i].execCount == txToUpdate.size());
+				}
+			}
+			REQUIRE(found);
+		}
+
+		SECTION("Transaction batch put test") {
+			DatabaseManager dbm(DBFILE);
+
+			REQUIRE(dbm.putTransactions(ISO, txToUpdate));
+
+			std::vector<TransactionEntity> readTx = dbm.getAllTransactions(ISO);
+			REQUIRE(TEST_TX_RECORD_CNT == readTx.size());
+
+			for (int i = 0; i < readTx.size(); ++i) {
+				REQUIRE(txToUpdate[i].buff.GetSize() == readTx[i].buff.GetSize());
+				REQUIRE(0 == memcmp(readTx[i].buff, txToUpdate[i].buff, txToUpdate[i].buff.GetSize()));
+				REQUIRE(readTx[i].txHash == txToUpdate[i].txHash);
+				REQUIRE(readTx[i].timeStamp == txToUpdate[i].timeStamp);
+				REQUIRE(readTx[i].blockHeight == txToUpdate[i].blockHeight);
+				REQUIRE(readTx[i].remark == txToUpdate[i].remark);
+			}
+		}
+
 		SECTION("Transaction delete by txHash test") {
 			DatabaseManager dbm(DBFILE);
 
@@ -416,4 +468,127 @@ TEST_CASE("DatabaseManager test", "[DatabaseManager]") {
 		REQUIRE(0 == count);
 	}
 
+	SECTION("Address transaction index test") {
+		DatabaseManager dbm(DBFILE);
+		REQUIRE(dbm.deleteAllAddressTxs(ISO));
+
+		std::string addr1 = getRandString(34), addr2 = getRandString(34);
+		std::vector<AddressTxEntity> entities;
+		for (uint32_t i = 0; i < 10; ++i) {
+			std::string hash = getRandString(64);
+			entities.push_back(AddressTxEntity(addr1, hash, i));
+			if (i % 2 == 0)
+				entities.push_back(AddressTxEntity(addr2, hash, i));
+		}
+		REQUIRE(dbm.putAddressTxs(ISO, entities));
+		REQUIRE(dbm.putAddressTxs(ISO, entities));
+
+		REQUIRE(dbm.getAddressTxsCount(ISO, addr1) == 10);
+		REQUIRE(dbm.getAddressTxsCount(ISO, addr2) == 5);
+
+		std::vector<AddressTxEntity> page = dbm.getAddressTxs(ISO, addr1, 2, 3);
+		REQUIRE(page.size() == 3);
+		REQUIRE(page[0].blockHeight == 7);
+		REQUIRE(page[2].blockHeight == 5);
+
+		REQUIRE(dbm.updateAddressTxHeight(ISO, entities[0].txHash, 100));
+		page = dbm.getAddressTxs(ISO, addr2, 0, 1);
+		REQUIRE(page.size() == 1);
+		REQUIRE(page[0].txHash == entities[0].txHash);
+		REQUIRE(page[0].blockHeight == 100);
+
+		REQUIRE(dbm.deleteAddressTxsByHash(ISO, entities[0].txHash));
+		REQUIRE(dbm.getAddressTxsCount(ISO, addr1) == 9);
+		REQUIRE(dbm.getAddressTxsCount(ISO, addr2) == 4);
+		REQUIRE(dbm.getAllAddressTxs(ISO).size() == 13);
+	}
+
+	SECTION("Concurrent read test") {
+		DatabaseManager dbm(DBFILE);
+		REQUIRE(dbm.deleteAllBlocks(ISO));
+
+		std::vector<MerkleBlockEntity> blocks;
+		for (uint32_t i = 0; i < 100; ++i) {
+			MerkleBlockEntity block;
+			block.blockBytes = getRandCMBlock(80);
+			block.blockHeight = i;
+			blocks.push_back(block);
+		}
+
+		boost::mutex mutex;
+		boost::condition_variable condition;
+		bool writing = false, readsDone = false, writerTimedOut = false;
+
+		// The writer holds its transaction open until every read has returned. A read waiting on the
+		// writer would stall until the writer gives up.
+		boost::thread writer([&]() {
+			dbm.doTransaction([&]() {
+				dbm.putMerkleBlocks(ISO, blocks);
+
+				boost::mutex::scoped_lock lock(mutex);
+				writing = true;
+				condition.notify_all();
+				while (!readsDone && !writerTimedOut) {
+					writerTimedOut = !condition.timed_wait(lock, boost::posix_time::seconds(10));
+				}
+			});
+		});
+
+		{
+			boost::mutex::scoped_lock lock(mutex);
+			while (!writing)
+				condition.wait(lock);
+		}
+
+		std::atomic<size_t> reads(0), uncommittedSeen(0);
+		boost::thread_group readers;
+		for (int i = 0; i < 4; ++i) {
+			readers.create_thread([&]() {
+				for (int n = 0; n < 50; ++n) {
+					if (!dbm.getAllMerkleBlocks(ISO).empty())
+						uncommittedSeen++;
+					dbm.getAllTransactionsCount(ISO);
+					reads++;
+				}
+			});
+		}
+		readers.join_all();
+
+		{
+			boost::mutex::scoped_lock lock(mutex);
+			readsDone = true;
+			condition.notify_all();
+		}
+		writer.join();
+
+		REQUIRE(!writerTimedOut);
+		REQUIRE(reads == 200);
+		REQUIRE(uncommittedSeen == 0);
+		REQUIRE(dbm.getAllMerkleBlocks(ISO).size() == blocks.size());
+	}
+
+	SECTION("Failed transaction rollback test") {
+		DatabaseManager dbm(DBFILE);
+		REQUIRE(dbm.deleteAllBlocks(ISO));
+
+		std::vector<MerkleBlockEntity> blocks;
+		for (uint32_t i = 0; i < 10; ++i) {
+			MerkleBlockEntity block;
+			block.blockBytes = getRandCMBlock(80);
+			block.blockHeight = i;
+			blocks.push_back(block);
+		}
+
+		REQUIRE(!dbm.doTransaction([&]() {
+			dbm.putMerkleBlocks(ISO, blocks);
+			throw std::logic_error("batch failed");
+		}));
+		REQUIRE(dbm.getAllMerkleBlocks(ISO).empty());
+
+		REQUIRE(dbm.doTransaction([&]() {
+			dbm.putMerkleBlocks(ISO, blocks);
+		}));
+		REQUIRE(dbm.getAllMerkleBlocks(ISO).size() == blocks.size());
+	}
+
 }
@@ -0,0 +1,119 @@
+// Copyright (c) 2012-2018 The Elastos Open Source Project
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#define CATCH_CONFIG_MAIN
+
+#include <csignal>
+#include <sys/resource.h>
+
+#include "catch.hpp"
+#include "HeaderStore.h"
+#include "TestHelper.h"
+
+using namespace Elastos::ElaWallet;
+
+#define HEADER_FILE "headers.test"
+
+static HeaderRecord makeRecord(uint32_t height) {
+	HeaderRecord record;
+	record.blockHash = getRandUInt256();
+	record.prevBlock = getRandUInt256();
+	record.merkleRoot = getRandUInt256();
+	record.height = height;
+	record.timestamp = height * 120;
+	record.target = 0x1d00ffff;
+	record.version = 1;
+	record.nonce = height;
+	return record;
+}
+
+TEST_CASE("HeaderStore test", "[HeaderStore]") {
+	boost::filesystem::remove(HEADER_FILE);
+
+	std::vector<HeaderRecord> records;
+	for (uint32_t height = 100; height < 10100; ++height) {
+		records.push_back(makeRecord(height));
+	}
+
+	SECTION("Append and reopen") {
+		{
+			HeaderStore store;
+			REQUIRE(store.open(HEADER_FILE));
+			for (size_t i = 0; i < records.size(); ++i) {
+				REQUIRE(store.put(records[i]));
+			}
+		}
+
+		HeaderStore store;
+		REQUIRE(store.open(HEADER_FILE));
+		REQUIRE(store.size() == records.size());
+		REQUIRE(store.firstHeight() == 100);
+		REQUIRE(store.lastHeight() == 10099);
+
+		HeaderRecord record;
+		REQUIRE(store.get(5000, record));
+		REQUIRE(UInt256Eq(&record.blockHash, &records[4900].blockHash));
+		REQUIRE(record.nonce == 5000);
+		REQUIRE(!store.get(99, record));
+		REQUIRE(!store.get(10100, record));
+	}
+
+	SECTION("Reorg truncates the chain") {
+		HeaderStore store;
+		REQUIRE(store.open(HEADER_FILE));
+		for (size_t i = 0; i < 100; ++i) {
+			REQUIRE(store.put(records[i]));
+		}
+
+		HeaderRecord fork = makeRecord(150);
+		REQUIRE(store.put(fork));
+		REQUIRE(store.lastHeight() == 150);
+
+		HeaderRecord record;
+		REQUIRE(store.get(150, record));
+		REQUIRE(UInt256Eq(&record.blockHash, &fork.blockHash));
+
+		store.truncate(120);
+		REQUIRE(store.lastHeight() == 119);
+	}
+
+	SECTION("Gap restarts the chain") {
+		HeaderStore store;
+		REQUIRE(store.open(HEADER_FILE));
+		REQUIRE(store.put(records[0]));
+		REQUIRE(store.put(records[10]));
+		REQUIRE(store.size() == 1);
+		REQUIRE(store.firstHeight() == 110);
+	}
+
+	SECTION("Chain survives a failed resize") {
+		HeaderStore store;
+		REQUIRE(store.open(HEADER_FILE));
+		for (size_t i = 0; i < 4096; ++i) {
+			REQUIRE(store.put(records[i]));
+		}
+
+		// the file can't grow past its initial capacity, so the next put fails
+		struct rlimit limit, small;
+		REQUIRE(getrlimit(RLIMIT_FSIZE, &limit) == 0);
+		small = limit;
+		small.rlim_cur = (rlim_t) boost::filesystem::file_size(HEADER_FILE);
+		void (*handler)(int) = signal(SIGXFSZ, SIG_IGN);
+		REQUIRE(setrlimit(RLIMIT_FSIZE, &small) == 0);
+		bool put = store.put(records[4096]);
+		REQUIRE(setrlimit(RLIMIT_FSIZE, &limit) == 0);
+		signal(SIGXFSZ, handler);
+
+		REQUIRE(!put);
+		REQUIRE(store.isOpen());
+		REQUIRE(store.size() == 4096);
+		REQUIRE(store.lastHeight() == 4195);
+		HeaderRecord record;
+		REQUIRE(store.get(4195, record));
+		REQUIRE(UInt256Eq(&record.blockHash, &records[4095].blockHash));
+
+		REQUIRE(store.put(records[4096]));
+		REQUIRE(store.size() == 4097);
+	}
+}
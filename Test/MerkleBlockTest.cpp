@@ -5,6 +5,7 @@
 #define CATCH_CONFIG_MAIN
 
 #include <Core/BRMerkleBlock.h>
+#include "BRCrypto.h"
 #include "BRMerkleBlock.h"
 #include "Utils.h"
 #include "catch.hpp"
@@ -47,6 +48,100 @@ TEST_CASE("MerkleBlock construct test", "[MerkleBlock]") {
 	}
 }
 
+// a BIP37 partial merkle tree over txHashes, built the way a full node does
+class PartialMerkleTree {
+public:
+	PartialMerkleTree(const std::vector<UInt256> &txHashes, const std::vector<bool> &matches) :
+		_txHashes(txHashes), _matches(matches), _bits(0) {
+		int height = 0;
+		while (width(height) > 1) height++;
+		root = hash(height, 0);
+		build(height, 0);
+	}
+
+	UInt256 root;
+	std::vector<UInt256> hashes;
+	std::vector<uint8_t> flags;
+
+private:
+	size_t width(int height) const { return (_txHashes.size() + (1 << height) - 1) >> height; }
+
+	UInt256 hash(int height, size_t pos) const {
+		if (height == 0)
+			return _txHashes[pos];
+
+		UInt256 pair[2], md;
+		pair[0] = hash(height - 1, pos * 2);
+		pair[1] = pos * 2 + 1 < width(height - 1) ? hash(height - 1, pos * 2 + 1) : pair[0];
+		BRSHA256_2(&md, pair, sizeof(pair));
+		return md;
+	}
+
+	void build(int height, size_t pos) {
+		bool parentOfMatch = false;
+		for (size_t p = pos << height; p < ((pos + 1) << height) && p < _txHashes.size(); ++p)
+			parentOfMatch |= _matches[p];
+
+		if (_bits % 8 == 0)
+			flags.push_back(0);
+		if (parentOfMatch)
+			flags.back() |= 1 << (_bits % 8);
+		_bits++;
+
+		if (height == 0 || !parentOfMatch) {
+			hashes.push_back(hash(height, pos));
+		} else {
+			build(height - 1, pos * 2);
+			if (pos * 2 + 1 < width(height - 1))
+				build(height - 1, pos * 2 + 1);
+		}
+	}
+
+	const std::vector<UInt256> &_txHashes;
+	const std::vector<bool> &_matches;
+	size_t _bits;
+};
+
+TEST_CASE("Partial merkle tree root", "[MerkleBlock]") {
+	srand(time(nullptr));
+
+	const size_t txCounts[] = {1, 2, 3, 7, 8, 9, 100, 1025};
+	for (size_t c = 0; c < sizeof(txCounts) / sizeof(txCounts[0]); ++c) {
+		INFO("transactions " << txCounts[c]);
+		std::vector<UInt256> txHashes, matched;
+		std::vector<bool> matches;
+		for (size_t i = 0; i < txCounts[c]; ++i) {
+			txHashes.push_back(getRandUInt256());
+			matches.push_back(i == txCounts[c] - 1 || rand() % 5 == 0);
+			if (matches.back())
+				matched.push_back(txHashes.back());
+		}
+
+		PartialMerkleTree tree(txHashes, matches);
+		BRMerkleBlock raw = BR_MERKLE_BLOCK_NONE;
+		raw.totalTx = (uint32_t) txHashes.size();
+		raw.hashes = tree.hashes.data();
+		raw.hashesCount = tree.hashes.size();
+		raw.flags = tree.flags.data();
+		raw.flagsLen = tree.flags.size();
+
+		std::vector<UInt256> found;
+		UInt256 root = MerkleBlock::MerkleBlockRoot(raw, &found);
+		REQUIRE(UInt256Eq(&root, &tree.root));
+		REQUIRE(found.size() == matched.size());
+		for (size_t i = 0; i < found.size(); ++i)
+			REQUIRE(UInt256Eq(&found[i], &matched[i]));
+		REQUIRE(BRMerkleBlockTxHashes(&raw, nullptr, 0) == matched.size());
+
+		// a tampered hash does not give the root
+		if (tree.hashes.size() >= 2) {
+			tree.hashes[1] = tree.hashes[0];
+			root = MerkleBlock::MerkleBlockRoot(raw, nullptr);
+			REQUIRE(!UInt256Eq(&root, &tree.root));
+		}
+	}
+}
+
 TEST_CASE("Json convert", "[json]") {
 
 	ELAMerkleBlock *merkleBlock = ELAMerkleBlockNew();
@@ -0,0 +1,132 @@
+// Copyright (c) 2012-2018 The Elastos Open Source Project
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#define CATCH_CONFIG_MAIN
+
+#include <set>
+
+#include "catch.hpp"
+#include "TestHelper.h"
+#include <Core/BROrphanPool.h>
+
+using namespace Elastos::ElaWallet;
+
+static std::set<BRMerkleBlock *> freedBlocks;
+
+static void freeBlock(void *info, BRMerkleBlock *block) {
+	freedBlocks.insert(block);
+	BRMerkleBlockFree(info, block);
+}
+
+static BRMerkleBlock *createOrphan(size_t hashesCount = 0) {
+	BRMerkleBlock *block = BRMerkleBlockNew(nullptr);
+	block->blockHash = getRandUInt256();
+	block->prevBlock = getRandUInt256();
+	block->height = BLOCK_UNKNOWN_HEIGHT;
+	if (hashesCount > 0) block->hashes = (UInt256 *) calloc(hashesCount, sizeof(UInt256));
+	block->hashesCount = hashesCount;
+	return block;
+}
+
+TEST_CASE("Orphan pool", "[OrphanPool]") {
+	const size_t blockSize = sizeof(BRMerkleBlock);
+	BRPeer peers[3];
+	BROrphanPool *pool = BROrphanPoolNew(10, 100*blockSize, 4, 40*blockSize);
+
+	freedBlocks.clear();
+
+	SECTION("Orphans are found by prevBlock") {
+		BRMerkleBlock *block = createOrphan(), *other = createOrphan();
+		other->prevBlock = block->prevBlock;
+
+		REQUIRE(BROrphanPoolAdd(pool, block, &peers[0], nullptr, freeBlock));
+		REQUIRE(BROrphanPoolNewest(pool) == block);
+		REQUIRE(BROrphanPoolNextBlock(pool, block->blockHash) == nullptr);
+
+		// an orphan with the same parent replaces the one in the pool
+		REQUIRE(BROrphanPoolAdd(pool, other, &peers[1], nullptr, freeBlock));
+		REQUIRE(freedBlocks.count(block) == 1);
+		REQUIRE(BROrphanPoolCount(pool) == 1);
+		REQUIRE(BROrphanPoolPeerCount(pool, &peers[0]) == 0);
+		REQUIRE(BROrphanPoolPeerCount(pool, &peers[1]) == 1);
+
+		REQUIRE(BROrphanPoolNextBlock(pool, other->prevBlock) == other);
+		REQUIRE(BROrphanPoolCount(pool) == 0);
+		REQUIRE(BROrphanPoolBytes(pool) == 0);
+		REQUIRE(BROrphanPoolNewest(pool) == nullptr);
+		REQUIRE(BROrphanPoolEvictedCount(pool) == 0);
+		BRMerkleBlockFree(nullptr, other);
+	}
+
+	SECTION("The oldest orphans are evicted once the pool is full") {
+		std::vector<BRMerkleBlock *> blocks;
+
+		for (size_t i = 0; i < 15; ++i) {
+			blocks.push_back(createOrphan());
+			REQUIRE(BROrphanPoolAdd(pool, blocks[i], &peers[i % 3], nullptr, freeBlock));
+		}
+
+		REQUIRE(BROrphanPoolCount(pool) == 10);
+		REQUIRE(BROrphanPoolEvictedCount(pool) == 5);
+		for (size_t i = 0; i < 5; ++i)
+			REQUIRE(freedBlocks.count(blocks[i]) == 1);
+		REQUIRE(BROrphanPoolNextBlock(pool, blocks[5]->prevBlock) == blocks[5]);
+		BRMerkleBlockFree(nullptr, blocks[5]);
+
+		// shrinking the pool evicts the oldest that are left
+		BROrphanPoolSetLimits(pool, 3, 100*blockSize, 4, 40*blockSize, nullptr, freeBlock);
+		REQUIRE(BROrphanPoolCount(pool) == 3);
+		REQUIRE(freedBlocks.count(blocks[11]) == 1);
+		REQUIRE(BROrphanPoolRemove(pool, blocks[12]));
+		BRMerkleBlockFree(nullptr, blocks[12]);
+		REQUIRE(BROrphanPoolCount(pool) == 2);
+	}
+
+	SECTION("Large orphans are evicted to stay within the memory limit") {
+		BRMerkleBlock *small = createOrphan();
+		REQUIRE(BROrphanPoolAdd(pool, small, &peers[0], nullptr, freeBlock));
+
+		std::vector<BRMerkleBlock *> blocks;
+		for (size_t i = 0; i < 3; ++i) {
+			blocks.push_back(createOrphan(blockSize + 1)); // three of them just fit, together with a small one they don't
+			REQUIRE(BROrphanPoolAdd(pool, blocks[i], &peers[i], nullptr, freeBlock));
+		}
+
+		REQUIRE(BROrphanPoolBytes(pool) <= 100*blockSize);
+		REQUIRE(freedBlocks.count(small) == 1);
+		REQUIRE(freedBlocks.count(blocks[0]) == 0);
+		REQUIRE(BROrphanPoolCount(pool) == 3);
+
+		// an orphan bigger than a peer may have in the pool isn't kept at all
+		BRMerkleBlock *huge = createOrphan(2*blockSize);
+		REQUIRE(!BROrphanPoolAdd(pool, huge, &peers[0], nullptr, freeBlock));
+		REQUIRE(freedBlocks.count(huge) == 1);
+		REQUIRE(BROrphanPoolCount(pool) == 2);
+		REQUIRE(BROrphanPoolNewest(pool) == blocks[2]);
+	}
+
+	SECTION("A peer only evicts its own orphans") {
+		BRMerkleBlock *block = createOrphan(), *other = createOrphan();
+
+		REQUIRE(BROrphanPoolAdd(pool, block, &peers[1], nullptr, freeBlock));
+		REQUIRE(BROrphanPoolAdd(pool, other, nullptr, nullptr, freeBlock));
+
+		for (size_t i = 0; i < 100; ++i)
+			REQUIRE(BROrphanPoolAdd(pool, createOrphan(), &peers[0], nullptr, freeBlock));
+
+		REQUIRE(BROrphanPoolPeerCount(pool, &peers[0]) == 4);
+		REQUIRE(BROrphanPoolEvictedCount(pool) == 96);
+		REQUIRE(BROrphanPoolCount(pool) == 6);
+		REQUIRE(BROrphanPoolNextBlock(pool, block->prevBlock) == block);
+		BRMerkleBlockFree(nullptr, block);
+
+		BROrphanPoolRemovePeer(pool, &peers[0], nullptr, freeBlock);
+		REQUIRE(BROrphanPoolCount(pool) == 1);
+		REQUIRE(BROrphanPoolPeerCount(pool, nullptr) == 1);
+		REQUIRE(BROrphanPoolNewest(pool) == other);
+		REQUIRE(freedBlocks.size() == 100);
+	}
+
+	BROrphanPoolFree(pool, nullptr, freeBlock);
+}
@@ -0,0 +1,498 @@
+// Copyright (c) 2012-2018 The Elastos Open Source Project
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#define CATCH_CONFIG_MAIN
+
+#include <atomic>
+#include <mutex>
+#include <vector>
+#include <string>
+#include <cstring>
+#include <unistd.h>
+#include <dirent.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <arpa/inet.h>
+#include <boost/thread.hpp>
+
+#include "catch.hpp"
+#include "BRPeer.h"
+#include "BRPeerMessages.h"
+#include "BRPeerManager.h"
+#include "BRPeerReactor.h"
+#include "BRCrypto.h"
+
+#if PEER_REACTOR
+
+#define MAGIC_NUMBER 0x12345678
+
+static void sleepMs(int ms) {
+	boost::this_thread::sleep(boost::posix_time::milliseconds(ms));
+}
+
+template<class Pred>
+static bool waitFor(Pred pred, int timeoutMs = 3000) {
+	for (int i = 0; i < timeoutMs / 10 && !pred(); ++i)
+		sleepMs(10);
+	return pred();
+}
+
+static size_t threadCount() {
+	size_t count = 0;
+	DIR *dir = opendir("/proc/self/task");
+
+	for (struct dirent *e; dir && (e = readdir(dir)) != nullptr;)
+		if (e->d_name[0] != '.') count++;
+	if (dir) closedir(dir);
+	return count;
+}
+
+struct TimerRecord {
+	std::mutex lock;
+	std::vector<int> fired;
+};
+
+struct TimerInfo {
+	TimerRecord *record;
+	int id;
+};
+
+static void timerFired(void *info) {
+	TimerInfo *timer = (TimerInfo *) info;
+	std::lock_guard<std::mutex> guard(timer->record->lock);
+	timer->record->fired.push_back(timer->id);
+}
+
+static void sourceReady(void *info, int events) {
+	std::atomic<size_t> *bytes = (std::atomic<size_t> *) info;
+	int fd = *(int *) ((char *) info + sizeof(std::atomic<size_t>));
+	char buf[64];
+	ssize_t n;
+
+	if ((events & PEER_REACTOR_READ) && (n = read(fd, buf, sizeof(buf))) > 0)
+		*bytes += n;
+}
+
+TEST_CASE("Peer reactor timers and sources", "[PeerReactor]") {
+	BRPeerReactor *reactor = BRPeerReactorNew();
+
+	SECTION("Timers fire in deadline order and never early") {
+		TimerRecord record;
+		TimerInfo infos[4] = {{&record, 0}, {&record, 1}, {&record, 2}, {&record, 3}};
+		BRPeerReactorTimer *timers[4];
+
+		for (size_t i = 0; i < 4; ++i)
+			timers[i] = BRPeerReactorTimerNew(reactor, &infos[i], timerFired);
+
+		boost::posix_time::ptime start = boost::posix_time::microsec_clock::universal_time();
+		BRPeerReactorTimerSet(timers[0], 0.3);
+		BRPeerReactorTimerSet(timers[1], 0.1);
+		BRPeerReactorTimerSet(timers[2], 0.2);
+		BRPeerReactorTimerSet(timers[3], 0.2);
+		BRPeerReactorTimerSet(timers[3], -1); // cancelled
+
+		REQUIRE(waitFor([&] {
+			std::lock_guard<std::mutex> guard(record.lock);
+			return record.fired.size() == 3;
+		}));
+		long elapsed = (boost::posix_time::microsec_clock::universal_time() - start).total_milliseconds();
+		sleepMs(300);
+
+		std::lock_guard<std::mutex> guard(record.lock);
+		REQUIRE(record.fired == std::vector<int>({1, 2, 0}));
+		REQUIRE(elapsed >= 300);
+
+		for (size_t i = 0; i < 4; ++i)
+			BRPeerReactorTimerFree(timers[i]);
+	}
+
+	SECTION("Timers beyond a turn of the wheel") {
+		TimerRecord record;
+		TimerInfo info = {&record, 7};
+		BRPeerReactorTimer *timer = BRPeerReactorTimerNew(reactor, &info, timerFired);
+
+		// same slot as a timer due in 0.1s, but a whole turn later
+		BRPeerReactorTimerSet(timer, PEER_REACTOR_WHEEL_SLOTS * PEER_REACTOR_TICK + 0.1);
+		sleepMs(300);
+		{
+			std::lock_guard<std::mutex> guard(record.lock);
+			REQUIRE(record.fired.empty());
+		}
+
+		BRPeerReactorTimerSet(timer, 0); // re-armed to fire on the next tick
+		REQUIRE(waitFor([&] {
+			std::lock_guard<std::mutex> guard(record.lock);
+			return record.fired.size() == 1;
+		}));
+		BRPeerReactorTimerFree(timer);
+	}
+
+	SECTION("Sources") {
+		int fds[2];
+		REQUIRE(socketpair(AF_UNIX, SOCK_STREAM, 0, fds) == 0);
+
+		struct {
+			std::atomic<size_t> bytes;
+			int fd;
+		} info;
+		info.bytes = 0;
+		info.fd = fds[0];
+
+		BRPeerReactorSource *source = BRPeerReactorAdd(reactor, fds[0], PEER_REACTOR_READ, &info, sourceReady);
+		REQUIRE(source != nullptr);
+		REQUIRE(BRPeerReactorSourceCount(reactor) == 1);
+
+		REQUIRE(write(fds[1], "hello", 5) == 5);
+		REQUIRE(waitFor([&] { return info.bytes == 5; }));
+
+		BRPeerReactorRemove(source);
+		REQUIRE(BRPeerReactorSourceCount(reactor) == 0);
+		REQUIRE(write(fds[1], "world", 5) == 5);
+		sleepMs(100);
+		REQUIRE(info.bytes == 5);
+
+		close(fds[0]);
+		close(fds[1]);
+	}
+
+	SECTION("Receive buffer pool") {
+		BRPeerBufferStats stats = {0, 0, 0, 0};
+		size_t capacity, largeCapacity;
+
+		uint8_t *buf = BRPeerReactorBufferGet(reactor, 100, &capacity);
+		REQUIRE(capacity == PEER_BUFFER_MIN_SIZE);
+		BRPeerReactorBufferPut(reactor, buf, capacity);
+		REQUIRE(BRPeerReactorBufferGet(reactor, PEER_BUFFER_MIN_SIZE, &capacity) == buf);
+		BRPeerReactorBufferPut(reactor, buf, capacity);
+
+		buf = BRPeerReactorBufferGet(reactor, PEER_BUFFER_MIN_SIZE + 1, &capacity);
+		REQUIRE(capacity == PEER_BUFFER_MIN_SIZE * 4);
+		BRPeerReactorBufferPut(reactor, buf, capacity);
+
+		// a buffer for the largest message is too big to keep
+		buf = BRPeerReactorBufferGet(reactor, MAX_MSG_LENGTH + HEADER_LENGTH, &largeCapacity);
+		REQUIRE(largeCapacity >= MAX_MSG_LENGTH + HEADER_LENGTH);
+		BRPeerReactorBufferPut(reactor, buf, largeCapacity);
+
+		BRPeerReactorBufferStats(reactor, &stats);
+		REQUIRE(stats.gets == 4);
+		REQUIRE(stats.hits == 1);
+		REQUIRE(stats.allocatedBytes == PEER_BUFFER_MIN_SIZE * 5 + largeCapacity);
+		REQUIRE(stats.pooledBytes == PEER_BUFFER_MIN_SIZE * 5);
+	}
+
+	BRPeerReactorFree(reactor);
+}
+
+struct PeerInfo {
+	std::atomic<int> disconnects;
+	std::atomic<int> error;
+};
+
+static void peerDisconnected(void *info, int error) {
+	PeerInfo *peerInfo = (PeerInfo *) info;
+	peerInfo->error = error;
+	peerInfo->disconnects++;
+}
+
+static std::vector<uint8_t> frame(const char *type, const std::vector<uint8_t> &payload) {
+	std::vector<uint8_t> msg(HEADER_LENGTH + payload.size());
+	uint8_t hash[32];
+
+	UInt32SetLE(&msg[0], MAGIC_NUMBER);
+	strncpy((char *) &msg[4], type, 12);
+	UInt32SetLE(&msg[16], (uint32_t) payload.size());
+	BRSHA256_2(hash, payload.data(), payload.size());
+	memcpy(&msg[20], hash, 4);
+	if (!payload.empty())
+		memcpy(&msg[HEADER_LENGTH], payload.data(), payload.size());
+	return msg;
+}
+
+static bool readFully(int fd, uint8_t *buf, size_t len) {
+	for (size_t off = 0; off < len;) {
+		struct pollfd p = {fd, POLLIN, 0};
+		if (poll(&p, 1, 3000) <= 0)
+			return false;
+		ssize_t n = read(fd, buf + off, len - off);
+		if (n <= 0)
+			return false;
+		off += n;
+	}
+	return true;
+}
+
+static bool readMessage(int fd, std::string &type, std::vector<uint8_t> &payload) {
+	uint8_t header[HEADER_LENGTH];
+
+	if (!readFully(fd, header, sizeof(header)) || UInt32GetLE(header) != MAGIC_NUMBER)
+		return false;
+	type = std::string((const char *) &header[4]);
+	payload.resize(UInt32GetLE(&header[16]));
+	return readFully(fd, payload.data(), payload.size());
+}
+
+class LocalNode {
+public:
+	LocalNode() {
+		struct sockaddr_in addr;
+		socklen_t len = sizeof(addr);
+
+		memset(&addr, 0, sizeof(addr));
+		addr.sin_family = AF_INET;
+		addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+		listenFd = socket(AF_INET, SOCK_STREAM, 0);
+		bind(listenFd, (struct sockaddr *) &addr, sizeof(addr));
+		listen(listenFd, 64);
+		getsockname(listenFd, (struct sockaddr *) &addr, &len);
+		port = ntohs(addr.sin_port);
+	}
+
+	~LocalNode() {
+		close(listenFd);
+	}
+
+	int Accept() {
+		struct pollfd p = {listenFd, POLLIN, 0};
+		return (poll(&p, 1, 3000) > 0) ? accept(listenFd, nullptr, nullptr) : -1;
+	}
+
+	int listenFd;
+	uint16_t port;
+};
+
+static BRPeer *newLocalPeer(BRPeerManager *manager, PeerInfo *info, uint16_t port) {
+	BRPeer *peer = BRPeerNew(MAGIC_NUMBER);
+
+	peer->address = ((UInt128) {0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0xff, 0xff, 127, 0, 0, 1});
+	peer->port = port;
+	((BRPeerContext *) peer)->manager = manager;
+	info->disconnects = 0;
+	info->error = 0;
+	BRPeerSetCallbacks(peer, info, nullptr, peerDisconnected, nullptr, nullptr, nullptr, nullptr, nullptr, nullptr,
+					   nullptr, nullptr, nullptr, nullptr, nullptr);
+	return peer;
+}
+
+TEST_CASE("Peers on the shared reactors", "[PeerReactor]") {
+	BRPeerManager *manager = (BRPeerManager *) calloc(1, sizeof(BRPeerManager));
+	BRMerkleBlock lastBlock;
+	pthread_mutexattr_t attr;
+
+	memset(&lastBlock, 0, sizeof(lastBlock));
+	lastBlock.height = 42;
+	manager->lastBlock = &lastBlock;
+	manager->peerMessages = BRPeerMessageNew();
+	pthread_mutexattr_init(&attr);
+	pthread_mutexattr_settype(&attr, PTHREAD_MUTEX_RECURSIVE);
+	pthread_mutex_init(&manager->lock, &attr);
+	pthread_mutexattr_destroy(&attr);
+
+	LocalNode node;
+
+	SECTION("Framing, resync and disconnect") {
+		PeerInfo info;
+		BRPeer *peer = newLocalPeer(manager, &info, node.port);
+		std::string type;
+		std::vector<uint8_t> payload;
+
+		BRPeerConnect(peer);
+		int fd = node.Accept();
+		REQUIRE(fd >= 0);
+		REQUIRE(readMessage(fd, type, payload));
+		REQUIRE(type == MSG_VERSION);
+
+		// garbage before the message, and the message split at odd places
+		std::vector<uint8_t> ping = frame(MSG_PING, std::vector<uint8_t>(8, 1));
+		std::vector<uint8_t> stream = {0x78, 0x56, 0x00, 0x12, 0xff};
+		stream.insert(stream.end(), ping.begin(), ping.end());
+		REQUIRE(write(fd, stream.data(), 7) == 7);
+		sleepMs(50);
+		REQUIRE(write(fd, stream.data() + 7, 20) == 20);
+		sleepMs(50);
+		REQUIRE(write(fd, stream.data() + 27, stream.size() - 27) == (ssize_t) (stream.size() - 27));
+
+		REQUIRE(readMessage(fd, type, payload));
+		REQUIRE(type == MSG_PONG);
+		REQUIRE(payload.size() == 8);
+		REQUIRE(UInt64GetLE(payload.data()) == 42);
+		REQUIRE(BRPeerConnectStatus(peer) == BRPeerStatusConnecting); // no verack yet
+
+		close(fd);
+		REQUIRE(waitFor([&] { return info.disconnects == 1; }));
+		REQUIRE(info.error == ECONNRESET);
+		REQUIRE(BRPeerConnectStatus(peer) == BRPeerStatusDisconnected);
+		BRPeerFree(peer);
+	}
+
+	SECTION("Filteradd") {
+		PeerInfo info;
+		BRPeer *peer = newLocalPeer(manager, &info, node.port);
+		std::string type;
+		std::vector<uint8_t> payload;
+		uint8_t data[21];
+
+		for (size_t i = 0; i < sizeof(data); i++) data[i] = (uint8_t) i;
+		BRPeerConnect(peer);
+		int fd = node.Accept();
+		REQUIRE(fd >= 0);
+		REQUIRE(readMessage(fd, type, payload));
+		manager->peerMessages->BRPeerSendFilteraddMessage(peer, data, sizeof(data));
+		REQUIRE(readMessage(fd, type, payload));
+		REQUIRE(type == MSG_FILTERADD);
+		REQUIRE(payload.size() == 1 + sizeof(data));
+		REQUIRE(payload[0] == sizeof(data));
+		REQUIRE(memcmp(&payload[1], data, sizeof(data)) == 0);
+
+		BRPeerDisconnect(peer);
+		REQUIRE(waitFor([&] { return info.disconnects == 1; }));
+		close(fd);
+		BRPeerFree(peer);
+	}
+
+	SECTION("Local disconnect and bad checksum") {
+		PeerInfo info;
+		BRPeer *peer = newLocalPeer(manager, &info, node.port);
+		std::string type;
+		std::vector<uint8_t> payload;
+
+		BRPeerConnect(peer);
+		int fd = node.Accept();
+		REQUIRE(fd >= 0);
+		REQUIRE(readMessage(fd, type, payload));
+		BRPeerDisconnect(peer);
+		REQUIRE(waitFor([&] { return info.disconnects == 1; }));
+		REQUIRE(info.error == ECONNRESET);
+		close(fd);
+
+		BRPeerConnect(peer);
+		fd = node.Accept();
+		REQUIRE(fd >= 0);
+		REQUIRE(readMessage(fd, type, payload));
+		std::vector<uint8_t> ping = frame(MSG_PING, std::vector<uint8_t>(8, 1));
+		ping[20] ^= 0xff;
+		REQUIRE(write(fd, ping.data(), ping.size()) == (ssize_t) ping.size());
+		REQUIRE(waitFor([&] { return info.disconnects == 2; }));
+		REQUIRE(info.error == EPROTO);
+		close(fd);
+		BRPeerFree(peer);
+	}
+
+	SECTION("A node that doesn't read is disconnected") {
+		PeerInfo info;
+		BRPeer *peer = newLocalPeer(manager, &info, node.port);
+		std::string type;
+		std::vector<uint8_t> payload, msg(0x100000, 0x55);
+
+		BRPeerConnect(peer);
+		int fd = node.Accept();
+		REQUIRE(fd >= 0);
+		REQUIRE(readMessage(fd, type, payload));
+
+		// once more than MAX_MSG_LENGTH is queued the peer gives up instead of dropping messages
+		for (size_t i = 0; i < 2*MAX_MSG_LENGTH/msg.size() && info.disconnects == 0; i++) {
+			BRPeerSendMessage(peer, msg.data(), msg.size(), MSG_TX);
+		}
+
+		REQUIRE(waitFor([&] { return info.disconnects == 1; }));
+		REQUIRE(info.error == ENOBUFS);
+		REQUIRE(BRPeerConnectStatus(peer) == BRPeerStatusDisconnected);
+		close(fd);
+		BRPeerFree(peer);
+	}
+
+	SECTION("Connection refused") {
+		PeerInfo info;
+		LocalNode closed;
+		uint16_t port = closed.port;
+		close(closed.listenFd);
+		closed.listenFd = socket(AF_INET, SOCK_STREAM, 0);
+
+		BRPeer *peer = newLocalPeer(manager, &info, port);
+		BRPeerConnect(peer);
+		REQUIRE(waitFor([&] { return info.disconnects == 1; }));
+		REQUIRE(info.error == ECONNREFUSED);
+		BRPeerFree(peer);
+	}
+
+	SECTION("Receive buffers are reused") {
+		PeerInfo info;
+		BRPeer *peer = newLocalPeer(manager, &info, node.port);
+		BRPeerReceiveStats before, after;
+		std::string type;
+		std::vector<uint8_t> payload, stream;
+		const size_t pings = 200;
+
+		BRPeerConnect(peer);
+		int fd = node.Accept();
+		REQUIRE(fd >= 0);
+		REQUIRE(readMessage(fd, type, payload));
+		BRPeerGetReceiveStats(&before);
+
+		for (size_t i = 0; i < pings; ++i) {
+			std::vector<uint8_t> ping = frame(MSG_PING, std::vector<uint8_t>(8, (uint8_t) i));
+			REQUIRE(write(fd, ping.data(), ping.size()) == (ssize_t) ping.size());
+			REQUIRE(readMessage(fd, type, payload));
+			REQUIRE(type == MSG_PONG);
+		}
+
+		// a message larger than the first buffer moves to a larger size class, and unknown types are dropped
+		stream = frame("unknown", std::vector<uint8_t>(300000, 0xab));
+		REQUIRE(write(fd, stream.data(), stream.size()) == (ssize_t) stream.size());
+		REQUIRE(waitFor([&] {
+			BRPeerGetReceiveStats(&after);
+			return after.messages == before.messages + pings + 1;
+		}));
+
+		uint64_t gets = after.bufferGets - before.bufferGets, hits = after.bufferHits - before.bufferHits;
+		uint64_t allocated = after.allocatedBytes - before.allocatedBytes;
+		REQUIRE(gets > 1); // a read may pick up the next ping too
+		REQUIRE(hits * 100 >= gets * 95);
+		REQUIRE(allocated <= PEER_BUFFER_MIN_SIZE << 10); // at most the one large buffer
+
+		close(fd);
+		REQUIRE(waitFor([&] { return info.disconnects == 1; }));
+		BRPeerFree(peer);
+	}
+
+	SECTION("Many peers share a few threads") {
+		const size_t count = 32;
+		std::vector<PeerInfo> infos(count);
+		std::vector<BRPeer *> peers;
+		std::vector<int> fds;
+		std::string type;
+		std::vector<uint8_t> payload;
+
+		BRPeerReactorShared(); // make sure the shared reactors are running
+		size_t threads = threadCount();
+
+		for (size_t i = 0; i < count; ++i) {
+			peers.push_back(newLocalPeer(manager, &infos[i], node.port));
+			BRPeerConnect(peers.back());
+		}
+
+		for (size_t i = 0; i < count; ++i) {
+			fds.push_back(node.Accept());
+			REQUIRE(fds.back() >= 0);
+			REQUIRE(readMessage(fds.back(), type, payload));
+			REQUIRE(type == MSG_VERSION);
+		}
+
+		REQUIRE(threadCount() == threads);
+
+		for (size_t i = 0; i < count; ++i)
+			close(fds[i]);
+		for (size_t i = 0; i < count; ++i) {
+			REQUIRE(waitFor([&] { return infos[i].disconnects == 1; }));
+			BRPeerFree(peers[i]);
+		}
+	}
+
+	BRPeerMessageFree(manager->peerMessages);
+	pthread_mutex_destroy(&manager->lock);
+	free(manager);
+}
+
+#endif // PEER_REACTOR
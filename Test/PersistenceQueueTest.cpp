@@ -0,0 +1,89 @@
+// Copyright (c) 2012-2018 The Elastos Open Source Project
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#define CATCH_CONFIG_MAIN
+
+#include "catch.hpp"
+#include "SpvService/PersistenceQueue.h"
+#include "TestHelper.h"
+
+using namespace Elastos::ElaWallet;
+
+#define ISO "els"
+#define DBFILE "persistence.db"
+
+TEST_CASE("PersistenceQueue test", "[PersistenceQueue]") {
+	if (boost::filesystem::exists(DBFILE) && boost::filesystem::is_regular_file(DBFILE)) {
+		boost::filesystem::remove(DBFILE);
+	}
+
+	DatabaseManager dbm(DBFILE);
+	REQUIRE(dbm.setDurability(DURABILITY_NORMAL));
+
+	SECTION("Coalesce and flush") {
+		PersistenceQueue queue(&dbm, ISO, 50, 100);
+
+		for (uint32_t i = 0; i < 120; ++i) {
+			TransactionEntity tx(getRandCMBlock(40), i, i, "remark", std::to_string(i));
+			queue.putTransaction(tx);
+			queue.updateTransaction(tx.txHash, i + 1000, i);
+		}
+		queue.deleteTransaction("7");
+		queue.flush();
+
+		std::vector<TransactionEntity> txs = dbm.getAllTransactions(ISO);
+		REQUIRE(txs.size() == 119);
+		for (size_t i = 0; i < txs.size(); ++i) {
+			REQUIRE(txs[i].txHash != "7");
+			REQUIRE(txs[i].blockHeight >= 1000);
+		}
+	}
+
+	SECTION("Replace supersedes queued blocks") {
+		PersistenceQueue queue(&dbm, ISO);
+
+		std::vector<MerkleBlockEntity> blocks;
+		for (uint32_t i = 0; i < 10; ++i) {
+			MerkleBlockEntity block;
+			block.blockBytes = getRandCMBlock(40);
+			block.blockHeight = i;
+			blocks.push_back(block);
+		}
+
+		queue.putMerkleBlocks(false, blocks);
+		queue.putMerkleBlocks(true, std::vector<MerkleBlockEntity>(blocks.begin(), blocks.begin() + 3));
+		queue.flush();
+
+		REQUIRE(dbm.getAllMerkleBlocks(ISO).size() == 3);
+	}
+
+	SECTION("Failed commits are retried") {
+		PersistenceQueue queue(&dbm, ISO, 500, 50);
+		sqlite3 *db = nullptr;
+		REQUIRE(sqlite3_open(DBFILE, &db) == SQLITE_OK);
+
+		// writes to the transaction table fail while it's renamed
+		REQUIRE(sqlite3_exec(db, "ALTER TABLE transactionTable RENAME TO hiddenTable;", nullptr, nullptr,
+							 nullptr) == SQLITE_OK);
+		queue.putTransaction(TransactionEntity(getRandCMBlock(40), 1, 1, "", "first"));
+		REQUIRE(!queue.flush());
+
+		REQUIRE(sqlite3_exec(db, "ALTER TABLE hiddenTable RENAME TO transactionTable;", nullptr, nullptr,
+							 nullptr) == SQLITE_OK);
+		sqlite3_close(db);
+		queue.putTransaction(TransactionEntity(getRandCMBlock(40), 2, 2, "", "second"));
+		REQUIRE(queue.flush());
+
+		REQUIRE(dbm.getAllTransactionsCount(ISO) == 2);
+	}
+
+	SECTION("Stop commits pending writes") {
+		{
+			PersistenceQueue queue(&dbm, ISO, 500, 60000);
+			queue.putTransaction(TransactionEntity(getRandCMBlock(40), 1, 1, "", "hash"));
+		}
+
+		REQUIRE(dbm.getAllTransactionsCount(ISO) == 1);
+	}
+}
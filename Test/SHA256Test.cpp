@@ -0,0 +1,112 @@
+// Copyright (c) 2012-2018 The Elastos Open Source Project
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#define CATCH_CONFIG_MAIN
+
+#include <iostream>
+#include <boost/date_time/posix_time/posix_time.hpp>
+
+#include "catch.hpp"
+#include "Utils.h"
+#include "TestHelper.h"
+#include <Core/BRCrypto.h>
+
+using namespace Elastos::ElaWallet;
+
+static std::string sha256(const std::string &message) {
+	CMBlock md(32);
+	BRSHA256(md, message.c_str(), message.size());
+	return Utils::encodeHex(md);
+}
+
+// every subset of the supported kernels, the portable code first
+static std::vector<int> kernelSets() {
+	std::vector<int> sets;
+	int supported = BRSHA256Supported();
+	for (int kernels = 0; kernels <= supported; ++kernels) {
+		if ((kernels & supported) == kernels)
+			sets.push_back(kernels);
+	}
+	return sets;
+}
+
+TEST_CASE("SHA-256 kernels", "[SHA256]") {
+	std::vector<int> sets = kernelSets();
+	INFO("supported kernels " << BRSHA256Supported());
+
+	SECTION("Known answers") {
+		for (size_t i = 0; i < sets.size(); ++i) {
+			INFO("kernels " << sets[i]);
+			REQUIRE(BRSHA256Use(sets[i]) == sets[i]);
+
+			REQUIRE(sha256("") == "e3b0c44298fc1c149afbf4c8996fb92427ae41e4649b934ca495991b7852b855");
+			REQUIRE(sha256("abc") == "ba7816bf8f01cfea414140de5dae2223b00361a396177a9cb410ff61f20015ad");
+			REQUIRE(sha256("abcdbcdecdefdefgefghfghighijhijkijkljklmklmnlmnomnopnopq") ==
+					"248d6a61d20638b8e5c026930c3e6039a33ce45964ff2167f6ecedd419db06c1");
+			REQUIRE(sha256(std::string(1000000, 'a')) ==
+					"cdc76e5c9914fb9281a1c7e284d73e67f1809a48a497200e046d39ccc7112cd0");
+		}
+	}
+
+	SECTION("Kernels match the portable code") {
+		CMBlock data = getRandCMBlock(64 * 40);
+		std::vector<CMBlock> expected;
+
+		REQUIRE(BRSHA256Use(0) == 0);
+		for (size_t len = 0; len <= 300; ++len) {
+			CMBlock md(32);
+			BRSHA256_2(md, data, len);
+			expected.push_back(md);
+		}
+		CMBlock expectedPairs(32 * 40);
+		for (size_t i = 0; i < 40; ++i)
+			BRSHA256_2(&expectedPairs[i * 32], &data[i * 64], 64);
+
+		for (size_t i = 1; i < sets.size(); ++i) {
+			INFO("kernels " << sets[i]);
+			REQUIRE(BRSHA256Use(sets[i]) == sets[i]);
+
+			for (size_t len = 0; len <= 300; ++len) {
+				CMBlock md(32);
+				BRSHA256_2(md, data, len);
+				REQUIRE(Utils::encodeHex(md) == Utils::encodeHex(expected[len]));
+			}
+
+			// whole groups of eight and a remainder
+			for (size_t count = 0; count <= 40; count += 13) {
+				CMBlock mds(32 * count);
+				BRSHA256_2_64(mds, data, count);
+				REQUIRE(memcmp(mds, expectedPairs, mds.GetSize()) == 0);
+			}
+		}
+	}
+
+	BRSHA256Use(BRSHA256Supported());
+}
+
+TEST_CASE("SHA-256 kernels benchmark", "[.benchmark][SHA256]") {
+	const size_t pairs = 4096, rounds = 100;
+	CMBlock data = getRandCMBlock(64 * pairs), mds(32 * pairs);
+	std::vector<int> sets = kernelSets();
+
+	for (size_t i = 0; i < sets.size(); ++i) {
+		BRSHA256Use(sets[i]);
+
+		boost::posix_time::ptime start = boost::posix_time::microsec_clock::universal_time();
+		for (size_t r = 0; r < rounds; ++r)
+			BRSHA256_2_64(mds, data, pairs);
+		boost::posix_time::time_duration batched = boost::posix_time::microsec_clock::universal_time() - start;
+
+		start = boost::posix_time::microsec_clock::universal_time();
+		for (size_t r = 0; r < rounds; ++r)
+			BRSHA256(mds, data, data.GetSize());
+		boost::posix_time::time_duration stream = boost::posix_time::microsec_clock::universal_time() - start;
+
+		std::cout << "kernels " << sets[i] << ": " << batched.total_nanoseconds() / (pairs * rounds)
+				  << " ns per 64 byte double hash, " << stream.total_nanoseconds() / (pairs * rounds)
+				  << " ns per 64 bytes streamed" << std::endl;
+	}
+
+	BRSHA256Use(BRSHA256Supported());
+}
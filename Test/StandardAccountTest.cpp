@@ -4,6 +4,10 @@
 
 #define CATCH_CONFIG_MAIN
 
+#include <iostream>
+#include <boost/date_time/posix_time/posix_time.hpp>
+#include <boost/thread/thread.hpp>
+
 #include "catch.hpp"
 
 #include "Utils.h"
@@ -66,3 +70,98 @@ TEST_CASE("Derive public and private key", "[HD wallet]") {
 	}
 }
 
+
+TEST_CASE("Unlocked key session", "[Account]") {
+	std::string payPassword = "payPassword";
+	std::string mnemonic = "flat universe quantum uniform emerge blame lemon detail april sting aerobic disease";
+	StandardAccount account("Data", mnemonic, "", payPassword);
+
+	UInt512 seed = account.DeriveSeed(payPassword);
+	std::string publicKey = Utils::encodeHex(account.DeriveKey(payPassword).getPubkey());
+
+	SECTION("Session gives the same keys until it is locked") {
+		REQUIRE(!account.IsUnlocked());
+		account.Unlock(payPassword, 60);
+		REQUIRE(account.IsUnlocked());
+
+		UInt512 sessionSeed = account.DeriveSeed(payPassword);
+		REQUIRE(UInt512Eq(&seed, &sessionSeed));
+		REQUIRE(Utils::encodeHex(account.DeriveKey(payPassword).getPubkey()) == publicKey);
+		REQUIRE_THROWS(account.DeriveSeed("wrongPassword"));
+
+		account.Lock();
+		REQUIRE(!account.IsUnlocked());
+		sessionSeed = account.DeriveSeed(payPassword);
+		REQUIRE(UInt512Eq(&seed, &sessionSeed));
+		var_clean(&sessionSeed);
+	}
+
+	SECTION("Session expires") {
+		REQUIRE_THROWS(account.Unlock("wrongPassword", 60));
+		REQUIRE_THROWS(account.Unlock(payPassword, 0));
+
+		account.Unlock(payPassword, 1);
+		REQUIRE(account.IsUnlocked());
+		boost::this_thread::sleep(boost::posix_time::milliseconds(1100));
+		REQUIRE(!account.IsUnlocked());
+	}
+
+	SECTION("Concurrent unlocks leave one session") {
+		boost::thread_group threads;
+		for (int i = 0; i < 4; ++i) {
+			threads.create_thread([&account, &payPassword]() {
+				for (int n = 0; n < 5; ++n)
+					account.Unlock(payPassword, 60);
+			});
+		}
+		threads.join_all();
+		REQUIRE(account.IsUnlocked());
+
+		UInt512 sessionSeed = account.DeriveSeed(payPassword);
+		REQUIRE(UInt512Eq(&seed, &sessionSeed));
+		var_clean(&sessionSeed);
+
+		account.Lock();
+		REQUIRE(!account.IsUnlocked());
+	}
+
+	SECTION("Changing the password locks the session") {
+		account.Unlock(payPassword, 60);
+		account.ChangePassword(payPassword, "newPayPassword");
+		REQUIRE(!account.IsUnlocked());
+		REQUIRE_THROWS(account.DeriveSeed(payPassword));
+	}
+
+	var_clean(&seed);
+}
+
+TEST_CASE("Unlocked key session benchmark", "[.benchmark][Account]") {
+	const size_t count = 20;
+	std::string payPassword = "payPassword";
+	std::string mnemonic = "flat universe quantum uniform emerge blame lemon detail april sting aerobic disease";
+	StandardAccount account("Data", mnemonic, "", payPassword);
+	CMBlock message = Utils::decodeHex("0123456789abcdef0123456789abcdef0123456789abcdef0123456789abcdef");
+
+	// what HDSubAccount::DeriveMainAccountKey and a signature take
+	boost::posix_time::time_duration elapsed[2];
+	for (size_t unlocked = 0; unlocked < 2; ++unlocked) {
+		if (unlocked)
+			account.Unlock(payPassword, 60);
+
+		boost::posix_time::ptime start = boost::posix_time::microsec_clock::universal_time();
+		for (size_t i = 0; i < count; ++i) {
+			UInt512 seed = account.DeriveSeed(payPassword);
+			Key key;
+			UInt256 chainCode;
+			BRBIP32PrivKeyPath(key.getRaw(), &chainCode, &seed, sizeof(seed), 3, 44 | BIP32_HARD,
+							   0 | BIP32_HARD, 0 | BIP32_HARD);
+			var_clean(&seed);
+			REQUIRE(key.compactSign(message).GetSize() == 65);
+		}
+		elapsed[unlocked] = boost::posix_time::microsec_clock::universal_time() - start;
+	}
+	account.Lock();
+
+	std::cout << "per signature, locked: " << elapsed[0].total_microseconds() / count << " us, unlocked: "
+			  << elapsed[1].total_microseconds() / count << " us" << std::endl;
+}
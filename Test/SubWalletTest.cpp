@@ -171,6 +171,11 @@ TEST_CASE("Sub wallet basic", "[SubWallet]") {
 		std::string newAddress = subWallet->CreateAddress();
 		REQUIRE(!newAddress.empty());
 		REQUIRE(subWallet->GetBalanceWithAddress(newAddress) == 0);
+
+		nlohmann::json batchInfo = subWallet->GetBalancesWithAddresses(nlohmann::json::array({newAddress}));
+		std::vector<nlohmann::json> batchList = batchInfo["Balances"];
+		REQUIRE(batchList.size() == 1);
+		REQUIRE(batchList[0][newAddress].get<uint64_t>() == 0);
 	}
 }
 
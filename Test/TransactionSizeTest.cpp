@@ -0,0 +1,234 @@
+// Copyright (c) 2012-2018 The Elastos Open Source Project
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#define CATCH_CONFIG_MAIN
+
+#include "catch.hpp"
+#include "BRTransaction.h"
+#include "ELATransaction.h"
+#include "SDK/Transaction/Transaction.h"
+#include "SDK/Transaction/TransactionOutput.h"
+#include "Payload/PayloadCancelProducer.h"
+#include "Payload/PayloadCoinBase.h"
+#include "Payload/PayloadIssueToken.h"
+#include "Payload/PayloadRecord.h"
+#include "Payload/PayloadRegisterAsset.h"
+#include "Payload/PayloadRegisterIdentification.h"
+#include "Payload/PayloadRegisterProducer.h"
+#include "Payload/PayloadSideMining.h"
+#include "Payload/PayloadTransferAsset.h"
+#include "Payload/PayloadTransferCrossChainAsset.h"
+#include "Payload/PayloadVoteProducer.h"
+#include "Payload/PayloadWithDrawAsset.h"
+#include "TestHelper.h"
+
+using namespace Elastos::ElaWallet;
+
+static const std::string PublicKey = "02b5a2ed0c7ba89c0e1d8c2bc1e2c5cb4f3a2e41c0b5b6a1b2c3d4e5f60718293a";
+
+static IPayload *createPayload(ELATransaction::Type type) {
+	switch (type) {
+		case ELATransaction::CoinBase: {
+			CMBlock data = getRandCMBlock(40);
+			return new PayloadCoinBase(data);
+		}
+
+		case ELATransaction::RegisterAsset: {
+			PayloadRegisterAsset *payload = new PayloadRegisterAsset();
+			Asset asset;
+			asset.setName("ELA");
+			asset.setDescription("Elastos native asset");
+			asset.setPrecision(8);
+			payload->setAsset(asset);
+			payload->setAmount(rand());
+			payload->setController(getRandUInt168());
+			return payload;
+		}
+
+		case ELATransaction::TransferAsset:
+			return new PayloadTransferAsset();
+
+		case ELATransaction::Record:
+			return new PayloadRecord("record type", getRandCMBlock(100));
+
+		case ELATransaction::SideMining:
+			return new PayloadSideMining(getRandUInt256(), getRandUInt256(), rand(), getRandCMBlock(64));
+
+		case ELATransaction::IssueToken:
+			return new PayloadIssueToken(getRandCMBlock(300), getRandCMBlock(260));
+
+		case ELATransaction::WithdrawAsset: {
+			std::vector<UInt256> hashes;
+			for (size_t i = 0; i < 3; ++i)
+				hashes.push_back(getRandUInt256());
+			return new PayloadWithDrawAsset(rand(), "XQd1DCi6H62NQdWZQhJCRnrPn7sF9CTjaU", hashes);
+		}
+
+		case ELATransaction::TransferCrossChainAsset: {
+			std::vector<std::string> addresses = {"EZcvtcsT8wXSXBTeijCdSXvT2sk62yPii5",
+												  "ETjMGz4GAGxMjMaoNwhJR1ynjrEGEUDpQQ"};
+			std::vector<uint64_t> indexes = {0, 300};
+			std::vector<uint64_t> amounts = {100000000ULL, 70000ULL};
+			return new PayloadTransferCrossChainAsset(addresses, indexes, amounts);
+		}
+
+		case ELATransaction::RegisterIdentification: {
+			PayloadRegisterIdentification *payload = new PayloadRegisterIdentification();
+			payload->setId("ij8rfb6A4Ri7c5CRE1nDVdVCUMuUxkk2c6");
+			for (size_t i = 0; i < 2; ++i) {
+				PayloadRegisterIdentification::SignContent content;
+				content.Path = "kyc/person/identityCard";
+				for (size_t j = 0; j < 2; ++j) {
+					PayloadRegisterIdentification::ValueItem item;
+					item.DataHash = getRandUInt256();
+					item.Proof = "\"signature\":\"30450220499a5de3f84e7e919c26b6a8543fb12ca4f5ca2cbe\"";
+					content.Values.push_back(item);
+				}
+				payload->addContent(content);
+			}
+			payload->setSign(getRandCMBlock(64));
+			return payload;
+		}
+
+		case ELATransaction::RegisterProducer: {
+			PayloadRegisterProducer *payload = new PayloadRegisterProducer();
+			nlohmann::json j;
+			j["PublicKey"] = PublicKey;
+			j["NickName"] = "producer";
+			j["Url"] = "https://www.elastos.org";
+			j["Location"] = 86;
+			payload->fromJson(j);
+			return payload;
+		}
+
+		case ELATransaction::CancelProducer: {
+			PayloadCancelProducer *payload = new PayloadCancelProducer();
+			nlohmann::json j;
+			j["PublicKey"] = PublicKey;
+			payload->fromJson(j);
+			return payload;
+		}
+
+		case ELATransaction::VoteProducer: {
+			PayloadVoteProducer *payload = new PayloadVoteProducer();
+			nlohmann::json j;
+			j["Voter"] = "EZcvtcsT8wXSXBTeijCdSXvT2sk62yPii5";
+			j["Stake"] = 100000000ULL;
+			j["PublicKeys"] = std::vector<std::string>(3, PublicKey);
+			payload->fromJson(j);
+			return payload;
+		}
+
+		default:
+			return nullptr;
+	}
+}
+
+static void addInput(ELATransaction *tx) {
+	CMBlock script = getRandCMBlock(25);
+	BRTransactionAddInput(&tx->raw, getRandUInt256(), (uint16_t) rand(), rand(), script, script.GetSize(),
+						  nullptr, 0, rand());
+}
+
+static void addOutput(ELATransaction *tx) {
+	ELATxOutput *o = ELATxOutputNew();
+	o->assetId = getRandUInt256();
+	o->programHash = getRandUInt168();
+	o->outputLock = rand();
+	o->raw.amount = rand();
+	tx->outputs.push_back(new TransactionOutput(o));
+}
+
+static ELATransaction *createTransaction(ELATransaction::Type type, size_t count) {
+	ELATransaction *tx = ELATransactionNew();
+	tx->type = type;
+	tx->payloadVersion = rand();
+	delete tx->payload;
+	tx->payload = createPayload(type);
+	tx->raw.lockTime = rand();
+
+	for (size_t i = 0; i < count; ++i) {
+		addInput(tx);
+		addOutput(tx);
+		tx->attributes.push_back(new Attribute(Attribute::Memo, getRandCMBlock(10 + i)));
+		tx->programs.push_back(new Program(getRandCMBlock(35), getRandCMBlock(65)));
+	}
+
+	return tx;
+}
+
+static size_t serializedSize(const Transaction &txn) {
+	ByteStream stream;
+	txn.Serialize(stream);
+	return stream.getBuffer().GetSize();
+}
+
+TEST_CASE("Transaction size matches the serialized length", "[TransactionSize]") {
+	srand(time(nullptr));
+
+	const ELATransaction::Type types[] = {
+		ELATransaction::CoinBase,
+		ELATransaction::RegisterAsset,
+		ELATransaction::TransferAsset,
+		ELATransaction::Record,
+		ELATransaction::SideMining,
+		ELATransaction::IssueToken,
+		ELATransaction::WithdrawAsset,
+		ELATransaction::TransferCrossChainAsset,
+		ELATransaction::RegisterIdentification,
+		ELATransaction::RegisterProducer,
+		ELATransaction::CancelProducer,
+		ELATransaction::VoteProducer,
+	};
+
+	SECTION("Every payload type") {
+		for (size_t i = 0; i < ARRAY_SIZE(types); ++i) {
+			INFO("payload type " << (int) types[i]);
+
+			ELATransaction *tx = createTransaction(types[i], 3);
+			REQUIRE(tx->payload != nullptr);
+
+			ByteStream payloadStream;
+			tx->payload->Serialize(payloadStream);
+			REQUIRE(tx->payload->getSize() == payloadStream.getBuffer().GetSize());
+
+			Transaction txn(tx);
+			REQUIRE(txn.getSize() == serializedSize(txn));
+		}
+	}
+
+	SECTION("Empty components") {
+		for (size_t i = 0; i < ARRAY_SIZE(types); ++i) {
+			// an identification payload needs an id and contents to serialize
+			if (types[i] == ELATransaction::RegisterIdentification)
+				continue;
+
+			INFO("payload type " << (int) types[i]);
+
+			ELATransaction *tx = ELATransactionNew();
+			tx->type = types[i];
+			delete tx->payload;
+			tx->payload = ELAPayloadNew(types[i]);
+
+			Transaction txn(tx);
+			REQUIRE(txn.getSize() == serializedSize(txn));
+		}
+	}
+
+	SECTION("Size follows added inputs and outputs") {
+		ELATransaction *tx = createTransaction(ELATransaction::TransferAsset, 0);
+		Transaction txn(tx);
+
+		// past 252 inputs and outputs the count prefixes grow to three bytes
+		for (size_t i = 0; i < 260; ++i) {
+			size_t size = txn.getSize();
+
+			addInput(tx);
+			REQUIRE(txn.getSize() == size + TX_UNSIGNED_INPUT_SIZE + (i == 252 ? 2 : 0));
+
+			addOutput(tx);
+			REQUIRE(txn.getSize() == serializedSize(txn));
+		}
+	}
+}
@@ -307,4 +307,32 @@ TEST_CASE("public function test", "[Transaction]") {
 		}
 
 	}
+
+	SECTION("sign inputs across workers") {
+		Key key(getRandUInt256(), true);
+		std::string address = key.address();
+		WrapperList<Key, BRKey> keys;
+		keys.push_back(key);
+
+		// enough inputs to be split across workers on a multi-core machine
+		const size_t count = TX_SIGN_BATCH * 2 + 3;
+		Transaction tx;
+		for (size_t i = 0; i < count; ++i) {
+			BRTransactionAddInput(tx.getRaw(), getRandUInt256(), (uint16_t) i, rand(), nullptr, 0, nullptr, 0,
+								  TXIN_SEQUENCE);
+			strncpy(tx.getRaw()->inputs[i].address, address.c_str(), sizeof(tx.getRaw()->inputs[i].address) - 1);
+		}
+
+		REQUIRE(tx.sign(keys, 0));
+		REQUIRE(tx.getPrograms().size() == count);
+
+		CMBlock shaData = tx.GetShaData();
+		UInt256 md;
+		memcpy(md.u8, shaData, sizeof(md));
+		for (size_t i = 0; i < count; ++i) {
+			REQUIRE(tx.getPrograms()[i]->getParameter().GetSize() == 65);
+			REQUIRE(Key::verifyByPublicKey(Utils::encodeHex(key.getPubkey()), md,
+										   tx.getPrograms()[i]->getParameter()));
+		}
+	}
 }
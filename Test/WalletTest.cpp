@@ -5,10 +5,203 @@
 #define CATCH_CONFIG_MAIN
 #include "catch.hpp"
 #include "Wallet.h"
+#include "Utils.h"
+#include "BRArray.h"
 
 using namespace Elastos::ElaWallet;
 
+#define BASIC_UINT 100000000ULL
+
+static const std::string WalletAddress = "EZcvtcsT8wXSXBTeijCdSXvT2sk62yPii5";
+static const std::string OtherAddress = "ETjMGz4GAGxMjMaoNwhJR1ynjrEGEUDpQQ";
+
+class TestSubAccount : public ISubAccount {
+public:
+	virtual nlohmann::json GetBasicInfo() const { return nlohmann::json(); }
+
+	virtual IAccount *GetParent() { return nullptr; }
+
+	virtual void InitWallet(BRTransaction *transactions[], size_t txCount, ELAWallet *wallet) {
+		wallet->IsSingleAddress = true;
+		wallet->SingleAddress = WalletAddress;
+		wallet->Raw.WalletUpdateBalance((BRWallet *) wallet);
+	}
+
+	virtual std::string GetMainAccountPublicKey() const { return ""; }
+
+	virtual Key DeriveMainAccountKey(const std::string &payPassword) { return Key(); }
+
+	virtual void SignTransaction(const TransactionPtr &transaction, ELAWallet *wallet,
+								 const std::string &payPassword) {}
+
+	virtual void SignTransactions(const std::vector<TransactionPtr> &transactions, ELAWallet *wallet,
+								  const std::string &payPassword) {}
+};
+
+class TestWalletListener : public Wallet::Listener {
+public:
+	virtual void balanceChanged(uint64_t balance) {}
+
+	virtual void onTxAdded(const TransactionPtr &transaction) {}
+
+	virtual void onTxUpdated(const std::string &hash, uint32_t blockHeight, uint32_t timeStamp) {}
+
+	virtual void onTxDeleted(const std::string &hash, bool notifyUser, bool recommendRescan) {}
+};
+
+static void addOutput(ELATransaction *tx, const std::string &address, uint64_t amount) {
+	UInt168 programHash = UINT168_ZERO;
+	Utils::UInt168FromAddress(programHash, address);
+
+	TransactionOutput *output = new TransactionOutput();
+	output->setAddress(address);
+	output->setAmount(amount);
+	output->setProgramHash(programHash);
+	output->setAssetId(Key::getSystemAssetId());
+	tx->outputs.push_back(output);
+}
+
+static ELATransaction *newTransaction(ELATransaction::Type type, uint32_t blockHeight, const std::string &hash) {
+	ELATransaction *tx = ELATransactionNew();
+	tx->type = type;
+	tx->raw.blockHeight = blockHeight;
+	tx->raw.txHash = Utils::UInt256FromString(hash);
+	return tx;
+}
+
+// coinbase -> confirmed spend -> unconfirmed spend, the wallet owns one output of each
+static SharedWrapperList<Transaction, BRTransaction *> makeTransactions(const std::string &spendHash) {
+	SharedWrapperList<Transaction, BRTransaction *> txs;
+
+	ELATransaction *coinBase = newTransaction(ELATransaction::CoinBase, 1,
+											  "0000000000000000011111111111111111111111111111111111111111111111");
+	addOutput(coinBase, WalletAddress, 150 * BASIC_UINT);
+	txs.push_back(TransactionPtr(new Transaction(coinBase, false)));
+
+	ELATransaction *spend = newTransaction(ELATransaction::Record, 2, spendHash);
+	BRTransactionAddInput(&spend->raw, coinBase->raw.txHash, 0, 150 * BASIC_UINT, nullptr, 0, nullptr, 0,
+						  TXIN_SEQUENCE);
+	addOutput(spend, WalletAddress, 100 * BASIC_UINT);
+	addOutput(spend, OtherAddress, 50 * BASIC_UINT);
+	txs.push_back(TransactionPtr(new Transaction(spend, false)));
+
+	ELATransaction *pending = newTransaction(ELATransaction::Record, TX_UNCONFIRMED,
+											 "0000000000000000033333333333333333333333333333333333333333333333");
+	BRTransactionAddInput(&pending->raw, spend->raw.txHash, 0, 100 * BASIC_UINT, nullptr, 0, nullptr, 0,
+						  TXIN_SEQUENCE);
+	addOutput(pending, WalletAddress, 30 * BASIC_UINT);
+	addOutput(pending, OtherAddress, 70 * BASIC_UINT);
+	txs.push_back(TransactionPtr(new Transaction(pending, false)));
+
+	return txs;
+}
+
+static void checkSameState(BRWallet *a, BRWallet *b) {
+	REQUIRE(a->balance == b->balance);
+	REQUIRE(a->totalSent == b->totalSent);
+	REQUIRE(a->totalReceived == b->totalReceived);
+
+	REQUIRE(array_count(a->utxos) == array_count(b->utxos));
+	for (size_t i = 0; i < array_count(a->utxos); ++i) {
+		REQUIRE(UInt256Eq(&a->utxos[i].hash, &b->utxos[i].hash));
+		REQUIRE(a->utxos[i].n == b->utxos[i].n);
+	}
+
+	REQUIRE(array_count(a->balanceHist) == array_count(b->balanceHist));
+	for (size_t i = 0; i < array_count(a->balanceHist); ++i) {
+		REQUIRE(a->balanceHist[i] == b->balanceHist[i]);
+	}
+
+	REQUIRE(BRSetCount(a->spentOutputs) == BRSetCount(b->spentOutputs));
+	REQUIRE(BRSetCount(a->usedAddrs) == BRSetCount(b->usedAddrs));
+	REQUIRE(BRSetCount(a->invalidTx) == BRSetCount(b->invalidTx));
+	REQUIRE(BRSetCount(a->pendingTx) == BRSetCount(b->pendingTx));
+}
+
 TEST_CASE( "Wallet test", "[Wallet]" )
 {
+	const std::string spendHash = "0000000000000000022222222222222222222222222222222222222222222222";
+	SubAccountPtr subAccount(new TestSubAccount());
+	boost::shared_ptr<Wallet::Listener> listener(new TestWalletListener());
+
+	Wallet replayed(makeTransactions(spendHash), subAccount, listener);
+	CMBlock snapshot = replayed.GetSnapshot();
+	REQUIRE(snapshot.GetSize() > 0);
+
+	SECTION("Snapshot restores the confirmed transactions") {
+		Wallet restored(makeTransactions(spendHash), subAccount, listener, snapshot);
+		checkSameState(replayed.getRaw(), restored.getRaw());
+
+		REQUIRE(ELAWalletApplySnapshot((ELAWallet *) restored.getRaw(), snapshot));
+		checkSameState(replayed.getRaw(), restored.getRaw());
+	}
+
+	SECTION("Snapshot of other transactions falls back to replay") {
+		const std::string otherHash = "0000000000000000044444444444444444444444444444444444444444444444";
+		Wallet expected(makeTransactions(otherHash), subAccount, listener);
+		Wallet restored(makeTransactions(otherHash), subAccount, listener, snapshot);
+		checkSameState(expected.getRaw(), restored.getRaw());
+
+		REQUIRE(!ELAWalletApplySnapshot((ELAWallet *) restored.getRaw(), snapshot));
+		checkSameState(expected.getRaw(), restored.getRaw());
+	}
+
+	SECTION("Incremental balance matches a full replay") {
+		ELAWallet *wallet = (ELAWallet *) replayed.getRaw();
+		const BalanceEngine &engine = wallet->Balance;
+		UInt256 pendingHash = Utils::UInt256FromString(
+			"0000000000000000033333333333333333333333333333333333333333333333");
+		REQUIRE(ELAWalletVerifyBalance(wallet));
+		size_t recomputeCount = engine.getRecomputeCount();
+		size_t appliedCount = engine.getAppliedCount();
+
+		// confirming the last transaction only redoes that one
+		BRWalletUpdateTransactions(&wallet->Raw, &pendingHash, 1, 3, 1000);
+		REQUIRE(ELAWalletVerifyBalance(wallet));
+		REQUIRE(engine.getAppliedCount() == appliedCount + 1);
+		REQUIRE(wallet->Raw.balance == 30 * BASIC_UINT);
+
+		BRWalletSetTxUnconfirmedAfter(&wallet->Raw, 2);
+		REQUIRE(ELAWalletVerifyBalance(wallet));
+		REQUIRE(engine.getAppliedCount() == appliedCount + 2);
+
+		ELATransaction *older = newTransaction(ELATransaction::Record, 1,
+											   "0000000000000000055555555555555555555555555555555555555555555555");
+		addOutput(older, WalletAddress, 20 * BASIC_UINT);
+		REQUIRE(BRWalletRegisterTransaction(&wallet->Raw, &older->raw) == 1);
+		REQUIRE(ELAWalletVerifyBalance(wallet));
+
+		BRWalletRemoveTransaction(&wallet->Raw, pendingHash);
+		REQUIRE(ELAWalletVerifyBalance(wallet));
+		REQUIRE(wallet->Raw.balance == 120 * BASIC_UINT);
+		REQUIRE(engine.getRecomputeCount() == recomputeCount);
+
+		REQUIRE(replayed.GetBalanceWithAddress(WalletAddress) == 120 * BASIC_UINT);
+		REQUIRE(replayed.GetBalanceWithAddress(OtherAddress) == 0);
+		std::vector<uint64_t> balances = replayed.GetBalancesWithAddresses({OtherAddress, WalletAddress});
+		REQUIRE(balances.size() == 2);
+		REQUIRE(balances[0] == 0);
+		REQUIRE(balances[1] == 120 * BASIC_UINT);
+		REQUIRE(engine.getAddressBalances().at(WalletAddress).utxos.size() == 2);
+	}
+
+	SECTION("Input derivation paths come from the address index") {
+		ELAWallet *wallet = (ELAWallet *) replayed.getRaw();
+		pthread_mutex_lock(&wallet->Raw.lock);
+		ELAWalletAddAddressPath(wallet, WalletAddress.c_str(), AddressPath(SEQUENCE_INTERNAL_CHAIN, 7));
+		pthread_mutex_unlock(&wallet->Raw.lock);
+
+		ELATransaction *tx = newTransaction(ELATransaction::TransferAsset, TX_UNCONFIRMED, spendHash);
+		const std::string addresses[] = {WalletAddress, OtherAddress, WalletAddress};
+		for (size_t i = 0; i < 3; ++i) {
+			BRTransactionAddInput(&tx->raw, UINT256_ZERO, i, BASIC_UINT, nullptr, 0, nullptr, 0, TXIN_SEQUENCE);
+			strncpy(tx->raw.inputs[i].address, addresses[i].c_str(), sizeof(tx->raw.inputs[i].address) - 1);
+		}
 
+		std::vector<AddressPath> paths = ELAWalletGetInputPaths(wallet, &tx->raw);
+		REQUIRE(paths.size() == 1);
+		REQUIRE(paths[0].chain == SEQUENCE_INTERNAL_CHAIN);
+		REQUIRE(paths[0].index == 7);
+		ELATransactionFree(tx);
+	}
 }